@@ -0,0 +1,16 @@
+dnl
+dnl Check for the Linux io_uring interface
+dnl
+AC_CACHE_CHECK([for io_uring], [ac_cv_has_io_uring],[
+  AC_TRY_COMPILE([
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+    ],
+    [int op = IORING_OP_READ + IORING_OP_WRITE + IORING_REGISTER_PROBE + __NR_io_uring_setup;],
+    ac_cv_has_io_uring=yes,
+    ac_cv_has_io_uring=no)
+  ])
+
+if test x"$ac_cv_has_io_uring" = "xyes" ; then
+  AC_DEFINE(HAVE_IO_URING, 1, [the Linux io_uring interface is available])
+fi
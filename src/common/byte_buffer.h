@@ -34,6 +34,7 @@ public:
     , m_num_reallocs(1)
     , m_max_alloced_size(chunk_size)
   {
+    m_data->set_accounting_component(mtx::mem::component_e::parsers);
   };
 
   void trim() {
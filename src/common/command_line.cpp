@@ -21,9 +21,13 @@
 
 #include "common/command_line.h"
 #include "common/hacks.h"
+#include "common/io_uring.h"
+#include "common/mm_io_statistics.h"
 #include "common/mm_io_x.h"
+#include "common/mm_read_buffer_io.h"
 #include "common/mm_write_buffer_io.h"
 #include "common/strings/editing.h"
+#include "common/strings/parsing.h"
 #include "common/strings/utf8.h"
 #include "common/translation.h"
 #include "common/version.h"
@@ -207,10 +211,31 @@ handle_common_cli_args(std::vector<std::string> &args,
       g_gui_mode = true;
       args.erase(args.begin() + i, args.begin() + i + 1);
 
+    } else if (args[i] == "--io-uring") {
+      io_uring_c::enable(true);
+      args.erase(args.begin() + i, args.begin() + i + 1);
+
+    } else if (args[i] == "--read-ahead") {
+      if ((i + 1) == args.size())
+        mxerror(Y("'--read-ahead' lacks the number of buffers.\n"));
+
+      unsigned int num_buffers;
+      if (!parse_number(args[i + 1], num_buffers))
+        mxerror(boost::format(Y("Invalid number of buffers in '--read-ahead %1%'.\n")) % args[i + 1]);
+
+      mm_read_buffer_io_c::set_read_ahead_buffers(num_buffers);
+      args.erase(args.begin() + i, args.begin() + i + 2);
+
+    } else if (args[i] == "--io-statistics") {
+      mm_io_statistics_c::enable(true);
+      args.erase(args.begin() + i, args.begin() + i + 1);
+
     } else
       ++i;
   }
 
+  mtx::mem::set_accounting_enabled(debugging_c::requested("memory_accounting"));
+
   // First see if there's an output charset given.
   i = 0;
   while (args.size() > i) {
@@ -28,9 +28,11 @@
 
 #include "common/fs_sys_helpers.h"
 #include "common/hacks.h"
+#include "common/mm_io_statistics.h"
 #include "common/random.h"
 #include "common/stereo_mode.h"
 #include "common/strings/editing.h"
+#include "common/tracing.h"
 #include "common/translation.h"
 
 #if !defined(LIBMATROSKA_VERSION) || (LIBMATROSKA_VERSION <= 0x000801)
@@ -81,6 +83,10 @@ static std::string s_program_name;
 
 static void
 mtx_common_cleanup() {
+  mtx::mem::report_accounting();
+  mtx::trace::write();
+  mm_io_statistics_c::report();
+
   // Make sure g_mm_stdio is closed before the global destruction
   // kicks in. If it's redirected to a file then this is an instance
   // of a buffered file. If it's only collected via global destruction
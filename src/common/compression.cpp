@@ -41,6 +41,8 @@ static const int compression_method_map[] = {
   0                             // none
 };
 
+static std::unique_ptr<mtx::thread_pool_c> s_thread_pool;
+
 compressor_c::~compressor_c() {
   if (0 == items)
     return;
@@ -107,6 +109,19 @@ compressor_c::create_from_file_name(std::string const &file_name) {
   return compressor_ptr(new compressor_c(COMPRESSION_NONE));
 }
 
+void
+compressor_c::set_num_threads(unsigned int num_threads) {
+  s_thread_pool.reset();
+
+  if (num_threads)
+    s_thread_pool.reset(new mtx::thread_pool_c{num_threads});
+}
+
+mtx::thread_pool_c *
+compressor_c::get_thread_pool() {
+  return s_thread_pool.get();
+}
+
 std::string
 compressor_c::compress(std::string const &buffer) {
   auto new_buffer = compress(memory_cptr(new memory_c(const_cast<char *>(&buffer[0]), buffer.length(), false)));
@@ -18,6 +18,8 @@
 
 #include <matroska/KaxContentEncoding.h>
 
+#include "common/thread_pool.h"
+
 /* compression types */
 enum compression_method_e {
   COMPRESSION_UNSPECIFIED = 0,
@@ -81,10 +83,22 @@ public:
 
   virtual void set_track_headers(KaxContentEncoding &c_encoding);
 
+  // Whether or not compress() and decompress() may be called from
+  // several threads at the same time.
+  virtual bool is_thread_safe() const {
+    return false;
+  }
+
   static compressor_ptr create(compression_method_e method);
   static compressor_ptr create(const char *method);
   static compressor_ptr create_from_file_name(std::string const &file_name);
 
+  /* Thread-safe compressors can process several buffers in parallel
+     on a shared pool of worker threads. There's no pool if the number
+     of threads is 0 (the default). */
+  static void set_num_threads(unsigned int num_threads);
+  static mtx::thread_pool_c *get_thread_pool();
+
 protected:
   virtual memory_cptr do_compress(memory_cptr const &buffer) {
     return buffer;
@@ -40,6 +40,7 @@ content_decoder_c::content_decoder_c(KaxTrackEntry &ktentry)
 }
 
 content_decoder_c::~content_decoder_c() {
+  discard_pending();
 }
 
 bool
@@ -128,11 +129,57 @@ content_decoder_c::reverse(memory_cptr &memory,
   if (!is_ok() || encodings.empty())
     return;
 
+  if (!pending_frames.empty()) {
+    auto itr = pending_frames.find(std::make_pair(memory->get_buffer(), memory->get_size()));
+
+    if (itr != pending_frames.end()) {
+      auto result = std::move(itr->second);
+      pending_frames.erase(itr);
+      memory = result.get();
+      return;
+    }
+  }
+
   for (auto &ce : encodings)
     if (0 != (ce.scope & scope))
       memory = ce.compressor->decompress(memory);
 }
 
+void
+content_decoder_c::start_reversing(memory_cptr const &memory,
+                                   content_encoding_scope_e scope) {
+  auto thread_pool = compressor_c::get_thread_pool();
+  if (!thread_pool || !is_ok() || encodings.empty())
+    return;
+
+  auto compressors = std::vector<compressor_ptr>{};
+  for (auto &ce : encodings)
+    if (0 != (ce.scope & scope)) {
+      if (!ce.compressor->is_thread_safe())
+        return;
+      compressors.push_back(ce.compressor);
+    }
+
+  if (compressors.empty())
+    return;
+
+  pending_frames[std::make_pair(memory->get_buffer(), memory->get_size())] = thread_pool->submit([compressors, memory]() -> memory_cptr {
+    auto result = memory;
+    for (auto const &compressor : compressors)
+      result = compressor->decompress(result);
+    return result;
+  });
+}
+
+void
+content_decoder_c::discard_pending() {
+  // The jobs may still be reading the frames' buffers.
+  for (auto &frame : pending_frames)
+    frame.second.wait();
+
+  pending_frames.clear();
+}
+
 std::string
 content_decoder_c::descriptive_algorithm_list() {
   std::string list;
@@ -16,6 +16,8 @@
 
 #include "common/common_pch.h"
 
+#include <future>
+
 #include <matroska/KaxContentEncoding.h>
 #include <matroska/KaxTracks.h>
 
@@ -45,6 +47,10 @@ protected:
   std::vector<kax_content_encoding_t> encodings;
   bool ok;
 
+  // Frames whose encodings are being reversed on the compressor's
+  // thread pool, identified by their buffer and size.
+  std::map<std::pair<unsigned char const *, size_t>, std::future<memory_cptr>> pending_frames;
+
 public:
   content_decoder_c();
   content_decoder_c(KaxTrackEntry &ktentry);
@@ -52,6 +58,14 @@ public:
 
   bool initialize(KaxTrackEntry &ktentry);
   void reverse(memory_cptr &data, content_encoding_scope_e scope);
+
+  /* Starts reversing the encodings of a frame in the background if
+     the compressor thread pool exists and all involved compressors are
+     thread-safe. A later call to reverse() for a buffer with the same
+     address and size picks up the result. The frame's buffer must stay
+     valid until then or until discard_pending() is called. */
+  void start_reversing(memory_cptr const &data, content_encoding_scope_e scope);
+  void discard_pending();
   bool is_ok() {
     return ok;
   }
@@ -16,6 +16,9 @@
 
 #include "common/common_pch.h"
 
+#include <atomic>
+#include <deque>
+#include <mutex>
 #include <sstream>
 #include <unordered_map>
 
@@ -41,49 +44,53 @@ public:
   static void init();
 };
 
+/* Options are registered when they're constructed and never
+   unregistered. Evaluating them is safe on any thread: the registered
+   entries never move, and their cached state is atomic. */
 class debugging_option_c {
   struct option_c {
-    boost::tribool m_requested;
+    static int const s_unknown = -1;
+
+    std::atomic<int> m_requested;
     std::string m_option;
 
     option_c(std::string const &option)
-      : m_requested{boost::logic::indeterminate}
+      : m_requested{s_unknown}
       , m_option{option}
     {
     }
 
     bool get() {
-      if (boost::logic::indeterminate(m_requested))
-        m_requested = debugging_c::requested(m_option);
+      auto requested = m_requested.load();
+      if (s_unknown == requested) {
+        requested = debugging_c::requested(m_option) ? 1 : 0;
+        m_requested.store(requested);
+      }
 
-      return m_requested;
+      return !!requested;
     }
   };
 
 protected:
-  mutable size_t m_registered_idx;
-  std::string m_option;
-
-private:
-  static std::vector<option_c> ms_registered_options;
+  option_c *m_registered_option;
 
 public:
   debugging_option_c(std::string const &option)
-    : m_registered_idx{std::numeric_limits<size_t>::max()}
-    , m_option{option}
+    : m_registered_option{register_option(option)}
   {
   }
 
   operator bool() const {
-    if (m_registered_idx == std::numeric_limits<size_t>::max())
-      m_registered_idx = register_option(m_option);
-
-    return ms_registered_options.at(m_registered_idx).get();
+    return m_registered_option->get();
   }
 
 public:
-  static size_t register_option(std::string const &option);
   static void invalidate_cache();
+
+private:
+  static option_c *register_option(std::string const &option);
+  static std::mutex &registered_options_mutex();
+  static std::deque<option_c> &registered_options();
 };
 
 #define mxdebug(msg) debugging_c::output((boost::format("Debug> %1%:%2%: %3%") % __FILE__ % __LINE__ % (msg)).str())
@@ -14,6 +14,7 @@
 #include "common/common_pch.h"
 
 #include "common/mm_io.h"
+#include "common/mm_io_x.h"
 
 int
 skip_id3v2_tag(mm_io_c &io) {
@@ -96,6 +97,18 @@ id3v1_tag_present_at_end(mm_io_c &io) {
 
 int
 id3_tag_present_at_end(mm_io_c &io) {
+  // The end of inputs that cannot seek, e.g. pipes, is unknown.
+  io.save_pos();
+
+  try {
+    io.setFilePointer(0, seek_end);
+    io.restore_pos();
+
+  } catch (mtx::mm_io::seek_x &) {
+    io.restore_pos();
+    return 0;
+  }
+
   if (id3v1_tag_present_at_end(io))
     return 128;
   return id3v2_tag_present_at_end(io);
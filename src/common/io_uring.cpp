@@ -0,0 +1,370 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   asynchronous file I/O via io_uring
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#if defined(HAVE_IO_URING)
+# include <linux/io_uring.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <sys/uio.h>
+# include <unistd.h>
+#endif
+
+#include "common/io_uring.h"
+#include "common/mm_io.h"
+#include "common/mm_io_x.h"
+
+bool io_uring_c::s_enabled = false;
+
+void
+io_uring_c::enable(bool enable) {
+  s_enabled = enable;
+}
+
+bool
+io_uring_c::is_enabled() {
+  return s_enabled && is_available();
+}
+
+bool
+io_uring_c::is_busy(unsigned int buffer_idx)
+  const {
+  return m_busy[buffer_idx];
+}
+
+unsigned int
+io_uring_c::get_num_in_flight()
+  const {
+  return m_num_in_flight;
+}
+
+void
+io_uring_c::submit_read(int fd,
+                        unsigned int buffer_idx,
+                        size_t buffer_offset,
+                        size_t size,
+                        uint64_t file_offset) {
+#if defined(HAVE_IO_URING)
+  submit(m_buffers_registered ? IORING_OP_READ_FIXED : IORING_OP_READ, fd, buffer_idx, buffer_offset, size, file_offset);
+#else
+  submit(0, fd, buffer_idx, buffer_offset, size, file_offset);
+#endif
+}
+
+void
+io_uring_c::submit_write(int fd,
+                         unsigned int buffer_idx,
+                         size_t buffer_offset,
+                         size_t size,
+                         uint64_t file_offset) {
+#if defined(HAVE_IO_URING)
+  submit(m_buffers_registered ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE, fd, buffer_idx, buffer_offset, size, file_offset);
+#else
+  submit(0, fd, buffer_idx, buffer_offset, size, file_offset);
+#endif
+}
+
+#if defined(HAVE_IO_URING)
+
+namespace {
+
+int
+io_uring_setup(unsigned int num_entries,
+               io_uring_params *params) {
+  return syscall(__NR_io_uring_setup, num_entries, params);
+}
+
+int
+io_uring_enter(int ring_fd,
+               unsigned int to_submit,
+               unsigned int min_complete,
+               unsigned int flags) {
+  return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+int
+io_uring_register(int ring_fd,
+                  unsigned int opcode,
+                  void *arg,
+                  unsigned int num_args) {
+  return syscall(__NR_io_uring_register, ring_fd, opcode, arg, num_args);
+}
+
+template<typename T>
+T *
+ring_ptr(void *ring,
+         unsigned int offset) {
+  return reinterpret_cast<T *>(static_cast<unsigned char *>(ring) + offset);
+}
+
+}
+
+io_uring_c::io_uring_c(std::vector<memory_cptr> const &buffers)
+  : m_ring_fd{-1}
+  , m_sq_ring{MAP_FAILED}
+  , m_cq_ring{MAP_FAILED}
+  , m_sqes{MAP_FAILED}
+  , m_sq_ring_size{}
+  , m_cq_ring_size{}
+  , m_sqes_size{}
+  , m_busy(buffers.size(), false)
+  , m_num_in_flight{}
+  , m_buffers_registered{}
+  , m_debug{"io_uring"}
+{
+  for (auto const &buffer : buffers)
+    m_buffers.push_back(buffer_t{ buffer->get_buffer(), buffer->get_size() });
+
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  m_ring_fd = io_uring_setup(std::max<unsigned int>(buffers.size(), 1), &params);
+  if (0 > m_ring_fd)
+    throw mtx::mm_io::exception{mtx::mm_io::make_error_code()};
+
+  m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+  m_cq_ring_size = params.cq_off.cqes  + params.cq_entries * sizeof(io_uring_cqe);
+  m_sqes_size    = params.sq_entries   * sizeof(io_uring_sqe);
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+
+  m_sq_ring = mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+  m_cq_ring = params.features & IORING_FEAT_SINGLE_MMAP ? m_sq_ring
+            : mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+  m_sqes    = mmap(nullptr, m_sqes_size,    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES);
+
+  if ((MAP_FAILED == m_sq_ring) || (MAP_FAILED == m_cq_ring) || (MAP_FAILED == m_sqes)) {
+    auto error_code = mtx::mm_io::make_error_code();
+    destroy();
+    throw mtx::mm_io::exception{error_code};
+  }
+
+  m_sq_head  = ring_ptr<unsigned int>(m_sq_ring, params.sq_off.head);
+  m_sq_tail  = ring_ptr<unsigned int>(m_sq_ring, params.sq_off.tail);
+  m_sq_mask  = ring_ptr<unsigned int>(m_sq_ring, params.sq_off.ring_mask);
+  m_sq_array = ring_ptr<unsigned int>(m_sq_ring, params.sq_off.array);
+  m_cq_head  = ring_ptr<unsigned int>(m_cq_ring, params.cq_off.head);
+  m_cq_tail  = ring_ptr<unsigned int>(m_cq_ring, params.cq_off.tail);
+  m_cq_mask  = ring_ptr<unsigned int>(m_cq_ring, params.cq_off.ring_mask);
+  m_cqes     = ring_ptr<void>(m_cq_ring,         params.cq_off.cqes);
+
+  // Registering buffers fails if they exceed the locked memory limit
+  // on older kernels. The regular read & write operations are
+  // available since Linux 5.6, which also introduced probing.
+  std::vector<iovec> iovecs;
+  for (auto const &buffer : m_buffers)
+    iovecs.push_back(iovec{ buffer.data, buffer.size });
+
+  m_buffers_registered = 0 == io_uring_register(m_ring_fd, IORING_REGISTER_BUFFERS, iovecs.data(), iovecs.size());
+
+  if (!m_buffers_registered) {
+    auto probe_size = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+    auto probe      = memory_c::alloc(probe_size);
+    auto p          = reinterpret_cast<io_uring_probe *>(probe->get_buffer());
+
+    memset(p, 0, probe_size);
+
+    auto supported = (0 == io_uring_register(m_ring_fd, IORING_REGISTER_PROBE, p, 256))
+                  && (p->last_op >= IORING_OP_WRITE)
+                  && (p->ops[IORING_OP_READ].flags  & IO_URING_OP_SUPPORTED)
+                  && (p->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+
+    if (!supported) {
+      destroy();
+      throw mtx::mm_io::exception{std::make_error_code(std::errc::function_not_supported)};
+    }
+  }
+
+  mxdebug_if(m_debug, boost::format("io_uring: created ring with %1% buffers, registered: %2%\n") % m_buffers.size() % m_buffers_registered);
+}
+
+io_uring_c::~io_uring_c() {
+  // The kernel may still access the buffers of requests in flight.
+  try {
+    while (m_num_in_flight)
+      wait_for_completion();
+  } catch (mtx::mm_io::exception &) {
+  }
+
+  destroy();
+}
+
+void
+io_uring_c::destroy() {
+  if (MAP_FAILED != m_sqes)
+    munmap(m_sqes, m_sqes_size);
+  if ((MAP_FAILED != m_cq_ring) && (m_cq_ring != m_sq_ring))
+    munmap(m_cq_ring, m_cq_ring_size);
+  if (MAP_FAILED != m_sq_ring)
+    munmap(m_sq_ring, m_sq_ring_size);
+  if (0 <= m_ring_fd)
+    ::close(m_ring_fd);
+
+  m_sqes = m_cq_ring = m_sq_ring = MAP_FAILED;
+  m_ring_fd = -1;
+}
+
+void
+io_uring_c::submit(unsigned char opcode,
+                   int fd,
+                   unsigned int buffer_idx,
+                   size_t buffer_offset,
+                   size_t size,
+                   uint64_t file_offset) {
+  assert(!m_busy[buffer_idx] && ((buffer_offset + size) <= m_buffers[buffer_idx].size));
+
+  // There are as many entries as buffers. Therefore there's always
+  // room for another request.
+  auto tail  = __atomic_load_n(m_sq_tail, __ATOMIC_ACQUIRE);
+  auto index = tail & *m_sq_mask;
+  auto sqe   = static_cast<io_uring_sqe *>(m_sqes) + index;
+
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode    = opcode;
+  sqe->fd        = fd;
+  sqe->off       = file_offset;
+  sqe->addr      = reinterpret_cast<uint64_t>(m_buffers[buffer_idx].data + buffer_offset);
+  sqe->len       = size;
+  sqe->user_data = buffer_idx;
+  if (m_buffers_registered)
+    sqe->buf_index = buffer_idx;
+
+  m_sq_array[index] = index;
+
+  // The request is accounted for before it is published so that the
+  // buffer is never reused while the kernel may still access it.
+  m_busy[buffer_idx] = true;
+  ++m_num_in_flight;
+
+  __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+  int result;
+  while ((0 > (result = io_uring_enter(m_ring_fd, 1, 0, 0))) && (EINTR == errno))
+    ;
+
+  if (0 <= result)
+    return;
+
+  auto error = mtx::mm_io::make_error_code();
+
+  // The kernel hasn't consumed the entry if the call failed. Take it
+  // back out of the queue; otherwise it would be submitted along with
+  // the next request.
+  if (__atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) == tail) {
+    __atomic_store_n(m_sq_tail, tail, __ATOMIC_RELEASE);
+    m_busy[buffer_idx] = false;
+    --m_num_in_flight;
+  }
+
+  mxdebug_if(m_debug, boost::format("io_uring: submitting request for buffer %1% failed: %2%\n") % buffer_idx % error.message());
+
+  throw mtx::mm_io::read_write_x{error};
+}
+
+/** \brief Wait for one of the requests in flight to finish
+
+   The result is the number of bytes read or written or a negative \c
+   errno value.
+*/
+io_uring_c::completion_t
+io_uring_c::wait_for_completion() {
+  assert(m_num_in_flight);
+
+  while (true) {
+    auto head = *m_cq_head;
+
+    if (head != __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE)) {
+      auto cqe        = static_cast<io_uring_cqe *>(m_cqes) + (head & *m_cq_mask);
+      auto completion = completion_t{ static_cast<unsigned int>(cqe->user_data), cqe->res };
+
+      __atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+
+      m_busy[completion.buffer_idx] = false;
+      --m_num_in_flight;
+
+      return completion;
+    }
+
+    if ((0 > io_uring_enter(m_ring_fd, 0, 1, IORING_ENTER_GETEVENTS)) && (EINTR != errno))
+      throw mtx::mm_io::read_write_x{mtx::mm_io::make_error_code()};
+  }
+}
+
+bool
+io_uring_c::is_available() {
+  static boost::logic::tribool s_available = boost::logic::indeterminate;
+
+  if (boost::logic::indeterminate(s_available)) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    auto ring_fd = io_uring_setup(1, &params);
+    s_available  = 0 <= ring_fd;
+
+    if (0 <= ring_fd)
+      ::close(ring_fd);
+  }
+
+  return static_cast<bool>(s_available);
+}
+
+int
+io_uring_c::get_file_descriptor(mm_io_c &io) {
+  auto file_io = dynamic_cast<mm_file_io_c *>(&io);
+  return file_io ? file_io->get_file_descriptor() : -1;
+}
+
+#else  // HAVE_IO_URING
+
+io_uring_c::io_uring_c(std::vector<memory_cptr> const &)
+  : m_num_in_flight{}
+  , m_buffers_registered{}
+  , m_debug{"io_uring"}
+{
+  throw mtx::mm_io::exception{std::make_error_code(std::errc::function_not_supported)};
+}
+
+io_uring_c::~io_uring_c() {
+}
+
+void
+io_uring_c::destroy() {
+}
+
+void
+io_uring_c::submit(unsigned char,
+                   int,
+                   unsigned int,
+                   size_t,
+                   size_t,
+                   uint64_t) {
+}
+
+io_uring_c::completion_t
+io_uring_c::wait_for_completion() {
+  return completion_t{ 0, -ENOSYS };
+}
+
+bool
+io_uring_c::is_available() {
+  return false;
+}
+
+int
+io_uring_c::get_file_descriptor(mm_io_c &) {
+  return -1;
+}
+
+#endif  // HAVE_IO_URING
@@ -0,0 +1,85 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definitions for asynchronous file I/O via io_uring
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_IO_URING_H
+#define MTX_COMMON_IO_URING_H
+
+#include "common/common_pch.h"
+
+#include "common/debugging.h"
+
+class mm_io_c;
+
+/** \brief A minimal wrapper around the Linux io_uring interface
+
+   It only supports reading into and writing from a fixed set of
+   buffers at explicit file offsets. The buffers are registered with
+   the kernel if possible and used with the "fixed buffer" operations;
+   otherwise the regular read and write operations are used. Each buffer can be the target of at most
+   one request at a time; its index is used for identifying the
+   completions.
+
+   The use of io_uring is selected at run time with enable(). It is
+   only used if the kernel supports it; otherwise the callers fall
+   back to their regular, blocking I/O.
+*/
+class io_uring_c {
+public:
+  struct completion_t {
+    unsigned int buffer_idx;
+    int result;
+  };
+
+protected:
+  struct buffer_t {
+    unsigned char *data;
+    size_t size;
+  };
+
+  int m_ring_fd;
+  void *m_sq_ring, *m_cq_ring, *m_sqes;
+  size_t m_sq_ring_size, m_cq_ring_size, m_sqes_size;
+  unsigned int *m_sq_head, *m_sq_tail, *m_sq_mask, *m_sq_array;
+  unsigned int *m_cq_head, *m_cq_tail, *m_cq_mask;
+  void *m_cqes;
+  std::vector<buffer_t> m_buffers;
+  std::vector<bool> m_busy;
+  unsigned int m_num_in_flight;
+  bool m_buffers_registered;
+  debugging_option_c m_debug;
+
+  static bool s_enabled;
+
+public:
+  io_uring_c(std::vector<memory_cptr> const &buffers);
+  ~io_uring_c();
+
+  void submit_read(int fd, unsigned int buffer_idx, size_t buffer_offset, size_t size, uint64_t file_offset);
+  void submit_write(int fd, unsigned int buffer_idx, size_t buffer_offset, size_t size, uint64_t file_offset);
+  completion_t wait_for_completion();
+
+  bool is_busy(unsigned int buffer_idx) const;
+  unsigned int get_num_in_flight() const;
+
+  static void enable(bool enable);
+  static bool is_enabled();
+  static bool is_available();
+  static int get_file_descriptor(mm_io_c &io);
+
+protected:
+  void submit(unsigned char opcode, int fd, unsigned int buffer_idx, size_t buffer_offset, size_t size, uint64_t file_offset);
+  void destroy();
+};
+using io_uring_cptr = std::shared_ptr<io_uring_c>;
+
+#endif  // MTX_COMMON_IO_URING_H
@@ -14,6 +14,7 @@
 #include "common/common_pch.h"
 
 #include "common/memory.h"
+#include "common/memory_pool.h"
 #include "common/error.h"
 
 void
@@ -23,17 +24,35 @@ memory_c::resize(size_t new_size)
   if (!its_counter)
     its_counter = new counter(nullptr, 0, false);
 
-  if (its_counter->is_free) {
+  if (its_counter->is_free && its_counter->capacity) {
+    // Pooled buffers often have enough room already. Otherwise move
+    // the content to a buffer from the next larger size class.
+    auto full_size = new_size + its_counter->offset;
+
+    if (full_size > its_counter->capacity) {
+      auto old_capacity = its_counter->capacity;
+      auto tmp          = mtx::mem::pool_alloc(full_size, its_counter->capacity);
+      memcpy(tmp, its_counter->ptr, std::min(full_size, its_counter->size));
+      mtx::mem::pool_free(its_counter->ptr, old_capacity);
+      its_counter->ptr  = tmp;
+    }
+
+    its_counter->size = full_size;
+
+  } else if (its_counter->is_free) {
     its_counter->ptr  = (unsigned char *)saferealloc(its_counter->ptr, new_size + its_counter->offset);
     its_counter->size = new_size + its_counter->offset;
 
   } else {
-    auto tmp = (unsigned char *)safemalloc(new_size);
+    auto tmp = mtx::mem::pool_alloc(new_size, its_counter->capacity);
     memcpy(tmp, its_counter->ptr + its_counter->offset, std::min(new_size, its_counter->size - its_counter->offset));
     its_counter->ptr     = tmp;
     its_counter->is_free = true;
     its_counter->size    = new_size;
+    its_counter->owner.reset();
   }
+
+  update_accounting();
 }
 
 void
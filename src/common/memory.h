@@ -18,6 +18,9 @@
 
 #include <deque>
 
+#include "common/memory_accounting.h"
+#include "common/memory_pool.h"
+
 namespace mtx {
   namespace mem {
     class exception: public mtx::exception {
@@ -88,13 +91,17 @@ public:
                     bool f = false) // allocate a new counter
     : its_counter(nullptr)
   {
-    if (p)
+    if (p) {
       its_counter = new counter(static_cast<unsigned char *>(p), s, f);
+      update_accounting();
+    }
   }
 
   explicit memory_c(size_t s)
-    : its_counter(new counter(static_cast<unsigned char *>(safemalloc(s)), s, true))
+    : its_counter(new counter(nullptr, s, true))
   {
+    its_counter->ptr = mtx::mem::pool_alloc(s, its_counter->capacity);
+    update_accounting();
   }
 
   ~memory_c() {
@@ -149,18 +156,44 @@ public:
   }
 
   void grab() {
-    if (!its_counter || its_counter->is_free)
+    // A view keeps the memory it points to alive itself. It does not
+    // have to be copied in order to outlive its creator.
+    if (!its_counter || its_counter->is_free || its_counter->owner)
       return;
 
-    its_counter->ptr      = static_cast<unsigned char *>(safememdup(get_buffer(), get_size()));
+    auto size             = get_size();
+    auto copy             = mtx::mem::pool_alloc(size, its_counter->capacity);
+    ::memcpy(copy, get_buffer(), size);
+
+    its_counter->ptr      = copy;
     its_counter->is_free  = true;
     its_counter->size    -= its_counter->offset;
     its_counter->offset   = 0;
+    its_counter->owner.reset();
+
+    update_accounting();
   }
 
   void lock() {
-    if (its_counter)
-      its_counter->is_free = false;
+    if (!its_counter)
+      return;
+
+    its_counter->is_free = false;
+    update_accounting();
+  }
+
+  // Attribute the buffer to a different component from now on, e.g.
+  // once data read by a reader has been queued as a packet.
+  void set_accounting_component(mtx::mem::component_e component) {
+    if (!its_counter || (its_counter->component == component))
+      return;
+
+    if (its_counter->accounted) {
+      mtx::mem::account(its_counter->component, -static_cast<int64_t>(its_counter->accounted));
+      mtx::mem::account(component,               its_counter->accounted);
+    }
+
+    its_counter->component = component;
   }
 
   void resize(size_t new_size) throw();
@@ -198,13 +231,18 @@ public:
 public:
   static memory_cptr
   alloc(size_t size) {
-    return memory_cptr(new memory_c(static_cast<unsigned char *>(safemalloc(size)), size, true));
+    return std::make_shared<memory_c>(size);
   };
 
   static inline memory_cptr
   clone(const void *buffer,
         size_t size) {
-    return memory_cptr(new memory_c(static_cast<unsigned char *>(safememdup(buffer, size)), size, true));
+    if (!buffer)
+      return std::make_shared<memory_c>();
+
+    auto mem = std::make_shared<memory_c>(size);
+    ::memcpy(mem->get_buffer(), buffer, size);
+    return mem;
   }
 
   static inline memory_cptr
@@ -217,6 +255,17 @@ public:
     return std::make_shared<memory_c>(reinterpret_cast<unsigned char *>(&buffer[0]), buffer.length(), false);
   }
 
+  // Points to memory owned by someone else, e.g. a memory-mapped
+  // file. \c owner is kept alive as long as the buffer is in use.
+  static inline memory_cptr
+  view(void *buffer,
+       size_t size,
+       std::shared_ptr<void> const &owner) {
+    auto mem                = std::make_shared<memory_c>(buffer, size, false);
+    mem->its_counter->owner = owner;
+    return mem;
+  }
+
 private:
   struct counter {
     unsigned char *ptr;
@@ -224,6 +273,10 @@ private:
     bool is_free;
     unsigned count;
     size_t offset;
+    size_t capacity;            // != 0 if ptr was allocated from the buffer pool
+    size_t accounted;           // bytes reported to the memory accounting
+    mtx::mem::component_e component;
+    std::shared_ptr<void> owner;
 
     counter(unsigned char *p = nullptr,
             size_t s = 0,
@@ -234,7 +287,19 @@ private:
       , is_free(f)
       , count(c)
       , offset(0)
+      , capacity(0)
+      , accounted(0)
+      , component(mtx::mem::get_current_component())
     { }
+
+    static void *operator new(size_t size) {
+      return mtx::mem::object_pool_c<counter>::allocate(size);
+    }
+
+    static void operator delete(void *p,
+                                size_t size) {
+      mtx::mem::object_pool_c<counter>::deallocate(p, size);
+    }
   } *its_counter;
 
   void acquire(counter *c) throw() { // increment the count
@@ -247,12 +312,24 @@ private:
     if (its_counter) {
       if (--its_counter->count == 0) {
         if (its_counter->is_free)
-          free(its_counter->ptr);
+          mtx::mem::pool_free(its_counter->ptr, its_counter->capacity);
+        if (its_counter->accounted)
+          mtx::mem::account(its_counter->component, -static_cast<int64_t>(its_counter->accounted));
         delete its_counter;
       }
       its_counter = 0;
     }
   }
+
+  void update_accounting() {
+    if (!its_counter || (!its_counter->accounted && !mtx::mem::is_accounting_enabled()))
+      return;
+
+    auto owned = !its_counter->is_free ? 0 : its_counter->capacity ? its_counter->capacity : its_counter->size;
+
+    mtx::mem::account(its_counter->component, static_cast<int64_t>(owned) - static_cast<int64_t>(its_counter->accounted));
+    its_counter->accounted = owned;
+  }
 };
 
 class memory_slice_cursor_c {
@@ -0,0 +1,140 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   accounting of allocated memory by component
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <atomic>
+
+#include "common/memory_accounting.h"
+#include "common/mm_io.h"
+#include "common/strings/formatting.h"
+
+namespace mtx { namespace mem {
+
+namespace {
+
+auto const s_num_components = static_cast<unsigned int>(component_e::max);
+
+struct usage_t {
+  std::atomic<int64_t> current, peak;
+};
+
+bool s_accounting_enabled = false;
+usage_t s_usage[s_num_components];
+usage_t s_total_usage;
+
+thread_local component_e tl_current_component = component_e::other;
+
+void
+add_to(usage_t &usage,
+       int64_t num_bytes) {
+  auto current = (usage.current += num_bytes);
+  auto peak    = usage.peak.load();
+
+  while ((current > peak) && !usage.peak.compare_exchange_weak(peak, current))
+    ;
+}
+
+}
+
+void
+set_accounting_enabled(bool enabled) {
+  s_accounting_enabled = enabled;
+}
+
+bool
+is_accounting_enabled() {
+  return s_accounting_enabled;
+}
+
+void
+account(component_e component,
+        int64_t num_bytes) {
+  if (!num_bytes)
+    return;
+
+  add_to(s_usage[static_cast<unsigned int>(component)], num_bytes);
+  add_to(s_total_usage, num_bytes);
+}
+
+int64_t
+get_accounted_bytes(component_e component) {
+  return s_usage[static_cast<unsigned int>(component)].current;
+}
+
+int64_t
+get_peak_accounted_bytes(component_e component) {
+  return s_usage[static_cast<unsigned int>(component)].peak;
+}
+
+component_e
+get_current_component() {
+  return tl_current_component;
+}
+
+char const *
+get_component_name(component_e component) {
+  static char const *s_names[] = {
+    "other",
+    "I/O buffers",
+    "readers",
+    "parsers",
+    "packets",
+    "cues",
+    "attachments",
+  };
+
+  return s_names[static_cast<unsigned int>(component)];
+}
+
+/** \brief Output the peak and current usage of all components to the
+    standard error
+
+   The total peak is the highest sum of all components at any point in
+   time, not the sum of the components' peaks.
+*/
+void
+report_accounting() {
+  if (!s_accounting_enabled)
+    return;
+
+  auto report = std::string{Y("Memory usage by component:\n")};
+  auto line   = [&report](std::string const &name, usage_t const &usage) {
+    report += (boost::format("  %|1$-12s| %|2$12s| %|3$12s|\n") % name % format_file_size(usage.peak) % format_file_size(usage.current)).str();
+  };
+
+  report += (boost::format("  %|1$-12s| %|2$12s| %|3$12s|\n") % Y("component") % Y("peak") % Y("current")).str();
+
+  for (auto idx = 0u; idx < s_num_components; ++idx)
+    line(get_component_name(static_cast<component_e>(idx)), s_usage[idx]);
+
+  line(Y("total"), s_total_usage);
+
+  // The standard output may carry e.g. the JSON identification
+  // result which must not be mixed with the report.
+  mm_stdio_c err{true};
+  err.puts(report);
+  err.flush();
+}
+
+component_scope_c::component_scope_c(component_e component)
+  : m_previous{tl_current_component}
+{
+  tl_current_component = component;
+}
+
+component_scope_c::~component_scope_c() {
+  tl_current_component = m_previous;
+}
+
+}}
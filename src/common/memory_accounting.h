@@ -0,0 +1,65 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   accounting of allocated memory by component
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MEMORY_ACCOUNTING_H
+#define MTX_COMMON_MEMORY_ACCOUNTING_H
+
+#include "common/common_pch.h"
+
+namespace mtx { namespace mem {
+
+/* Buffers owned by memory_c instances are attributed to the component
+   that was active on the allocating thread when they were created
+   (see component_scope_c). Code can move a buffer to a different
+   component later, e.g. once a packet is queued, and can report
+   memory held in other data structures with account().
+
+   Accounting is disabled by default and enabled with the debugging
+   option 'memory_accounting'. The peak and current number of bytes
+   per component are output when the program exits. */
+
+enum class component_e {
+  other = 0,
+  io_buffers,
+  readers,
+  parsers,
+  packets,
+  cues,
+  attachments,
+  max
+};
+
+void set_accounting_enabled(bool enabled);
+bool is_accounting_enabled();
+
+void account(component_e component, int64_t num_bytes);
+int64_t get_accounted_bytes(component_e component);
+int64_t get_peak_accounted_bytes(component_e component);
+
+component_e get_current_component();
+char const *get_component_name(component_e component);
+
+void report_accounting();
+
+class component_scope_c {
+protected:
+  component_e m_previous;
+
+public:
+  component_scope_c(component_e component);
+  ~component_scope_c();
+};
+
+}}
+
+#endif  // MTX_COMMON_MEMORY_ACCOUNTING_H
@@ -0,0 +1,133 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   buffer and object pools
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/memory.h"
+#include "common/memory_pool.h"
+
+namespace mtx { namespace mem {
+
+namespace {
+
+// Buffers are pooled in size classes that are powers of two from 64
+// bytes up to 1 MB. Larger buffers are allocated with malloc()
+// directly.
+unsigned int const s_min_class_shift      = 6;
+unsigned int const s_num_classes          = 15;
+size_t const s_max_cached_bytes_per_class = 1024 * 1024;
+
+bool s_pooling_enabled                    = true;
+
+struct buffer_cache_t {
+  std::vector<unsigned char *> m_buffers[s_num_classes];
+
+  ~buffer_cache_t();
+};
+
+thread_local bool tl_buffer_cache_destroyed = false;
+
+buffer_cache_t::~buffer_cache_t() {
+  tl_buffer_cache_destroyed = true;
+
+  for (auto &buffers : m_buffers)
+    for (auto buffer : buffers)
+      free(buffer);
+}
+
+buffer_cache_t &
+buffer_cache() {
+  static thread_local buffer_cache_t s_cache;
+  return s_cache;
+}
+
+int
+size_class_for(size_t size) {
+  auto class_size = size_t{1} << s_min_class_shift;
+
+  for (auto idx = 0u; idx < s_num_classes; ++idx, class_size <<= 1)
+    if (size <= class_size)
+      return idx;
+
+  return -1;
+}
+
+size_t
+max_cached_for(unsigned int size_class) {
+  return std::max<size_t>(s_max_cached_bytes_per_class >> (s_min_class_shift + size_class), 2);
+}
+
+}
+
+void
+set_pooling_enabled(bool enabled) {
+  s_pooling_enabled = enabled;
+}
+
+bool
+is_pooling_enabled() {
+  return s_pooling_enabled;
+}
+
+/** \brief Allocate a buffer of at least \c size bytes
+
+   \c capacity is set to the number of bytes actually allocated if the
+   buffer can be returned to the pool with pool_free() and to 0
+   otherwise.
+*/
+unsigned char *
+pool_alloc(size_t size,
+           size_t &capacity) {
+  auto size_class = s_pooling_enabled && !tl_buffer_cache_destroyed ? size_class_for(size) : -1;
+
+  if (-1 == size_class) {
+    capacity = 0;
+    return safemalloc(size);
+  }
+
+  capacity      = size_t{1} << (s_min_class_shift + size_class);
+  auto &buffers = buffer_cache().m_buffers[size_class];
+
+  if (buffers.empty())
+    return safemalloc(capacity);
+
+  auto buffer = buffers.back();
+  buffers.pop_back();
+
+  return buffer;
+}
+
+void
+pool_free(unsigned char *buffer,
+          size_t capacity) {
+  if (!buffer)
+    return;
+
+  auto size_class = capacity && s_pooling_enabled && !tl_buffer_cache_destroyed ? size_class_for(capacity) : -1;
+
+  if (-1 == size_class) {
+    free(buffer);
+    return;
+  }
+
+  auto &buffers = buffer_cache().m_buffers[size_class];
+
+  if (buffers.size() >= max_cached_for(size_class)) {
+    free(buffer);
+    return;
+  }
+
+  buffers.push_back(buffer);
+}
+
+}}
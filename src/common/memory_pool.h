@@ -0,0 +1,96 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   buffer and object pools
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MEMORY_POOL_H
+#define MTX_COMMON_MEMORY_POOL_H
+
+#include "common/common_pch.h"
+
+namespace mtx { namespace mem {
+
+/* Each thread keeps a limited number of released buffers and objects
+   around for re-use. All of them are regular malloc()ed memory
+   blocks; therefore they can be released with free() or passed to
+   realloc() by code that doesn't know about the pools. */
+
+void set_pooling_enabled(bool enabled);
+bool is_pooling_enabled();
+
+unsigned char *pool_alloc(size_t size, size_t &capacity);
+void pool_free(unsigned char *buffer, size_t capacity);
+
+template<typename T>
+class object_pool_c {
+protected:
+  static size_t const s_max_cached = 4096;
+
+  struct cache_t {
+    std::vector<void *> m_objects;
+
+    ~cache_t() {
+      destroyed() = true;
+      for (auto object : m_objects)
+        ::operator delete(object);
+    }
+  };
+
+  static cache_t &cache() {
+    static thread_local cache_t s_cache;
+    return s_cache;
+  }
+
+  // Objects released during the thread's or the program's shutdown
+  // after the cache has been destroyed are freed right away.
+  static bool &destroyed() {
+    static thread_local bool s_destroyed = false;
+    return s_destroyed;
+  }
+
+public:
+  static void *allocate(size_t size) {
+    if ((sizeof(T) != size) || destroyed() || !is_pooling_enabled())
+      return ::operator new(size);
+
+    auto &objects = cache().m_objects;
+    if (objects.empty())
+      return ::operator new(size);
+
+    auto object = objects.back();
+    objects.pop_back();
+
+    return object;
+  }
+
+  static void deallocate(void *object,
+                         size_t size) {
+    if (!object)
+      return;
+
+    if ((sizeof(T) != size) || destroyed() || !is_pooling_enabled()) {
+      ::operator delete(object);
+      return;
+    }
+
+    auto &objects = cache().m_objects;
+    if (objects.size() >= s_max_cached) {
+      ::operator delete(object);
+      return;
+    }
+
+    objects.push_back(object);
+  }
+};
+
+}}
+
+#endif  // MTX_COMMON_MEMORY_POOL_H
@@ -0,0 +1,101 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class for files that are still growing
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <chrono>
+#include <thread>
+
+#include "common/fs_sys_helpers.h"
+#include "common/mm_follow_io.h"
+
+static auto const s_poll_interval = std::chrono::milliseconds{100};
+
+mm_follow_io_c::mm_follow_io_c(mm_io_c *in,
+                               int64_t idle_timeout,
+                               bool delete_in)
+  : mm_proxy_io_c{in, delete_in}
+  , m_idle_timeout{idle_timeout}
+  , m_following{}
+  , m_timed_out{}
+  , m_debug{"follow_io"}
+{
+}
+
+mm_follow_io_c::~mm_follow_io_c() {
+}
+
+bool
+mm_follow_io_c::eof() {
+  return is_following() ? false : m_proxy_io->eof();
+}
+
+/** \brief Return the file's current size
+
+   The size isn't cached while following as the file keeps growing.
+*/
+int64_t
+mm_follow_io_c::get_size() {
+  if (!is_following())
+    return m_proxy_io->get_size();
+
+  auto position = m_proxy_io->getFilePointer();
+  m_proxy_io->setFilePointer(0, seek_end);
+  auto size     = static_cast<int64_t>(m_proxy_io->getFilePointer());
+  m_proxy_io->setFilePointer(position);
+
+  return size;
+}
+
+void
+mm_follow_io_c::enable_following(bool enable) {
+  m_following = enable;
+}
+
+bool
+mm_follow_io_c::is_following()
+  const {
+  return m_following && !m_timed_out;
+}
+
+uint32
+mm_follow_io_c::_read(void *buffer,
+                      size_t size) {
+  auto destination = static_cast<unsigned char *>(buffer);
+  auto num_read    = static_cast<size_t>(m_proxy_io->read(destination, size));
+
+  if (!is_following())
+    return num_read;
+
+  auto idle_since = mtx::sys::get_current_time_millis();
+
+  while (num_read < size) {
+    if ((mtx::sys::get_current_time_millis() - idle_since) >= m_idle_timeout) {
+      mxdebug_if(m_debug, boost::format("follow_io: no new data for %1% ms in %2% at position %3%; assuming the file is complete\n") % m_idle_timeout % get_file_name() % getFilePointer());
+      m_timed_out = true;
+      break;
+    }
+
+    std::this_thread::sleep_for(s_poll_interval);
+
+    m_proxy_io->clear_eof();
+    auto num_new = m_proxy_io->read(destination + num_read, size - num_read);
+
+    if (num_new) {
+      num_read   += num_new;
+      idle_since  = mtx::sys::get_current_time_millis();
+    }
+  }
+
+  return num_read;
+}
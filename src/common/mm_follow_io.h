@@ -0,0 +1,52 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class for files that are still growing
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MM_FOLLOW_IO_H
+#define MTX_COMMON_MM_FOLLOW_IO_H
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+
+/* Reads from a file that another program is still writing to, e.g. a
+   recording in progress. Once following has been enabled a read
+   reaching the end of the file waits for more data instead of
+   returning less than requested. The file is considered to be
+   complete once no new data has arrived for the idle timeout. From
+   then on reads behave like regular reads again.
+
+   Following is off initially so that probing the file type doesn't
+   wait at the end of short files. */
+class mm_follow_io_c: public mm_proxy_io_c {
+protected:
+  int64_t m_idle_timeout;       // milliseconds
+  bool m_following, m_timed_out;
+  debugging_option_c m_debug;
+
+public:
+  mm_follow_io_c(mm_io_c *in, int64_t idle_timeout, bool delete_in = true);
+  virtual ~mm_follow_io_c();
+
+  virtual bool eof();
+  virtual int64_t get_size();
+
+  void enable_following(bool enable = true);
+  bool is_following() const;
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size);
+};
+
+using mm_follow_io_cptr = std::shared_ptr<mm_follow_io_c>;
+
+#endif  // MTX_COMMON_MM_FOLLOW_IO_H
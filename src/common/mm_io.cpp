@@ -14,6 +14,7 @@
 
 #include "common/common_pch.h"
 
+#include <chrono>
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -22,11 +23,17 @@
 #endif
 #include <sys/stat.h>
 #include <sys/types.h>
+#if defined(SYS_LINUX)
+# include <fcntl.h>
+# include <linux/falloc.h>
+# include <sys/syscall.h>
+#endif
 
 #include "common/endian.h"
 #include "common/error.h"
 #include "common/fs_sys_helpers.h"
 #include "common/mm_io.h"
+#include "common/mm_io_statistics.h"
 #include "common/mm_io_x.h"
 #include "common/strings/editing.h"
 #include "common/strings/parsing.h"
@@ -73,11 +80,15 @@ mm_file_io_c::mm_file_io_c(const std::string &path,
 
   if (!m_file)
     throw mtx::mm_io::open_x{mtx::mm_io::make_error_code()};
+
+  m_statistics = mm_io_statistics_c::create(path);
 }
 
 void
 mm_file_io_c::setFilePointer(int64 offset,
                              seek_mode mode) {
+  auto previous_position = m_current_position;
+
   int whence = mode == seek_beginning ? SEEK_SET
              : mode == seek_end       ? SEEK_END
              :                          SEEK_CUR;
@@ -86,6 +97,9 @@ mm_file_io_c::setFilePointer(int64 offset,
     throw mtx::mm_io::seek_x{mtx::mm_io::make_error_code()};
 
   m_current_position = ftello((FILE *)m_file);
+
+  if (m_statistics)
+    m_statistics->add_seek(previous_position, m_current_position);
 }
 
 size_t
@@ -98,16 +112,23 @@ mm_file_io_c::_write(const void *buffer,
   m_current_position += bwritten;
   m_cached_size       = -1;
 
+  if (m_statistics)
+    m_statistics->add_write(bwritten);
+
   return bwritten;
 }
 
 uint32
 mm_file_io_c::_read(void *buffer,
                     size_t size) {
+  auto start    = m_statistics ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
   int64_t bread = fread(buffer, 1, size, (FILE *)m_file);
 
   m_current_position += bread;
 
+  if (m_statistics)
+    m_statistics->add_read(bread, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
   return bread;
 }
 
@@ -135,6 +156,94 @@ mm_file_io_c::truncate(int64_t pos) {
   return ftruncate(fileno((FILE *)m_file), pos);
 }
 
+void
+mm_file_io_c::flush() {
+  fflush((FILE *)m_file);
+}
+
+int
+mm_file_io_c::get_file_descriptor()
+  const {
+  return fileno((FILE *)m_file);
+}
+
+/** \brief Make room in the middle of the file
+
+   Linux can insert whole file system blocks into a file without
+   moving any data if the file system supports it (e.g. ext4 and
+   XFS). Otherwise the data is copied inside the kernel with
+   copy_file_range(), which may also share the blocks instead of
+   copying them. Chunks are moved from back to front and are never
+   larger than \c size so that source and destination don't overlap.
+*/
+bool
+mm_file_io_c::insert_space(uint64_t offset,
+                           uint64_t size) {
+#if defined(SYS_LINUX)
+  fflush((FILE *)m_file);
+
+  auto fd = fileno((FILE *)m_file);
+
+  struct stat st;
+  if ((0 != fstat(fd, &st)) || (static_cast<uint64_t>(st.st_size) <= offset) || !size)
+    return false;
+
+# if defined(FALLOC_FL_INSERT_RANGE)
+  if (0 == fallocate(fd, FALLOC_FL_INSERT_RANGE, offset, size)) {
+    m_cached_size = -1;
+    return true;
+  }
+# endif
+
+# if defined(__NR_copy_file_range)
+  auto file_size = static_cast<uint64_t>(st.st_size);
+  auto to_move   = file_size - offset;
+  auto chunk     = std::min<uint64_t>(size, 1024 * 1024);
+  auto moved     = uint64_t{};
+
+  if (0 != ftruncate(fd, file_size + size))
+    return false;
+
+  m_cached_size = -1;
+
+  while (moved < to_move) {
+    auto to_copy = std::min(chunk, to_move - moved);
+    loff_t src   = offset + to_move - moved - to_copy;
+    loff_t dst   = src + size;
+    auto copied  = uint64_t{};
+
+    while (copied < to_copy) {
+      auto result = syscall(__NR_copy_file_range, fd, &src, fd, &dst, to_copy - copied, 0);
+
+      if (0 < result) {
+        copied += result;
+        continue;
+      }
+
+      // Not supported at all for this file: let the caller copy.
+      if (!moved && !copied && (0 == ftruncate(fd, file_size)))
+        return false;
+
+      throw mtx::mm_io::read_write_x{mtx::mm_io::make_error_code()};
+    }
+
+    moved += to_copy;
+  }
+
+  return true;
+
+# else
+  return false;
+# endif
+
+#else
+  (void)offset;
+  (void)size;
+
+  return false;
+#endif
+}
+
 /** \brief OS and kernel dependant setup
 */
 void
@@ -1081,7 +1190,9 @@ mm_text_io_c::setFilePointer(int64 offset,
    Class for reading from stdin & writing to stdout.
 */
 
-mm_stdio_c::mm_stdio_c() {
+mm_stdio_c::mm_stdio_c(bool use_stderr)
+  : m_use_stderr{use_stderr}
+{
 }
 
 uint64
@@ -1094,19 +1205,19 @@ mm_stdio_c::setFilePointer(int64,
                            seek_mode) {
 }
 
+#if !defined(SYS_WINDOWS)
 uint32
 mm_stdio_c::_read(void *buffer,
                   size_t size) {
   return fread(buffer, 1, size, stdin);
 }
 
-#if !defined(SYS_WINDOWS)
 size_t
 mm_stdio_c::_write(const void *buffer,
                    size_t size) {
   m_cached_size = -1;
 
-  return fwrite(buffer, 1, size, stdout);
+  return fwrite(buffer, 1, size, m_use_stderr ? stderr : stdout);
 }
 #endif // defined(SYS_WINDOWS)
 
@@ -1116,5 +1227,5 @@ mm_stdio_c::close() {
 
 void
 mm_stdio_c::flush() {
-  fflush(stdout);
+  fflush(m_use_stderr ? stderr : stdout);
 }
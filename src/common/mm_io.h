@@ -28,6 +28,9 @@ using mm_io_cptr = std::shared_ptr<mm_io_c>;
 class charset_converter_c;
 using charset_converter_cptr = std::shared_ptr<charset_converter_c>;
 
+class mm_io_statistics_c;
+using mm_io_statistics_cptr = std::shared_ptr<mm_io_statistics_c>;
+
 class mm_io_c: public IOCallback {
 protected:
   bool m_dos_style_newlines, m_bom_written;
@@ -83,6 +86,12 @@ public:
   virtual int truncate(int64_t) {
     return 0;
   }
+  // Moves everything from offset to the end of the file towards the
+  // end by size bytes without passing it through user space. Returns
+  // false without changing anything if that isn't supported.
+  virtual bool insert_space(uint64_t, uint64_t) {
+    return false;
+  }
 
   virtual std::string get_file_name() const = 0;
 
@@ -123,6 +132,7 @@ class mm_file_io_c: public mm_io_c {
 protected:
   std::string m_file_name;
   void *m_file;
+  mm_io_statistics_cptr m_statistics;
 
 #if defined(SYS_WINDOWS)
   bool m_eof;
@@ -138,6 +148,10 @@ public:
   virtual uint64 getFilePointer();
 #if defined(SYS_WINDOWS)
   virtual uint64 get_real_file_pointer();
+#else
+  virtual void flush();
+  virtual int get_file_descriptor() const;
+  virtual bool insert_space(uint64_t offset, uint64_t size);
 #endif
   virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
   virtual void close();
@@ -150,6 +164,10 @@ public:
 
   virtual int truncate(int64_t pos);
 
+  mm_io_statistics_cptr get_statistics() const {
+    return m_statistics;
+  }
+
   static void setup();
   static void cleanup();
   static mm_io_cptr open(const std::string &path, const open_mode mode = MODE_READ);
@@ -192,6 +210,9 @@ public:
   virtual std::string get_file_name() const {
     return m_proxy_io->get_file_name();
   }
+  virtual bool insert_space(uint64_t offset, uint64_t size) {
+    return m_proxy_io->insert_space(offset, size);
+  }
   virtual mm_io_c *get_proxied() const {
     return m_proxy_io;
   }
@@ -295,8 +316,11 @@ public:
 using mm_text_io_cptr = std::shared_ptr<mm_text_io_c>;
 
 class mm_stdio_c: public mm_io_c {
+protected:
+  bool m_use_stderr;
+
 public:
-  mm_stdio_c();
+  mm_stdio_c(bool use_stderr = false);
 
   virtual uint64 getFilePointer();
   virtual void setFilePointer(int64 offset, seek_mode mode=seek_beginning);
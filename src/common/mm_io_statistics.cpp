@@ -0,0 +1,214 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   statistics about the I/O operations on files
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <mutex>
+
+#include "common/mm_io.h"
+#include "common/mm_io_statistics.h"
+#include "common/strings/editing.h"
+
+namespace {
+
+std::mutex s_mutex;
+std::vector<mm_io_statistics_cptr> s_statistics;
+
+std::vector<std::string> const s_size_labels{ "<= 512", "<= 4K", "<= 32K", "<= 256K", "<= 1M", "> 1M" };
+std::vector<std::string> const s_latency_labels{ "<= 10us", "<= 100us", "<= 1ms", "<= 10ms", "<= 100ms", "> 100ms" };
+std::vector<std::string> const s_seek_distance_labels{ "<= 4K", "<= 64K", "<= 1M", "<= 16M", "<= 256M", "> 256M" };
+
+}
+
+bool mm_io_statistics_c::ms_enabled = false;
+
+mm_io_statistics_c::histogram_c::histogram_c(std::vector<uint64_t> const &limits)
+  : m_limits(limits)
+  , m_counts(limits.size() + 1, 0)
+{
+}
+
+void
+mm_io_statistics_c::histogram_c::add(uint64_t value) {
+  auto bucket = 0u;
+  while ((bucket < m_limits.size()) && (value > m_limits[bucket]))
+    ++bucket;
+
+  ++m_counts[bucket];
+}
+
+void
+mm_io_statistics_c::histogram_c::merge(histogram_c const &other) {
+  for (auto idx = 0u; idx < m_counts.size(); ++idx)
+    m_counts[idx] += other.m_counts[idx];
+}
+
+uint64_t
+mm_io_statistics_c::histogram_c::get_count(unsigned int bucket)
+  const {
+  return m_counts[bucket];
+}
+
+std::string
+mm_io_statistics_c::histogram_c::format(std::vector<std::string> const &labels)
+  const {
+  auto buckets = std::vector<std::string>{};
+
+  for (auto idx = 0u; idx < m_counts.size(); ++idx)
+    buckets.push_back((boost::format("%1%: %2%") % labels[idx] % m_counts[idx]).str());
+
+  return join(", ", buckets);
+}
+
+mm_io_statistics_c::mm_io_statistics_c(std::string const &file_name)
+  : m_file_name{file_name}
+  , m_bytes_read{}
+  , m_bytes_written{}
+  , m_num_reads{}
+  , m_num_writes{}
+  , m_num_seeks{}
+  , m_num_moving_seeks{}
+  , m_seek_distance{}
+  , m_read_sizes{{ 512, 4 * 1024, 32 * 1024, 256 * 1024, 1024 * 1024 }}
+  , m_read_latencies{{ 10000, 100000, 1000000, 10000000, 100000000 }}
+  , m_seek_distances{{ 4 * 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024, 256 * 1024 * 1024 }}
+{
+}
+
+void
+mm_io_statistics_c::add_read(size_t size,
+                             int64_t duration_ns) {
+  m_bytes_read += size;
+  ++m_num_reads;
+
+  m_read_sizes.add(size);
+  m_read_latencies.add(std::max<int64_t>(duration_ns, 0));
+}
+
+void
+mm_io_statistics_c::add_write(size_t size) {
+  m_bytes_written += size;
+  ++m_num_writes;
+}
+
+void
+mm_io_statistics_c::add_seek(uint64_t from,
+                             uint64_t to) {
+  ++m_num_seeks;
+
+  if (from == to)
+    return;
+
+  auto distance    = from < to ? to - from : from - to;
+  m_seek_distance += distance;
+  ++m_num_moving_seeks;
+
+  m_seek_distances.add(distance);
+}
+
+void
+mm_io_statistics_c::merge(mm_io_statistics_c const &other) {
+  m_bytes_read       += other.m_bytes_read;
+  m_bytes_written    += other.m_bytes_written;
+  m_num_reads        += other.m_num_reads;
+  m_num_writes       += other.m_num_writes;
+  m_num_seeks        += other.m_num_seeks;
+  m_num_moving_seeks += other.m_num_moving_seeks;
+  m_seek_distance    += other.m_seek_distance;
+
+  m_read_sizes.merge(other.m_read_sizes);
+  m_read_latencies.merge(other.m_read_latencies);
+  m_seek_distances.merge(other.m_seek_distances);
+}
+
+std::string
+mm_io_statistics_c::format()
+  const {
+  auto result = (boost::format(Y("I/O statistics for '%1%':\n")) % m_file_name).str();
+
+  result += (boost::format(Y("  read:           %1% bytes in %2% calls\n")) % m_bytes_read % m_num_reads).str();
+  result += (boost::format(Y("  written:        %1% bytes in %2% calls\n")) % m_bytes_written % m_num_writes).str();
+  result += (boost::format(Y("  seeks:          %1% calls, %2% changing the position, total distance %3% bytes\n")) % m_num_seeks % m_num_moving_seeks % m_seek_distance).str();
+
+  if (m_num_reads) {
+    result += (boost::format(Y("  read sizes:     %1%\n")) % m_read_sizes.format(s_size_labels)).str();
+    result += (boost::format(Y("  read latencies: %1%\n")) % m_read_latencies.format(s_latency_labels)).str();
+  }
+
+  if (m_num_moving_seeks)
+    result += (boost::format(Y("  seek distances: %1%\n")) % m_seek_distances.format(s_seek_distance_labels)).str();
+
+  return result;
+}
+
+void
+mm_io_statistics_c::enable(bool enabled) {
+  ms_enabled = enabled;
+}
+
+/** \brief Create and register the statistics for a newly opened file
+
+   Returns \c nullptr if the statistics aren't enabled.
+*/
+mm_io_statistics_cptr
+mm_io_statistics_c::create(std::string const &file_name) {
+  if (!ms_enabled)
+    return mm_io_statistics_cptr{};
+
+  auto statistics = std::make_shared<mm_io_statistics_c>(file_name);
+
+  std::lock_guard<std::mutex> lock{s_mutex};
+  s_statistics.push_back(statistics);
+
+  return statistics;
+}
+
+/** \brief Output the statistics of all files opened so far to the
+    standard error
+
+   Instances for the same file name are combined. Files that were
+   opened but neither read, written nor seeked in are skipped.
+*/
+void
+mm_io_statistics_c::report() {
+  if (!ms_enabled)
+    return;
+
+  std::map<std::string, mm_io_statistics_c> combined;
+
+  {
+    std::lock_guard<std::mutex> lock{s_mutex};
+
+    for (auto const &statistics : s_statistics) {
+      if (!statistics->m_num_reads && !statistics->m_num_writes && !statistics->m_num_seeks)
+        continue;
+
+      auto itr = combined.find(statistics->m_file_name);
+      if (combined.end() == itr)
+        combined.emplace(statistics->m_file_name, *statistics);
+      else
+        itr->second.merge(*statistics);
+    }
+
+    s_statistics.clear();
+  }
+
+  // The standard output may carry e.g. the JSON identification
+  // result which must not be mixed with the statistics.
+  mm_stdio_c err{true};
+
+  for (auto const &pair : combined)
+    err.puts(pair.second.format());
+
+  err.flush();
+}
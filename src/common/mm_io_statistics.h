@@ -0,0 +1,105 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   statistics about the I/O operations on files
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MM_IO_STATISTICS_H
+#define MTX_COMMON_MM_IO_STATISTICS_H
+
+#include "common/common_pch.h"
+
+/* Collected by mm_file_io_c for each file it opens if enabled with the
+   common option '--io-statistics'. The numbers describe the requests
+   mm_file_io_c passes on to the C library's stdio functions (to the
+   operating system on Windows), not the ones served from the buffers
+   in mm_read_buffer_io_c or mm_write_buffer_io_c. stdio may buffer
+   them again. All files are reported on the standard error when the
+   program exits, several instances opened for the same file name
+   combined. */
+
+class mm_io_statistics_c {
+public:
+  class histogram_c {
+  protected:
+    std::vector<uint64_t> m_limits, m_counts;
+
+  public:
+    histogram_c(std::vector<uint64_t> const &limits);
+
+    void add(uint64_t value);
+    void merge(histogram_c const &other);
+    uint64_t get_count(unsigned int bucket) const;
+    std::string format(std::vector<std::string> const &labels) const;
+  };
+
+protected:
+  std::string m_file_name;
+  uint64_t m_bytes_read, m_bytes_written, m_num_reads, m_num_writes, m_num_seeks, m_num_moving_seeks, m_seek_distance;
+  histogram_c m_read_sizes, m_read_latencies, m_seek_distances;
+
+  static bool ms_enabled;
+
+public:
+  mm_io_statistics_c(std::string const &file_name);
+
+  void add_read(size_t size, int64_t duration_ns);
+  void add_write(size_t size);
+  void add_seek(uint64_t from, uint64_t to);
+
+  void merge(mm_io_statistics_c const &other);
+  std::string format() const;
+
+  std::string const &get_file_name() const {
+    return m_file_name;
+  }
+  uint64_t get_bytes_read() const {
+    return m_bytes_read;
+  }
+  uint64_t get_bytes_written() const {
+    return m_bytes_written;
+  }
+  uint64_t get_num_reads() const {
+    return m_num_reads;
+  }
+  uint64_t get_num_writes() const {
+    return m_num_writes;
+  }
+  uint64_t get_num_seeks() const {
+    return m_num_seeks;
+  }
+  uint64_t get_num_moving_seeks() const {
+    return m_num_moving_seeks;
+  }
+  uint64_t get_seek_distance() const {
+    return m_seek_distance;
+  }
+  histogram_c const &get_read_sizes() const {
+    return m_read_sizes;
+  }
+  histogram_c const &get_read_latencies() const {
+    return m_read_latencies;
+  }
+  histogram_c const &get_seek_distances() const {
+    return m_seek_distances;
+  }
+
+public:
+  static void enable(bool enabled);
+  static bool is_enabled() {
+    return ms_enabled;
+  }
+
+  static std::shared_ptr<mm_io_statistics_c> create(std::string const &file_name);
+  static void report();
+};
+using mm_io_statistics_cptr = std::shared_ptr<mm_io_statistics_c>;
+
+#endif  // MTX_COMMON_MM_IO_STATISTICS_H
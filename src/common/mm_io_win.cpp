@@ -15,6 +15,7 @@
 
 #if defined(SYS_WINDOWS)
 
+#include <chrono>
 #include <direct.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -29,6 +30,7 @@
 #include "common/error.h"
 #include "common/fs_sys_helpers.h"
 #include "common/mm_io.h"
+#include "common/mm_io_statistics.h"
 #include "common/mm_io_x.h"
 #include "common/strings/editing.h"
 #include "common/strings/parsing.h"
@@ -76,6 +78,7 @@ mm_file_io_c::mm_file_io_c(const std::string &path,
     throw mtx::mm_io::open_x{mtx::mm_io::make_error_code()};
 
   m_dos_style_newlines = true;
+  m_statistics         = mm_io_statistics_c::create(path);
 }
 
 void
@@ -101,6 +104,8 @@ mm_file_io_c::get_real_file_pointer() {
 void
 mm_file_io_c::setFilePointer(int64 offset,
                              seek_mode mode) {
+  auto previous_position = m_current_position;
+
   DWORD method = seek_beginning == mode ? FILE_BEGIN
                : seek_current   == mode ? FILE_CURRENT
                : seek_end       == mode ? FILE_END
@@ -113,12 +118,16 @@ mm_file_io_c::setFilePointer(int64 offset,
 
   m_eof              = false;
   m_current_position = (int64_t)low + ((int64_t)high << 32);
+
+  if (m_statistics)
+    m_statistics->add_seek(previous_position, m_current_position);
 }
 
 uint32
 mm_file_io_c::_read(void *buffer,
                     size_t size) {
   DWORD bytes_read;
+  auto start = m_statistics ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
 
   if (!ReadFile((HANDLE)m_file, buffer, size, &bytes_read, nullptr)) {
     m_eof              = true;
@@ -130,6 +139,9 @@ mm_file_io_c::_read(void *buffer,
   m_eof               = size != bytes_read;
   m_current_position += bytes_read;
 
+  if (m_statistics)
+    m_statistics->add_read(bytes_read, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
   return bytes_read;
 }
 
@@ -170,6 +182,9 @@ mm_file_io_c::_write(const void *buffer,
   m_cached_size       = -1;
   m_eof               = false;
 
+  if (m_statistics)
+    m_statistics->add_write(bytes_written);
+
   return bytes_written;
 }
 
@@ -204,12 +219,23 @@ void
 mm_file_io_c::setup() {
 }
 
-static bool s_stdout_binmode_set = false;
+static bool s_stdin_binmode_set = false, s_stdout_binmode_set = false, s_stderr_binmode_set = false;
+
+uint32
+mm_stdio_c::_read(void *buffer,
+                  size_t size) {
+  if (!s_stdin_binmode_set) {
+    _setmode(0, _O_BINARY);
+    s_stdin_binmode_set = true;
+  }
+
+  return fread(buffer, 1, size, stdin);
+}
 
 size_t
 mm_stdio_c::_write(const void *buffer,
                    size_t size) {
-  HANDLE h_stdout = GetStdHandle(STD_OUTPUT_HANDLE);
+  HANDLE h_stdout = GetStdHandle(m_use_stderr ? STD_ERROR_HANDLE : STD_OUTPUT_HANDLE);
   if (INVALID_HANDLE_VALUE == h_stdout)
     return 0;
 
@@ -229,13 +255,15 @@ mm_stdio_c::_write(const void *buffer,
     return bytes_written;
   }
 
-  if (!s_stdout_binmode_set) {
-    _setmode(1, _O_BINARY);
-    s_stdout_binmode_set = true;
+  auto &binmode_set = m_use_stderr ? s_stderr_binmode_set : s_stdout_binmode_set;
+  if (!binmode_set) {
+    _setmode(m_use_stderr ? 2 : 1, _O_BINARY);
+    binmode_set = true;
   }
 
-  size_t bytes_written = fwrite(buffer, 1, size, stdout);
-  fflush(stdout);
+  auto out             = m_use_stderr ? stderr : stdout;
+  size_t bytes_written = fwrite(buffer, 1, size, out);
+  fflush(out);
 
   m_cached_size = -1;
 
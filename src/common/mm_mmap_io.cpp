@@ -0,0 +1,397 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class for memory-mapped files
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#if !defined(SYS_WINDOWS)
+# include <atomic>
+# include <fcntl.h>
+# include <mutex>
+# include <signal.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <sys/types.h>
+#endif
+
+#include "common/mm_io_x.h"
+#include "common/mm_mmap_io.h"
+
+#if !defined(SYS_WINDOWS)
+
+namespace {
+
+// Accessing a page of a mapping beyond the end of its file raises
+// SIGBUS. That happens if the file is truncated while it is being
+// read. The mapped windows are registered so that the signal handler
+// can name the file instead of letting the program crash.
+//
+// Only async-signal-safe functions may be used in the handler. It
+// neither allocates nor locks: the registry is a fixed table, and the
+// error message is formatted when the window is mapped. A slot is free
+// while its data pointer is null; that pointer is set last. Windows
+// mapped while all slots are in use aren't registered. Accessing them
+// after a truncation crashes the program as before.
+struct mapped_window_t {
+  std::atomic<unsigned char const *> data;
+  size_t size, message_length;
+  char message[1024];
+};
+
+std::mutex s_mapped_windows_mutex;
+mapped_window_t s_mapped_windows[128];
+bool s_sigbus_handler_installed = false;
+
+void
+handle_sigbus(int,
+              siginfo_t *info,
+              void *) {
+  auto address = static_cast<unsigned char const *>(info->si_addr);
+
+  for (auto &window : s_mapped_windows) {
+    auto data = window.data.load(std::memory_order_acquire);
+    if (!data || (address < data) || ((data + window.size) <= address))
+      continue;
+
+    auto result = ::write(STDERR_FILENO, window.message, window.message_length);
+    static_cast<void>(result);
+
+    _exit(2);
+  }
+
+  // Not caused by a mapped file: re-raise with the default action.
+  signal(SIGBUS, SIG_DFL);
+}
+
+void
+register_window(unsigned char const *data,
+                size_t size,
+                std::string const &file_name) {
+  std::lock_guard<std::mutex> lock{s_mapped_windows_mutex};
+
+  for (auto &window : s_mapped_windows) {
+    if (window.data.load(std::memory_order_relaxed))
+      continue;
+
+    auto message = (boost::format("%1% %2%") % Y("Error:") % (boost::format(Y("The file '%1%' was truncated while it was being read.\n")) % file_name)).str();
+
+    window.size           = size;
+    window.message_length = std::min(message.size(), sizeof(window.message));
+    std::memcpy(window.message, message.c_str(), window.message_length);
+    window.data.store(data, std::memory_order_release);
+
+    break;
+  }
+
+  if (s_sigbus_handler_installed)
+    return;
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = handle_sigbus;
+  action.sa_flags     = SA_SIGINFO;
+  sigemptyset(&action.sa_mask);
+
+  s_sigbus_handler_installed = 0 == sigaction(SIGBUS, &action, nullptr);
+}
+
+void
+unregister_window(unsigned char const *data) {
+  std::lock_guard<std::mutex> lock{s_mapped_windows_mutex};
+
+  for (auto &window : s_mapped_windows)
+    if (window.data.load(std::memory_order_relaxed) == data) {
+      window.data.store(nullptr, std::memory_order_release);
+      break;
+    }
+}
+
+}
+
+#endif  // !defined(SYS_WINDOWS)
+
+mm_mmap_io_c::window_t::window_t(unsigned char *data,
+                                 int64_t offset,
+                                 size_t size)
+  : m_data{data}
+  , m_offset{offset}
+  , m_size{size}
+{
+}
+
+#if !defined(SYS_WINDOWS)
+
+mm_mmap_io_c::window_t::~window_t() {
+  unregister_window(m_data);
+  munmap(m_data, m_size);
+}
+
+mm_mmap_io_c::mm_mmap_io_c(std::string const &file_name,
+                           size_t window_size)
+  : m_file_name{file_name}
+  , m_fd{-1}
+  , m_size{}
+  , m_position{}
+  , m_window_size{window_size ? window_size : sizeof(void *) >= 8 ? 64 * 1024 * 1024 : 16 * 1024 * 1024}
+  , m_eof{}
+{
+  auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  m_window_size  = std::max<size_t>((m_window_size + page_size - 1) / page_size * page_size, page_size);
+
+  m_fd = ::open(g_cc_local_utf8->native(file_name).c_str(), O_RDONLY);
+  if (-1 == m_fd)
+    throw mtx::mm_io::open_x{mtx::mm_io::make_error_code()};
+
+  struct stat st;
+  if ((0 != fstat(m_fd, &st)) || !S_ISREG(st.st_mode)) {
+    auto error_code = mtx::mm_io::make_error_code();
+    ::close(m_fd);
+    m_fd = -1;
+
+    throw mtx::mm_io::open_x{error_code};
+  }
+
+  m_size = st.st_size;
+}
+
+mm_mmap_io_c::~mm_mmap_io_c() {
+  close();
+}
+
+/** \brief Find or map the window containing a range of the file
+
+   If no window contains the whole range then a new one is mapped. It
+   starts at the window boundary before \c position and is enlarged
+   if the range would otherwise cross its end. Only the most recently
+   used windows are kept mapped by the file itself.
+*/
+mm_mmap_io_c::window_cptr
+mm_mmap_io_c::window_for(int64_t position,
+                         size_t size) {
+  for (auto itr = m_windows.begin(), end = m_windows.end(); itr != end; ++itr) {
+    auto window = *itr;
+    if ((window->m_offset > position) || ((window->m_offset + static_cast<int64_t>(window->m_size)) < (position + static_cast<int64_t>(size))))
+      continue;
+
+    if (itr != m_windows.begin()) {
+      m_windows.erase(itr);
+      m_windows.push_front(window);
+    }
+
+    return window;
+  }
+
+  auto offset      = position / m_window_size * m_window_size;
+  auto window_size = static_cast<size_t>(std::min<int64_t>(std::max<int64_t>(m_window_size, position + size - offset), m_size - offset));
+  auto data        = mmap(nullptr, window_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, m_fd, offset);
+
+  if (MAP_FAILED == data)
+    throw mtx::mm_io::read_write_x{mtx::mm_io::make_error_code()};
+
+  madvise(data, window_size, MADV_SEQUENTIAL);
+
+  auto window = std::make_shared<window_t>(static_cast<unsigned char *>(data), offset, window_size);
+  register_window(window->m_data, window->m_size, m_file_name);
+
+  m_windows.push_front(window);
+  if (m_windows.size() > s_max_windows)
+    m_windows.pop_back();
+
+  return window;
+}
+
+uint64
+mm_mmap_io_c::getFilePointer() {
+  return m_position;
+}
+
+void
+mm_mmap_io_c::setFilePointer(int64 offset,
+                             seek_mode mode) {
+  int64_t new_position
+    = seek_beginning == mode ? offset
+    : seek_end       == mode ? m_size     + offset // offsets from the end are negative already
+    :                          m_position + offset;
+
+  if (0 > new_position)
+    throw mtx::mm_io::seek_x{mtx::mm_io::make_error_code()};
+
+  m_position = new_position;
+  m_eof      = false;
+}
+
+uint32
+mm_mmap_io_c::_read(void *buffer,
+                    size_t size) {
+  auto destination = static_cast<unsigned char *>(buffer);
+  auto num_read    = size_t{};
+
+  while ((num_read < size) && (m_position < m_size)) {
+    auto window    = window_for(m_position, 1);
+    auto in_window = std::min<size_t>(size - num_read, window->m_offset + window->m_size - m_position);
+
+    std::memcpy(destination + num_read, window->m_data + (m_position - window->m_offset), in_window);
+
+    num_read   += in_window;
+    m_position += in_window;
+  }
+
+  if (num_read < size)
+    m_eof = true;
+
+  return num_read;
+}
+
+/** \brief Return a buffer pointing directly into the mapping
+
+   Throws \c mtx::mm_io::end_of_file_x if fewer than \c size bytes are
+   left, just like the generic implementation.
+*/
+memory_cptr
+mm_mmap_io_c::read(size_t size) {
+  if (!size)
+    return memory_c::alloc(0);
+
+  if ((m_position + static_cast<int64_t>(size)) > m_size) {
+    m_position = std::max(m_position, m_size);
+    m_eof      = true;
+    throw mtx::mm_io::end_of_file_x{};
+  }
+
+  auto window = window_for(m_position, size);
+  auto buffer = memory_c::view(window->m_data + (m_position - window->m_offset), size, window);
+
+  m_position += size;
+
+  return buffer;
+}
+
+size_t
+mm_mmap_io_c::_write(const void *,
+                     size_t) {
+  throw mtx::mm_io::wrong_read_write_access_x{};
+}
+
+bool
+mm_mmap_io_c::eof() {
+  return m_eof;
+}
+
+void
+mm_mmap_io_c::clear_eof() {
+  m_eof = false;
+}
+
+int64_t
+mm_mmap_io_c::get_size() {
+  return m_size;
+}
+
+void
+mm_mmap_io_c::close() {
+  // Buffers handed out by read() still hold references to their
+  // windows. Those windows are unmapped once the last buffer is gone.
+  m_windows.clear();
+
+  if (-1 != m_fd)
+    ::close(m_fd);
+
+  m_fd       = -1;
+  m_size     = 0;
+  m_position = 0;
+}
+
+#else  // !defined(SYS_WINDOWS)
+
+mm_mmap_io_c::window_t::~window_t() {
+}
+
+// Not implemented on Windows. Callers fall back to regular file I/O.
+mm_mmap_io_c::mm_mmap_io_c(std::string const &file_name,
+                           size_t window_size)
+  : m_file_name{file_name}
+  , m_fd{-1}
+  , m_size{}
+  , m_position{}
+  , m_window_size{window_size}
+  , m_eof{}
+{
+  throw mtx::mm_io::open_x{};
+}
+
+mm_mmap_io_c::~mm_mmap_io_c() {
+}
+
+mm_mmap_io_c::window_cptr
+mm_mmap_io_c::window_for(int64_t,
+                         size_t) {
+  return window_cptr{};
+}
+
+uint64
+mm_mmap_io_c::getFilePointer() {
+  return m_position;
+}
+
+void
+mm_mmap_io_c::setFilePointer(int64,
+                             seek_mode) {
+}
+
+uint32
+mm_mmap_io_c::_read(void *,
+                    size_t) {
+  return 0;
+}
+
+memory_cptr
+mm_mmap_io_c::read(size_t) {
+  throw mtx::mm_io::end_of_file_x{};
+}
+
+size_t
+mm_mmap_io_c::_write(const void *,
+                     size_t) {
+  throw mtx::mm_io::wrong_read_write_access_x{};
+}
+
+bool
+mm_mmap_io_c::eof() {
+  return true;
+}
+
+void
+mm_mmap_io_c::clear_eof() {
+}
+
+int64_t
+mm_mmap_io_c::get_size() {
+  return 0;
+}
+
+void
+mm_mmap_io_c::close() {
+}
+
+#endif  // !defined(SYS_WINDOWS)
+
+std::string
+mm_mmap_io_c::get_file_name()
+  const {
+  return m_file_name;
+}
+
+mm_io_cptr
+mm_mmap_io_c::open(std::string const &file_name) {
+  return std::make_shared<mm_mmap_io_c>(file_name);
+}
@@ -0,0 +1,79 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class for memory-mapped files
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MM_MMAP_IO_H
+#define MTX_COMMON_MM_MMAP_IO_H
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+
+/* Read-only access to a file via mmap(). The file is mapped in
+   windows of a fixed size so that huge files don't exhaust the
+   address space on 32-bit systems. read(size_t) returns buffers that
+   point directly into the mapping instead of copying the data. Such a
+   buffer keeps its window mapped for as long as it exists, even after
+   the file itself has been closed.
+
+   The windows are mapped privately. Modifying the content of such a
+   buffer in place is therefore safe; only the modified pages are
+   copied by the kernel. If the file is truncated while it is mapped
+   then accessing the missing part results in an error message instead
+   of a crash. */
+class mm_mmap_io_c: public mm_io_c {
+protected:
+  struct window_t {
+    unsigned char *m_data;
+    int64_t m_offset;
+    size_t m_size;
+
+    window_t(unsigned char *data, int64_t offset, size_t size);
+    ~window_t();
+  };
+  using window_cptr = std::shared_ptr<window_t>;
+
+  static unsigned int const s_max_windows = 4;
+
+  std::string m_file_name;
+  int m_fd;
+  int64_t m_size, m_position;
+  size_t m_window_size;
+  bool m_eof;
+  std::deque<window_cptr> m_windows;
+
+public:
+  mm_mmap_io_c(std::string const &file_name, size_t window_size = 0);
+  virtual ~mm_mmap_io_c();
+
+  virtual uint64 getFilePointer();
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
+  using mm_io_c::read;
+  virtual memory_cptr read(size_t size);
+  virtual bool eof();
+  virtual void clear_eof();
+  virtual int64_t get_size();
+  virtual void close();
+  virtual std::string get_file_name() const;
+
+  static mm_io_cptr open(std::string const &file_name);
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size);
+  virtual size_t _write(const void *buffer, size_t size);
+
+  window_cptr window_for(int64_t position, size_t size);
+};
+
+using mm_mmap_io_cptr = std::shared_ptr<mm_mmap_io_c>;
+
+#endif  // MTX_COMMON_MM_MMAP_IO_H
@@ -0,0 +1,203 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class for reading from pipes
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/mm_io_x.h"
+#include "common/mm_pipe_input_io.h"
+
+mm_pipe_input_io_c::mm_pipe_input_io_c(mm_io_c *in,
+                                       std::string const &file_name,
+                                       size_t max_head_size)
+  : mm_proxy_io_c{in}
+  , m_file_name{file_name}
+  , m_buffer_start{}
+  , m_position{}
+  , m_max_head_size{max_head_size}
+  , m_holding_head{true}
+  , m_source_eof{}
+  , m_eof{}
+  , m_debug{"pipe_input"}
+{
+}
+
+mm_pipe_input_io_c::~mm_pipe_input_io_c() {
+}
+
+/** \brief Whether a file name refers to the standard input or a pipe
+
+   \c - stands for the standard input. Other names qualify if they
+   exist but are neither regular files nor directories, e.g. named
+   pipes or character devices.
+*/
+bool
+mm_pipe_input_io_c::is_pipe(std::string const &file_name) {
+  if ("-" == file_name)
+    return true;
+
+  boost::system::error_code ec;
+  auto status = bfs::status(file_name, ec);
+
+  return !ec && bfs::exists(status) && !bfs::is_regular_file(status) && !bfs::is_directory(status);
+}
+
+uint64
+mm_pipe_input_io_c::getFilePointer() {
+  return m_position;
+}
+
+void
+mm_pipe_input_io_c::setFilePointer(int64 offset,
+                                   seek_mode mode) {
+  if ((seek_end == mode) && !m_source_eof)
+    throw mtx::mm_io::seek_x{};
+
+  int64_t new_position
+    = seek_beginning == mode ? offset
+    : seek_end       == mode ? get_buffer_end() + offset // offsets from the end are negative already
+    :                          m_position + offset;
+
+  // Data before the buffer is gone. Data behind the head cannot be
+  // reached without giving up the head.
+  if (   (new_position < m_buffer_start)
+      || (m_holding_head && !m_source_eof && (new_position > static_cast<int64_t>(m_max_head_size)))) {
+    mxdebug_if(m_debug, boost::format("pipe_input: cannot seek to %1% in %2%; buffered: %3%-%4%\n") % new_position % m_file_name % m_buffer_start % get_buffer_end());
+    throw mtx::mm_io::seek_x{};
+  }
+
+  m_position = new_position;
+  m_eof      = false;
+}
+
+bool
+mm_pipe_input_io_c::eof() {
+  return m_eof;
+}
+
+void
+mm_pipe_input_io_c::clear_eof() {
+  m_eof = false;
+}
+
+/** \brief Return the input's size if it is known already
+
+   Short inputs are read completely while their type is probed so that
+   readers know their actual size.
+*/
+int64_t
+mm_pipe_input_io_c::get_size() {
+  if (m_holding_head)
+    fill_to(std::min<int64_t>(s_size_probe_size, m_max_head_size));
+
+  return m_source_eof ? get_buffer_end() : s_unknown_size;
+}
+
+bool
+mm_pipe_input_io_c::is_size_known()
+  const {
+  return m_source_eof;
+}
+
+std::string
+mm_pipe_input_io_c::get_file_name()
+  const {
+  return m_file_name;
+}
+
+/** \brief Stop keeping the start of the input in memory
+
+   Called once the headers have been parsed. Only the most recently
+   read data is kept from then on.
+*/
+void
+mm_pipe_input_io_c::release_head() {
+  mxdebug_if(m_debug, boost::format("pipe_input: releasing the head of %1% at %2%; buffered: %3%-%4%\n") % m_file_name % m_position % m_buffer_start % get_buffer_end());
+
+  m_holding_head = false;
+  drop_old_data();
+}
+
+int64_t
+mm_pipe_input_io_c::get_buffer_end()
+  const {
+  return m_buffer_start + m_buffer.size();
+}
+
+void
+mm_pipe_input_io_c::fill_to(int64_t end) {
+  while ((get_buffer_end() < end) && !m_source_eof) {
+    if (m_holding_head && (m_buffer.size() >= m_max_head_size)) {
+      mxdebug_if(m_debug, boost::format("pipe_input: more than %1% bytes read from %2%; releasing the head\n") % m_max_head_size % m_file_name);
+      m_holding_head = false;
+    }
+
+    auto wanted   = static_cast<size_t>(std::max<int64_t>(std::min<int64_t>(end - get_buffer_end(), s_rewind_size), s_min_read_size));
+    auto old_size = m_buffer.size();
+
+    m_buffer.resize(old_size + wanted);
+    auto num_read = m_proxy_io->read(&m_buffer[old_size], wanted);
+    m_buffer.resize(old_size + num_read);
+
+    if (num_read < wanted)
+      m_source_eof = true;
+
+    drop_old_data();
+  }
+}
+
+/** \brief Drop data that cannot be rewound to anymore
+
+   Data is dropped in large chunks so that the buffer isn't shifted
+   around after every read.
+*/
+void
+mm_pipe_input_io_c::drop_old_data() {
+  if (m_holding_head)
+    return;
+
+  auto keep_from = std::min(m_position, get_buffer_end()) - static_cast<int64_t>(s_rewind_size);
+  auto to_drop   = keep_from - m_buffer_start;
+
+  if (to_drop < static_cast<int64_t>(s_rewind_size))
+    return;
+
+  m_buffer.erase(m_buffer.begin(), m_buffer.begin() + to_drop);
+  m_buffer_start += to_drop;
+}
+
+uint32
+mm_pipe_input_io_c::_read(void *buffer,
+                          size_t size) {
+  fill_to(m_position + size);
+
+  auto offset   = m_position - m_buffer_start;
+  auto num_read = static_cast<size_t>(std::min<int64_t>(size, std::max<int64_t>(static_cast<int64_t>(m_buffer.size()) - offset, 0)));
+
+  if (num_read)
+    std::memcpy(buffer, &m_buffer[offset], num_read);
+
+  m_position += num_read;
+
+  if (num_read < size)
+    m_eof = true;
+
+  drop_old_data();
+
+  return num_read;
+}
+
+size_t
+mm_pipe_input_io_c::_write(const void *,
+                           size_t) {
+  throw mtx::mm_io::wrong_read_write_access_x{};
+}
@@ -0,0 +1,79 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class for reading from pipes
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MM_PIPE_INPUT_IO_H
+#define MTX_COMMON_MM_PIPE_INPUT_IO_H
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+
+/* Reads from an input that cannot seek, e.g. the standard input or a
+   named pipe. Everything read is kept in memory up to a limit so that
+   the file type can be probed and the headers be parsed with the usual
+   seeks. Once release_head() has been called, or once more than the
+   limit has been read, only the most recently read data is kept. Seeking
+   backwards within that data works; seeking before it throws
+   mtx::mm_io::seek_x. Seeking forward reads and discards the data in
+   between.
+
+   The size is unknown until the end of the input has been reached. Until
+   then is_size_known() returns false, get_size() returns a value larger
+   than any real input so that readers don't stop early, and seeking
+   relative to the end throws mtx::mm_io::seek_x. */
+class mm_pipe_input_io_c: public mm_proxy_io_c {
+protected:
+  static size_t const s_default_max_head_size = 64 * 1024 * 1024;
+  static size_t const s_rewind_size           = 4 * 1024 * 1024;
+  static size_t const s_min_read_size         = 64 * 1024;
+  static size_t const s_size_probe_size       = 1024 * 1024;
+
+  std::string m_file_name;
+  // The data kept in memory, starting at m_buffer_start.
+  std::vector<unsigned char> m_buffer;
+  int64_t m_buffer_start, m_position;
+  size_t m_max_head_size;
+  bool m_holding_head, m_source_eof, m_eof;
+  debugging_option_c m_debug;
+
+public:
+  static int64_t const s_unknown_size = 1ll << 62;
+
+public:
+  mm_pipe_input_io_c(mm_io_c *in, std::string const &file_name, size_t max_head_size = s_default_max_head_size);
+  virtual ~mm_pipe_input_io_c();
+
+  virtual uint64 getFilePointer();
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
+  virtual bool eof();
+  virtual void clear_eof();
+  virtual int64_t get_size();
+  virtual std::string get_file_name() const;
+
+  void release_head();
+  bool is_size_known() const;
+
+  static bool is_pipe(std::string const &file_name);
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size);
+  virtual size_t _write(const void *buffer, size_t size);
+
+  int64_t get_buffer_end() const;
+  void fill_to(int64_t end);
+  void drop_old_data();
+};
+
+using mm_pipe_input_io_cptr = std::shared_ptr<mm_pipe_input_io_c>;
+
+#endif  // MTX_COMMON_MM_PIPE_INPUT_IO_H
@@ -0,0 +1,164 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class for probing the head of a file
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/mm_io_x.h"
+#include "common/mm_probe_buffer_io.h"
+
+mm_probe_buffer_io_c::mm_probe_buffer_io_c(mm_io_cptr const &in,
+                                           size_t max_buffer_size)
+  : mm_proxy_io_c{in.get(), false}
+  , m_af_in{in}
+  , m_position{}
+  , m_max_buffer_size{max_buffer_size}
+  , m_eof{}
+  , m_source_exhausted{}
+  , m_debug{"probe_buffer"}
+{
+}
+
+mm_probe_buffer_io_c::~mm_probe_buffer_io_c() {
+}
+
+uint64
+mm_probe_buffer_io_c::getFilePointer() {
+  return m_position;
+}
+
+void
+mm_probe_buffer_io_c::setFilePointer(int64 offset,
+                                     seek_mode mode) {
+  int64_t new_position
+    = seek_beginning == mode ? offset
+    : seek_end       == mode ? get_size() + offset // offsets from the end are negative already
+    :                          m_position + offset;
+
+  if (0 > new_position)
+    throw mtx::mm_io::seek_x{mtx::mm_io::make_error_code()};
+
+  m_position = new_position;
+  m_eof      = false;
+}
+
+bool
+mm_probe_buffer_io_c::eof() {
+  return m_eof;
+}
+
+void
+mm_probe_buffer_io_c::clear_eof() {
+  m_eof = false;
+}
+
+int64_t
+mm_probe_buffer_io_c::get_size() {
+  return m_proxy_io->get_size();
+}
+
+size_t
+mm_probe_buffer_io_c::get_buffered_size()
+  const {
+  return m_buffer.size();
+}
+
+/** \brief Release the buffer
+
+   All following reads go to the underlying file directly. Used once
+   probing is done so that the buffer doesn't stay around for as long
+   as the file is read.
+*/
+void
+mm_probe_buffer_io_c::drop_buffer() {
+  mxdebug_if(m_debug, boost::format("probe_buffer: dropping %1% bytes for %2%\n") % m_buffer.size() % get_file_name());
+
+  std::vector<unsigned char>{}.swap(m_buffer);
+
+  m_max_buffer_size  = 0;
+  m_source_exhausted = false;
+}
+
+uint32
+mm_probe_buffer_io_c::read_from_source(unsigned char *buffer,
+                                       int64_t position,
+                                       size_t size) {
+  if (m_proxy_io->getFilePointer() != static_cast<uint64_t>(position))
+    m_proxy_io->setFilePointer(position);
+
+  return m_proxy_io->read(buffer, size);
+}
+
+/** \brief Extend the buffer so that it reaches up to \c end
+
+   The buffer grows at least to the initial size and at least doubles
+   each time so that probes reading a bit further each time don't cause
+   many small reads. It never grows beyond the maximum size.
+*/
+void
+mm_probe_buffer_io_c::extend_buffer(int64_t end) {
+  auto old_size = m_buffer.size();
+  auto new_size = std::min<int64_t>(std::max<int64_t>(std::max<int64_t>(end, old_size * 2), s_initial_buffer_size), m_max_buffer_size);
+
+  m_buffer.resize(new_size);
+
+  auto num_wanted = new_size - old_size;
+  auto num_read   = read_from_source(&m_buffer[old_size], old_size, num_wanted);
+
+  m_buffer.resize(old_size + num_read);
+
+  if (num_read < num_wanted)
+    m_source_exhausted = true;
+
+  mxdebug_if(m_debug, boost::format("probe_buffer: extended from %1% to %2% bytes for %3%\n") % old_size % m_buffer.size() % get_file_name());
+}
+
+uint32
+mm_probe_buffer_io_c::_read(void *buffer,
+                            size_t size) {
+  auto destination = static_cast<unsigned char *>(buffer);
+  auto buffered    = static_cast<int64_t>(m_buffer.size());
+  auto end         = m_position + static_cast<int64_t>(size);
+
+  if (   (end      >  buffered)
+      && (m_position <= buffered)
+      && (buffered <  static_cast<int64_t>(m_max_buffer_size))
+      && !m_source_exhausted) {
+    extend_buffer(end);
+    buffered = m_buffer.size();
+  }
+
+  auto num_read = size_t{};
+
+  if (m_position < buffered) {
+    num_read = std::min<size_t>(size, buffered - m_position);
+    std::memcpy(destination, &m_buffer[m_position], num_read);
+  }
+
+  // Once the end of the file has been buffered there's nothing left to
+  // read behind the buffer.
+  if ((num_read < size) && !m_source_exhausted)
+    num_read += read_from_source(destination + num_read, m_position + num_read, size - num_read);
+
+  m_position += num_read;
+
+  if (num_read < size)
+    m_eof = true;
+
+  return num_read;
+}
+
+size_t
+mm_probe_buffer_io_c::_write(const void *,
+                             size_t) {
+  throw mtx::mm_io::wrong_read_write_access_x{};
+}
@@ -0,0 +1,64 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class for probing the head of a file
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MM_PROBE_BUFFER_IO_H
+#define MTX_COMMON_MM_PROBE_BUFFER_IO_H
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+
+/* Keeps the head of a file in memory while it is probed by several
+   readers one after the other. The buffer is filled with a single
+   large read the first time it is accessed and is only extended if a
+   read continues past its end. Reads starting behind the buffer, or
+   extending beyond the maximum buffer size, go to the underlying file
+   directly.
+
+   Writing is not supported. */
+class mm_probe_buffer_io_c: public mm_proxy_io_c {
+protected:
+  static size_t const s_initial_buffer_size     = 1024 * 1024;
+  static size_t const s_default_max_buffer_size = 8 * 1024 * 1024;
+
+  mm_io_cptr m_af_in;
+  std::vector<unsigned char> m_buffer;
+  int64_t m_position;
+  size_t m_max_buffer_size;
+  bool m_eof, m_source_exhausted;
+  debugging_option_c m_debug;
+
+public:
+  mm_probe_buffer_io_c(mm_io_cptr const &in, size_t max_buffer_size = s_default_max_buffer_size);
+  virtual ~mm_probe_buffer_io_c();
+
+  virtual uint64 getFilePointer();
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
+  virtual bool eof();
+  virtual void clear_eof();
+  virtual int64_t get_size();
+
+  size_t get_buffered_size() const;
+  void drop_buffer();
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size);
+  virtual size_t _write(const void *buffer, size_t size);
+
+  void extend_buffer(int64_t end);
+  uint32 read_from_source(unsigned char *buffer, int64_t position, size_t size);
+};
+
+using mm_probe_buffer_io_cptr = std::shared_ptr<mm_probe_buffer_io_c>;
+
+#endif  // MTX_COMMON_MM_PROBE_BUFFER_IO_H
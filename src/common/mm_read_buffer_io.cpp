@@ -17,6 +17,16 @@
 #include "common/mm_io_x.h"
 #include "common/mm_read_buffer_io.h"
 
+namespace {
+
+// Number of buffer refills without seeking in between after which the
+// access is considered to be sequential.
+unsigned int const s_min_sequential_refills = 2;
+
+}
+
+unsigned int mm_read_buffer_io_c::s_read_ahead_buffers = 0;
+
 mm_read_buffer_io_c::mm_read_buffer_io_c(mm_io_c *in,
                                          size_t buffer_size,
                                          bool delete_in)
@@ -29,9 +39,23 @@ mm_read_buffer_io_c::mm_read_buffer_io_c(mm_io_c *in,
   , m_offset(0)
   , m_size(buffer_size)
   , m_buffering(true)
+  , m_growing{}
   , m_debug_seek{"read_buffer_io|read_buffer_io_read"}
   , m_debug_read{"read_buffer_io|read_buffer_io_read"}
+  , m_current_ring_buffer{}
+  , m_read_ahead_offset{-1}
+  , m_fd{-1}
+  , m_prefetch_offset{}
+  , m_prefetch_file_size{}
+  , m_sequential_refills{}
+  , m_prefetcher_done{}
+  , m_stop_prefetcher{}
 {
+  m_af_buffer->set_accounting_component(mtx::mem::component_e::io_buffers);
+
+  if (io_uring_c::is_enabled())
+    create_ring();
+
   setFilePointer(0, seek_beginning);
 }
 
@@ -39,6 +63,237 @@ mm_read_buffer_io_c::~mm_read_buffer_io_c() {
   close();
 }
 
+void
+mm_read_buffer_io_c::close() {
+  stop_prefetcher();
+  cancel_read_ahead();
+  mm_proxy_io_c::close();
+}
+
+mm_io_cptr
+mm_read_buffer_io_c::open(std::string const &file_name,
+                          size_t buffer_size) {
+  return mm_io_cptr(new mm_read_buffer_io_c(new mm_file_io_c(file_name), buffer_size));
+}
+
+void
+mm_read_buffer_io_c::set_read_ahead_buffers(unsigned int num_buffers) {
+  s_read_ahead_buffers = num_buffers;
+}
+
+unsigned int
+mm_read_buffer_io_c::get_read_ahead_buffers() {
+  return s_read_ahead_buffers;
+}
+
+void
+mm_read_buffer_io_c::create_ring() {
+  m_fd = io_uring_c::get_file_descriptor(*m_proxy_io);
+  if (0 > m_fd)
+    return;
+
+  mtx::mem::component_scope_c memory_scope{mtx::mem::component_e::io_buffers};
+
+  m_ring_buffers = std::vector<memory_cptr>{ m_af_buffer, memory_c::alloc(m_size) };
+
+  try {
+    m_ring = std::make_unique<io_uring_c>(m_ring_buffers);
+
+  } catch (mtx::mm_io::exception &ex) {
+    mxdebug_if(m_debug_read, boost::format("io_uring not usable, falling back to regular reads: %1%\n") % ex.code().message());
+    m_ring_buffers.clear();
+  }
+}
+
+void
+mm_read_buffer_io_c::start_read_ahead() {
+  if (!m_ring || !m_fill || m_ring->get_num_in_flight())
+    return;
+
+  auto offset = m_offset + static_cast<int64_t>(m_fill);
+  auto size   = std::min(get_size() - offset, static_cast<int64_t>(m_size));
+
+  if (0 >= size)
+    return;
+
+  m_read_ahead_offset = offset;
+  m_ring->submit_read(m_fd, 1 - m_current_ring_buffer, 0, size, offset);
+}
+
+/** \brief Use the block read ahead for refilling the buffer
+
+   Returns \c false if nothing has been read ahead or if the block
+   read ahead doesn't start at the current position, e.g. after
+   seeking. In that case the caller has to read from the file itself.
+*/
+bool
+mm_read_buffer_io_c::finish_read_ahead(size_t size) {
+  if (!m_ring || !m_ring->get_num_in_flight())
+    return false;
+
+  auto completion = m_ring->wait_for_completion();
+
+  mxdebug_if(m_debug_read, boost::format("read ahead via io_uring from position %1% returned %2% (wanted position %3%)\n") % m_read_ahead_offset % completion.result % m_offset);
+
+  if ((m_read_ahead_offset != m_offset) || (0 > completion.result))
+    return false;
+
+  m_current_ring_buffer = completion.buffer_idx;
+  m_af_buffer           = m_ring_buffers[m_current_ring_buffer];
+  m_buffer              = m_af_buffer->get_buffer();
+  m_fill                = std::min<size_t>(completion.result, size);
+
+  // The kernel read at an explicit offset without moving the file
+  // pointer.
+  m_proxy_io->setFilePointer(m_offset + m_fill);
+
+  return true;
+}
+
+void
+mm_read_buffer_io_c::cancel_read_ahead() {
+  if (!m_ring)
+    return;
+
+  while (m_ring->get_num_in_flight())
+    m_ring->wait_for_completion();
+}
+
+void
+mm_read_buffer_io_c::start_prefetcher() {
+  if (   !s_read_ahead_buffers
+      || m_ring
+      || m_growing
+      || m_prefetcher.joinable()
+      || (m_fill < m_size)
+      || (m_sequential_refills < s_min_sequential_refills))
+    return;
+
+  // The size is determined before the thread is started. get_size()
+  // returns this value while the thread owns the underlying file.
+  auto file_size = get_size();
+  auto offset    = m_offset + static_cast<int64_t>(m_fill);
+
+  if (offset >= file_size)
+    return;
+
+  mtx::mem::component_scope_c memory_scope{mtx::mem::component_e::io_buffers};
+
+  while ((m_free_prefetch_buffers.size() + m_prefetched_buffers.size()) < s_read_ahead_buffers)
+    m_free_prefetch_buffers.push_back(memory_c::alloc(m_size));
+
+  mxdebug_if(m_debug_read, boost::format("starting read ahead thread at position %1% with %2% buffers\n") % offset % s_read_ahead_buffers);
+
+  m_prefetch_offset    = offset;
+  m_prefetch_file_size = file_size;
+  m_prefetcher_done    = false;
+  m_stop_prefetcher    = false;
+  m_prefetcher         = std::thread{[this]() { run_prefetcher(); }};
+}
+
+void
+mm_read_buffer_io_c::run_prefetcher() {
+  std::unique_lock<std::mutex> lock{m_prefetch_mutex};
+
+  while (true) {
+    m_prefetch_cond.wait(lock, [this]() { return m_stop_prefetcher || !m_free_prefetch_buffers.empty(); });
+
+    if (m_stop_prefetcher)
+      return;
+
+    auto item   = prefetched_buffer_t{ m_free_prefetch_buffers.back(), 0, std::exception_ptr{} };
+    auto wanted = static_cast<size_t>(std::min<int64_t>(m_prefetch_file_size - m_prefetch_offset, m_size));
+
+    m_free_prefetch_buffers.pop_back();
+
+    lock.unlock();
+
+    try {
+      item.fill = m_proxy_io->read(item.buffer->get_buffer(), wanted);
+    } catch (...) {
+      item.error = std::current_exception();
+    }
+
+    lock.lock();
+
+    m_prefetch_offset += item.fill;
+    m_prefetcher_done  = item.error || (item.fill != wanted) || (m_prefetch_offset >= m_prefetch_file_size);
+
+    m_prefetched_buffers.push_back(item);
+    m_prefetch_cond.notify_all();
+
+    if (m_prefetcher_done)
+      return;
+  }
+}
+
+/** \brief Use the next block read by the read ahead thread
+
+   The thread reads the blocks following the position it was started
+   at, and it is stopped whenever a seek leaves the current buffer.
+   Its next block therefore always starts at the current position.
+   Returns \c false if the thread isn't running or has stopped reading
+   because it reached the end of the file.
+*/
+bool
+mm_read_buffer_io_c::take_prefetched_buffer(size_t size) {
+  if (!m_prefetcher.joinable())
+    return false;
+
+  std::unique_lock<std::mutex> lock{m_prefetch_mutex};
+
+  m_prefetch_cond.wait(lock, [this]() { return !m_prefetched_buffers.empty() || m_prefetcher_done; });
+
+  if (m_prefetched_buffers.empty()) {
+    lock.unlock();
+    stop_prefetcher();
+    return false;
+  }
+
+  auto item = m_prefetched_buffers.front();
+  m_prefetched_buffers.pop_front();
+  m_free_prefetch_buffers.push_back(m_af_buffer);
+
+  m_prefetch_cond.notify_all();
+  lock.unlock();
+
+  m_af_buffer = item.buffer;
+  m_buffer    = m_af_buffer->get_buffer();
+  m_fill      = std::min(item.fill, size);
+
+  if (item.error) {
+    stop_prefetcher();
+    std::rethrow_exception(item.error);
+  }
+
+  return true;
+}
+
+void
+mm_read_buffer_io_c::stop_prefetcher() {
+  m_sequential_refills = 0;
+
+  if (!m_prefetcher.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock{m_prefetch_mutex};
+    m_stop_prefetcher = true;
+    m_prefetch_cond.notify_all();
+  }
+
+  m_prefetcher.join();
+
+  mxdebug_if(m_debug_read, boost::format("stopped read ahead thread at position %1%, discarding %2% buffers\n") % m_prefetch_offset % m_prefetched_buffers.size());
+
+  for (auto &item : m_prefetched_buffers)
+    m_free_prefetch_buffers.push_back(item.buffer);
+  m_prefetched_buffers.clear();
+
+  // The thread has moved the file pointer past the blocks it has read.
+  m_proxy_io->setFilePointer(m_offset + m_fill);
+}
+
 uint64
 mm_read_buffer_io_c::getFilePointer() {
   return m_buffering ? m_offset + m_cursor : m_proxy_io->getFilePointer();
@@ -84,6 +339,8 @@ mm_read_buffer_io_c::setFilePointer(int64 offset,
     return;
   }
 
+  stop_prefetcher();
+
   int64_t previous_pos = m_proxy_io->getFilePointer();
 
   // Actual seeking
@@ -101,7 +358,7 @@ mm_read_buffer_io_c::setFilePointer(int64 offset,
 
 int64_t
 mm_read_buffer_io_c::get_size() {
-  return m_proxy_io->get_size();
+  return m_prefetcher.joinable() ? m_prefetch_file_size : m_proxy_io->get_size();
 }
 
 uint32
@@ -130,6 +387,12 @@ mm_read_buffer_io_c::_read(void *buffer,
       m_fill    = 0;
       avail     = std::min(get_size() - m_offset, static_cast<int64_t>(m_size));
 
+      // The source may wait for more data itself, e.g. when following
+      // a file that is still being written. Ask it for what the caller
+      // needs.
+      if (!avail && m_growing)
+        avail = std::min(size, m_size);
+
       if (!avail) {
         // must keep track of eof, as m_proxy_io->eof() will never be reached
         // because of the above eof calculation
@@ -137,10 +400,18 @@ mm_read_buffer_io_c::_read(void *buffer,
         break;
       }
 
-      int64_t previous_pos = m_proxy_io->getFilePointer();
+      if (!finish_read_ahead(avail) && !take_prefetched_buffer(avail)) {
+        int64_t previous_pos = m_proxy_io->getFilePointer();
+
+        m_fill = m_proxy_io->read(m_buffer, avail);
+        mxdebug_if(m_debug_read, boost::format("physical read from position %3% for %1% returned %2%\n") % avail % m_fill % previous_pos);
+      }
+
+      start_read_ahead();
+
+      ++m_sequential_refills;
+      start_prefetcher();
 
-      m_fill = m_proxy_io->read(m_buffer, avail);
-      mxdebug_if(m_debug_read, boost::format("physical read from position %3% for %1% returned %2%\n") % avail % m_fill % previous_pos);
       if (m_fill != avail) {
         m_eof = true;
         if (!m_fill)
@@ -159,10 +430,23 @@ mm_read_buffer_io_c::_write(const void *,
   return 0;
 }
 
+/** \brief Let reads go beyond the size the source reports
+
+   For sources that keep growing while they're read and that wait for
+   more data themselves, e.g. \c mm_follow_io_c. Reading ahead on a
+   separate thread is disabled for them as it relies on a fixed size.
+*/
+void
+mm_read_buffer_io_c::set_growing(bool growing) {
+  m_growing = growing;
+}
+
 void
 mm_read_buffer_io_c::enable_buffering(bool enable) {
   m_buffering = enable;
   if (!m_buffering) {
+    stop_prefetcher();
+    cancel_read_ahead();
     m_offset = 0;
     m_cursor = 0;
     m_fill   = 0;
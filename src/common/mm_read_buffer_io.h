@@ -17,8 +17,22 @@
 
 #include "common/common_pch.h"
 
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "common/io_uring.h"
 #include "common/mm_io.h"
 
+/* If io_uring is enabled and the input is a file then the block
+   following the current buffer is read into a second buffer in the
+   background.
+
+   Otherwise a thread can read ahead a configurable number of blocks
+   while the file is read sequentially. It is started after the buffer
+   has been refilled a couple of times in a row and stopped as soon as
+   a seek leaves the current buffer. */
 class mm_read_buffer_io_c: public mm_proxy_io_c {
 protected:
   memory_cptr m_af_buffer;
@@ -28,9 +42,34 @@ protected:
   size_t m_fill;
   int64_t m_offset;
   const size_t m_size;
-  bool m_buffering;
+  bool m_buffering, m_growing;
   debugging_option_c m_debug_seek, m_debug_read;
 
+  // Only used for reading ahead via io_uring:
+  std::vector<memory_cptr> m_ring_buffers;
+  std::unique_ptr<io_uring_c> m_ring;
+  unsigned int m_current_ring_buffer;
+  int64_t m_read_ahead_offset;
+  int m_fd;
+
+  // Only used for reading ahead on a separate thread:
+  struct prefetched_buffer_t {
+    memory_cptr buffer;
+    size_t fill;
+    std::exception_ptr error;
+  };
+
+  std::thread m_prefetcher;
+  std::mutex m_prefetch_mutex;
+  std::condition_variable m_prefetch_cond;
+  std::deque<prefetched_buffer_t> m_prefetched_buffers;
+  std::vector<memory_cptr> m_free_prefetch_buffers;
+  int64_t m_prefetch_offset, m_prefetch_file_size;
+  unsigned int m_sequential_refills;
+  bool m_prefetcher_done, m_stop_prefetcher;
+
+  static unsigned int s_read_ahead_buffers;
+
 public:
   mm_read_buffer_io_c(mm_io_c *in, size_t buffer_size = 1 << 12, bool delete_in = true);
   virtual ~mm_read_buffer_io_c();
@@ -41,10 +80,27 @@ public:
   inline virtual bool eof() { return m_eof; }
   virtual void clear_eof() { m_eof = false; }
   virtual void enable_buffering(bool enable);
+  virtual void set_growing(bool growing);
+  virtual void close();
+
+  static mm_io_cptr open(std::string const &file_name, size_t buffer_size);
+
+  static void set_read_ahead_buffers(unsigned int num_buffers);
+  static unsigned int get_read_ahead_buffers();
 
 protected:
   virtual uint32 _read(void *buffer, size_t size);
   virtual size_t _write(const void *buffer, size_t size);
+
+  void create_ring();
+  void start_read_ahead();
+  bool finish_read_ahead(size_t size);
+  void cancel_read_ahead();
+
+  void start_prefetcher();
+  bool take_prefetched_buffer(size_t size);
+  void stop_prefetcher();
+  void run_prefetcher();
 };
 
 using mm_read_buffer_io_cptr = std::shared_ptr<mm_read_buffer_io_c>;
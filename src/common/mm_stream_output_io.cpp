@@ -0,0 +1,149 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class for non-seekable output
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/mm_io_x.h"
+#include "common/mm_stream_output_io.h"
+
+mm_stream_output_io_c::mm_stream_output_io_c(mm_io_cptr const &out,
+                                             std::string const &file_name,
+                                             size_t max_head_size)
+  : m_out{out}
+  , m_file_name{file_name}
+  , m_flushed{}
+  , m_position{}
+  , m_max_head_size{max_head_size}
+  , m_holding_head{true}
+{
+}
+
+mm_stream_output_io_c::~mm_stream_output_io_c() {
+  close();
+}
+
+uint64
+mm_stream_output_io_c::getFilePointer() {
+  return m_position;
+}
+
+void
+mm_stream_output_io_c::setFilePointer(int64 offset,
+                                      seek_mode mode) {
+  int64_t new_position
+    = seek_beginning == mode ? offset
+    : seek_end       == mode ? get_size() + offset // offsets from the end are negative already
+    :                          m_position + offset;
+
+  if (!can_overwrite(new_position))
+    throw mtx::mm_io::seek_x{};
+
+  m_position = new_position;
+}
+
+bool
+mm_stream_output_io_c::eof() {
+  return false;
+}
+
+int64_t
+mm_stream_output_io_c::get_size() {
+  return m_flushed + m_buffer.size();
+}
+
+std::string
+mm_stream_output_io_c::get_file_name()
+  const {
+  return m_file_name;
+}
+
+bool
+mm_stream_output_io_c::can_overwrite(int64_t position)
+  const {
+  return position >= m_flushed;
+}
+
+/** \brief Stop holding back the start of the output
+
+   Everything but the most recently written bytes is passed on.
+*/
+void
+mm_stream_output_io_c::release_head() {
+  m_holding_head = false;
+
+  auto passable = m_position - m_flushed - static_cast<int64_t>(s_tail_size);
+  if (0 < passable)
+    pass_on(passable);
+}
+
+void
+mm_stream_output_io_c::pass_on(size_t num_bytes) {
+  num_bytes = std::min(num_bytes, m_buffer.size());
+  if (!num_bytes)
+    return;
+
+  if (m_out->write(&m_buffer[0], num_bytes) != num_bytes)
+    throw mtx::mm_io::insufficient_space_x{};
+
+  m_buffer.erase(m_buffer.begin(), m_buffer.begin() + num_bytes);
+  m_flushed += num_bytes;
+}
+
+uint32
+mm_stream_output_io_c::_read(void *buffer,
+                             size_t size) {
+  auto offset   = m_position - m_flushed;
+  auto num_read = std::min<int64_t>(size, std::max<int64_t>(static_cast<int64_t>(m_buffer.size()) - offset, 0));
+
+  if (num_read)
+    std::memcpy(buffer, &m_buffer[offset], num_read);
+
+  m_position += num_read;
+
+  return num_read;
+}
+
+size_t
+mm_stream_output_io_c::_write(const void *buffer,
+                              size_t size) {
+  auto offset = static_cast<size_t>(m_position - m_flushed);
+
+  if ((offset + size) > m_buffer.size())
+    m_buffer.resize(offset + size);
+
+  std::memcpy(&m_buffer[offset], buffer, size);
+  m_position += size;
+
+  if (m_holding_head && (static_cast<size_t>(get_size()) > m_max_head_size))
+    m_holding_head = false;
+
+  // Pass data on in large chunks so that the buffer isn't shifted
+  // around after every write.
+  if (!m_holding_head && ((m_position - m_flushed) >= static_cast<int64_t>(2 * s_tail_size)))
+    pass_on(m_position - m_flushed - s_tail_size);
+
+  return size;
+}
+
+/** \brief Pass on all data and close the output
+*/
+void
+mm_stream_output_io_c::close() {
+  if (!m_out)
+    return;
+
+  pass_on(m_buffer.size());
+  m_out->flush();
+  m_out->close();
+  m_out.reset();
+}
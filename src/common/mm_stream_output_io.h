@@ -0,0 +1,67 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class for non-seekable output
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MM_STREAM_OUTPUT_IO_H
+#define MTX_COMMON_MM_STREAM_OUTPUT_IO_H
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+
+/* Writes to an output that cannot seek, e.g. a pipe or the standard
+   output. The start of the output is held back in memory so that
+   headers can still be overwritten, e.g. when the track headers change
+   after the first frames have been processed. It is written once
+   release_head() is called or once it grows beyond a limit. After that
+   only the most recently written bytes are kept in memory and can be
+   overwritten.
+
+   Seeking to a position that has already been passed on to the output
+   throws mtx::mm_io::seek_x. Use can_overwrite() to check beforehand. */
+class mm_stream_output_io_c: public mm_io_c {
+protected:
+  static size_t const s_default_max_head_size = 16 * 1024 * 1024;
+  static size_t const s_tail_size             = 1024 * 1024;
+
+  mm_io_cptr m_out;
+  std::string m_file_name;
+  // The bytes not passed on yet, starting at m_flushed.
+  std::vector<unsigned char> m_buffer;
+  int64_t m_flushed, m_position;
+  size_t m_max_head_size;
+  bool m_holding_head;
+
+public:
+  mm_stream_output_io_c(mm_io_cptr const &out, std::string const &file_name, size_t max_head_size = s_default_max_head_size);
+  virtual ~mm_stream_output_io_c();
+
+  virtual uint64 getFilePointer();
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
+  virtual bool eof();
+  virtual int64_t get_size();
+  virtual void close();
+  virtual std::string get_file_name() const;
+
+  bool can_overwrite(int64_t position) const;
+  void release_head();
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size);
+  virtual size_t _write(const void *buffer, size_t size);
+
+  void pass_on(size_t num_bytes);
+};
+
+using mm_stream_output_io_cptr = std::shared_ptr<mm_stream_output_io_c>;
+
+#endif  // MTX_COMMON_MM_STREAM_OUTPUT_IO_H
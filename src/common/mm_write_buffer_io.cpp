@@ -16,10 +16,12 @@
 
 #include "common/mm_io_x.h"
 #include "common/mm_write_buffer_io.h"
+#include "common/tracing.h"
 
 mm_write_buffer_io_c::mm_write_buffer_io_c(mm_io_c *out,
                                            size_t buffer_size,
-                                           bool delete_out)
+                                           bool delete_out,
+                                           unsigned int num_buffers)
   : mm_proxy_io_c(out, delete_out)
   , m_af_buffer(memory_c::alloc(buffer_size))
   , m_buffer(m_af_buffer->get_buffer())
@@ -27,7 +29,27 @@ mm_write_buffer_io_c::mm_write_buffer_io_c(mm_io_c *out,
   , m_size(buffer_size)
   , m_debug_seek{ "write_buffer_io|write_buffer_io_read"}
   , m_debug_write{"write_buffer_io|write_buffer_io_write"}
+  , m_position{}
+  , m_writing{}
+  , m_stop_writer{}
+  , m_current_ring_buffer{}
+  , m_fd{-1}
 {
+  mtx::mem::component_scope_c memory_scope{mtx::mem::component_e::io_buffers};
+
+  m_af_buffer->set_accounting_component(mtx::mem::component_e::io_buffers);
+
+  if (io_uring_c::is_enabled() && create_ring(std::max(num_buffers, 2u)))
+    return;
+
+  if (1 >= num_buffers)
+    return;
+
+  for (auto idx = 1u; idx < num_buffers; ++idx)
+    m_free_buffers.push_back(memory_c::alloc(buffer_size));
+
+  m_position = m_proxy_io->getFilePointer();
+  m_writer   = std::thread{[this]() { run_writer(); }};
 }
 
 mm_write_buffer_io_c::~mm_write_buffer_io_c() {
@@ -36,18 +58,64 @@ mm_write_buffer_io_c::~mm_write_buffer_io_c() {
 
 mm_io_cptr
 mm_write_buffer_io_c::open(const std::string &file_name,
-                           size_t buffer_size) {
-  return mm_io_cptr(new mm_write_buffer_io_c(new mm_file_io_c(file_name, MODE_CREATE), buffer_size));
+                           size_t buffer_size,
+                           unsigned int num_buffers) {
+  return mm_io_cptr(new mm_write_buffer_io_c(new mm_file_io_c(file_name, MODE_CREATE), buffer_size, true, num_buffers));
+}
+
+bool
+mm_write_buffer_io_c::writing_behind()
+  const {
+  return m_writer.joinable() || m_ring;
+}
+
+bool
+mm_write_buffer_io_c::create_ring(unsigned int num_buffers) {
+  m_fd = io_uring_c::get_file_descriptor(*m_proxy_io);
+  if (0 > m_fd)
+    return false;
+
+  m_ring_buffers.push_back(m_af_buffer);
+  for (auto idx = 1u; idx < num_buffers; ++idx) {
+    m_ring_buffers.push_back(memory_c::alloc(m_size));
+    m_free_ring_buffers.push_back(idx);
+  }
+
+  try {
+    m_ring = std::make_unique<io_uring_c>(m_ring_buffers);
+
+  } catch (mtx::mm_io::exception &ex) {
+    mxdebug_if(m_debug_write, boost::format("io_uring not usable, falling back to regular writes: %1%\n") % ex.code().message());
+
+    m_ring_buffers.clear();
+    m_free_ring_buffers.clear();
+
+    return false;
+  }
+
+  m_ring_requests.resize(num_buffers);
+
+  // Data written through the stdio buffers must reach the file before
+  // the kernel writes the buffers at explicit offsets.
+  m_proxy_io->flush();
+  m_position = m_proxy_io->getFilePointer();
+
+  return true;
 }
 
 uint64
 mm_write_buffer_io_c::getFilePointer() {
-  return mm_proxy_io_c::getFilePointer() + m_fill;
+  // The underlying file's position changes while the writer thread
+  // is busy. Therefore it is tracked separately.
+  return (writing_behind() ? m_position : mm_proxy_io_c::getFilePointer()) + m_fill;
 }
 
 void
 mm_write_buffer_io_c::setFilePointer(int64 offset,
                                      seek_mode mode) {
+  if (seek_end == mode)
+    wait_for_pending_buffers();
+
   int64_t new_pos
     = seek_beginning == mode ? offset
     : seek_end       == mode ? m_proxy_io->get_size() + offset // offsets from the end are negative already
@@ -56,7 +124,7 @@ mm_write_buffer_io_c::setFilePointer(int64 offset,
   if (new_pos == static_cast<int64_t>(getFilePointer()))
     return;
 
-  flush_buffer();
+  wait_for_pending_buffers();
 
   if (m_debug_seek) {
     int64_t previous_pos = mm_proxy_io_c::getFilePointer();
@@ -64,25 +132,53 @@ mm_write_buffer_io_c::setFilePointer(int64 offset,
   }
 
   mm_proxy_io_c::setFilePointer(offset, mode);
+
+  if (writing_behind())
+    m_position = mm_proxy_io_c::getFilePointer();
 }
 
 void
 mm_write_buffer_io_c::flush() {
-  flush_buffer();
+  mtx::trace::span_c span{"io", "flush"};
+
+  wait_for_pending_buffers();
   mm_proxy_io_c::flush();
 }
 
+bool
+mm_write_buffer_io_c::insert_space(uint64_t offset,
+                                   uint64_t size) {
+  wait_for_pending_buffers();
+
+  m_cached_size = -1;
+
+  return mm_proxy_io_c::insert_space(offset, size);
+}
+
 void
 mm_write_buffer_io_c::close() {
-  flush_buffer();
+  try {
+    wait_for_pending_buffers();
+  } catch (...) {
+    stop_writer();
+    throw;
+  }
+
+  stop_writer();
   mm_proxy_io_c::close();
 }
 
 uint32
 mm_write_buffer_io_c::_read(void *buffer,
                             size_t size) {
-  flush_buffer();
-  return mm_proxy_io_c::_read(buffer, size);
+  wait_for_pending_buffers();
+
+  auto num_read = mm_proxy_io_c::_read(buffer, size);
+
+  if (writing_behind())
+    m_position = mm_proxy_io_c::getFilePointer();
+
+  return num_read;
 }
 
 size_t
@@ -94,7 +190,7 @@ mm_write_buffer_io_c::_write(const void *buffer,
 
   // whole blocks
   while (remain >= (avail = m_size - m_fill)) {
-    if (m_fill) {
+    if (m_fill || writing_behind()) {
       // Fill the buffer in an attempt to defeat potentially
       // lousy OS I/O scheduling
       memcpy(m_buffer + m_fill, buf, avail);
@@ -129,6 +225,13 @@ mm_write_buffer_io_c::flush_buffer() {
   if (!m_fill)
     return;
 
+  mtx::trace::span_c span{"io", "flush_buffer"};
+
+  if (writing_behind()) {
+    queue_buffer();
+    return;
+  }
+
   size_t written = mm_proxy_io_c::_write(m_buffer, m_fill);
   size_t fill    = m_fill;
   m_fill         = 0;
@@ -142,4 +245,206 @@ mm_write_buffer_io_c::flush_buffer() {
 void
 mm_write_buffer_io_c::discard_buffer() {
   m_fill = 0;
+
+  if (!writing_behind())
+    return;
+
+  if (m_ring) {
+    while (m_ring->get_num_in_flight())
+      handle_ring_completion();
+
+    m_write_error = nullptr;
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  for (auto &pending : m_pending_buffers)
+    m_free_buffers.push_back(pending.buffer);
+  m_pending_buffers.clear();
+
+  m_cond.wait(lock, [this]() { return !m_writing; });
+
+  m_write_error = nullptr;
+}
+
+void
+mm_write_buffer_io_c::rethrow_write_error() {
+  if (!m_write_error)
+    return;
+
+  auto error    = m_write_error;
+  m_write_error = nullptr;
+
+  std::rethrow_exception(error);
+}
+
+/** \brief Hand the current buffer over to the writer thread
+
+   Blocks until another buffer is available for filling. Errors that
+   occurred while writing earlier buffers are re-thrown here.
+*/
+void
+mm_write_buffer_io_c::queue_buffer() {
+  if (m_ring) {
+    queue_buffer_in_ring();
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  m_pending_buffers.push_back(pending_buffer_t{ m_af_buffer, m_fill });
+  m_position += m_fill;
+  m_fill      = 0;
+  m_af_buffer.reset();
+  m_buffer    = nullptr;
+
+  m_cond.notify_all();
+  m_cond.wait(lock, [this]() { return !m_free_buffers.empty(); });
+
+  m_af_buffer = m_free_buffers.back();
+  m_buffer    = m_af_buffer->get_buffer();
+  m_free_buffers.pop_back();
+
+  rethrow_write_error();
+}
+
+void
+mm_write_buffer_io_c::queue_buffer_in_ring() {
+  m_ring_requests[m_current_ring_buffer] = ring_request_t{ m_position, 0, m_fill };
+  m_ring->submit_write(m_fd, m_current_ring_buffer, 0, m_fill, m_position);
+
+  m_position += m_fill;
+  m_fill      = 0;
+
+  while (m_free_ring_buffers.empty())
+    handle_ring_completion();
+
+  m_current_ring_buffer = m_free_ring_buffers.back();
+  m_af_buffer           = m_ring_buffers[m_current_ring_buffer];
+  m_buffer              = m_af_buffer->get_buffer();
+  m_free_ring_buffers.pop_back();
+
+  rethrow_write_error();
+}
+
+void
+mm_write_buffer_io_c::handle_ring_completion() {
+  auto completion = m_ring->wait_for_completion();
+  auto idx        = completion.buffer_idx;
+  auto &request   = m_ring_requests[idx];
+
+  mxdebug_if(m_debug_write, boost::format("flush_buffer() via io_uring at %1% for %2% written %3%\n") % (request.file_offset + request.done) % (request.size - request.done) % completion.result);
+
+  if (0 < completion.result) {
+    request.done += completion.result;
+
+    // Short writes are continued where they left off.
+    if (request.done < request.size) {
+      m_ring->submit_write(m_fd, idx, request.done, request.size - request.done, request.file_offset + request.done);
+      return;
+    }
+
+  } else if (!m_write_error) {
+    if (0 == completion.result)
+      m_write_error = std::make_exception_ptr(mtx::mm_io::insufficient_space_x{});
+    else
+      m_write_error = std::make_exception_ptr(mtx::mm_io::read_write_x{std::error_code(-completion.result, std::generic_category())});
+  }
+
+  m_free_ring_buffers.push_back(idx);
+}
+
+void
+mm_write_buffer_io_c::wait_for_pending_buffers() {
+  flush_buffer();
+
+  if (!writing_behind())
+    return;
+
+  if (m_ring) {
+    while (m_ring->get_num_in_flight())
+      handle_ring_completion();
+
+    // The kernel wrote at explicit offsets without moving the file
+    // pointer.
+    m_proxy_io->setFilePointer(m_position);
+
+    rethrow_write_error();
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  m_cond.wait(lock, [this]() { return m_pending_buffers.empty() && !m_writing; });
+
+  rethrow_write_error();
+}
+
+void
+mm_write_buffer_io_c::stop_writer() {
+  if (m_ring) {
+    m_ring.reset();
+    return;
+  }
+
+  if (!writing_behind())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop_writer = true;
+    m_cond.notify_all();
+  }
+
+  m_writer.join();
+}
+
+void
+mm_write_buffer_io_c::run_writer() {
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  while (true) {
+    m_cond.wait(lock, [this]() { return m_stop_writer || !m_pending_buffers.empty(); });
+
+    if (m_pending_buffers.empty())
+      return;
+
+    auto pending = m_pending_buffers.front();
+    m_pending_buffers.pop_front();
+    m_writing = true;
+
+    lock.unlock();
+
+    auto error = std::exception_ptr{};
+
+    try {
+      mtx::trace::span_c span{"io", "write_behind"};
+
+      size_t written = m_proxy_io->write(pending.buffer->get_buffer(), pending.fill);
+
+      mxdebug_if(m_debug_write, boost::format("flush_buffer() in the background at %1% for %2% written %3%\n") % (m_proxy_io->getFilePointer() - written) % pending.fill % written);
+
+      if (written != pending.fill)
+        throw mtx::mm_io::insufficient_space_x();
+
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    lock.lock();
+
+    m_writing = false;
+    m_free_buffers.push_back(pending.buffer);
+
+    // Nothing after a failed write may end up in the file.
+    if (error) {
+      m_write_error = error;
+      for (auto &other : m_pending_buffers)
+        m_free_buffers.push_back(other.buffer);
+      m_pending_buffers.clear();
+    }
+
+    m_cond.notify_all();
+  }
 }
@@ -17,18 +17,61 @@
 
 #include "common/common_pch.h"
 
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "common/io_uring.h"
 #include "common/mm_io.h"
 
+/* If more than one buffer is requested then full buffers are written
+   by a background thread ("write-behind"). Writing only blocks if all
+   buffers are waiting to be written. All other operations on the
+   underlying file (seeking, reading, flushing, closing) wait until all
+   pending buffers have been written first.
+
+   If io_uring is enabled and the output is a file then the buffers
+   are submitted to the kernel instead of a thread. At least two
+   buffers are used in that case. */
 class mm_write_buffer_io_c: public mm_proxy_io_c {
 protected:
+  struct pending_buffer_t {
+    memory_cptr buffer;
+    size_t fill;
+  };
+
+  struct ring_request_t {
+    int64_t file_offset;
+    size_t done, size;
+  };
+
   memory_cptr m_af_buffer;
   unsigned char *m_buffer;
   size_t m_fill;
   const size_t m_size;
   debugging_option_c m_debug_seek, m_debug_write;
 
+  // Only used for write-behind:
+  std::thread m_writer;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::deque<pending_buffer_t> m_pending_buffers;
+  std::vector<memory_cptr> m_free_buffers;
+  std::exception_ptr m_write_error;
+  int64_t m_position;
+  bool m_writing, m_stop_writer;
+
+  // Only used for write-behind via io_uring:
+  std::vector<memory_cptr> m_ring_buffers;
+  std::unique_ptr<io_uring_c> m_ring;
+  std::vector<ring_request_t> m_ring_requests;
+  std::vector<unsigned int> m_free_ring_buffers;
+  unsigned int m_current_ring_buffer;
+  int m_fd;
+
 public:
-  mm_write_buffer_io_c(mm_io_c *out, size_t buffer_size, bool delete_out = true);
+  mm_write_buffer_io_c(mm_io_c *out, size_t buffer_size, bool delete_out = true, unsigned int num_buffers = 1);
   virtual ~mm_write_buffer_io_c();
 
   virtual uint64 getFilePointer();
@@ -36,13 +79,25 @@ public:
   virtual void flush();
   virtual void close();
   virtual void discard_buffer();
+  virtual bool insert_space(uint64_t offset, uint64_t size);
 
-  static mm_io_cptr open(const std::string &file_name, size_t buffer_size);
+  static mm_io_cptr open(const std::string &file_name, size_t buffer_size, unsigned int num_buffers = 1);
 
 protected:
   virtual uint32 _read(void *buffer, size_t size);
   virtual size_t _write(const void *buffer, size_t size);
   virtual void flush_buffer();
+
+  bool writing_behind() const;
+  void queue_buffer();
+  void wait_for_pending_buffers();
+  void stop_writer();
+  void rethrow_write_error();
+
+  bool create_ring(unsigned int num_buffers);
+  void queue_buffer_in_ring();
+  void handle_ring_completion();
+  void run_writer();
 };
 using mm_write_buffer_io_cptr = std::shared_ptr<mm_write_buffer_io_c>;
 
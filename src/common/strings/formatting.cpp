@@ -322,3 +322,27 @@ format_file_size(int64_t size) {
 
   return result.str();
 }
+
+/** \brief Quote and escape a string for use in JSON output
+
+   The string is assumed to be encoded in UTF-8 already. Only the
+   quotes, the backslash and the control characters are escaped.
+*/
+std::string
+format_json_string(std::string const &value) {
+  std::string result{"\""};
+
+  for (auto c : value) {
+    auto uc = static_cast<unsigned char>(c);
+
+    if      ('"'  == c) result += "\\\"";
+    else if ('\\' == c) result += "\\\\";
+    else if ('\n' == c) result += "\\n";
+    else if ('\r' == c) result += "\\r";
+    else if ('\t' == c) result += "\\t";
+    else if (0x20 > uc) result += (boost::format("\\u%|1$04x|") % static_cast<unsigned int>(uc)).str();
+    else                result += c;
+  }
+
+  return result + "\"";
+}
@@ -53,6 +53,7 @@ operator <<(std::ostream &out,
 }
 
 std::string format_file_size(int64_t size);
+std::string format_json_string(std::string const &value);
 
 std::string format_paragraph(const std::string &text_to_wrap,
                              int indent_column                    = 0,
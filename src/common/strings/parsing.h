@@ -16,12 +16,11 @@
 
 #include "common/common_pch.h"
 
-#include <locale.h>
+#include <locale>
+#include <sstream>
 
 #include <boost/lexical_cast.hpp>
 
-#include "common/at_scope_exit.h"
-
 namespace mtx { namespace conversion {
 
 template <bool is_unsigned>
@@ -39,6 +38,26 @@ struct unsigned_checker<true> {
   }
 };
 
+// Floating point numbers always use '.' as the decimal separator. The
+// stream's own locale is used instead of switching the process-wide
+// one as parsing may happen on several threads at the same time.
+template<typename StrT, typename ValueT>
+bool
+parse_floating_point_number(StrT const &string,
+                            ValueT &value) {
+  std::istringstream in{std::string{string}};
+  in.imbue(std::locale::classic());
+
+  ValueT parsed;
+  in >> std::noskipws >> parsed;
+
+  if (in.fail() || (std::char_traits<char>::eof() != in.peek()))
+    return false;
+
+  value = parsed;
+  return true;
+}
+
 }}
 
 template<typename StrT, typename ValueT>
@@ -58,18 +77,14 @@ template<typename StrT>
 bool
 parse_number(StrT const &string,
              double &value) {
-  std::string old_locale = setlocale(LC_NUMERIC, "C");
-  at_scope_exit_c restore_locale{ [&]() { setlocale(LC_NUMERIC, old_locale.c_str()); } };
-  return parse_number<StrT, double>(string, value);
+  return mtx::conversion::parse_floating_point_number(string, value);
 }
 
 template<typename StrT>
 bool
 parse_number(StrT const &string,
              float &value) {
-  std::string old_locale = setlocale(LC_NUMERIC, "C");
-  at_scope_exit_c restore_locale{ [&]() { setlocale(LC_NUMERIC, old_locale.c_str()); } };
-  return parse_number<StrT, float>(string, value);
+  return mtx::conversion::parse_floating_point_number(string, value);
 }
 
 extern std::string timecode_parser_error;
@@ -0,0 +1,80 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   a fixed-size pool of worker threads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/thread_pool.h"
+
+namespace mtx {
+
+thread_pool_c::thread_pool_c(unsigned int num_threads)
+  : m_stopping{}
+{
+  for (auto idx = 0u; idx < std::max(num_threads, 1u); ++idx)
+    m_threads.emplace_back([this]() { run(); });
+}
+
+thread_pool_c::~thread_pool_c() {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stopping = true;
+  }
+
+  m_job_available.notify_all();
+
+  // A job may terminate the program, e.g. via mxerror(), running the
+  // static destructors on one of the pool's own threads.
+  for (auto &thread : m_threads)
+    if (thread.get_id() == std::this_thread::get_id())
+      thread.detach();
+    else
+      thread.join();
+}
+
+unsigned int
+thread_pool_c::get_num_threads()
+  const {
+  return m_threads.size();
+}
+
+void
+thread_pool_c::enqueue(std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_jobs.push_back(std::move(job));
+  }
+
+  m_job_available.notify_one();
+}
+
+void
+thread_pool_c::run() {
+  while (true) {
+    std::function<void()> job;
+
+    {
+      std::unique_lock<std::mutex> lock{m_mutex};
+      m_job_available.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+
+      if (m_jobs.empty())
+        return;
+
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+    }
+
+    job();
+  }
+}
+
+}
@@ -0,0 +1,64 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   a fixed-size pool of worker threads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_THREAD_POOL_H
+#define MTX_COMMON_THREAD_POOL_H
+
+#include "common/common_pch.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace mtx {
+
+/* Runs submitted jobs on a fixed number of threads in the order they
+   were submitted. Results and exceptions are delivered through the
+   std::future returned by submit(). Jobs still queued when the pool is
+   destroyed are run before the threads are joined. */
+class thread_pool_c {
+protected:
+  std::vector<std::thread> m_threads;
+  std::deque<std::function<void()>> m_jobs;
+  std::mutex m_mutex;
+  std::condition_variable m_job_available;
+  bool m_stopping;
+
+public:
+  thread_pool_c(unsigned int num_threads);
+  ~thread_pool_c();
+
+  unsigned int get_num_threads() const;
+
+  template<typename Tfunc>
+  std::future<typename std::result_of<Tfunc()>::type>
+  submit(Tfunc func) {
+    auto job    = std::make_shared<std::packaged_task<typename std::result_of<Tfunc()>::type()>>(std::move(func));
+    auto result = job->get_future();
+
+    enqueue([job]() { (*job)(); });
+
+    return result;
+  }
+
+protected:
+  void enqueue(std::function<void()> job);
+  void run();
+};
+
+}
+
+#endif  // MTX_COMMON_THREAD_POOL_H
@@ -0,0 +1,177 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   recording of timed spans in the Chrome trace event format
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include "common/mm_io.h"
+#include "common/mm_io_x.h"
+#include "common/strings/formatting.h"
+#include "common/tracing.h"
+
+namespace mtx { namespace trace {
+
+bool g_enabled = false;
+
+namespace {
+
+struct span_t {
+  char const *category, *name;
+  int64_t start_ns, end_ns, track;
+  unsigned int thread_id;
+};
+
+std::mutex s_mutex;
+std::string s_file_name;
+std::vector<span_t> s_spans;
+size_t s_max_num_spans = 0;
+uint64_t s_num_recorded = 0;
+int64_t s_start_ns = 0;
+
+std::atomic<unsigned int> s_next_thread_id{1};
+thread_local unsigned int tl_thread_id = 0;
+
+unsigned int
+get_thread_id() {
+  if (!tl_thread_id)
+    tl_thread_id = s_next_thread_id++;
+
+  return tl_thread_id;
+}
+
+std::string
+format_span(span_t const &span) {
+  auto args = -1 == span.track ? std::string{} : (boost::format(",\"args\":{\"track\":%1%}") % span.track).str();
+
+  return (boost::format("{\"name\":%1%,\"cat\":%2%,\"ph\":\"X\",\"ts\":%|3$.3f|,\"dur\":%|4$.3f|,\"pid\":1,\"tid\":%5%%6%}")
+          % format_json_string(span.name)
+          % format_json_string(span.category)
+          % ((span.start_ns - s_start_ns) / 1000.0)
+          % ((span.end_ns - span.start_ns) / 1000.0)
+          % span.thread_id
+          % args).str();
+}
+
+}
+
+/** \brief Start recording spans
+
+   Only the most recent \c max_num_spans spans are kept. They're
+   written to \c file_name by \c write().
+*/
+void
+enable(std::string const &file_name,
+       size_t max_num_spans) {
+  std::lock_guard<std::mutex> lock{s_mutex};
+
+  s_file_name     = file_name;
+  s_max_num_spans = std::max<size_t>(max_num_spans, 1);
+  s_num_recorded  = 0;
+  s_start_ns      = get_time_ns();
+  g_enabled       = true;
+
+  s_spans.clear();
+}
+
+void
+disable() {
+  std::lock_guard<std::mutex> lock{s_mutex};
+
+  g_enabled      = false;
+  s_num_recorded = 0;
+
+  s_spans.clear();
+  s_spans.shrink_to_fit();
+}
+
+int64_t
+get_time_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void
+add_span(char const *category,
+         char const *name,
+         int64_t start_ns,
+         int64_t end_ns,
+         int64_t track) {
+  auto span = span_t{ category, name, start_ns, end_ns, track, get_thread_id() };
+
+  std::lock_guard<std::mutex> lock{s_mutex};
+
+  if (!g_enabled)
+    return;
+
+  // Once the buffer is full the oldest span is overwritten.
+  if (s_spans.size() < s_max_num_spans)
+    s_spans.push_back(span);
+  else
+    s_spans[s_num_recorded % s_max_num_spans] = span;
+
+  ++s_num_recorded;
+}
+
+/** \brief Write the recorded spans as a JSON object in the Chrome trace
+    event format
+
+   Each span is a complete event ("ph":"X") with its start time and
+   duration in microseconds relative to the moment tracing was
+   enabled. The number of spans that were overwritten is reported as
+   \c dropped_spans.
+*/
+void
+write(mm_io_c &out) {
+  std::lock_guard<std::mutex> lock{s_mutex};
+
+  auto num_spans = s_spans.size();
+  auto first     = s_num_recorded > num_spans ? s_num_recorded % num_spans : 0;
+  auto content   = std::string{"{\"traceEvents\":[\n"};
+
+  for (auto idx = 0u; idx < num_spans; ++idx) {
+    content += format_span(s_spans[(first + idx) % num_spans]) + ((idx + 1) < num_spans ? ",\n" : "\n");
+
+    if (content.size() >= 1024 * 1024) {
+      out.write(content);
+      content.clear();
+    }
+  }
+
+  content += (boost::format("],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_spans\":%1%}}\n") % (s_num_recorded - num_spans)).str();
+  out.write(content);
+}
+
+/** \brief Write the recorded spans to the file given to \c enable() and
+    stop tracing
+
+   Called when the program exits.
+*/
+void
+write() {
+  if (!g_enabled)
+    return;
+
+  try {
+    mm_file_io_c out{s_file_name, MODE_CREATE};
+    write(out);
+
+  } catch (mtx::mm_io::exception &ex) {
+    mxwarn(boost::format(Y("The trace file '%1%' could not be written: %2%.\n")) % s_file_name % ex);
+  }
+
+  disable();
+}
+
+}}
@@ -0,0 +1,68 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   recording of timed spans in the Chrome trace event format
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_TRACING_H
+#define MTX_COMMON_TRACING_H
+
+#include "common/common_pch.h"
+
+class mm_io_c;
+
+namespace mtx { namespace trace {
+
+/* Spans are kept in memory in a ring buffer holding the most recent
+   ones and are written when the program exits. The file can be loaded
+   into chrome://tracing or the Perfetto UI. Recording a span while
+   tracing is disabled costs a single check of a flag. */
+
+extern bool g_enabled;
+
+inline bool
+is_enabled() {
+  return g_enabled;
+}
+
+void enable(std::string const &file_name, size_t max_num_spans = 1024 * 1024);
+void disable();
+
+int64_t get_time_ns();
+void add_span(char const *category, char const *name, int64_t start_ns, int64_t end_ns, int64_t track = -1);
+
+void write(mm_io_c &out);
+void write();
+
+class span_c {
+protected:
+  char const *m_category, *m_name;
+  int64_t m_track, m_start_ns;
+
+public:
+  span_c(char const *category,
+         char const *name,
+         int64_t track = -1)
+    : m_category{category}
+    , m_name{name}
+    , m_track{track}
+    , m_start_ns{is_enabled() ? get_time_ns() : -1}
+  {
+  }
+
+  ~span_c() {
+    if (-1 != m_start_ns)
+      add_span(m_category, m_name, m_start_ns, get_time_ns(), m_track);
+  }
+};
+
+}}
+
+#endif  // MTX_COMMON_TRACING_H
@@ -13,6 +13,7 @@
 
 #include "common/common_pch.h"
 
+#include "common/compression.h"
 #include "common/ebml.h"
 #include "common/strings/formatting.h"
 #include "common/strings/parsing.h"
@@ -58,7 +59,8 @@ extract_cli_parser_c::init_parser() {
                      "All other options depend on the mode."));
 
   add_section_header(YT("Global options"));
-  OPT("f|parse-fully",    set_parse_fully,      YT("Parse the whole file instead of relying on the index."));
+  OPT("f|parse-fully",         set_parse_fully,         YT("Parse the whole file instead of relying on the index."));
+  OPT("compression-threads=n", set_compression_threads, YT("Decompress frames stored with zlib compression on n threads."));
 
   add_common_options();
 
@@ -145,6 +147,15 @@ extract_cli_parser_c::set_parse_fully() {
   m_options.m_parse_mode = kax_analyzer_c::parse_mode_full;
 }
 
+void
+extract_cli_parser_c::set_compression_threads() {
+  unsigned int num_threads;
+  if (!parse_number(m_next_arg, num_threads))
+    mxerror(boost::format(Y("Invalid number of threads in '--compression-threads %1%'.\n")) % m_next_arg);
+
+  compressor_c::set_num_threads(num_threads);
+}
+
 void
 extract_cli_parser_c::set_charset() {
   assert_mode(options_c::em_tracks);
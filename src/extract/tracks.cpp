@@ -32,9 +32,12 @@
 #include <matroska/KaxTrackAudio.h>
 #include <matroska/KaxTrackVideo.h>
 
+#include "common/compression.h"
 #include "common/ebml.h"
+#include "common/io_uring.h"
 #include "common/kax_file.h"
 #include "common/mm_io_x.h"
+#include "common/mm_read_buffer_io.h"
 #include "common/mm_write_buffer_io.h"
 #include "extract/mkvextract.h"
 #include "extract/xtr_base.h"
@@ -244,6 +247,51 @@ handle_simpleblock(KaxSimpleBlock &simpleblock,
   return max_timecode;
 }
 
+static xtr_base_c *
+find_extractor(uint64_t track_num) {
+  for (auto extractor : extractors)
+    if (extractor->m_track_num == static_cast<int64_t>(track_num))
+      return extractor;
+
+  return nullptr;
+}
+
+// Decompresses the frames of all extracted tracks on the compressor
+// thread pool while the blocks are handled in order.
+static void
+start_reversing_encodings(KaxCluster &cluster) {
+  if (!compressor_c::get_thread_pool())
+    return;
+
+  for (auto element : cluster) {
+    KaxInternalBlock *block = nullptr;
+
+    if (Is<KaxSimpleBlock>(element))
+      block = static_cast<KaxSimpleBlock *>(element);
+
+    else if (Is<KaxBlockGroup>(element))
+      block = FindChild<KaxBlock>(static_cast<KaxBlockGroup *>(element));
+
+    auto extractor = block ? find_extractor(block->TrackNum()) : nullptr;
+    if (!extractor || !extractor->m_content_decoder.has_encodings())
+      continue;
+
+    for (auto idx = 0u, num_frames = block->NumberFrames(); idx < num_frames; ++idx) {
+      auto &data = block->GetBuffer(idx);
+      extractor->m_content_decoder.start_reversing(std::make_shared<memory_c>(data.Buffer(), data.Size(), false), CONTENT_ENCODING_SCOPE_BLOCK);
+    }
+  }
+}
+
+static void
+discard_pending_frames() {
+  if (!compressor_c::get_thread_pool())
+    return;
+
+  for (auto extractor : extractors)
+    extractor->m_content_decoder.discard_pending();
+}
+
 static void
 close_extractors() {
   size_t i;
@@ -352,7 +400,7 @@ extract_tracks(const std::string &file_name,
   mm_io_cptr in;
   kax_file_cptr file;
   try {
-    in   = mm_file_io_c::open(file_name);
+    in   = io_uring_c::is_enabled() || mm_read_buffer_io_c::get_read_ahead_buffers() ? mm_read_buffer_io_c::open(file_name, 1 << 20) : mm_file_io_c::open(file_name);
     file = kax_file_cptr(new kax_file_c(in));
   } catch (mtx::mm_io::exception &ex) {
     show_error(boost::format(Y("The file '%1%' could not be opened for reading: %2%.\n")) % file_name % ex);
@@ -447,6 +495,8 @@ extract_tracks(const std::string &file_name,
         } else
           cluster->InitTimecode(0, tc_scale);
 
+        start_reversing_encodings(*cluster);
+
         size_t i;
         int64_t max_timecode = -1;
 
@@ -466,6 +516,8 @@ extract_tracks(const std::string &file_name,
           max_timecode = std::max(max_timecode, max_bg_timecode);
         }
 
+        discard_pending_frames();
+
         if (-1 != max_timecode)
           file->set_last_timecode(max_timecode);
 
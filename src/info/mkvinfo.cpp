@@ -59,9 +59,11 @@
 #include "common/endian.h"
 #include "common/fourcc.h"
 #include "common/hevc.h"
+#include "common/io_uring.h"
 #include "common/kax_file.h"
 #include "common/mm_io.h"
 #include "common/mm_io_x.h"
+#include "common/mm_read_buffer_io.h"
 #include "common/mpeg4_p10.h"
 #include "common/stereo_mode.h"
 #include "common/strings/editing.h"
@@ -1658,7 +1660,7 @@ process_file(const std::string &file_name) {
   // open input file
   mm_io_cptr in;
   try {
-    in = mm_file_io_c::open(file_name);
+    in = io_uring_c::is_enabled() || mm_read_buffer_io_c::get_read_ahead_buffers() ? mm_read_buffer_io_c::open(file_name, 1 << 20) : mm_file_io_c::open(file_name);
   } catch (mtx::mm_io::exception &ex) {
     show_error((boost::format(Y("Error: Couldn't open input file %1% (%2%).")) % file_name % ex).str());
     return false;
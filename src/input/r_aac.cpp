@@ -123,9 +123,9 @@ aac_reader_c::create_packetizer(int64_t) {
 file_status_e
 aac_reader_c::read(generic_packetizer_c *,
                    bool) {
-  int remaining_bytes = m_size - m_in->getFilePointer();
-  int read_len        = std::min(INITCHUNKSIZE, remaining_bytes);
-  int num_read        = m_in->read(m_chunk, read_len);
+  int64_t remaining_bytes = m_size - m_in->getFilePointer();
+  int64_t read_len        = std::min<int64_t>(INITCHUNKSIZE, remaining_bytes);
+  int64_t num_read        = m_in->read(m_chunk, read_len);
 
   if (0 < num_read) {
     m_parser.add_bytes(m_chunk->get_buffer(), num_read);
@@ -40,6 +40,9 @@ aac_adif_reader_c::probe_file(mm_io_c *in,
 
     return 0;
 
+  } catch (mtx::id::unsupported_container_x &) {
+    throw;
+
   } catch (...) {
     return 0;
   }
@@ -37,6 +37,9 @@ cdxa_reader_c::probe_file(mm_io_c *in,
       return true;
     }
 
+  } catch (mtx::id::unsupported_container_x &) {
+    throw;
+
   } catch (...) {
   }
 
@@ -70,6 +70,9 @@ dv_reader_c::probe_file(mm_io_c *in,
       return 1;
     }
 
+  } catch (mtx::id::unsupported_container_x &) {
+    throw;
+
   } catch (...) {
   }
 
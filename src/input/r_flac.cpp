@@ -294,6 +294,10 @@ flac_reader_c::probe_file(mm_io_c *in,
 
     if (data == "fLaC")
       id_result_container_unsupported(in->get_file_name(), "FLAC");
+
+  } catch (mtx::id::unsupported_container_x &) {
+    throw;
+
   } catch (...) {
   }
   return false;
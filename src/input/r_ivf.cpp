@@ -17,6 +17,7 @@
 
 #include "common/endian.h"
 #include "common/ivf.h"
+#include "common/mm_io_x.h"
 #include "common/id_info.h"
 #include "input/r_ivf.h"
 #include "output/p_vpx.h"
@@ -105,8 +106,11 @@ ivf_reader_c::read(generic_packetizer_c *,
     return flush_packetizers();
   }
 
-  memory_cptr buffer = memory_c::alloc(frame_size);
-  if (m_in->read(buffer->get_buffer(), frame_size) < frame_size) {
+  // The buffer may point directly into a memory-mapped input file.
+  memory_cptr buffer;
+  try {
+    buffer = m_in->read(frame_size);
+  } catch (mtx::mm_io::end_of_file_x &) {
     m_in->setFilePointer(0, seek_end);
     return flush_packetizers();
   }
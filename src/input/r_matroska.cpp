@@ -52,6 +52,7 @@
 #include "common/iso639.h"
 #include "common/ivf.h"
 #include "common/mm_io.h"
+#include "common/mm_io_x.h"
 #include "common/strings/formatting.h"
 #include "common/strings/parsing.h"
 #include "common/strings/utf8.h"
@@ -695,6 +696,28 @@ kax_reader_c::has_deferred_element_been_processed(kax_reader_c::deferred_l1_type
   return false;
 }
 
+/** \brief Save the current position and seek to a deferred element
+
+   Inputs that cannot seek, e.g. pipes, cannot reach elements that are
+   located far behind the first cluster. Such elements are skipped.
+*/
+bool
+kax_reader_c::save_pos_for_deferred_element(mm_io_c *io,
+                                            int64_t position) {
+  io->save_pos();
+
+  try {
+    io->setFilePointer(position);
+    return true;
+
+  } catch (mtx::mm_io::seek_x &) {
+    io->restore_pos();
+    mxwarn_fn(m_ti.m_fname, boost::format(Y("The element at position %1% cannot be read as the input cannot be seeked in. It will be skipped.\n")) % position);
+  }
+
+  return false;
+}
+
 void
 kax_reader_c::handle_attachments(mm_io_c *io,
                                  EbmlElement *l0,
@@ -702,7 +725,9 @@ kax_reader_c::handle_attachments(mm_io_c *io,
   if (has_deferred_element_been_processed(dl1t_attachments, pos))
     return;
 
-  io->save_pos(pos);
+  if (!save_pos_for_deferred_element(io, pos))
+    return;
+
   at_scope_exit_c restore([&]() { io->restore_pos(); });
 
   int upper_lvl_el = 0;
@@ -754,7 +779,9 @@ kax_reader_c::handle_chapters(mm_io_c *io,
   if (has_deferred_element_been_processed(dl1t_chapters, pos))
     return;
 
-  io->save_pos(pos);
+  if (!save_pos_for_deferred_element(io, pos))
+    return;
+
   at_scope_exit_c restore([&]() { io->restore_pos(); });
 
   int upper_lvl_el = 0;
@@ -783,7 +810,9 @@ kax_reader_c::handle_tags(mm_io_c *io,
   if (has_deferred_element_been_processed(dl1t_tags, pos))
     return;
 
-  io->save_pos(pos);
+  if (!save_pos_for_deferred_element(io, pos))
+    return;
+
   at_scope_exit_c restore([&]() { io->restore_pos(); });
 
   int upper_lvl_el = 0;
@@ -864,7 +893,9 @@ kax_reader_c::read_headers_info(mm_io_c *io,
   if (has_deferred_element_been_processed(dl1t_info, pos))
     return;
 
-  io->save_pos(pos);
+  if (!save_pos_for_deferred_element(io, pos))
+    return;
+
   at_scope_exit_c restore([&]() { io->restore_pos(); });
 
   int upper_lvl_el = 0;
@@ -1018,8 +1049,10 @@ kax_reader_c::read_headers_tracks(mm_io_c *io,
   if (has_deferred_element_been_processed(dl1t_tracks, position))
     return;
 
+  if (!save_pos_for_deferred_element(io, position))
+    return;
+
   int upper_lvl_el = 0;
-  io->save_pos(position);
   EbmlElement *l1 = m_es->FindNextElement(EBML_CONTEXT(l0), upper_lvl_el, 0xFFFFFFFFL, true);
 
   if (!l1 || !Is<KaxTracks>(l1)) {
@@ -1975,6 +2008,8 @@ kax_reader_c::read(generic_packetizer_c *requested_ptzr,
         adjust_chapter_timecodes(*m_chapters, -m_first_timecode);
     }
 
+    start_reversing_encodings(*cluster);
+
     size_t bgidx;
     for (bgidx = 0; bgidx < cluster->ListSize(); bgidx++) {
       EbmlElement *element = (*cluster)[bgidx];
@@ -1986,6 +2021,8 @@ kax_reader_c::read(generic_packetizer_c *requested_ptzr,
         process_block_group(cluster, static_cast<KaxBlockGroup *>(element));
     }
 
+    discard_pending_frames();
+
     delete cluster;
 
   } catch (...) {
@@ -2082,6 +2119,46 @@ kax_reader_c::process_simple_block(KaxCluster *cluster,
   block_track->units_processed   += block_simple->NumberFrames();
 }
 
+/* Decompresses the frames of all tracks stored with thread-safe
+   content encodings on the compressor thread pool while the blocks are
+   processed in order. */
+void
+kax_reader_c::start_reversing_encodings(KaxCluster &cluster) {
+  if (!compressor_c::get_thread_pool())
+    return;
+
+  for (auto element : cluster) {
+    KaxInternalBlock *block = nullptr;
+
+    if (Is<KaxSimpleBlock>(element))
+      block = static_cast<KaxSimpleBlock *>(element);
+
+    else if (Is<KaxBlockGroup>(element))
+      block = FindChild<KaxBlock>(static_cast<KaxBlockGroup *>(element));
+
+    if (!block)
+      continue;
+
+    auto track = find_track_by_num(block->TrackNum());
+    if (!track || (-1 == track->ptzr) || !track->content_decoder.has_encodings())
+      continue;
+
+    for (auto idx = 0u, num_frames = block->NumberFrames(); idx < num_frames; ++idx) {
+      auto &data_buffer = block->GetBuffer(idx);
+      track->content_decoder.start_reversing(std::make_shared<memory_c>(data_buffer.Buffer(), data_buffer.Size(), false), CONTENT_ENCODING_SCOPE_BLOCK);
+    }
+  }
+}
+
+void
+kax_reader_c::discard_pending_frames() {
+  if (!compressor_c::get_thread_pool())
+    return;
+
+  for (auto &track : m_tracks)
+    track->content_decoder.discard_pending();
+}
+
 void
 kax_reader_c::process_block_group_common(KaxBlockGroup *block_group,
                                          packet_t *packet) {
@@ -2238,7 +2315,7 @@ kax_reader_c::get_progress() {
   if (0 != m_segment_duration)
     return (m_last_timecode - std::max(m_first_timecode, static_cast<int64_t>(0))) * 100 / m_segment_duration;
 
-  return 100 * m_in->getFilePointer() / m_size;
+  return generic_reader_c::get_progress();
 }
 
 void
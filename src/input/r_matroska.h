@@ -295,9 +295,12 @@ protected:
   virtual void process_simple_block(KaxCluster *cluster, KaxSimpleBlock *block_simple);
   virtual void process_block_group(KaxCluster *cluster, KaxBlockGroup *block_group);
   virtual void process_block_group_common(KaxBlockGroup *block_group, packet_t *packet);
+  virtual void start_reversing_encodings(KaxCluster &cluster);
+  virtual void discard_pending_frames();
 
   void init_l1_position_storage(deferred_positions_t &storage);
   virtual bool has_deferred_element_been_processed(deferred_l1_type_e type, int64_t position);
+  virtual bool save_pos_for_deferred_element(mm_io_c *io, int64_t position);
 };
 
 #endif  // MTX_INPUT_R_MATROSKA_H
@@ -20,6 +20,7 @@
 #include "common/math.h"
 #include "common/strings/formatting.h"
 #include "common/tags/tags.h"
+#include "common/tracing.h"
 #include "merge/cluster_helper.h"
 #include "merge/cues.h"
 #include "merge/libmatroska_extensions.h"
@@ -118,6 +119,19 @@ cluster_helper_c::splitting()
   return !m->split_points.empty();
 }
 
+/** \brief Maximum size of the current output file
+
+   Returns 0 unless the output is split by size.
+*/
+int64_t
+cluster_helper_c::get_split_size_limit()
+  const {
+  if (!splitting() || (m->split_points.end() == m->current_split_point) || (split_point_c::size != m->current_split_point->m_type))
+    return 0;
+
+  return m->current_split_point->m_point;
+}
+
 bool
 cluster_helper_c::discarding()
   const {
@@ -333,7 +347,6 @@ cluster_helper_c::set_duration(render_groups_c *rg) {
   if (rg->m_durations.empty())
     return;
 
-  kax_block_blob_c *group = rg->m_groups.back().get();
   int64_t def_duration    = rg->m_source->get_track_default_duration();
   int64_t block_duration  = 0;
 
@@ -348,13 +361,22 @@ cluster_helper_c::set_duration(render_groups_c *rg) {
     if (   (0 == block_duration)
         || (   (0 < block_duration)
             && (block_duration != (static_cast<int64_t>(rg->m_durations.size()) * def_duration))))
-      group->set_block_duration(RND_TIMECODE_SCALE(block_duration));
+      set_block_duration(rg, RND_TIMECODE_SCALE(block_duration));
 
   } else if (   (   g_use_durations
                  || (0 < def_duration))
              && (0 < block_duration)
              && (RND_TIMECODE_SCALE(block_duration) != RND_TIMECODE_SCALE(rg->m_durations.size() * def_duration)))
-    group->set_block_duration(RND_TIMECODE_SCALE(block_duration));
+    set_block_duration(rg, RND_TIMECODE_SCALE(block_duration));
+}
+
+void
+cluster_helper_c::set_block_duration(render_groups_c *rg,
+                                     int64_t duration) {
+  if (-1 != rg->m_direct_block_idx)
+    m->cluster_serializer.set_block_duration(rg->m_direct_block_idx, duration);
+  else
+    rg->m_groups.back()->set_block_duration(duration);
 }
 
 bool
@@ -392,6 +414,8 @@ cluster_helper_c::must_duration_be_set(render_groups_c *rg,
 
 int
 cluster_helper_c::render() {
+  mtx::trace::span_c span{"muxer", "render"};
+
   std::vector<render_groups_cptr> render_groups;
   KaxCues cues;
   cues.SetGlobalTimecodeScale(g_timecode_scale);
@@ -406,6 +430,11 @@ cluster_helper_c::render() {
   int elements_in_cluster = 0;
   bool added_to_cues      = false;
 
+  // Clusters consisting of plain blocks only are serialized directly
+  // instead of building libmatroska element trees for them.
+  bool serialize_directly = can_render_directly();
+  std::vector<size_t> direct_cue_blocks;
+
   // Splitpoint stuff
   if ((-1 == m->header_overhead) && splitting())
     m->header_overhead = m->out->getFilePointer() + g_tags_size;
@@ -447,8 +476,6 @@ cluster_helper_c::render() {
     min_cl_timecode                        = std::min(pack->assigned_timecode, min_cl_timecode);
     max_cl_timecode                        = std::max(pack->assigned_timecode, max_cl_timecode);
 
-    DataBuffer *data_buffer                = new DataBuffer((binary *)pack->data->get_buffer(), pack->data->get_size());
-
     KaxTrackEntry &track_entry             = static_cast<KaxTrackEntry &>(*source->get_track_entry());
 
     kax_block_blob_c *previous_block_group = !render_group->m_groups.empty() ? render_group->m_groups.back().get() : nullptr;
@@ -473,10 +500,15 @@ cluster_helper_c::render() {
         : pack->has_discard_padding()              ? BLOCK_BLOB_NO_SIMPLE
         :                                            BLOCK_BLOB_ALWAYS_SIMPLE;
 
-      render_group->m_groups.push_back(kax_block_blob_cptr(new kax_block_blob_c(this_block_blob_type)));
-      new_block_group = render_group->m_groups.back().get();
-      m->cluster->AddBlockBlob(new_block_group);
-      new_block_group->SetParent(*m->cluster);
+      if (serialize_directly)
+        render_group->m_direct_block_idx = m->cluster_serializer.add_block(source->get_track_num(), BLOCK_BLOB_ALWAYS_SIMPLE == this_block_blob_type, lacing_type);
+
+      else {
+        render_group->m_groups.push_back(kax_block_blob_cptr(new kax_block_blob_c(this_block_blob_type)));
+        new_block_group = render_group->m_groups.back().get();
+        m->cluster->AddBlockBlob(new_block_group);
+        new_block_group->SetParent(*m->cluster);
+      }
 
       added_to_cues = false;
     }
@@ -486,9 +518,17 @@ cluster_helper_c::render() {
         static_cast<before_adding_to_cluster_cb_packet_extension_c *>(extension.get())->get_callback()(pack, timecode_offset);
 
     // Now put the packet into the cluster.
-    render_group->m_more_data = new_block_group->add_frame_auto(track_entry, pack->assigned_timecode - timecode_offset, *data_buffer, lacing_type,
-                                                                pack->has_bref() ? pack->bref - timecode_offset : -1,
-                                                                pack->has_fref() ? pack->fref - timecode_offset : -1);
+    if (serialize_directly)
+      render_group->m_more_data = m->cluster_serializer.add_frame(render_group->m_direct_block_idx, pack->data, pack->assigned_timecode - timecode_offset,
+                                                                  pack->has_bref() ? pack->bref - timecode_offset : -1,
+                                                                  pack->has_fref() ? pack->fref - timecode_offset : -1);
+
+    else {
+      DataBuffer *data_buffer   = new DataBuffer((binary *)pack->data->get_buffer(), pack->data->get_size());
+      render_group->m_more_data = new_block_group->add_frame_auto(track_entry, pack->assigned_timecode - timecode_offset, *data_buffer, lacing_type,
+                                                                  pack->has_bref() ? pack->bref - timecode_offset : -1,
+                                                                  pack->has_fref() ? pack->fref - timecode_offset : -1);
+    }
 
     if (has_codec_state) {
       KaxBlockGroup &bgroup = (KaxBlockGroup &)*new_block_group;
@@ -537,7 +577,14 @@ cluster_helper_c::render() {
 
     elements_in_cluster++;
 
-    if (!new_block_group)
+    if (serialize_directly) {
+      if (g_write_cues && !added_to_cues) {
+        added_to_cues = add_to_cues_maybe(pack);
+        if (added_to_cues)
+          direct_cue_blocks.push_back(render_group->m_direct_block_idx);
+      }
+
+    } else if (!new_block_group)
       new_block_group = previous_block_group;
 
     else if (g_write_cues && (!added_to_cues || has_codec_state)) {
@@ -558,19 +605,24 @@ cluster_helper_c::render() {
       for (auto &rg : render_groups)
         set_duration(rg.get());
 
-      m->cluster->SetPreviousTimecode(min_cl_timecode - timecode_offset - 1, (int64_t)g_timecode_scale);
-      m->cluster->set_min_timecode(min_cl_timecode - timecode_offset);
-      m->cluster->set_max_timecode(max_cl_timecode - timecode_offset);
+      if (serialize_directly)
+        render_directly(min_cl_timecode - timecode_offset, direct_cue_blocks);
 
-      m->cluster->Render(*m->out, cues);
-      m->bytes_in_file += m->cluster->ElementSize();
+      else {
+        m->cluster->SetPreviousTimecode(min_cl_timecode - timecode_offset - 1, (int64_t)g_timecode_scale);
+        m->cluster->set_min_timecode(min_cl_timecode - timecode_offset);
+        m->cluster->set_max_timecode(max_cl_timecode - timecode_offset);
 
-      if (g_kax_sh_cues)
-        g_kax_sh_cues->IndexThis(*m->cluster, *g_kax_segment);
+        m->cluster->Render(*m->out, cues);
+        m->bytes_in_file += m->cluster->ElementSize();
 
-      m->previous_cluster_tc = m->cluster->GlobalTimecode();
+        if (g_kax_sh_cues)
+          g_kax_sh_cues->IndexThis(*m->cluster, *g_kax_segment);
 
-      cues_c::get().postprocess_cues(cues, *m->cluster);
+        m->previous_cluster_tc = m->cluster->GlobalTimecode();
+
+        cues_c::get().postprocess_cues(cues, *m->cluster);
+      }
 
     } else
       m->previous_cluster_tc = -1;
@@ -580,10 +632,70 @@ cluster_helper_c::render() {
   m->max_timecode_in_cluster = -1;
 
   m->cluster->delete_non_blocks();
+  m->cluster_serializer.clear();
 
   return 1;
 }
 
+/** \brief Whether or not the queued packets can be serialized directly
+
+   The cluster serializer only handles plain SimpleBlocks and BlockGroups
+   consisting of a Block, ReferenceBlocks and a BlockDuration. It is
+   only used if the development hack "direct_cluster_rendering" is
+   engaged until the regression tests have shown that it creates the
+   same files as libmatroska.
+*/
+bool
+cluster_helper_c::can_render_directly()
+  const {
+  if (!hack_engaged(ENGAGE_DIRECT_CLUSTER_RENDERING))
+    return false;
+
+  for (auto const &pack : m->packets)
+    if (   pack->codec_state
+        || !pack->data_adds.empty()
+        || pack->has_discard_padding()
+        || (0 < pack->ref_priority)
+        || pack->source->contains_gap())
+      return false;
+
+  return true;
+}
+
+void
+cluster_helper_c::render_directly(int64_t cluster_timecode,
+                                  std::vector<size_t> const &cue_blocks) {
+  auto &serializer       = m->cluster_serializer;
+  auto cluster_position  = m->out->getFilePointer();
+  m->bytes_in_file      += serializer.render(*m->out, cluster_timecode, g_timecode_scale);
+
+  auto relative_position = g_kax_segment->GetRelativePosition(cluster_position);
+
+  if (g_kax_sh_cues) {
+    binary id[4];
+    EBML_ID(KaxCluster).Fill(id);
+
+    auto &seek = AddNewChild<KaxSeek>(*g_kax_sh_cues);
+    GetChild<KaxSeekID>(seek).CopyBuffer(id, EBML_ID_LENGTH(EBML_ID(KaxCluster)));
+    GetChild<KaxSeekPosition>(seek).SetValue(relative_position);
+  }
+
+  m->previous_cluster_tc = cluster_timecode;
+
+  // Same information libmatroska's KaxCuePoint::PositionSet() provides
+  // for blocks rendered through KaxCluster::Render().
+  for (auto idx : cue_blocks) {
+    auto &block = serializer.get_blocks()[idx];
+    cues_c::get().add(block.m_timecode / g_timecode_scale * g_timecode_scale, block.m_track_num, relative_position);
+  }
+
+  std::multimap<id_timecode_t, uint64_t> block_positions;
+  for (auto const &block : serializer.get_blocks())
+    block_positions.insert({ id_timecode_t{ block.m_track_num, block.m_timecode }, block.m_position });
+
+  cues_c::get().postprocess_cues(cluster_position + serializer.get_head_size(), block_positions);
+}
+
 bool
 cluster_helper_c::add_to_cues_maybe(packet_cptr &pack) {
   auto &source  = *pack->source;
@@ -59,6 +59,7 @@ public:
   void dump_split_points() const;
   bool splitting() const;
   bool split_mode_produces_many_files() const;
+  int64_t get_split_size_limit() const;
 
   bool discarding() const;
 
@@ -71,6 +72,7 @@ public:
 
 private:
   void set_duration(render_groups_c *rg);
+  void set_block_duration(render_groups_c *rg, int64_t duration);
   bool must_duration_be_set(render_groups_c *rg, packet_cptr &new_packet);
 
   void render_before_adding_if_necessary(packet_cptr &packet);
@@ -79,6 +81,9 @@ private:
   void split(packet_cptr &packet);
 
   bool add_to_cues_maybe(packet_cptr &pack);
+
+  bool can_render_directly() const;
+  void render_directly(int64_t cluster_timecode, std::vector<size_t> const &cue_blocks);
 };
 
 extern std::unique_ptr<cluster_helper_c> g_cluster_helper;
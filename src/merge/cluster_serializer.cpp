@@ -0,0 +1,375 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   direct rendering of clusters without libebml element trees
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <matroska/KaxBlockData.h>
+#include <matroska/KaxCluster.h>
+#include <matroska/KaxClusterData.h>
+
+#include "common/endian.h"
+#include "merge/cluster_serializer.h"
+
+namespace {
+
+unsigned int
+get_uint_size(uint64_t value) {
+  auto size = 1u;
+  while ((8 > size) && (value >> (size * 8)))
+    ++size;
+
+  return size;
+}
+
+unsigned int
+get_sint_size(int64_t value) {
+  auto size = 1u;
+  while ((8 > size) && ((value < -(int64_t{1} << (size * 8 - 1))) || (value >= (int64_t{1} << (size * 8 - 1)))))
+    ++size;
+
+  return size;
+}
+
+uint64_t
+get_element_size(EbmlId const &id,
+                 uint64_t data_size) {
+  return EBML_ID_LENGTH(id) + CodedSizeLength(data_size, 0) + data_size;
+}
+
+unsigned char *
+put_head(unsigned char *cursor,
+         EbmlId const &id,
+         uint64_t data_size) {
+  id.Fill(cursor);
+  cursor += EBML_ID_LENGTH(id);
+
+  auto coded_size = CodedSizeLength(data_size, 0);
+  CodedValueLength(data_size, coded_size, cursor);
+
+  return cursor + coded_size;
+}
+
+unsigned char *
+put_uint(unsigned char *cursor,
+         EbmlId const &id,
+         uint64_t value) {
+  auto size = get_uint_size(value);
+  cursor    = put_head(cursor, id, size);
+
+  for (auto idx = size; 0 < idx; --idx, value >>= 8)
+    cursor[idx - 1] = value & 0xff;
+
+  return cursor + size;
+}
+
+unsigned char *
+put_sint(unsigned char *cursor,
+         EbmlId const &id,
+         int64_t value) {
+  auto size      = get_sint_size(value);
+  cursor         = put_head(cursor, id, size);
+  auto raw_value = static_cast<uint64_t>(value);
+
+  for (auto idx = size; 0 < idx; --idx, raw_value >>= 8)
+    cursor[idx - 1] = raw_value & 0xff;
+
+  return cursor + size;
+}
+
+}
+
+cluster_serializer_c::cluster_serializer_c()
+  : m_head_size{}
+{
+}
+
+size_t
+cluster_serializer_c::add_block(uint64_t track_num,
+                                bool simple,
+                                LacingType lacing) {
+  m_blocks.emplace_back();
+
+  auto &block         = m_blocks.back();
+  block.m_track_num   = track_num;
+  block.m_timecode    = 0;
+  block.m_duration    = -1;
+  block.m_past_ref    = -1;
+  block.m_forw_ref    = -1;
+  block.m_lacing      = lacing;
+  block.m_lacing_used = LACING_NONE;
+  block.m_simple      = simple;
+  block.m_key_frame   = true;
+  block.m_discardable = false;
+  block.m_num_frames  = 0;
+
+  return m_blocks.size() - 1;
+}
+
+/** \brief Add a frame to a block
+
+   The arguments have the same meaning as the ones of
+   kax_block_blob_c::add_frame_auto(), and so does the result: whether
+   or not another frame can be laced into the same block.
+*/
+bool
+cluster_serializer_c::add_frame(size_t block_idx,
+                                memory_cptr const &frame,
+                                int64_t timecode,
+                                int64_t past_ref,
+                                int64_t forw_ref) {
+  auto &block = m_blocks[block_idx];
+
+  assert(s_max_frames_per_block > block.m_num_frames);
+
+  if (!block.m_num_frames)
+    block.m_timecode = timecode;
+
+  block.m_frames[block.m_num_frames++] = frame;
+
+  if (block.m_simple) {
+    block.m_key_frame   = (-1 == past_ref) && (-1 == forw_ref);
+    block.m_discardable = !block.m_key_frame
+                       && (   ((-1 != forw_ref) && (forw_ref > timecode))
+                           || ((-1 != past_ref) && (past_ref > timecode)));
+
+  } else {
+    if (0 <= past_ref)
+      block.m_past_ref = past_ref;
+    if (0 <= forw_ref)
+      block.m_forw_ref = forw_ref;
+  }
+
+  // Same rules as libmatroska's: at most eight frames per block, and
+  // lacing only pays off for small frames.
+  return (s_max_frames_per_block > block.m_num_frames)
+      && (LACING_NONE            != block.m_lacing)
+      && ((6 * 0xff)             >  frame->get_size());
+}
+
+void
+cluster_serializer_c::set_block_duration(size_t block_idx,
+                                         int64_t duration) {
+  auto &block = m_blocks[block_idx];
+
+  // SimpleBlocks cannot carry a duration.
+  if (!block.m_simple)
+    block.m_duration = duration;
+}
+
+LacingType
+cluster_serializer_c::get_best_lacing_type(block_t const &block)
+  const {
+  if (1 >= block.m_num_frames)
+    return LACING_NONE;
+
+  if (LACING_AUTO != block.m_lacing)
+    return block.m_lacing;
+
+  auto same_size = true;
+  for (auto idx = 1u; idx < block.m_num_frames; ++idx)
+    if (block.m_frames[idx]->get_size() != block.m_frames[0]->get_size())
+      same_size = false;
+
+  if (same_size)
+    return LACING_FIXED;
+
+  return get_lacing_head_size(block, LACING_XIPH) < get_lacing_head_size(block, LACING_EBML) ? LACING_XIPH : LACING_EBML;
+}
+
+uint64_t
+cluster_serializer_c::get_lacing_head_size(block_t const &block,
+                                           LacingType lacing)
+  const {
+  if (LACING_NONE == lacing)
+    return 0;
+
+  auto size = uint64_t{1};
+
+  if (LACING_XIPH == lacing)
+    for (auto idx = 0u; (idx + 1) < block.m_num_frames; ++idx)
+      size += block.m_frames[idx]->get_size() / 0xff + 1;
+
+  else if (LACING_EBML == lacing) {
+    size += CodedSizeLength(block.m_frames[0]->get_size(), 0);
+    for (auto idx = 1u; (idx + 1) < block.m_num_frames; ++idx)
+      size += CodedSizeLengthSigned(static_cast<int64_t>(block.m_frames[idx]->get_size()) - static_cast<int64_t>(block.m_frames[idx - 1]->get_size()), 0);
+  }
+
+  return size;
+}
+
+uint64_t
+cluster_serializer_c::calculate_block_size(block_t &block,
+                                           int64_t timecode_scale) {
+  block.m_lacing_used = get_best_lacing_type(block);
+  block.m_data_size   = (0x80 > block.m_track_num ? 1 : 2) + 2 + 1 + get_lacing_head_size(block, block.m_lacing_used);
+
+  for (auto idx = 0u; idx < block.m_num_frames; ++idx)
+    block.m_data_size += block.m_frames[idx]->get_size();
+
+  if (block.m_simple)
+    return get_element_size(EBML_ID(KaxSimpleBlock), block.m_data_size);
+
+  auto group_size = get_element_size(EBML_ID(KaxBlock), block.m_data_size);
+
+  if (-1 != block.m_past_ref)
+    group_size += get_element_size(EBML_ID(KaxReferenceBlock), get_sint_size((block.m_past_ref - block.m_timecode) / timecode_scale));
+  if (-1 != block.m_forw_ref)
+    group_size += get_element_size(EBML_ID(KaxReferenceBlock), get_sint_size((block.m_forw_ref - block.m_timecode) / timecode_scale));
+  if (-1 != block.m_duration)
+    group_size += get_element_size(EBML_ID(KaxBlockDuration), get_uint_size(block.m_duration / timecode_scale));
+
+  block.m_group_size = group_size;
+
+  return get_element_size(EBML_ID(KaxBlockGroup), group_size);
+}
+
+unsigned char *
+cluster_serializer_c::render_block(unsigned char *cursor,
+                                   block_t const &block,
+                                   int64_t cluster_timecode,
+                                   int64_t timecode_scale)
+  const {
+  if (block.m_simple)
+    cursor = put_head(cursor, EBML_ID(KaxSimpleBlock), block.m_data_size);
+
+  else {
+    cursor = put_head(cursor, EBML_ID(KaxBlockGroup), block.m_group_size);
+    cursor = put_head(cursor, EBML_ID(KaxBlock),      block.m_data_size);
+  }
+
+  if (0x80 > block.m_track_num)
+    *cursor++ = 0x80 | block.m_track_num;
+  else {
+    *cursor++ = 0x40 | (block.m_track_num >> 8);
+    *cursor++ = block.m_track_num & 0xff;
+  }
+
+  auto local_timecode = static_cast<int16_t>((block.m_timecode - cluster_timecode) / timecode_scale);
+  put_uint16_be(cursor, static_cast<uint16_t>(local_timecode));
+  cursor += 2;
+
+  auto flags = static_cast<unsigned char>(  LACING_XIPH  == block.m_lacing_used ? 0x02
+                                          : LACING_FIXED == block.m_lacing_used ? 0x04
+                                          : LACING_EBML  == block.m_lacing_used ? 0x06
+                                          :                                       0x00);
+  if (block.m_simple && block.m_key_frame)
+    flags |= 0x80;
+  if (block.m_simple && block.m_discardable)
+    flags |= 0x01;
+  *cursor++ = flags;
+
+  if (LACING_NONE != block.m_lacing_used) {
+    *cursor++ = block.m_num_frames - 1;
+
+    if (LACING_XIPH == block.m_lacing_used)
+      for (auto idx = 0u; (idx + 1) < block.m_num_frames; ++idx) {
+        auto size = block.m_frames[idx]->get_size();
+        for (; 0xff <= size; size -= 0xff)
+          *cursor++ = 0xff;
+        *cursor++ = size;
+      }
+
+    else if (LACING_EBML == block.m_lacing_used) {
+      auto size       = block.m_frames[0]->get_size();
+      auto coded_size = CodedSizeLength(size, 0);
+      cursor         += CodedValueLength(size, coded_size, cursor);
+
+      for (auto idx = 1u; (idx + 1) < block.m_num_frames; ++idx) {
+        auto difference = static_cast<int64_t>(block.m_frames[idx]->get_size()) - static_cast<int64_t>(block.m_frames[idx - 1]->get_size());
+        coded_size      = CodedSizeLengthSigned(difference, 0);
+        cursor         += CodedValueLengthSigned(difference, coded_size, cursor);
+      }
+    }
+  }
+
+  for (auto idx = 0u; idx < block.m_num_frames; ++idx) {
+    auto &frame = *block.m_frames[idx];
+    std::memcpy(cursor, frame.get_buffer(), frame.get_size());
+    cursor += frame.get_size();
+  }
+
+  if (block.m_simple)
+    return cursor;
+
+  if (-1 != block.m_past_ref)
+    cursor = put_sint(cursor, EBML_ID(KaxReferenceBlock), (block.m_past_ref - block.m_timecode) / timecode_scale);
+  if (-1 != block.m_forw_ref)
+    cursor = put_sint(cursor, EBML_ID(KaxReferenceBlock), (block.m_forw_ref - block.m_timecode) / timecode_scale);
+  if (-1 != block.m_duration)
+    cursor = put_uint(cursor, EBML_ID(KaxBlockDuration),  block.m_duration / timecode_scale);
+
+  return cursor;
+}
+
+/** \brief Render the cluster at the output's current position
+
+   The positions of all blocks are recorded in \c block_t::m_position
+   for the cues. \c cluster_timecode is the cluster's timecode in
+   nanoseconds; the blocks' timecodes are stored relative to it.
+
+   \return The number of bytes written.
+*/
+uint64_t
+cluster_serializer_c::render(mm_io_c &out,
+                             int64_t cluster_timecode,
+                             int64_t timecode_scale) {
+  auto content_size = get_element_size(EBML_ID(KaxClusterTimecode), get_uint_size(cluster_timecode / timecode_scale));
+  for (auto &block : m_blocks)
+    content_size += calculate_block_size(block, timecode_scale);
+
+  m_head_size     = EBML_ID_LENGTH(EBML_ID(KaxCluster)) + CodedSizeLength(content_size, 0);
+  auto total_size = m_head_size + content_size;
+
+  if (!m_buffer || (m_buffer->get_size() < total_size))
+    m_buffer = memory_c::alloc(total_size);
+
+  auto start_position = out.getFilePointer();
+  auto buffer         = m_buffer->get_buffer();
+  auto cursor         = put_head(buffer, EBML_ID(KaxCluster), content_size);
+  cursor              = put_uint(cursor, EBML_ID(KaxClusterTimecode), cluster_timecode / timecode_scale);
+
+  for (auto &block : m_blocks) {
+    block.m_position = start_position + (cursor - buffer);
+    cursor           = render_block(cursor, block, cluster_timecode, timecode_scale);
+  }
+
+  assert(static_cast<uint64_t>(cursor - buffer) == total_size);
+
+  out.write(buffer, total_size);
+
+  return total_size;
+}
+
+void
+cluster_serializer_c::clear() {
+  m_blocks.clear();
+}
+
+bool
+cluster_serializer_c::empty()
+  const {
+  return m_blocks.empty();
+}
+
+std::vector<cluster_serializer_c::block_t> const &
+cluster_serializer_c::get_blocks()
+  const {
+  return m_blocks;
+}
+
+uint64_t
+cluster_serializer_c::get_head_size()
+  const {
+  return m_head_size;
+}
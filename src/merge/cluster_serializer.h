@@ -0,0 +1,77 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   direct rendering of clusters without libebml element trees
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_CLUSTER_SERIALIZER_H
+#define MTX_MERGE_CLUSTER_SERIALIZER_H
+
+#include "common/common_pch.h"
+
+#include <array>
+
+#include <matroska/KaxBlock.h>
+
+#include "common/mm_io.h"
+
+using namespace libmatroska;
+
+/* Encodes a whole cluster into one contiguous buffer and writes it
+   with a single call. Only SimpleBlocks and BlockGroups consisting of
+   a Block, ReferenceBlocks and a BlockDuration are supported. Clusters
+   containing anything else (codec states, block additions, discard
+   padding, silent tracks) must be rendered by libmatroska.
+
+   The elements are laid out the way libmatroska renders the same
+   blocks: same element order, same lacing decisions and minimal size
+   and value lengths. The frames are referenced, not copied, until the
+   cluster is rendered. */
+class cluster_serializer_c {
+public:
+  static unsigned int const s_max_frames_per_block = 8;
+
+  struct block_t {
+    uint64_t m_track_num;
+    int64_t m_timecode, m_duration, m_past_ref, m_forw_ref;
+    LacingType m_lacing, m_lacing_used;
+    bool m_simple, m_key_frame, m_discardable;
+    std::array<memory_cptr, s_max_frames_per_block> m_frames;
+    unsigned int m_num_frames;
+    uint64_t m_data_size, m_group_size, m_position;
+  };
+
+protected:
+  std::vector<block_t> m_blocks;
+  memory_cptr m_buffer;
+  uint64_t m_head_size;
+
+public:
+  cluster_serializer_c();
+
+  size_t add_block(uint64_t track_num, bool simple, LacingType lacing);
+  bool add_frame(size_t block_idx, memory_cptr const &frame, int64_t timecode, int64_t past_ref, int64_t forw_ref);
+  void set_block_duration(size_t block_idx, int64_t duration);
+
+  uint64_t render(mm_io_c &out, int64_t cluster_timecode, int64_t timecode_scale);
+  void clear();
+
+  bool empty() const;
+  std::vector<block_t> const &get_blocks() const;
+  uint64_t get_head_size() const;
+
+protected:
+  LacingType get_best_lacing_type(block_t const &block) const;
+  uint64_t get_lacing_head_size(block_t const &block, LacingType lacing) const;
+  uint64_t calculate_block_size(block_t &block, int64_t timecode_scale);
+  unsigned char *render_block(unsigned char *cursor, block_t const &block, int64_t cluster_timecode, int64_t timecode_scale) const;
+};
+
+#endif  // MTX_MERGE_CLUSTER_SERIALIZER_H
@@ -28,18 +28,29 @@ cues_cptr cues_c::s_cues;
 
 cues_c::cues_c()
   : m_num_cue_points_postprocessed{}
+  , m_accounted_memory{}
   , m_no_cue_duration{hack_engaged(ENGAGE_NO_CUE_DURATION)}
   , m_no_cue_relative_position{hack_engaged(ENGAGE_NO_CUE_RELATIVE_POSITION)}
   , m_debug_cue_duration{         "cues|cues_cue_duration"}
   , m_debug_cue_relative_position{"cues|cues_cue_relative_position"}
+  , m_debug_memory{               "cues|cues_memory"}
 {
 }
 
+cues_c::~cues_c() {
+  mtx::mem::account(mtx::mem::component_e::cues, -static_cast<int64_t>(m_accounted_memory));
+}
+
 void
 cues_c::set_duration_for_id_timecode(uint64_t id,
                                      uint64_t timecode,
                                      uint64_t duration) {
-  if (!m_no_cue_duration)
+  if (m_no_cue_duration)
+    return;
+
+  // Only the durations of tracks wanting them are ever used.
+  auto ptzr = g_packetizers_by_track_num[id];
+  if (ptzr && ptzr->wants_cue_duration())
     m_id_timecode_duration_multimap.insert({ id_timecode_t{id, timecode}, duration });
 }
 
@@ -64,23 +75,28 @@ cues_c::add(KaxCuePoint &point) {
     uint64_t track_num = FindChildValue<KaxCueTrack>(*positions);
     assert(track_num <= static_cast<uint64_t>(std::numeric_limits<uint32_t>::max()));
 
-    m_points.push_back({ timecode, 0, FindChildValue<KaxCueClusterPosition>(*positions), static_cast<uint32_t>(track_num), 0 });
+    add(timecode, static_cast<uint32_t>(track_num), FindChildValue<KaxCueClusterPosition>(*positions));
 
-    uint64_t codec_state_position = FindChildValue<KaxCueCodecState>(*positions);
-    if (codec_state_position)
-      m_codec_state_position_map[ id_timecode_t{ track_num, timecode } ] = codec_state_position;
+    m_points.back().codec_state_position = FindChildValue<KaxCueCodecState>(*positions);
   }
 }
 
+void
+cues_c::add(uint64_t timecode,
+            uint32_t track_num,
+            uint64_t cluster_position) {
+  m_points.push_back({ timecode, 0, cluster_position, 0, track_num, 0 });
+}
+
 void
 cues_c::write(mm_io_c &out,
               KaxSeekHead &seek_head) {
-  if (!m_points.size() || !g_cue_writing_requested)
+  if ((m_points.empty() && m_packed_points.empty()) || !g_cue_writing_requested)
     return;
 
-  // auto start = mtx::sys::get_current_time_millis();
-  sort();
-  // auto end_sort = mtx::sys::get_current_time_millis();
+  pack_points();
+
+  mxdebug_if(m_debug_memory, boost::format("cues: %1% points packed into %2% bytes\n") % m_packed_points.size() % m_packed_points.get_memory_usage());
 
   // Need to write the (empty) cues element so that its position will
   // be set for indexing in g_kax_sh_main. Necessary because there's
@@ -100,7 +116,8 @@ cues_c::write(mm_io_c &out,
   auto total_size = calculate_total_size();
   write_ebml_element_head(out, EBML_ID(KaxCues), total_size);
 
-  for (auto &point : m_points) {
+  // The points are merged from the sorted runs while they're written.
+  m_packed_points.for_each_sorted([&out](cue_point_t const &point) {
     KaxCuePoint kc_point;
 
     GetChild<KaxCueTime>(kc_point).SetValue(point.timecode / g_timecode_scale);
@@ -109,9 +126,8 @@ cues_c::write(mm_io_c &out,
     GetChild<KaxCueTrack>(positions).SetValue(point.track_num);
     GetChild<KaxCueClusterPosition>(positions).SetValue(point.cluster_position);
 
-    auto codec_state_position = m_codec_state_position_map.find({ point.track_num, point.timecode });
-    if (codec_state_position != m_codec_state_position_map.end())
-      GetChild<KaxCueCodecState>(positions).SetValue(codec_state_position->second);
+    if (point.codec_state_position)
+      GetChild<KaxCueCodecState>(positions).SetValue(point.codec_state_position);
 
     if (point.relative_position)
       GetChild<KaxCueRelativePosition>(positions).SetValue(point.relative_position);
@@ -120,29 +136,35 @@ cues_c::write(mm_io_c &out,
       GetChild<KaxCueDuration>(positions).SetValue(RND_TIMECODE_SCALE(point.duration) / g_timecode_scale);
 
     kc_point.Render(out);
-  }
+  });
+
+  m_packed_points.clear();
+}
+
+/** \brief Move all points into the packed storage
 
+   The points are sorted by timecode and track number on the way.
+*/
+void
+cues_c::pack_points() {
+  m_packed_points.add(m_points);
   m_points.clear();
-  m_codec_state_position_map.clear();
   m_num_cue_points_postprocessed = 0;
 
-  // auto end_all = mtx::sys::get_current_time_millis();
-  // mxinfo(boost::format("dur sort %1% write %2% total %3%\n") % (end_sort - start) % (end_all - end_sort) % (end_all - start));
+  update_memory_accounting();
 }
 
+/** \brief Report the memory used by the cue points to the memory accounting
+*/
 void
-cues_c::sort() {
-  brng::sort(m_points, [](cue_point_t const &a, cue_point_t const &b) -> bool {
-      if (a.timecode < b.timecode)
-        return true;
-      if (a.timecode > b.timecode)
-        return false;
-
-      if (a.track_num < b.track_num)
-        return true;
-
-      return false;
-    });
+cues_c::update_memory_accounting() {
+  if (!mtx::mem::is_accounting_enabled())
+    return;
+
+  auto usage = m_packed_points.get_memory_usage() + m_points.capacity() * sizeof(cue_point_t);
+
+  mtx::mem::account(mtx::mem::component_e::cues, static_cast<int64_t>(usage) - static_cast<int64_t>(m_accounted_memory));
+  m_accounted_memory = usage;
 }
 
 std::multimap<id_timecode_t, uint64_t>
@@ -180,10 +202,28 @@ cues_c::postprocess_cues(KaxCues &cues,
   add(cues);
 
   if (m_no_cue_duration && m_no_cue_relative_position)
+    postprocess_cues(0, {});
+  else
+    postprocess_cues(cluster.GetElementPosition() + cluster.HeadSize(), calculate_block_positions(cluster));
+}
+
+/** \brief Set relative positions and durations of the cue points added last
+
+   \c block_positions maps track numbers and timecodes of the blocks in
+   the cluster just rendered to their positions in the file.
+*/
+void
+cues_c::postprocess_cues(uint64_t cluster_data_start_pos,
+                         std::multimap<id_timecode_t, uint64_t> const &block_positions) {
+  if (m_no_cue_duration && m_no_cue_relative_position) {
+    m_num_cue_points_postprocessed = m_points.size();
+    if (m_points.size() >= s_points_per_run)
+      pack_points();
+    else
+      update_memory_accounting();
     return;
+  }
 
-  auto cluster_data_start_pos = cluster.GetElementPosition() + cluster.HeadSize();
-  auto block_positions        = calculate_block_positions(cluster);
   std::map<id_timecode_t, size_t> nblocks_processed; //# blocks processed so far with given track #/timecode
 
   for (auto point = m_points.begin() + m_num_cue_points_postprocessed, end = m_points.end(); point != end; ++point) {
@@ -238,12 +278,20 @@ cues_c::postprocess_cues(KaxCues &cues,
   m_num_cue_points_postprocessed = m_points.size();
 
   m_id_timecode_duration_multimap.clear();
+
+  if (m_points.size() >= s_points_per_run)
+    pack_points();
+  else
+    update_memory_accounting();
 }
 
 uint64_t
 cues_c::calculate_total_size()
   const {
-  return boost::accumulate(m_points, 0ull, [this](uint64_t sum, cue_point_t const &point) { return sum + calculate_point_size(point); });
+  auto total_size = uint64_t{};
+  m_packed_points.for_each([this, &total_size](cue_point_t const &point) { total_size += calculate_point_size(point); });
+
+  return total_size;
 }
 
 uint64_t
@@ -264,9 +312,8 @@ cues_c::calculate_point_size(cue_point_t const &point)
                       + EBML_ID_LENGTH(EBML_ID(KaxCueTrack))           + 1 + calculate_bytes_for_uint(point.track_num)
                       + EBML_ID_LENGTH(EBML_ID(KaxCueClusterPosition)) + 1 + calculate_bytes_for_uint(point.cluster_position);
 
-  auto codec_state_position = m_codec_state_position_map.find({ point.track_num, point.timecode });
-  if (codec_state_position != m_codec_state_position_map.end())
-    point_size += EBML_ID_LENGTH(EBML_ID(KaxCueCodecState)) + 1 + calculate_bytes_for_uint(codec_state_position->second);
+  if (point.codec_state_position)
+    point_size += EBML_ID_LENGTH(EBML_ID(KaxCueCodecState)) + 1 + calculate_bytes_for_uint(point.codec_state_position);
 
   if (point.relative_position)
     point_size += EBML_ID_LENGTH(EBML_ID(KaxCueRelativePosition)) + 1 + calculate_bytes_for_uint(point.relative_position);
@@ -282,20 +329,49 @@ cues_c::adjust_positions(uint64_t old_position,
                          uint64_t delta) {
   auto s_debug_rerender_track_headers = debugging_option_c{"rerender|rerender_track_headers"};
 
-  if (!delta || (m_points.empty() && m_codec_state_position_map.empty()))
+  if (!delta || (m_points.empty() && m_packed_points.empty()))
     return;
 
   mxdebug_if(s_debug_rerender_track_headers,
-             boost::format("[rerender] cues_c::adjust_positions: old_position %1% delta %2% num_points %3% first point's position %4%\n")
-             % old_position % delta % m_points.size() % (!m_points.empty() ? m_points[0].cluster_position : 0));
+             boost::format("[rerender] cues_c::adjust_positions: old_position %1% delta %2% num_points %3% num_packed_points %4%\n")
+             % old_position % delta % m_points.size() % m_packed_points.size());
 
-  for (auto &point : m_points)
+  for (auto &point : m_points) {
     if (point.cluster_position >= old_position)
       point.cluster_position += delta;
+    if (point.codec_state_position && (point.codec_state_position >= old_position))
+      point.codec_state_position += delta;
+  }
+
+  m_packed_points.adjust_positions(old_position, delta);
+}
 
-  for (auto &element : m_codec_state_position_map)
-    if (element.second >= old_position)
-      element.second += delta;
+/** \brief Size of the cues element \c write() would render
+
+   Includes the element's head.
+*/
+uint64_t
+cues_c::calculate_element_size() {
+  if (m_points.empty() && m_packed_points.empty())
+    return 0;
+
+  pack_points();
+
+  auto total_size = calculate_total_size();
+  return EBML_ID_LENGTH(EBML_ID(KaxCues)) + CodedSizeLength(total_size, 0) + total_size;
+}
+
+/** \brief Project the size of the cues element before muxing
+
+   Assumes \c num_points points each needing as much space as
+   \c largest_point. Includes the element's head.
+*/
+uint64_t
+cues_c::project_element_size(uint64_t num_points,
+                             cue_point_t const &largest_point)
+  const {
+  auto total_size = num_points * calculate_point_size(largest_point);
+  return EBML_ID_LENGTH(EBML_ID(KaxCues)) + CodedSizeLength(total_size, 0) + total_size;
 }
 
 cues_c &
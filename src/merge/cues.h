@@ -21,45 +21,52 @@
 #include <matroska/KaxSeekHead.h>
 
 #include "common/mm_io.h"
+#include "merge/packed_cue_points.h"
 
 using id_timecode_t = std::pair<uint64_t, uint64_t>;
 
-struct cue_point_t {
-  uint64_t timecode, duration, cluster_position;
-  uint32_t track_num, relative_position;
-};
-
 class cues_c;
 using cues_cptr = std::shared_ptr<cues_c>;
 
 class cues_c {
 protected:
+  // Number of postprocessed points collected before they're packed.
+  static size_t const s_points_per_run = 4096;
+
+  // Points of the most recent clusters. Older ones are kept in
+  // m_packed_points.
   std::vector<cue_point_t> m_points;
+  packed_cue_points_c m_packed_points;
   std::multimap<id_timecode_t, uint64_t> m_id_timecode_duration_multimap;
-  std::map<id_timecode_t, uint64_t> m_codec_state_position_map;
 
-  size_t m_num_cue_points_postprocessed;
+  size_t m_num_cue_points_postprocessed, m_accounted_memory;
   bool m_no_cue_duration, m_no_cue_relative_position;
-  debugging_option_c m_debug_cue_duration, m_debug_cue_relative_position;
+  debugging_option_c m_debug_cue_duration, m_debug_cue_relative_position, m_debug_memory;
 
 protected:
   static cues_cptr s_cues;
 
 public:
   cues_c();
+  ~cues_c();
 
   void add(KaxCues &cues);
   void add(KaxCuePoint &point);
+  void add(uint64_t timecode, uint32_t track_num, uint64_t cluster_position);
   void write(mm_io_c &out, KaxSeekHead &seek_head);
   void postprocess_cues(KaxCues &cues, KaxCluster &cluster);
+  void postprocess_cues(uint64_t cluster_data_start_pos, std::multimap<id_timecode_t, uint64_t> const &block_positions);
   void set_duration_for_id_timecode(uint64_t id, uint64_t timecode, uint64_t duration);
   void adjust_positions(uint64_t old_position, uint64_t delta);
+  uint64_t calculate_element_size();
+  uint64_t project_element_size(uint64_t num_points, cue_point_t const &largest_point) const;
 
 public:
   static cues_c &get();
 
 protected:
-  void sort();
+  void pack_points();
+  void update_memory_accounting();
   std::multimap<id_timecode_t, uint64_t> calculate_block_positions(KaxCluster &cluster) const;
   uint64_t calculate_total_size() const;
   uint64_t calculate_point_size(cue_point_t const &point) const;
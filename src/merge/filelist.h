@@ -51,6 +51,10 @@ struct filelist_t {
   size_t playlist_index{}, playlist_previous_filelist_id{};
   mm_mpls_multi_file_io_cptr playlist_mpls_in;
 
+  // The input the type was detected with. Only kept while identifying
+  // so that the reader can read its headers from the probe buffer.
+  mm_io_cptr probe_in;
+
   timestamp_c restricted_timecode_min, restricted_timecode_max;
 
   filelist_t()
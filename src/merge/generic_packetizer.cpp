@@ -29,12 +29,15 @@
 #include "common/ebml.h"
 #include "common/hacks.h"
 #include "common/strings/formatting.h"
+#include "common/tracing.h"
 #include "common/unique_numbers.h"
 #include "common/xml/ebml_tags_converter.h"
 #include "merge/filelist.h"
 #include "merge/generic_packetizer.h"
 #include "merge/generic_reader.h"
+#include "merge/memory_budget.h"
 #include "merge/output_control.h"
+#include "merge/reader_thread.h"
 #include "merge/webm.h"
 
 #define TRACK_TYPE_TO_DEFTRACK_TYPE(track_type)      \
@@ -62,6 +65,7 @@ generic_packetizer_c::generic_packetizer_c(generic_reader_c *reader,
   , m_free_refs{-1}
   , m_next_free_refs{-1}
   , m_enqueued_bytes{}
+  , m_num_pending_compressions{}
   , m_safety_last_timecode{}
   , m_safety_last_duration{}
   , m_track_entry{}
@@ -373,14 +377,18 @@ generic_packetizer_c::set_track_default_duration(int64_t def_dur) {
   if (m_default_duration_forced)
     return;
 
-  m_htrack_default_duration = (int64_t)(def_dur * m_ti.m_tcsync.numerator / m_ti.m_tcsync.denominator);
+  // The cluster helper uses the default duration while rendering
+  // packets on the main thread.
+  reader_threads_c::synchronize([this, def_dur]() {
+    m_htrack_default_duration = (int64_t)(def_dur * m_ti.m_tcsync.numerator / m_ti.m_tcsync.denominator);
 
-  if (m_track_entry) {
-    if (m_htrack_default_duration)
-      GetChild<KaxTrackDefaultDuration>(m_track_entry).SetValue(m_htrack_default_duration);
-    else
-      DeleteChildren<KaxTrackDefaultDuration>(m_track_entry);
-  }
+    if (m_track_entry) {
+      if (m_htrack_default_duration)
+        GetChild<KaxTrackDefaultDuration>(m_track_entry).SetValue(m_htrack_default_duration);
+      else
+        DeleteChildren<KaxTrackDefaultDuration>(m_track_entry);
+    }
+  });
 }
 
 void
@@ -786,6 +794,13 @@ generic_packetizer_c::fix_headers() {
   m_track_entry->SetGlobalTimecodeScale((int64_t)g_timecode_scale);
 }
 
+int
+generic_packetizer_c::process(packet_cptr packet) {
+  mtx::trace::span_c span{"packetizer", "process", m_hserialno};
+
+  return process_impl(packet);
+}
+
 void
 generic_packetizer_c::add_packet(packet_cptr pack) {
   if ((0 == m_num_packets) && m_ti.m_reset_timecodes)
@@ -801,25 +816,36 @@ generic_packetizer_c::add_packet(packet_cptr pack) {
       && (pack->data_adds.size()  > static_cast<size_t>(m_htrack_max_add_block_ids)))
     pack->data_adds.resize(m_htrack_max_add_block_ids);
 
-  if (m_compressor) {
-    try {
-      pack->data = m_compressor->compress(pack->data);
-      size_t i;
-      for (i = 0; pack->data_adds.size() > i; ++i)
-        pack->data_adds[i] = m_compressor->compress(pack->data_adds[i]);
+  auto compress_in_background = m_compressor && compressor_c::get_thread_pool() && m_compressor->is_thread_safe();
 
-    } catch (mtx::compression_x &e) {
-      mxerror_tid(m_ti.m_fname, m_ti.m_id, boost::format(Y("Compression failed: %1%\n")) % e.error());
-    }
-  }
+  mtx::mem::component_scope_c memory_scope{mtx::mem::component_e::packets};
+
+  if (m_compressor && !compress_in_background)
+    compress_packet(*pack);
 
   pack->data->grab();
-  for (auto &data_add : pack->data_adds)
+  pack->data->set_accounting_component(mtx::mem::component_e::packets);
+  for (auto &data_add : pack->data_adds) {
     data_add->grab();
+    data_add->set_accounting_component(mtx::mem::component_e::packets);
+  }
+
+  if (compress_in_background)
+    compress_packet_in_background(*pack);
 
   pack->source = this;
 
   m_enqueued_bytes += pack->data->get_size();
+  memory_budget_c::add(pack->data->get_size());
+
+  // Packets queued behind others won't be needed for a while. Move
+  // their data out of memory if the limit has been exceeded. Reader
+  // threads take the packets off this queue right away; they spill
+  // them from their own queues instead.
+  if (   memory_budget_c::is_exceeded()
+      && !reader_threads_c::get()
+      && (!m_packet_queue.empty() || !m_deferred_packets.empty()))
+    memory_budget_c::spill(*pack);
 
   if ((0 > pack->bref) && (0 <= pack->fref))
     std::swap(pack->bref, pack->fref);
@@ -894,6 +920,9 @@ generic_packetizer_c::add_packet2(packet_cptr pack) {
   m_safety_last_duration        = pack->duration;
   pack->timecode_before_factory = pack->timecode;
 
+  if (pack->pending_compression.valid())
+    ++m_num_pending_compressions;
+
   m_packet_queue.push_back(pack);
   if (!m_timestamp_factory || (TFA_IMMEDIATE == m_timestamp_factory_application_mode))
     apply_factory_once(pack);
@@ -918,7 +947,18 @@ generic_packetizer_c::get_packet() {
 
   pack->output_order_timecode = timestamp_c::ns(pack->assigned_timecode - std::max(m_codec_delay.to_ns(0), m_seek_pre_roll.to_ns(0)));
 
+  memory_budget_c::unspill(*pack);
+
   m_enqueued_bytes -= pack->data->get_size();
+  memory_budget_c::remove(pack->data->get_size());
+
+  if (pack->pending_compression.valid()) {
+    finish_compression(*pack);
+
+    pack->data->set_accounting_component(mtx::mem::component_e::packets);
+    for (auto &data_add : pack->data_adds)
+      data_add->set_accounting_component(mtx::mem::component_e::packets);
+  }
 
   --m_next_packet_wo_assigned_timecode;
   if (0 > m_next_packet_wo_assigned_timecode)
@@ -952,6 +992,8 @@ generic_packetizer_c::apply_factory() {
   if (m_packet_queue.empty())
     return;
 
+  mtx::trace::span_c span{"packetizer", "apply_factory", m_hserialno};
+
   // Find the first packet to which the factory hasn't been applied yet.
   packet_cptr_di p_start = m_packet_queue.begin() + m_next_packet_wo_assigned_timecode;
 
@@ -1133,9 +1175,74 @@ generic_packetizer_c::is_compatible_with(output_compatibility_e compatibility) {
   return OC_MATROSKA == compatibility;
 }
 
+bool
+generic_packetizer_c::packet_available() {
+  if (m_packet_queue.empty() || !m_packet_queue.front()->factory_applied)
+    return false;
+
+  auto &compression = m_packet_queue.front()->pending_compression;
+  if (!compression.valid())
+    return true;
+
+  // Let the caller keep reading while the workers are busy so that
+  // they have several frames to compress in parallel.
+  return (m_num_pending_compressions >= 2 * compressor_c::get_thread_pool()->get_num_threads())
+      || (compression.wait_for(std::chrono::seconds{0}) == std::future_status::ready);
+}
+
 void
 generic_packetizer_c::discard_queued_packets() {
+  for (auto &packet : m_packet_queue)
+    memory_budget_c::discard(*packet);
+
   m_packet_queue.clear();
+  m_num_pending_compressions = 0;
+}
+
+void
+generic_packetizer_c::compress_packet(packet_t &packet) {
+  try {
+    packet.data = m_compressor->compress(packet.data);
+    for (auto &data_add : packet.data_adds)
+      data_add = m_compressor->compress(data_add);
+
+  } catch (mtx::compression_x &e) {
+    mxerror_tid(m_ti.m_fname, m_ti.m_id, boost::format(Y("Compression failed: %1%\n")) % e.error());
+  }
+}
+
+/* The uncompressed buffers stay in the packet until get_packet()
+   swaps in the compressed ones. This keeps the number of queued bytes
+   consistent. */
+void
+generic_packetizer_c::compress_packet_in_background(packet_t &packet) {
+  auto compressor = m_compressor;
+  auto buffers    = std::vector<memory_cptr>{ packet.data };
+
+  buffers.insert(buffers.end(), packet.data_adds.begin(), packet.data_adds.end());
+
+  packet.pending_compression = compressor_c::get_thread_pool()->submit([compressor, buffers]() -> std::vector<memory_cptr> {
+    auto compressed = std::vector<memory_cptr>{};
+    for (auto const &buffer : buffers)
+      compressed.push_back(compressor->compress(buffer));
+    return compressed;
+  });
+}
+
+void
+generic_packetizer_c::finish_compression(packet_t &packet) {
+  --m_num_pending_compressions;
+
+  try {
+    auto compressed = packet.pending_compression.get();
+
+    packet.data = compressed[0];
+    for (auto idx = 0u; idx < packet.data_adds.size(); ++idx)
+      packet.data_adds[idx] = compressed[idx + 1];
+
+  } catch (mtx::compression_x &e) {
+    mxerror_tid(m_ti.m_fname, m_ti.m_id, boost::format(Y("Compression failed: %1%\n")) % e.error());
+  }
 }
 
 bool
@@ -1199,6 +1306,22 @@ generic_packetizer_c::create_track_number() {
 
 file_status_e
 generic_packetizer_c::read() {
+  mtx::mem::component_scope_c memory_scope{mtx::mem::component_e::readers};
+
+  // Hold back readers that are ahead of the others: they have packets
+  // queued for their other tracks already. Audio and video tracks are
+  // always read as they're needed for interleaving; their packets are
+  // spilled to disk instead.
+  if (   memory_budget_c::is_exceeded()
+      && (track_audio != m_htrack_type)
+      && (track_video != m_htrack_type)
+      && (m_reader->get_queued_bytes() > m_enqueued_bytes)) {
+    mxdebug_if(memory_budget_c::s_debug, boost::format("memory_budget: holding reader for %1% track %2% with %3% queued\n") % m_ti.m_fname % m_ti.m_id % format_file_size(m_reader->get_queued_bytes()));
+    return FILE_STATUS_HOLDING;
+  }
+
+  mtx::trace::span_c span{"reader", "read", m_hserialno};
+
   return m_reader->read(this);
 }
 
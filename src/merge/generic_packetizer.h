@@ -16,6 +16,7 @@
 
 #include "common/common_pch.h"
 
+#include <atomic>
 #include <deque>
 
 #include "common/option_with_source.h"
@@ -50,7 +51,11 @@ protected:
   std::deque<packet_cptr> m_packet_queue, m_deferred_packets;
   int m_next_packet_wo_assigned_timecode;
 
-  int64_t m_free_refs, m_next_free_refs, m_enqueued_bytes;
+  int64_t m_free_refs, m_next_free_refs;
+  // Read by the main thread for progress reports while a reader thread
+  // may be modifying it.
+  std::atomic<int64_t> m_enqueued_bytes;
+  unsigned int m_num_pending_compressions;
   int64_t m_safety_last_timecode, m_safety_last_duration;
 
   KaxTrackEntry *m_track_entry;
@@ -113,9 +118,7 @@ public:
   virtual void process_deferred_packets();
 
   virtual packet_cptr get_packet();
-  inline bool packet_available() {
-    return !m_packet_queue.empty() && m_packet_queue.front()->factory_applied;
-  }
+  bool packet_available();
   void discard_queued_packets();
   void flush();
   virtual int64_t get_smallest_timecode() const {
@@ -137,7 +140,8 @@ public:
   inline int process(packet_t *packet) {
     return process(packet_cptr(packet));
   }
-  virtual int process(packet_cptr packet) = 0;
+  int process(packet_cptr packet);
+  virtual int process_impl(packet_cptr packet) = 0;
 
   virtual void set_cue_creation(cue_strategy_e create_cue_data) {
     m_ti.m_cues = create_cue_data;
@@ -248,6 +252,14 @@ public:
 
   virtual bool is_compatible_with(output_compatibility_e compatibility);
 
+  // Number of bytes the track headers are expected to grow by once
+  // the packetizer has seen the first frames. The space is reserved
+  // when the headers are rendered for the first time if the option
+  // '--reserve-header-space' is used.
+  virtual int64_t get_expected_header_growth() const {
+    return 0;
+  }
+
   int64_t create_track_number();
 
   virtual void prevent_lacing();
@@ -262,6 +274,10 @@ protected:
   virtual void flush_impl() {
   };
 
+  void compress_packet(packet_t &packet);
+  void compress_packet_in_background(packet_t &packet);
+  void finish_compression(packet_t &packet);
+
   virtual void show_experimental_status_version(std::string const &codec_id);
 };
 
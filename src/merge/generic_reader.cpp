@@ -13,6 +13,7 @@
 
 #include "common/common_pch.h"
 
+#include "common/mm_pipe_input_io.h"
 #include "common/strings/formatting.h"
 #include "merge/generic_packetizer.h"
 #include "merge/generic_reader.h"
@@ -419,9 +420,22 @@ generic_reader_c::add_available_track_id_range(int64_t start,
     add_available_track_id(id);
 }
 
+/** \brief The percentage of the input read so far
+
+   Returns -1 if it is unknown. That's the case for inputs read from
+   pipes until their end has been reached.
+*/
 int
 generic_reader_c::get_progress() {
-  return 100 * m_in->getFilePointer() / m_size;
+  auto size = m_size;
+
+  if (auto pipe_io = dynamic_cast<mm_pipe_input_io_c *>(m_in.get())) {
+    if (!pipe_io->is_size_known())
+      return -1;
+    size = pipe_io->get_size();
+  }
+
+  return size ? 100 * m_in->getFilePointer() / size : 0;
 }
 
 mm_io_c *
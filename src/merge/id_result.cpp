@@ -23,7 +23,9 @@ id_result_container_unsupported(std::string const &filename,
       mxinfo(boost::format("File '%1%': unsupported container: %2%\n") % filename % info);
     else
       mxinfo(boost::format(Y("File '%1%': unsupported container: %2%\n")) % filename % info);
-    mxexit(3);
+
+    // The caller exits with code 3.
+    throw mtx::id::unsupported_container_x{};
 
   } else
     mxerror(boost::format(Y("The file '%1%' is a non-supported file type (%2%).\n")) % filename % info);
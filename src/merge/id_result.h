@@ -58,6 +58,19 @@ struct id_result_t {
   }
 };
 
+namespace mtx { namespace id {
+
+// Thrown by id_result_container_unsupported() after the result has
+// been output while identifying.
+class unsupported_container_x: public mtx::exception {
+public:
+  virtual const char *what() const throw() {
+    return "unsupported container";
+  }
+};
+
+}}
+
 void id_result_container_unsupported(std::string const &filename, translatable_string_c const &info);
 
 #endif  // MTX_MERGE_ID_RESULT_H
@@ -0,0 +1,191 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   on-disk cache for identification results
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#if !defined(SYS_WINDOWS)
+# include <sys/stat.h>
+# include <sys/types.h>
+#endif
+
+#include "common/checksums/base.h"
+#include "common/mm_io.h"
+#include "common/mm_io_x.h"
+#include "common/strings/editing.h"
+#include "common/strings/formatting.h"
+#include "common/strings/parsing.h"
+#include "merge/identification_cache.h"
+
+namespace {
+
+/* The modification time as returned by boost::filesystem only has a
+   resolution of one second. A file that is rewritten within the same
+   second without changing its size would therefore keep its key. On
+   POSIX systems the nanoseconds, the device and inode numbers and the
+   status change time are used as well; the latter two change if the
+   file is replaced, e.g. by renaming another file to its name. */
+std::string
+format_file_state(bfs::path const &path) {
+#if defined(SYS_WINDOWS)
+  return (boost::format("%1% %2%") % bfs::file_size(path) % bfs::last_write_time(path)).str();
+
+#else
+  struct stat st;
+  if (0 != stat(g_cc_local_utf8->native(path.string()).c_str(), &st))
+    return {};
+
+# if defined(SYS_APPLE)
+  auto const &mtime = st.st_mtimespec;
+  auto const &ctime = st.st_ctimespec;
+# else
+  auto const &mtime = st.st_mtim;
+  auto const &ctime = st.st_ctim;
+# endif
+
+  return (boost::format("%1% %2%.%|3$09d| %4%.%|5$09d| %6%:%7%")
+          % st.st_size
+          % mtime.tv_sec % mtime.tv_nsec
+          % ctime.tv_sec % ctime.tv_nsec
+          % st.st_dev % st.st_ino).str();
+#endif
+}
+
+}
+
+identification_cache_c::identification_cache_c(bfs::path const &directory,
+                                               std::string const &variant)
+  : m_directory{directory}
+  , m_variant{variant}
+  , m_debug{"identification_cache"}
+{
+}
+
+/** \brief Build the key identifying a file's current state
+
+   The output contains the file name as given on the command line. The
+   same file referred to by another name must therefore not match,
+   which is why both that name and the absolute path are part of the
+   key. Returns an empty string if the file cannot be accessed or if
+   its name contains line breaks, which keys must not contain.
+*/
+std::string
+identification_cache_c::build_key(std::string const &file_name)
+  const {
+  try {
+    auto path  = bfs::absolute(bfs::path{file_name});
+    auto state = format_file_state(path);
+    if (state.empty())
+      return {};
+
+    auto key   = (boost::format("%1% %2% %3% %4%")
+                  % escape(file_name)
+                  % escape(path.string())
+                  % state
+                  % escape(m_variant)).str();
+
+    return std::string::npos == key.find_first_of("\r\n") ? key : std::string{};
+
+  } catch (bfs::filesystem_error &) {
+    return {};
+  }
+}
+
+bfs::path
+identification_cache_c::get_entry_path(std::string const &key)
+  const {
+  auto hash = mtx::checksum::calculate(mtx::checksum::algorithm_e::md5, key.c_str(), key.length());
+  return m_directory / to_hex(hash, true);
+}
+
+/** \brief Look up the identification result for a file
+
+   An entry consists of the key, the exit code and the output, the
+   first two terminated by line breaks.
+*/
+boost::optional<identification_result_t>
+identification_cache_c::get(std::string const &file_name)
+  const {
+  auto key = build_key(file_name);
+  if (key.empty())
+    return boost::none;
+
+  auto entry_path = get_entry_path(key);
+
+  try {
+    if (!bfs::exists(entry_path))
+      return boost::none;
+
+    auto content  = mm_file_io_c::slurp(entry_path.string());
+    auto entry    = std::string{reinterpret_cast<char const *>(content->get_buffer()), content->get_size()};
+    auto key_end  = entry.find('\n');
+    auto code_end = std::string::npos != key_end ? entry.find('\n', key_end + 1) : std::string::npos;
+    auto result   = identification_result_t{};
+
+    if (   (std::string::npos == code_end)
+        || (entry.substr(0, key_end) != key)
+        || !parse_number(entry.substr(key_end + 1, code_end - key_end - 1), result.exit_code)) {
+      mxdebug_if(m_debug, boost::format("identification_cache: no match for %1% in %2%\n") % file_name % entry_path.string());
+      return boost::none;
+    }
+
+    result.output = entry.substr(code_end + 1);
+
+    mxdebug_if(m_debug, boost::format("identification_cache: hit for %1% in %2%\n") % file_name % entry_path.string());
+
+    return result;
+
+  } catch (mtx::mm_io::exception &) {
+  } catch (bfs::filesystem_error &) {
+  }
+
+  return boost::none;
+}
+
+/** \brief Store the identification result for a file
+
+   The entry is written to a temporary file first and renamed
+   afterwards. Failures are ignored; they only mean that the file will
+   be identified again the next time.
+*/
+void
+identification_cache_c::put(std::string const &file_name,
+                            identification_result_t const &result)
+  const {
+  auto key = build_key(file_name);
+  if (key.empty())
+    return;
+
+  auto entry_path = get_entry_path(key);
+  auto temp_path  = m_directory / bfs::unique_path(entry_path.filename().string() + ".%%%%-%%%%-%%%%");
+  auto entry      = (boost::format("%1%\n%2%\n%3%") % key % result.exit_code % result.output).str();
+
+  try {
+    {
+      mm_file_io_c out{temp_path.string(), MODE_CREATE};
+      if (out.write(entry.c_str(), entry.length()) != entry.length())
+        throw mtx::mm_io::end_of_file_x{};
+    }
+
+    bfs::rename(temp_path, entry_path);
+
+    mxdebug_if(m_debug, boost::format("identification_cache: stored result for %1% in %2%\n") % file_name % entry_path.string());
+
+  } catch (mtx::mm_io::exception &) {
+    boost::system::error_code ec;
+    bfs::remove(temp_path, ec);
+
+  } catch (bfs::filesystem_error &) {
+    boost::system::error_code ec;
+    bfs::remove(temp_path, ec);
+  }
+}
@@ -0,0 +1,53 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   on-disk cache for identification results
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_IDENTIFICATION_CACHE_H
+#define MTX_MERGE_IDENTIFICATION_CACHE_H
+
+#include "common/common_pch.h"
+
+struct identification_result_t {
+  std::string output;
+  int exit_code;
+};
+
+/* Stores the output of identifying a file in a directory, one file per
+   entry. An entry is only valid for the file's name as given, its
+   absolute path, size and modification time, and for the variant
+   given to the constructor. The variant should contain everything
+   else the output depends on, e.g. the program version and the output
+   format. Entries that don't match are simply ignored and overwritten
+   eventually.
+
+   All functions are safe to call from several threads and processes
+   at once as entries are replaced atomically by renaming them. */
+class identification_cache_c {
+protected:
+  bfs::path m_directory;
+  std::string m_variant;
+  debugging_option_c m_debug;
+
+public:
+  identification_cache_c(bfs::path const &directory, std::string const &variant);
+
+  boost::optional<identification_result_t> get(std::string const &file_name) const;
+  void put(std::string const &file_name, identification_result_t const &result) const;
+
+protected:
+  std::string build_key(std::string const &file_name) const;
+  bfs::path get_entry_path(std::string const &key) const;
+};
+
+using identification_cache_cptr = std::shared_ptr<identification_cache_c>;
+
+#endif  // MTX_MERGE_IDENTIFICATION_CACHE_H
@@ -0,0 +1,65 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   the packet interleaver
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "merge/interleaver.h"
+
+void
+interleaver_c::add_packet(size_t idx,
+                          timestamp_c const &timecode) {
+  m_packets.push(entry_t{ timecode.to_ns(), idx });
+}
+
+bool
+interleaver_c::has_packet()
+  const {
+  return !m_packets.empty();
+}
+
+size_t
+interleaver_c::pop_winner() {
+  auto idx = m_packets.top().idx;
+  m_packets.pop();
+
+  return idx;
+}
+
+void
+interleaver_c::request_pull(size_t idx) {
+  m_to_pull.insert(idx);
+}
+
+/** \brief Ask all packetizers that need it for a new packet
+
+   \c puller is called for each packetizer in ascending order of their
+   indexes. Packetizers requested while this function is running are
+   still visited during the same run if their index is higher than
+   the current one -- just like a loop over all packetizers would.
+
+   \c puller returns \c true if the packetizer has to be asked again
+   the next time.
+*/
+void
+interleaver_c::pull(std::function<bool(size_t)> const &puller) {
+  auto itr = m_to_pull.begin();
+
+  while (itr != m_to_pull.end()) {
+    auto idx = *itr;
+
+    if (puller(idx))
+      ++itr;
+    else
+      itr = m_to_pull.erase(itr);
+  }
+}
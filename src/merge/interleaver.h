@@ -0,0 +1,61 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definition for the packet interleaver
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_INTERLEAVER_H
+#define MTX_MERGE_INTERLEAVER_H
+
+#include "common/common_pch.h"
+
+#include <queue>
+#include <set>
+
+#include "common/timestamp.h"
+
+/** \brief Decides which packetizer's packet is written next
+
+   The packetizers are identified by their index into
+   g_packetizers. The interleaver keeps the indexes of all packetizers
+   that currently hold a packet in a priority queue ordered by the
+   packets' output order timecodes. Ties are broken by the lower index
+   so that the order is the same as with a linear scan over all
+   packetizers.
+
+   It also keeps track of which packetizers have to be asked for
+   packets again. Those are the ones whose packet has been written and
+   the ones that couldn't deliver a packet the last time.
+*/
+class interleaver_c {
+protected:
+  struct entry_t {
+    int64_t timecode;
+    size_t idx;
+
+    bool operator <(entry_t const &other) const {
+      // Inverted as std::priority_queue returns the largest element.
+      return (timecode > other.timecode) || ((timecode == other.timecode) && (idx > other.idx));
+    }
+  };
+
+  std::priority_queue<entry_t> m_packets;
+  std::set<size_t> m_to_pull;
+
+public:
+  void add_packet(size_t idx, timestamp_c const &timecode);
+  bool has_packet() const;
+  size_t pop_winner();
+
+  void request_pull(size_t idx);
+  void pull(std::function<bool(size_t)> const &puller);
+};
+
+#endif  // MTX_MERGE_INTERLEAVER_H
@@ -0,0 +1,240 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   the process-wide memory budget
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/mm_io_x.h"
+#include "common/strings/formatting.h"
+#include "merge/memory_budget.h"
+#include "merge/packet.h"
+
+int64_t memory_budget_c::s_limit = 0;
+std::atomic<int64_t> memory_budget_c::s_usage{0};
+
+std::mutex memory_budget_c::s_mutex;
+mm_io_cptr memory_budget_c::s_spill_file;
+std::string memory_budget_c::s_spill_file_name;
+int64_t memory_budget_c::s_spill_end           = 0;
+int64_t memory_budget_c::s_num_spilled         = 0;
+int64_t memory_budget_c::s_max_spilled_bytes   = 0;
+int64_t memory_budget_c::s_spilled_bytes       = 0;
+std::map<int64_t, int64_t> memory_budget_c::s_free_ranges;
+
+debugging_option_c memory_budget_c::s_debug{"memory_budget"};
+
+void
+memory_budget_c::set_limit(int64_t limit) {
+  s_limit = std::max<int64_t>(limit, 0);
+}
+
+int64_t
+memory_budget_c::get_limit() {
+  return s_limit;
+}
+
+void
+memory_budget_c::add(int64_t num_bytes) {
+  s_usage += num_bytes;
+}
+
+void
+memory_budget_c::remove(int64_t num_bytes) {
+  s_usage -= num_bytes;
+}
+
+int64_t
+memory_budget_c::get_usage() {
+  return s_usage;
+}
+
+bool
+memory_budget_c::is_exceeded() {
+  return s_limit && (s_usage > s_limit);
+}
+
+void
+memory_budget_c::open_spill_file() {
+  s_spill_file_name = (bfs::temp_directory_path() / bfs::unique_path("mkvmerge-spill-%%%%-%%%%-%%%%-%%%%")).string();
+
+  try {
+    s_spill_file = std::make_shared<mm_file_io_c>(s_spill_file_name, MODE_CREATE);
+
+  } catch (mtx::mm_io::exception &ex) {
+    mxerror(boost::format(Y("The memory limit was exceeded, but the temporary file '%1%' for storing queued data could not be created: %2%.\n")) % s_spill_file_name % ex);
+  }
+
+  mxdebug_if(s_debug, boost::format("memory_budget: spilling queued packets to %1%\n") % s_spill_file_name);
+
+#if !defined(SYS_WINDOWS)
+  // The file stays accessible while it is open. Removing it right away
+  // makes sure that it is gone even if mkvmerge exits with an error.
+  boost::system::error_code ec;
+  bfs::remove(s_spill_file_name, ec);
+#endif
+}
+
+/** \brief Find a place in the spill file for \c size bytes
+
+   Uses the first unused range that's large enough and appends to the
+   file otherwise. Must be called with \c s_mutex locked.
+*/
+int64_t
+memory_budget_c::allocate_spill_range(int64_t size) {
+  for (auto itr = s_free_ranges.begin(), end = s_free_ranges.end(); itr != end; ++itr) {
+    if (itr->second < size)
+      continue;
+
+    auto position = itr->first, remaining = itr->second - size;
+
+    s_free_ranges.erase(itr);
+    if (remaining)
+      s_free_ranges.emplace(position + size, remaining);
+
+    return position;
+  }
+
+  auto position  = s_spill_end;
+  s_spill_end   += size;
+
+  return position;
+}
+
+/** \brief Mark a range in the spill file as unused
+
+   Adjacent unused ranges are merged. Unused space at the end of the
+   file is given up entirely. Must be called with \c s_mutex locked.
+*/
+void
+memory_budget_c::release_spill_range(int64_t position,
+                                     int64_t size) {
+  auto next = s_free_ranges.lower_bound(position);
+
+  if ((next != s_free_ranges.end()) && ((position + size) == next->first)) {
+    size += next->second;
+    next  = s_free_ranges.erase(next);
+  }
+
+  if (next != s_free_ranges.begin()) {
+    auto previous = std::prev(next);
+    if ((previous->first + previous->second) == position) {
+      position  = previous->first;
+      size     += previous->second;
+      s_free_ranges.erase(previous);
+    }
+  }
+
+  if ((position + size) == s_spill_end)
+    s_spill_end = position;
+  else
+    s_free_ranges.emplace(position, size);
+}
+
+/** \brief Move a queued packet's data to the spill file
+
+   The packet's data is released and its usage is subtracted from the
+   budget. Packets whose data is still being compressed are left
+   alone.
+*/
+void
+memory_budget_c::spill(packet_t &packet) {
+  if (packet.is_spilled() || !packet.data || packet.pending_compression.valid())
+    return;
+
+  std::lock_guard<std::mutex> lock{s_mutex};
+
+  if (!s_spill_file)
+    open_spill_file();
+
+  auto size     = packet.data->get_size();
+  auto position = allocate_spill_range(size);
+
+  s_spill_file->setFilePointer(position);
+  if (s_spill_file->write(packet.data->get_buffer(), size) != size)
+    mxerror(boost::format(Y("Could not write to the temporary file '%1%' for storing queued data. Check whether or not there's enough free space.\n")) % s_spill_file_name);
+
+  packet.spill_position  = position;
+  packet.spill_size      = size;
+  packet.data.reset();
+
+  s_spilled_bytes       += size;
+  s_max_spilled_bytes    = std::max(s_max_spilled_bytes, s_spilled_bytes);
+  ++s_num_spilled;
+
+  s_usage -= size;
+}
+
+/** \brief Read a packet's data back from the spill file
+
+   The packet's space in the spill file is re-used for packets spilled
+   later.
+*/
+void
+memory_budget_c::unspill(packet_t &packet) {
+  if (!packet.is_spilled())
+    return;
+
+  std::lock_guard<std::mutex> lock{s_mutex};
+
+  auto data = memory_c::alloc(packet.spill_size);
+  data->set_accounting_component(mtx::mem::component_e::packets);
+
+  s_spill_file->setFilePointer(packet.spill_position);
+  if (s_spill_file->read(data, packet.spill_size) != static_cast<uint64_t>(packet.spill_size))
+    mxerror(boost::format(Y("Could not read queued data back from the temporary file '%1%'.\n")) % s_spill_file_name);
+
+  release_spill_range(packet.spill_position, packet.spill_size);
+
+  packet.data            = data;
+  packet.spill_position  = -1;
+
+  s_spilled_bytes       -= packet.spill_size;
+  --s_num_spilled;
+
+  s_usage += packet.spill_size;
+}
+
+/** \brief Remove a queued packet that won't be output from the budget
+*/
+void
+memory_budget_c::discard(packet_t &packet) {
+  if (!packet.is_spilled()) {
+    if (packet.data)
+      s_usage -= packet.data->get_size();
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock{s_mutex};
+
+  release_spill_range(packet.spill_position, packet.spill_size);
+
+  packet.spill_position  = -1;
+  s_spilled_bytes       -= packet.spill_size;
+  --s_num_spilled;
+}
+
+void
+memory_budget_c::cleanup() {
+  std::lock_guard<std::mutex> lock{s_mutex};
+
+  if (!s_spill_file)
+    return;
+
+  mxdebug_if(s_debug, boost::format("memory_budget: at most %1% were stored in %2%\n") % format_file_size(s_max_spilled_bytes) % s_spill_file_name);
+
+  s_spill_file.reset();
+  s_free_ranges.clear();
+  s_spill_end = 0;
+
+  boost::system::error_code ec;
+  bfs::remove(s_spill_file_name, ec);
+}
@@ -0,0 +1,78 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definition for the process-wide memory budget
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_MEMORY_BUDGET_H
+#define MTX_MERGE_MEMORY_BUDGET_H
+
+#include "common/common_pch.h"
+
+#include <atomic>
+#include <mutex>
+
+#include "common/debugging.h"
+#include "common/mm_io.h"
+
+struct packet_t;
+
+/** \brief Limits the amount of memory used by queued packets
+
+   The packetizers and the reader threads report how many bytes of
+   packet data they currently hold in their queues. Once the total
+   exceeds the limit, readers that are ahead of the others are held
+   back. If holding a reader back is not possible, e.g. because the
+   track being read is needed for interleaving audio and video, then
+   the data of newly queued packets is written to a temporary file
+   instead and read back once the packet leaves the queue. The space
+   of packets read back is re-used for packets spilled later so that
+   the file only grows to the largest amount spilled at once.
+
+   A limit of 0 means that there is no limit. All functions are safe
+   to call from several threads at once.
+*/
+class memory_budget_c {
+protected:
+  static int64_t s_limit;
+  static std::atomic<int64_t> s_usage;
+
+  static std::mutex s_mutex;
+  static mm_io_cptr s_spill_file;
+  static std::string s_spill_file_name;
+  static int64_t s_spill_end, s_num_spilled, s_max_spilled_bytes, s_spilled_bytes;
+  // Unused ranges before s_spill_end: position -> size
+  static std::map<int64_t, int64_t> s_free_ranges;
+
+public:
+  static debugging_option_c s_debug;
+
+public:
+  static void set_limit(int64_t limit);
+  static int64_t get_limit();
+
+  static void add(int64_t num_bytes);
+  static void remove(int64_t num_bytes);
+  static int64_t get_usage();
+  static bool is_exceeded();
+
+  static void spill(packet_t &packet);
+  static void unspill(packet_t &packet);
+  static void discard(packet_t &packet);
+
+  static void cleanup();
+
+protected:
+  static void open_spill_file();
+  static int64_t allocate_spill_range(int64_t size);
+  static void release_spill_range(int64_t position, int64_t size);
+};
+
+#endif  // MTX_MERGE_MEMORY_BUDGET_H
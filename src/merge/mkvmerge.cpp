@@ -28,6 +28,8 @@
 #endif
 
 #include <algorithm>
+#include <deque>
+#include <future>
 #include <iostream>
 #include <list>
 #include <sstream>
@@ -40,19 +42,25 @@
 #include <matroska/KaxTag.h>
 #include <matroska/KaxTags.h>
 
+#include "common/at_scope_exit.h"
 #include "common/chapters/chapters.h"
 #include "common/command_line.h"
+#include "common/compression.h"
 #include "common/ebml.h"
 #include "common/extern_data.h"
 #include "common/file_types.h"
 #include "common/fs_sys_helpers.h"
 #include "common/iso639.h"
 #include "common/kax_analyzer.h"
+#include "common/locale.h"
 #include "common/mm_io.h"
 #include "common/segmentinfo.h"
 #include "common/split_arg_parsing.h"
 #include "common/strings/formatting.h"
 #include "common/strings/parsing.h"
+#include "common/thread_pool.h"
+#include "common/tracing.h"
+#include "common/translation.h"
 #include "common/unique_numbers.h"
 #include "common/version.h"
 #include "common/webm.h"
@@ -61,6 +69,9 @@
 #include "merge/cluster_helper.h"
 #include "merge/filelist.h"
 #include "merge/generic_reader.h"
+#include "merge/id_result.h"
+#include "merge/identification_cache.h"
+#include "merge/memory_budget.h"
 #include "merge/output_control.h"
 #include "merge/reader_detection_and_creation.h"
 #include "merge/track_info.h"
@@ -109,12 +120,37 @@ set_usage() {
                   "                           put at most n milliseconds of data into each\n"
                   "                           cluster.\n");
   usage_text += Y("  --no-cues                Do not write the cue data (the index).\n");
+  usage_text += Y("  --cues-at-front          Reserve space for the cue data in front of the\n"
+                  "                           clusters and write it there if it fits.\n");
   usage_text += Y("  --clusters-in-meta-seek  Write meta seek data for clusters.\n");
   usage_text += Y("  --disable-lacing         Do not use lacing.\n");
   usage_text += Y("  --enable-durations       Enable block durations for all blocks.\n");
   usage_text += Y("  --timecode-scale <n>     Force the timecode scale factor to n.\n");
   usage_text += Y("  --disable-track-statistics-tags\n"
                   "                           Do not write tags with track statistics.\n");
+  usage_text += Y("  --reader-threads         Read each source file in its own thread.\n");
+  usage_text += Y("  --reader-thread-queue-depth <n>\n"
+                  "                           Queue at most n packets per track when\n"
+                  "                           reading in threads.\n");
+  usage_text += Y("  --progress-file <name>   Write the progress as JSON lines to a file or\n"
+                  "                           to the file descriptor n with 'fd:n'.\n");
+  usage_text += Y("  --progress-interval <n>  Write the progress every n milliseconds.\n");
+  usage_text += Y("  --trace-file <name>      Write the time spent in each stage of muxing\n"
+                  "                           to a file in Chrome's trace event format.\n");
+  usage_text += Y("  --memory-limit <size>    Keep at most size bytes (with k, m or g as\n"
+                  "                           suffix) of queued data in memory. Hold back\n"
+                  "                           source files that are ahead of the others and\n"
+                  "                           store further data in a temporary file.\n");
+  usage_text += Y("  --write-behind-buffers <n>\n"
+                  "                           Use n output buffers and write full ones in\n"
+                  "                           the background if n is at least 2.\n");
+  usage_text += Y("  --mmap-input             Map source files into memory instead of\n"
+                  "                           reading them.\n");
+  usage_text += Y("  --reserve-header-space   Reserve space for track headers that grow\n"
+                  "                           once the first frames have been parsed.\n");
+  usage_text += Y("  --compression-threads <n>\n"
+                  "                           Compress and decompress frames with zlib on\n"
+                  "                           n threads.\n");
   usage_text +=   "\n";
   usage_text += Y(" File splitting, linking, appending and concatenating (more global options):\n");
   usage_text += Y("  --split <d[K,M,G]|HH:MM:SS|s>\n"
@@ -197,6 +233,9 @@ set_usage() {
   usage_text += Y("  -T, --no-track-tags      Don't copy tags for tracks from the source file.\n");
   usage_text += Y("  --no-global-tags         Don't keep global tags from the source file.\n");
   usage_text += Y("  --no-chapters            Don't keep chapters from the source file.\n");
+  usage_text += Y("  --follow <seconds>       The source file is still being written to. Wait\n"
+                  "                           for more data at its end until none has been\n"
+                  "                           added for the given number of seconds.\n");
   usage_text += Y("  -y, --sync <TID:d[,o[/p]]>\n"
                   "                           Synchronize, adjust the track's timecodes with\n"
                   "                           the id TID by 'd' ms.\n"
@@ -266,6 +305,12 @@ set_usage() {
   usage_text +=   "\n\n";
   usage_text += Y(" Other options:\n");
   usage_text += Y("  -i, --identify <file>    Print information about the source file.\n");
+  usage_text += Y("  --identify-batch <list-file> [--identify-threads <n>]\n"
+                  "                           Identify all files listed in list-file (or\n"
+                  "                           read from stdin for '-') on n threads.\n");
+  usage_text += Y("  --identification-cache <dir>\n"
+                  "                           Store identification results in dir and reuse\n"
+                  "                           them as long as the files don't change.\n");
   usage_text += Y("  -l, --list-types         Lists supported input file types.\n");
   usage_text += Y("  --list-languages         Lists all ISO639 languages and their\n"
                   "                           ISO639-2 codes.\n");
@@ -279,6 +324,11 @@ set_usage() {
                   "                           Redirects all messages into this file.\n");
   usage_text += Y("  --debug <topic>          Turns on debugging output for 'topic'.\n");
   usage_text += Y("  --engage <feature>       Turns on experimental feature 'feature'.\n");
+  usage_text += Y("  --io-uring               Use io_uring for reading and writing files.\n");
+  usage_text += Y("  --read-ahead <n>         Read up to n blocks of input files ahead in\n"
+                  "                           the background.\n");
+  usage_text += Y("  --io-statistics          Output statistics about reading and writing\n"
+                  "                           each file when exiting.\n");
   usage_text += Y("  @optionsfile             Reads additional command line options from\n"
                   "                           the specified file (see man page).\n");
   usage_text += Y("  -h, --help               Show this help.\n");
@@ -361,43 +411,249 @@ list_file_types() {
     mxinfo(boost::format("  %1% [%2%]\n") % file_type.title % file_type.extensions);
 }
 
+// Messages output while identifying a file on the current thread are
+// collected here so that they can be cached and so that the results of
+// several files identified at once aren't interleaved.
+static thread_local std::string *s_identification_output = nullptr;
+
+static std::string s_identification_cache_directory;
+static identification_cache_cptr s_identification_cache;
+
+static void
+setup_identification() {
+  verbose             = 0;
+  g_suppress_warnings = true;
+  g_identifying       = true;
+
+  set_mxmsg_handler(MXMSG_INFO, [](unsigned int, std::string const &info) {
+    if (s_identification_output)
+      *s_identification_output += info;
+    else
+      mxmsg(MXMSG_INFO, info);
+  });
+
+  if (s_identification_cache_directory.empty())
+    return;
+
+  auto variant = (boost::format("%1% %2% %3% %4%")
+                  % get_version_info("mkvmerge", vif_full)
+                  % (g_identify_for_gui ? "gui" : g_identify_verbose ? "verbose" : "plain")
+                  % translation_c::get_active_translation().get_locale()
+                  % g_cc_stdio->get_charset()).str();
+
+  s_identification_cache = std::make_shared<identification_cache_c>(s_identification_cache_directory, variant);
+}
+
+static void
+setup_file_for_identification(filelist_t &file,
+                              std::string file_name) {
+  file.ti = std::make_unique<track_info_c>();
+
+  if (!file_name.empty() && ('=' == file_name[0])) {
+    file.ti->m_disable_multi_file = true;
+    file_name                     = file_name.substr(1);
+  }
+
+  file.ti->m_fname = file_name;
+  file.name        = file_name;
+  file.all_names.push_back(file_name);
+}
+
 /** \brief Identify a file type and its contents
 
-   This function called for \c --identify. It sets up dummy track info
-   data for the reader, probes the input file, creates the file reader
-   and calls its identify function.
+   Probes the input file, creates the file reader and calls its
+   identify function. Returns what the reader output and the exit code
+   (0, or 3 for unsupported containers). Errors are reported with
+   \c mxerror().
+
+   Results are taken from and stored in the identification cache if
+   one is used. Results of playlists and of files that are read
+   together with other files aren't stored as they depend on more than
+   the file itself.
+*/
+static identification_result_t
+identify_file(filelist_t &file) {
+  // Whether or not other files are read along with this one isn't
+  // part of the cache key.
+  auto use_cache = s_identification_cache && !file.ti->m_disable_multi_file;
+
+  if (use_cache) {
+    auto cached = s_identification_cache->get(file.name);
+    if (cached)
+      return *cached;
+  }
+
+  auto result             = identification_result_t{ std::string{}, 0 };
+  s_identification_output = &result.output;
+  at_scope_exit_c reset_output{ []() { s_identification_output = nullptr; } };
+
+  try {
+    get_file_type(file);
+
+    if (FILE_TYPE_IS_UNKNOWN == file.type)
+      mxerror(boost::format(Y("File %1% has unknown type. Please have a look at the supported file types ('mkvmerge --list-types') and "
+                              "contact the author Moritz Bunkus <moritz@bunkus.org> if your file type is supported but not recognized properly.\n"))
+              % file.name);
+
+    create_reader(file);
+
+    file.reader->identify();
+    file.reader->display_identification_results();
+
+  } catch (mtx::id::unsupported_container_x &) {
+    result.exit_code = 3;
+  }
+
+  // Readers switch to reading several files in read_headers(); the
+  // size then differs from the file's own size.
+  boost::system::error_code ec;
+  auto single_file = !file.is_playlist && (!file.reader || (static_cast<uintmax_t>(file.size) == bfs::file_size(file.name, ec)));
+
+  if (use_cache && single_file && !ec)
+    s_identification_cache->put(file.name, result);
+
+  return result;
+}
+
+/** \brief Identify a single file
+
+   This function called for \c --identify.
 */
 static void
-identify(std::string &filename) {
+identify(std::string const &file_name) {
+  setup_identification();
+
   g_files.emplace_back(new filelist_t);
   auto &file = *g_files.back();
-  file.ti    = std::make_unique<track_info_c>();
 
-  if ('=' == filename[0]) {
-    file.ti->m_disable_multi_file = true;
-    filename                      = filename.substr(1);
+  setup_file_for_identification(file, file_name);
+
+  auto result = identify_file(file);
+
+  mxinfo(result.output);
+
+  g_files.clear();
+
+  if (result.exit_code)
+    mxexit(result.exit_code);
+}
+
+class batch_identification_error_x: public mtx::exception {
+protected:
+  std::string m_message;
+
+public:
+  batch_identification_error_x(std::string const &message)
+    : m_message{message}
+  {
   }
+  virtual ~batch_identification_error_x() throw() { }
 
-  verbose             = 0;
-  g_suppress_warnings = true;
-  g_identifying       = true;
-  file.ti->m_fname    = filename;
-  file.name           = filename;
-  file.all_names.push_back(filename);
+  virtual const char *what() const throw() {
+    return m_message.c_str();
+  }
+};
 
-  get_file_type(file);
+static std::pair<std::string, bool>
+format_batch_identification_error(std::string const &file_name,
+                                  std::string message) {
+  balg::replace_all(message, "\n", " ");
+  strip(message, true);
 
-  if (FILE_TYPE_IS_UNKNOWN == file.type)
-    mxerror(boost::format(Y("File %1% has unknown type. Please have a look at the supported file types ('mkvmerge --list-types') and "
-                            "contact the author Moritz Bunkus <moritz@bunkus.org> if your file type is supported but not recognized properly.\n"))
-            % file.name);
+  return { (boost::format("File '%1%': error: %2%\n") % file_name % message).str(), false };
+}
 
-  create_readers();
+/** \brief Identify one file for \c --identify-batch
 
-  file.reader->identify();
-  file.reader->display_identification_results();
+   Runs on one of the batch identification threads. Errors don't abort
+   the program; they're returned as a single error line instead. The
+   second member of the result is \c false in that case.
+*/
+static std::pair<std::string, bool>
+identify_in_batch(std::string const &file_name) {
+  filelist_t file;
+  setup_file_for_identification(file, file_name);
 
-  g_files.clear();
+  try {
+    return { identify_file(file).output, true };
+
+  } catch (mtx::exception &ex) {
+    return format_batch_identification_error(file.name, ex.error());
+
+  } catch (std::exception &ex) {
+    return format_batch_identification_error(file.name, ex.what());
+  }
+}
+
+/** \brief Identify many files concurrently
+
+   This function is called for \c --identify-batch. The names of the
+   files are read from \c list_file_name, one per line, or from the
+   standard input if it is \c -. Files are identified on
+   \c num_threads threads, and the results are output in the same
+   format as for \c --identify-for-gui and in the order the names were
+   read. Files that cannot be identified result in a single line
+   "File '...': error: ..." instead of aborting the whole batch.
+
+   Returns \c true if all files were identified successfully.
+*/
+static bool
+identify_batch(std::string const &list_file_name,
+               unsigned int num_threads) {
+  g_identify_verbose = true;
+  g_identify_for_gui = true;
+
+  setup_identification();
+
+  auto list_file = std::unique_ptr<mm_text_io_c>{};
+  if (list_file_name != "-") {
+    try {
+      list_file.reset(new mm_text_io_c(new mm_file_io_c(list_file_name)));
+    } catch (mtx::mm_io::exception &ex) {
+      mxerror(boost::format(Y("The file '%1%' could not be opened for reading: %2%.\n")) % list_file_name % ex);
+    }
+  }
+
+  auto read_file_name = [&list_file](std::string &line) -> bool {
+    return list_file ? list_file->getline2(line) : !!std::getline(std::cin, line);
+  };
+
+  // From now on errors only concern the file being identified.
+  set_mxmsg_handler(MXMSG_ERROR, [](unsigned int, std::string const &error) {
+    throw batch_identification_error_x{error};
+  });
+
+  mtx::thread_pool_c pool{std::max(num_threads, 1u)};
+  std::deque<std::future<std::pair<std::string, bool>>> pending;
+  auto num_failed = 0u;
+
+  auto output_first = [&pending, &num_failed]() {
+    auto result = pending.front().get();
+    pending.pop_front();
+
+    if (!result.second)
+      ++num_failed;
+
+    mxinfo(result.first);
+  };
+
+  std::string file_name;
+  while (read_file_name(file_name)) {
+    strip(file_name, true);
+    if (file_name.empty())
+      continue;
+
+    pending.push_back(pool.submit([file_name]() { return identify_in_batch(file_name); }));
+
+    // Keep the threads busy without reading the whole list first.
+    if (pending.size() >= (4 * pool.get_num_threads()))
+      output_first();
+  }
+
+  while (!pending.empty())
+    output_first();
+
+  return !num_failed;
 }
 
 /** \brief Parse a number postfixed with a time-based unit
@@ -880,6 +1136,40 @@ parse_arg_split_parts(const std::string &arg,
   }
 }
 
+/** \brief Parse the argument for \c --memory-limit
+
+   The size is given in bytes, optionally followed by one of the
+   suffixes 'k', 'm' or 'g'.
+*/
+static void
+parse_arg_memory_limit(const std::string &arg) {
+  std::string s       = arg;
+  std::string err_msg = Y("Invalid size in '--memory-limit %1%'.\n");
+
+  if (s.empty())
+    mxerror(boost::format(err_msg) % arg);
+
+  char mod         = tolower(s[s.length() - 1]);
+  int64_t modifier = 1;
+  if ('k' == mod)
+    modifier = 1024;
+  else if ('m' == mod)
+    modifier = 1024 * 1024;
+  else if ('g' == mod)
+    modifier = 1024 * 1024 * 1024;
+  else if (!isdigit(mod))
+    mxerror(boost::format(err_msg) % arg);
+
+  if (1 != modifier)
+    s.erase(s.size() - 1);
+
+  int64_t limit = 0;
+  if (!parse_number(s, limit) || (0 >= limit))
+    mxerror(boost::format(err_msg) % arg);
+
+  memory_budget_c::set_limit(limit * modifier);
+}
+
 /** \brief Parse the size format to \c --split
 
   This function is called by ::parse_split if the format specifies
@@ -1799,6 +2089,35 @@ parse_common_args(std::vector<std::string> args) {
 
 static void
 parse_args(std::vector<std::string> args) {
+  // The identification cache can be combined with all of the
+  // identification modes below.
+  auto cache_itr = brng::find(args, "--identification-cache");
+  if (cache_itr != args.end()) {
+    if ((cache_itr + 1) == args.end())
+      mxerror(Y("'--identification-cache' lacks the name of the directory.\n"));
+
+    s_identification_cache_directory = *(cache_itr + 1);
+    args.erase(cache_itr, cache_itr + 2);
+  }
+
+  // Identification of many files at once. Only the number of threads
+  // may be given in addition to the file list.
+  if (!args.empty() && (args[0] == "--identify-batch")) {
+    if (1 == args.size())
+      mxerror(Y("'--identify-batch' lacks the name of the file with the list of files.\n"));
+
+    auto num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    if ((4 == args.size()) && (args[2] == "--identify-threads")) {
+      if (!parse_number(args[3], num_threads) || !num_threads)
+        mxerror(boost::format(Y("Invalid number of threads in '--identify-threads %1%'.\n")) % args[3]);
+
+    } else if (2 != args.size())
+      mxerror(Y("'--identify-batch' can only be used with a file name and the option '--identify-threads'. No further options are allowed if this option is used.\n"));
+
+    mxexit(identify_batch(args[1], num_threads) ? 0 : 2);
+  }
+
   // Check if only information about the file is wanted. In this mode only
   // two parameters are allowed: the --identify switch and the file.
   if ((   (2 == args.size())
@@ -1838,7 +2157,7 @@ parse_args(std::vector<std::string> args) {
       list_iso639_languages();
       mxexit();
 
-    } else if ((this_arg == "-i") || (this_arg == "--identify") || (this_arg == "-I") || (this_arg == "--identify-verbose") || (this_arg == "--identify-for-mmg") || (this_arg == "--identify-for-gui"))
+    } else if ((this_arg == "-i") || (this_arg == "--identify") || (this_arg == "-I") || (this_arg == "--identify-verbose") || (this_arg == "--identify-for-mmg") || (this_arg == "--identify-for-gui") || (this_arg == "--identify-batch"))
       mxerror(boost::format(Y("'%1%' can only be used with a file name. No further options are allowed if this option is used.\n")) % this_arg);
 
     else if (this_arg == "--capabilities") {
@@ -1877,6 +2196,15 @@ parse_args(std::vector<std::string> args) {
     usage(2);
   }
 
+  // Output to the standard output or to e.g. a named pipe cannot be
+  // seeked in. Messages must not end up in the output file either.
+  boost::system::error_code ec;
+  auto output_status = bfs::status(g_outfile, ec);
+  g_stream_output    = ("-" == g_outfile) || (!ec && bfs::exists(output_status) && !bfs::is_regular_file(output_status) && !bfs::is_directory(output_status));
+
+  if (("-" == g_outfile) && !stdio_redirected())
+    redirect_stdio(std::make_shared<mm_stdio_c>(true));
+
   if (!outputting_webm() && is_webm_file_name(g_outfile)) {
     set_output_compatibility(OC_WEBM);
     mxinfo(boost::format(Y("Automatically enabling WebM compliance mode due to output file name extension.\n")));
@@ -1978,6 +2306,9 @@ parse_args(std::vector<std::string> args) {
     } else if (this_arg == "--no-cues")
       g_write_cues = false;
 
+    else if (this_arg == "--cues-at-front")
+      g_cues_at_front = true;
+
     else if (this_arg == "--clusters-in-meta-seek")
       g_write_meta_seek_for_clusters = true;
 
@@ -1990,6 +2321,82 @@ parse_args(std::vector<std::string> args) {
     else if (this_arg == "--disable-track-statistics-tags")
       g_no_track_statistics_tags = true;
 
+    else if (this_arg == "--reader-threads")
+      g_reader_threads = true;
+
+    else if (this_arg == "--reader-thread-queue-depth") {
+      if (no_next_arg)
+        mxerror(Y("'--reader-thread-queue-depth' lacks the number of packets.\n"));
+
+      if (!parse_number(next_arg, g_reader_thread_queue_depth) || !g_reader_thread_queue_depth)
+        mxerror(boost::format(Y("Invalid queue depth in '--reader-thread-queue-depth %1%'.\n")) % next_arg);
+
+      g_reader_threads = true;
+      sit++;
+    }
+
+    else if (this_arg == "--progress-file") {
+      if (no_next_arg)
+        mxerror(Y("'--progress-file' lacks the file name.\n"));
+
+      g_progress_file = next_arg;
+      sit++;
+    }
+
+    else if (this_arg == "--progress-interval") {
+      if (no_next_arg)
+        mxerror(Y("'--progress-interval' lacks the number of milliseconds.\n"));
+
+      if (!parse_number(next_arg, g_progress_interval) || (0 >= g_progress_interval))
+        mxerror(boost::format(Y("Invalid interval in '--progress-interval %1%'.\n")) % next_arg);
+
+      sit++;
+    }
+
+    else if (this_arg == "--trace-file") {
+      if (no_next_arg)
+        mxerror(Y("'--trace-file' lacks the file name.\n"));
+
+      mtx::trace::enable(next_arg);
+      sit++;
+    }
+
+    else if (this_arg == "--memory-limit") {
+      if (no_next_arg)
+        mxerror(Y("'--memory-limit' lacks the size.\n"));
+
+      parse_arg_memory_limit(next_arg);
+      sit++;
+    }
+
+    else if (this_arg == "--write-behind-buffers") {
+      if (no_next_arg)
+        mxerror(Y("'--write-behind-buffers' lacks the number of buffers.\n"));
+
+      if (!parse_number(next_arg, g_write_behind_buffers) || !g_write_behind_buffers)
+        mxerror(boost::format(Y("Invalid number of buffers in '--write-behind-buffers %1%'.\n")) % next_arg);
+
+      sit++;
+    }
+
+    else if (this_arg == "--mmap-input")
+      g_mmap_input = true;
+
+    else if (this_arg == "--reserve-header-space")
+      g_reserve_header_space = true;
+
+    else if (this_arg == "--compression-threads") {
+      if (no_next_arg)
+        mxerror(Y("'--compression-threads' lacks the number of threads.\n"));
+
+      unsigned int num_threads;
+      if (!parse_number(next_arg, num_threads))
+        mxerror(boost::format(Y("Invalid number of threads in '--compression-threads %1%'.\n")) % next_arg);
+
+      compressor_c::set_num_threads(num_threads);
+      sit++;
+    }
+
     else if (this_arg == "--attachment-description") {
       if (no_next_arg)
         mxerror(Y("'--attachment-description' lacks the description.\n"));
@@ -2095,7 +2502,19 @@ parse_args(std::vector<std::string> args) {
     } else if (this_arg == "--no-global-tags")
       ti->m_no_global_tags = true;
 
-    else if (this_arg == "--meta-seek-size") {
+    else if (this_arg == "--follow") {
+      if (no_next_arg)
+        mxerror(boost::format(Y("'%1%' lacks its argument.\n")) % this_arg);
+
+      double timeout = 0;
+      if (!parse_number(next_arg, timeout) || (0 >= timeout))
+        mxerror(boost::format(Y("Invalid timeout for '%1%' given: '%2%'. It must be a positive number of seconds.\n")) % this_arg % next_arg);
+
+      ti->m_follow_timeout     = std::max<int64_t>(timeout * 1000, 1);
+      ti->m_disable_multi_file = true;
+      sit++;
+
+    } else if (this_arg == "--meta-seek-size") {
       mxwarn(Y("The option '--meta-seek-size' is no longer supported. Please read mkvmerge's documentation, especially the section about the MATROSKA FILE LAYOUT.\n"));
       sit++;
 
@@ -2359,6 +2778,9 @@ parse_args(std::vector<std::string> args) {
   if (!g_cluster_helper->splitting() && !g_no_linking)
     mxwarn(Y("'--link' is only useful in combination with '--split'.\n"));
 
+  if (g_cluster_helper->splitting() && g_stream_output)
+    mxerror(boost::format(Y("Splitting cannot be used when writing to the standard output or to a pipe ('%1%').\n")) % g_outfile);
+
   if (!inputs_found && g_files.empty())
     mxerror(Y("No input files were given. No output will be created.\n"));
 }
@@ -2562,6 +2984,7 @@ main(int argc,
     create_next_output_file();
     main_loop();
     finish_file(true);
+    report_final_progress();
   } catch (mtx::mm_io::exception &ex) {
     force_close_output_file();
     mxerror(boost::format("%1% %2% %3% %4%; %5%\n")
@@ -2569,6 +2992,10 @@ main(int argc,
             % ex.what() % ex.error());
   }
 
+  if (g_num_header_relocations)
+    mxinfo(boost::format(Y("The track headers outgrew the space reserved for them %1% time(s). %2% bytes of already written data had to be moved.\n"))
+           % g_num_header_relocations % g_num_header_relocation_bytes);
+
   mxinfo(boost::format(Y("Muxing took %1%.\n")) % create_minutes_seconds_time_string((mtx::sys::get_current_time_millis() - start + 500) / 1000, true));
 
   cleanup();
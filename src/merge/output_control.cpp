@@ -54,6 +54,7 @@
 #include "common/ebml.h"
 #include "common/fs_sys_helpers.h"
 #include "common/hacks.h"
+#include "common/mm_stream_output_io.h"
 #include "common/mm_write_buffer_io.h"
 #include "common/strings/formatting.h"
 #include "common/tags/tags.h"
@@ -65,7 +66,11 @@
 #include "merge/filelist.h"
 #include "merge/generic_packetizer.h"
 #include "merge/generic_reader.h"
+#include "merge/interleaver.h"
+#include "merge/memory_budget.h"
 #include "merge/output_control.h"
+#include "merge/progress_reporter.h"
+#include "merge/reader_thread.h"
 #include "merge/webm.h"
 
 using namespace libmatroska;
@@ -95,10 +100,12 @@ kax_info_cptr g_kax_info_chap;
 
 // Variables set by the command line parser.
 std::string g_outfile;
-int64_t g_file_sizes                        = 0;
+std::atomic<int64_t> g_file_sizes{};
 int g_max_blocks_per_cluster                = 65535;
 int64_t g_max_ns_per_cluster                = 5000000000ll;
 bool g_write_cues                           = true;
+bool g_cues_at_front                        = false;
+bool g_stream_output                        = false;
 bool g_cue_writing_requested                = false;
 generic_packetizer_c *g_video_packetizer    = nullptr;
 bool g_write_meta_seek_for_clusters         = false;
@@ -106,6 +113,15 @@ bool g_no_lacing                            = false;
 bool g_no_linking                           = true;
 bool g_use_durations                        = false;
 bool g_no_track_statistics_tags             = false;
+bool g_reader_threads                       = false;
+size_t g_reader_thread_queue_depth          = 32;
+unsigned int g_write_behind_buffers         = 1;
+std::string g_progress_file;
+int64_t g_progress_interval                 = 1000;
+bool g_mmap_input                           = false;
+bool g_reserve_header_space                 = false;
+unsigned int g_num_header_relocations       = 0;
+uint64_t g_num_header_relocation_bytes      = 0;
 
 double g_timecode_scale                     = TIMECODE_SCALE;
 timecode_scale_mode_e g_timecode_scale_mode = TIMECODE_SCALE_MODE_NORMAL;
@@ -149,6 +165,7 @@ append_mode_e g_append_mode                 = APPEND_MODE_FILE_BASED;
 bool s_appending_files                      = false;
 auto s_debug_appending                      = debugging_option_c{"append|appending"};
 auto s_debug_rerender_track_headers         = debugging_option_c{"rerender|rerender_track_headers"};
+auto s_debug_cues_at_front                  = debugging_option_c{"cues_at_front"};
 
 std::string g_default_language              = "und";
 
@@ -169,19 +186,54 @@ static std::unique_ptr<EbmlVoid> s_kax_chapters_void;
 static int64_t s_max_chapter_size           = 0;
 static std::unique_ptr<EbmlVoid> s_void_after_track_headers;
 
+// Space reserved for the cues in front of the clusters with
+// --cues-at-front. Only the position is tracked as the data behind
+// the track headers may be moved.
+static int64_t s_cues_void_position         = 0;
+static int64_t s_cues_void_size             = 0;
+
 static mm_io_cptr s_out;
 
+/** \brief Whether data written at \c position can still be overwritten
+
+   Always the case unless the output is non-seekable and the data has
+   already been passed on.
+*/
+static bool
+can_overwrite(int64_t position) {
+  auto stream_out = dynamic_cast<mm_stream_output_io_c *>(s_out.get());
+  return !stream_out || stream_out->can_overwrite(position);
+}
+
+static void
+warn_about_non_seekable_output() {
+  static auto s_warned = false;
+
+  if (s_warned)
+    return;
+
+  s_warned = true;
+  mxwarn(boost::format(Y("The headers written to the non-seekable output '%1%' would have to be updated, but they have already been written. "
+                         "The output may not be playable correctly.\n")) % s_out->get_file_name());
+}
+
 static bitvalue_c s_seguid_prev(128), s_seguid_current(128), s_seguid_next(128);
 
 static int s_display_files_done           = 0;
 static int s_display_path_length          = 1;
 static generic_reader_c *s_display_reader = nullptr;
 
+static int64_t s_num_packets_written      = 0;
+static int64_t s_bytes_written_before     = 0;
+static timestamp_c s_output_timestamp;
+
 static std::unique_ptr<EbmlHead> s_head;
 
 static std::string s_muxing_app, s_writing_app;
 static boost::posix_time::ptime s_writing_date;
 
+static interleaver_c s_interleaver;
+
 static auto s_required_matroska_version      = 1u;
 static auto s_required_matroska_read_version = 1u;
 
@@ -239,14 +291,16 @@ sighandler(int /* signum */) {
   mxinfo(Y("The file is being fixed, part 2/4..."));
   // Now re-render the kax_duration and fill in the biggest timecode
   // as the file's duration.
-  s_out->save_pos(s_kax_duration->GetElementPosition());
-  s_kax_duration->SetValue(calculate_file_duration());
-  s_kax_duration->Render(*s_out);
-  s_out->restore_pos();
+  if (s_kax_duration && can_overwrite(s_kax_duration->GetElementPosition())) {
+    s_out->save_pos(s_kax_duration->GetElementPosition());
+    s_kax_duration->SetValue(calculate_file_duration());
+    s_kax_duration->Render(*s_out);
+    s_out->restore_pos();
+  }
   mxinfo(Y(" done\n"));
 
   mxinfo(Y("The file is being fixed, part 3/4..."));
-  if ((g_kax_sh_main->ListSize() > 0) && !hack_engaged(ENGAGE_NO_META_SEEK)) {
+  if ((g_kax_sh_main->ListSize() > 0) && !hack_engaged(ENGAGE_NO_META_SEEK) && can_overwrite(s_kax_sh_void->GetElementPosition())) {
     g_kax_sh_main->UpdateSize();
     if (s_kax_sh_void->ReplaceWith(*g_kax_sh_main, *s_out, true) == INVALID_FILEPOS_T)
       mxwarn(boost::format(Y("This should REALLY not have happened. The space reserved for the first meta seek element was too small. %1%\n")) % BUGMSG);
@@ -255,7 +309,8 @@ sighandler(int /* signum */) {
 
   mxinfo(Y("The file is being fixed, part 4/4..."));
   // Set the correct size for the segment.
-  if (g_kax_segment->ForceSize(s_out->getFilePointer() - g_kax_segment->GetElementPosition() - g_kax_segment->HeadSize()))
+  if (   can_overwrite(g_kax_segment->GetElementPosition())
+      && g_kax_segment->ForceSize(s_out->getFilePointer() - g_kax_segment->GetElementPosition() - g_kax_segment->HeadSize()))
     g_kax_segment->OverwriteHead(*s_out);
 
   mxinfo(Y(" done\n"));
@@ -286,6 +341,20 @@ determine_display_reader() {
   return winner->reader.get();
 }
 
+/** \brief The overall percentage done or -1 if it is unknown
+*/
+static int
+get_progress_percentage() {
+  if (!s_display_reader)
+    s_display_reader = determine_display_reader();
+
+  auto reader_progress = reader_threads_c::get() ? reader_threads_c::get()->get_progress(*s_display_reader) : s_display_reader->get_progress();
+  if (0 > reader_progress)
+    return -1;
+
+  return (reader_progress + s_display_files_done * 100) / s_display_path_length;
+}
+
 /** \brief Selects a reader for displaying its progress information
 */
 static void
@@ -305,13 +374,24 @@ display_progress(bool is_100percent = false) {
     return;
   }
 
-  if (!s_display_reader)
-    s_display_reader = determine_display_reader();
-
   bool display_progress  = false;
-  int current_percentage = (s_display_reader->get_progress() + s_display_files_done * 100) / s_display_path_length;
+  int current_percentage = get_progress_percentage();
   int64_t current_time   = mtx::sys::get_current_time_millis();
 
+  // The size of the source is unknown, e.g. when reading from a
+  // pipe. Show the amount read so far instead.
+  if (0 > current_percentage) {
+    if (g_gui_mode || ((current_time - s_previous_progress_on) < 500))
+      return;
+
+    auto position = reader_threads_c::get() ? reader_threads_c::get()->get_position(*s_display_reader) : static_cast<int64_t>(s_display_reader->m_in->getFilePointer());
+    mxinfo(boost::format(Y("Progress: %1% read%2%")) % format_file_size(position) % "\r");
+
+    s_previous_percentage  = current_percentage;
+    s_previous_progress_on = current_time;
+    return;
+  }
+
   if (   (-1 == s_previous_percentage)
       || ((100 == current_percentage) && (100 > s_previous_percentage))
       || ((current_percentage != s_previous_percentage) && ((current_time - s_previous_progress_on) >= 500)))
@@ -332,6 +412,42 @@ display_progress(bool is_100percent = false) {
   s_previous_progress_on = current_time;
 }
 
+/** \brief Write a machine-readable progress report if one is due
+
+   Only active with \c --progress-file. The final report is always
+   written.
+*/
+static void
+report_progress(bool done = false) {
+  auto reporter = progress_reporter_c::get();
+  if (!reporter)
+    return;
+
+  auto current_time = mtx::sys::get_current_time_millis();
+  if (!done && !reporter->is_due(current_time))
+    return;
+
+  auto reader_threads = reader_threads_c::get();
+  progress_status_t status;
+
+  status.time             = current_time;
+  status.percentage       = done ? 100 : get_progress_percentage();
+  status.bytes_written    = s_bytes_written_before + (s_out ? s_out->getFilePointer() : 0);
+  status.num_packets      = s_num_packets_written;
+  status.output_timestamp = s_output_timestamp;
+
+  for (auto &file : g_files)
+    if (file->reader->m_in)
+      status.bytes_read += reader_threads ? reader_threads->get_position(*file->reader) : file->reader->m_in->getFilePointer();
+
+  for (auto &ptzr : g_packetizers) {
+    auto queued_bytes = reader_threads ? reader_threads->get_queued_bytes(*ptzr.packetizer) : ptzr.packetizer->get_queued_bytes();
+    status.tracks.push_back(progress_status_t::track_t{ ptzr.file, ptzr.packetizer->get_source_track_num(), queued_bytes });
+  }
+
+  reporter->report(status, done);
+}
+
 /** \brief Add some tags to the list of all tags
 */
 void
@@ -371,6 +487,7 @@ add_attachment(attachment_t attachment) {
     // No ID yet. Let's assign one.
     attachment.id = create_unique_number(UNIQUE_ATTACHMENT_IDS);
 
+  attachment.data->set_accounting_component(mtx::mem::component_e::attachments);
   g_attachments.push_back(attachment);
 
   return attachment.id;
@@ -400,6 +517,7 @@ add_packetizer_globally(generic_packetizer_c *packetizer) {
     mxerror(boost::format(Y("filelist_t not found for generic_packetizer_c. %1%\n")) % BUGMSG);
 
   g_packetizers.push_back(pack);
+  s_interleaver.request_pull(g_packetizers.size() - 1);
 }
 
 static void
@@ -441,26 +559,42 @@ set_timecode_scale() {
 
 bool
 set_required_matroska_version(unsigned int required_version) {
-  auto previous               = s_required_matroska_version;
-  s_required_matroska_version = std::max(s_required_matroska_version, required_version);
-  auto version_changed        = s_required_matroska_version != previous;
+  // The versions are only ever raised while all reader threads are
+  // idle. Therefore there's no need to synchronize if nothing changes.
+  if (required_version <= s_required_matroska_version)
+    return false;
+
+  auto version_changed = false;
 
-  if (version_changed)
-    rerender_ebml_head();
+  reader_threads_c::synchronize([required_version, &version_changed]() {
+    auto previous               = s_required_matroska_version;
+    s_required_matroska_version = std::max(s_required_matroska_version, required_version);
+    version_changed             = s_required_matroska_version != previous;
+
+    if (version_changed)
+      rerender_ebml_head();
+  });
 
   return version_changed;
 }
 
 bool
 set_required_matroska_read_version(unsigned int required_read_version) {
-  auto previous                    = s_required_matroska_read_version;
-  s_required_matroska_read_version = std::max(s_required_matroska_read_version, required_read_version);
+  if (required_read_version <= s_required_matroska_read_version)
+    return false;
 
-  auto read_version_changed        = s_required_matroska_read_version != previous;
-  auto version_changed             = set_required_matroska_version(required_read_version);
+  auto read_version_changed = false;
 
-  if (read_version_changed && !version_changed)
-    rerender_ebml_head();
+  reader_threads_c::synchronize([required_read_version, &read_version_changed]() {
+    auto previous                    = s_required_matroska_read_version;
+    s_required_matroska_read_version = std::max(s_required_matroska_read_version, required_read_version);
+
+    read_version_changed             = s_required_matroska_read_version != previous;
+    auto version_changed             = set_required_matroska_version(required_read_version);
+
+    if (read_version_changed && !version_changed)
+      rerender_ebml_head();
+  });
 
   return read_version_changed;
 }
@@ -490,6 +624,11 @@ rerender_ebml_head() {
   if (!out || !s_head)
     return;
 
+  if (!can_overwrite(s_head->GetElementPosition())) {
+    warn_about_non_seekable_output();
+    return;
+  }
+
   out->save_pos(s_head->GetElementPosition());
   render_ebml_head(out);
   out->restore_pos();
@@ -508,10 +647,16 @@ render_headers(mm_io_c *out) {
 
     s_kax_infos = std::make_unique<KaxInfo>();
 
-    s_kax_duration = new KaxMyDuration{ !g_video_packetizer || (TIMECODE_SCALE_MODE_AUTO == g_timecode_scale_mode) ? EbmlFloat::FLOAT_64 : EbmlFloat::FLOAT_32};
+    // The duration is only known at the end. Non-seekable output
+    // usually cannot be updated by then; it doesn't get one at all.
+    s_kax_duration = nullptr;
+
+    if (!g_stream_output) {
+      s_kax_duration = new KaxMyDuration{ !g_video_packetizer || (TIMECODE_SCALE_MODE_AUTO == g_timecode_scale_mode) ? EbmlFloat::FLOAT_64 : EbmlFloat::FLOAT_32};
 
-    s_kax_duration->SetValue(0.0);
-    s_kax_infos->PushElement(*s_kax_duration);
+      s_kax_duration->SetValue(0.0);
+      s_kax_infos->PushElement(*s_kax_duration);
+    }
 
     if (s_muxing_app.empty()) {
       if (!hack_engaged(ENGAGE_NO_VARIABLE_DATA)) {
@@ -616,6 +761,16 @@ render_headers(mm_io_c *out) {
 
     g_kax_segment->WriteHead(*out, 8);
 
+    // Mark the segment's size as unknown in case the start of a
+    // non-seekable output has been passed on before the end.
+    if (g_stream_output) {
+      static unsigned char const s_unknown_size[8] = { 0x01, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+      out->save_pos(g_kax_segment->GetElementPosition() + EBML_ID_LENGTH(EBML_ID(KaxSegment)));
+      out->write(s_unknown_size, 8);
+      out->restore_pos();
+    }
+
     // Reserve some space for the meta seek stuff.
     g_kax_sh_main = std::make_unique<KaxSeekHead>();
     s_kax_sh_void = std::make_unique<EbmlVoid>();
@@ -658,9 +813,17 @@ render_headers(mm_io_c *out) {
       g_kax_sh_main->IndexThis(*g_kax_tracks, *g_kax_segment);
 
       // Reserve some small amount of space for header changes by the
-      // packetizers.
+      // packetizers. With '--reserve-header-space' add whatever they
+      // expect to add later on, e.g. codec private data only known
+      // after parsing the first frames.
+      auto expected_growth = int64_t{};
+      if (g_reserve_header_space)
+        for (auto &ptzr : g_packetizers)
+          if (ptzr.packetizer)
+            expected_growth += ptzr.packetizer->get_expected_header_growth();
+
       s_void_after_track_headers = std::make_unique<EbmlVoid>();
-      s_void_after_track_headers->SetSize(1024 + full_header_size - g_kax_tracks->ElementSize(false));
+      s_void_after_track_headers->SetSize(1024 + expected_growth + full_header_size - g_kax_tracks->ElementSize(false));
       s_void_after_track_headers->Render(*out);
     }
 
@@ -700,28 +863,72 @@ adjust_cue_and_seekhead_positions(uint64_t data_start_pos,
 
   if (g_write_meta_seek_for_clusters)
     adjust_cluster_seekhead_positions(data_start_pos, delta);
+
+  if (s_cues_void_size && (s_cues_void_position >= static_cast<int64_t>(data_start_pos)))
+    s_cues_void_position += delta;
 }
 
-static void
+/** \brief Move all data written after the track headers towards the end
+
+   Makes room for \c min_delta additional bytes of track headers. With
+   '--reserve-header-space' the space actually inserted is rounded up
+   to whole file system blocks, and the move starts at a block boundary
+   if that boundary lies within the track headers or the void following
+   them. Both are rendered again afterwards. This allows the output
+   file to simply insert blocks without copying any data. Otherwise the
+   layout of the file is the same as with the plain copy.
+
+   Returns the number of bytes the data has been moved by.
+*/
+static uint64_t
 relocate_written_data(uint64_t data_start_pos,
-                      uint64_t delta) {
+                      uint64_t min_delta) {
   s_out->save_pos();
 
-  auto const block_size = 1024llu * 1024;
-  auto to_relocate      = s_out->get_size() - data_start_pos;
+  auto const fs_block_size = 4096llu;
+  auto const block_size    = 1024llu * 1024;
+  auto delta               = min_delta;
+  auto move_start_pos      = data_start_pos;
+
+  if (g_reserve_header_space) {
+    delta          = (min_delta + fs_block_size - 1) / fs_block_size * fs_block_size;
+    move_start_pos = data_start_pos / fs_block_size * fs_block_size;
+
+    if (move_start_pos < g_kax_tracks->GetElementPosition())
+      move_start_pos = data_start_pos;
+  }
+
+  auto to_relocate      = s_out->get_size() - move_start_pos;
   auto relocated        = 0llu;
-  auto af_buffer        = memory_c::alloc(block_size);
-  auto buffer           = af_buffer->get_buffer();
 
   mxdebug_if(s_debug_rerender_track_headers,
-             boost::format("[rerender] relocate_written_data: void pos %1% void size %2% = data_start_pos %3% s_out size %4% delta %5% to_relocate %6%\n")
-             % s_void_after_track_headers->GetElementPosition() % s_void_after_track_headers->ElementSize(true) % data_start_pos % s_out->get_size() % delta % to_relocate);
+             boost::format("[rerender] relocate_written_data: void pos %1% void size %2% = data_start_pos %3% s_out size %4% delta %5% to_relocate %6% move_start_pos %7%\n")
+             % s_void_after_track_headers->GetElementPosition() % s_void_after_track_headers->ElementSize(true) % data_start_pos % s_out->get_size() % delta % to_relocate % move_start_pos);
+
+  ++g_num_header_relocations;
+  g_num_header_relocation_bytes += to_relocate;
+
+  if (s_out->insert_space(move_start_pos, delta)) {
+    mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender]   moved inside the kernel\n"));
+
+    s_out->restore_pos();
+
+    if (s_out->getFilePointer() >= data_start_pos)
+      s_out->setFilePointer(delta, seek_current);
+
+    adjust_cue_and_seekhead_positions(data_start_pos, delta);
+
+    return delta;
+  }
+
+  auto af_buffer = memory_c::alloc(block_size);
+  auto buffer    = af_buffer->get_buffer();
 
   // Extend the file's size. Setting the file pointer to beyond the
   // end and starting to write from there won't work with most of the
   // mm_io_c-derived classes.
   s_out->save_pos(s_out->get_size());
-  auto dummy_data = std::make_unique<std::string>(to_relocate, '\0');
+  auto dummy_data = std::make_unique<std::string>(delta, '\0');
   s_out->write(dummy_data->c_str(), dummy_data->length());
   s_out->restore_pos();
 
@@ -729,7 +936,7 @@ relocate_written_data(uint64_t data_start_pos,
   // existing data in case it overlaps which is likely.
   while (relocated < to_relocate) {
     auto to_copy = std::min(block_size, to_relocate - relocated);
-    auto src_pos = data_start_pos + to_relocate - relocated - to_copy;
+    auto src_pos = move_start_pos + to_relocate - relocated - to_copy;
     auto dst_pos = src_pos + delta;
 
     mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender]   relocating %1% bytes from %2% to %3%\n") % to_copy % src_pos % dst_pos);
@@ -752,24 +959,36 @@ relocate_written_data(uint64_t data_start_pos,
     s_out->setFilePointer(delta, seek_current);
 
   adjust_cue_and_seekhead_positions(data_start_pos, delta);
+
+  return delta;
 }
 
-static void
-render_void(int64_t new_size) {
+/** \brief Create an EbmlVoid element whose total size is exactly \c new_size
+
+   \c new_size must be at least 2.
+*/
+static std::unique_ptr<EbmlVoid>
+create_void(int64_t new_size) {
   auto actual_size = new_size;
+  auto void_elt    = std::make_unique<EbmlVoid>();
+
+  void_elt->SetSize(new_size);
+  void_elt->UpdateSize();
 
-  s_void_after_track_headers = std::make_unique<EbmlVoid>();
-  s_void_after_track_headers->SetSize(new_size);
-  s_void_after_track_headers->UpdateSize();
+  while (static_cast<int64_t>(void_elt->ElementSize()) > new_size)
+    void_elt->SetSize(--actual_size);
 
-  while (static_cast<int64_t>(s_void_after_track_headers->ElementSize()) > new_size)
-    s_void_after_track_headers->SetSize(--actual_size);
+  if (static_cast<int64_t>(void_elt->ElementSize()) < new_size)
+    void_elt->SetSizeLength(new_size - actual_size - 1);
 
-  if (static_cast<int64_t>(s_void_after_track_headers->ElementSize()) < new_size)
-    s_void_after_track_headers->SetSizeLength(new_size - actual_size - 1);
+  mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender] create_void new_size %1% actual_size %2% size_length %3%\n") % new_size % actual_size % (new_size - actual_size - 1));
 
-  mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender] render_void new_size %1% actual_size %2% size_length %3%\n") % new_size % actual_size % (new_size - actual_size - 1));
+  return void_elt;
+}
 
+static void
+render_void(int64_t new_size) {
+  s_void_after_track_headers = create_void(new_size);
   s_void_after_track_headers->Render(*s_out);
 }
 
@@ -805,20 +1024,23 @@ shrink_void_and_rerender_track_headers(int64_t new_void_size) {
 */
 void
 rerender_track_headers() {
-  g_kax_tracks->UpdateSize(false);
+  reader_threads_c::synchronize([]() {
+    if (!can_overwrite(g_kax_tracks->GetElementPosition())) {
+      warn_about_non_seekable_output();
+      return;
+    }
 
-  auto new_tracks_end_pos = g_kax_tracks->GetElementPosition() + g_kax_tracks->ElementSize();
-  auto data_start_pos     = s_void_after_track_headers->GetElementPosition() + s_void_after_track_headers->ElementSize(true);
-  auto data_size          = s_out->get_size() - data_start_pos;
+    g_kax_tracks->UpdateSize(false);
 
-  if (data_size && (new_tracks_end_pos >= (data_start_pos - 3))) {
-    auto delta      = 1024 + new_tracks_end_pos - data_start_pos;
-    data_start_pos += delta;
+    auto new_tracks_end_pos = g_kax_tracks->GetElementPosition() + g_kax_tracks->ElementSize();
+    auto data_start_pos     = s_void_after_track_headers->GetElementPosition() + s_void_after_track_headers->ElementSize(true);
+    auto data_size          = s_out->get_size() - data_start_pos;
 
-    relocate_written_data(data_start_pos - delta, delta);
-  }
+    if (data_size && (new_tracks_end_pos >= (data_start_pos - 3)))
+      data_start_pos += relocate_written_data(data_start_pos, 1024 + new_tracks_end_pos - data_start_pos);
 
-  shrink_void_and_rerender_track_headers(data_start_pos - new_tracks_end_pos);
+    shrink_void_and_rerender_track_headers(data_start_pos - new_tracks_end_pos);
+  });
 }
 
 /** \brief Render all attachments into the output file at the current position
@@ -1251,6 +1473,83 @@ render_chapter_void_placeholder() {
   s_kax_chapters_void->Render(*s_out);
 }
 
+/** \brief Reserve space for the cues in front of the clusters
+
+    Used with \c --cues-at-front. The cues' size is projected from the
+    total size of the source files assuming one cue point per 64 KB
+    for each video track. At 1 MBit/s that is one cue point every half
+    second. Files with lower bitrates or shorter key frame intervals
+    may need more. The cues are written at the end of the file if they
+    don't fit into the space after all.
+ */
+static void
+render_cues_void_placeholder() {
+  s_cues_void_size = 0;
+
+  if (!g_cues_at_front || !g_write_cues)
+    return;
+
+  // g_file_sizes only sums up the probe sizes, at most 32 MB per file.
+  auto output_size = int64_t{};
+  for (auto const &file : g_files)
+    output_size += std::max<int64_t>(file->size, 0);
+
+  auto size_limit  = g_cluster_helper->get_split_size_limit();
+  if (size_limit && (size_limit < output_size))
+    output_size = size_limit;
+
+  auto num_video_tracks = std::count_if(g_packetizers.begin(), g_packetizers.end(), [](packetizer_t const &ptzr) {
+    return ptzr.packetizer && (track_video == ptzr.packetizer->get_track_type());
+  });
+
+  auto num_points    = std::max<int64_t>(output_size / (64 * 1024), 1) * std::max<int64_t>(num_video_tracks, 1);
+  auto largest_point = cue_point_t{ 24ll * 3600 * 1000000000, 0, static_cast<uint64_t>(output_size), 0, static_cast<uint32_t>(g_packetizers.size()), 1 << 20 };
+
+  s_cues_void_size     = std::max<int64_t>(cues_c::get().project_element_size(num_points, largest_point), 4096);
+  s_cues_void_position = s_out->getFilePointer();
+
+  create_void(s_cues_void_size)->Render(*s_out);
+
+  mxdebug_if(s_debug_cues_at_front, boost::format("cues_at_front: reserved %1% bytes at %2% for %3% points; expected output size %4%\n") % s_cues_void_size % s_cues_void_position % num_points % output_size);
+}
+
+/** \brief Render the cues
+
+    With \c --cues-at-front they're written into the space reserved
+    in front of the clusters if they fit. The rest of that space is
+    filled with an EbmlVoid element. Otherwise they're written at the
+    current position.
+ */
+static void
+render_cues() {
+  auto &cues = cues_c::get();
+
+  if (s_cues_void_size) {
+    auto cues_size = static_cast<int64_t>(cues.calculate_element_size());
+    auto remaining = s_cues_void_size - cues_size;
+
+    mxdebug_if(s_debug_cues_at_front, boost::format("cues_at_front: %1% bytes needed, %2% reserved\n") % cues_size % s_cues_void_size);
+
+    if (cues_size && ((0 == remaining) || (2 <= remaining)) && can_overwrite(s_cues_void_position)) {
+      s_out->save_pos(s_cues_void_position);
+      cues.write(*s_out, *g_kax_sh_main);
+      if (remaining)
+        create_void(remaining)->Render(*s_out);
+      s_out->restore_pos();
+
+      s_cues_void_size = 0;
+      return;
+    }
+
+    if (cues_size && verbose)
+      mxinfo(boost::format(Y("The space reserved for the cues at the front of the file was too small (%1% bytes needed, %2% bytes reserved). They are written at the end instead.\n")) % cues_size % s_cues_void_size);
+
+    s_cues_void_size = 0;
+  }
+
+  cues.write(*s_out, *g_kax_sh_main);
+}
+
 /** \brief Prepare tag elements for rendering
 
     Adds missing mandatory elements to the tag structures and sorts
@@ -1277,6 +1576,14 @@ prepare_tags_for_rendering() {
   g_tags_size = s_kax_tags->ElementSize();
 }
 
+/** \brief Open a pipe or the standard output (\c -) for writing
+*/
+static mm_io_cptr
+open_stream_output(std::string const &file_name) {
+  auto out = "-" == file_name ? mm_io_cptr{ new mm_stdio_c } : mm_io_cptr{ new mm_file_io_c{file_name, MODE_CREATE} };
+  return std::make_shared<mm_stream_output_io_c>(out, file_name);
+}
+
 /** \brief Creates the next output file
 
    Creates a new file name depending on the split settings. Opens that
@@ -1293,7 +1600,9 @@ create_next_output_file() {
 
   // Open the output file.
   try {
-    s_out = !g_cluster_helper->discarding() ? mm_write_buffer_io_c::open(this_outfile, 20 * 1024 * 1024) : mm_io_cptr{ new mm_null_io_c{this_outfile} };
+    s_out = g_cluster_helper->discarding() ? mm_io_cptr{ new mm_null_io_c{this_outfile} }
+          : g_stream_output                ? open_stream_output(this_outfile)
+          :                                  mm_write_buffer_io_c::open(this_outfile, 20 * 1024 * 1024, g_write_behind_buffers);
   } catch (mtx::mm_io::exception &ex) {
     mxerror(boost::format(Y("The file '%1%' could not be opened for writing: %2%.\n")) % this_outfile % ex);
   }
@@ -1306,6 +1615,7 @@ create_next_output_file() {
   render_headers(s_out.get());
   render_attachments(s_out.get());
   render_chapter_void_placeholder();
+  render_cues_void_placeholder();
   add_tags_from_cue_chapters();
   prepare_tags_for_rendering();
 
@@ -1365,7 +1675,10 @@ render_chapters() {
   if (!s_kax_chapters_void)
     return;
 
-  if (s_chapters_in_this_file)
+  if (s_chapters_in_this_file && !can_overwrite(s_kax_chapters_void->GetElementPosition()))
+    s_chapters_in_this_file->Render(*s_out, true);
+
+  else if (s_chapters_in_this_file)
     s_kax_chapters_void->ReplaceWith(*s_chapters_in_this_file, *s_out, true, true);
 
   s_kax_chapters_void.reset();
@@ -1419,14 +1732,18 @@ finish_file(bool last_file,
   if (g_write_cues && g_cue_writing_requested) {
     if (do_output)
       mxinfo(Y("The cue entries (the index) are being written...\n"));
-    cues_c::get().write(*s_out, *g_kax_sh_main);
+    render_cues();
   }
 
   // Now re-render the s_kax_duration and fill in the biggest timecode
   // as the file's duration.
-  s_out->save_pos(s_kax_duration->GetElementPosition());
-  s_kax_duration->SetValue(calculate_file_duration());
-  s_kax_duration->Render(*s_out);
+  s_out->save_pos();
+
+  if (s_kax_duration) {
+    s_out->setFilePointer(s_kax_duration->GetElementPosition());
+    s_kax_duration->SetValue(calculate_file_duration());
+    s_kax_duration->Render(*s_out);
+  }
 
   // If splitting is active and this is the last part then handle the
   // 'next segment UID'. If it was given on the command line then set it here.
@@ -1452,7 +1769,7 @@ finish_file(bool last_file,
       }
   }
 
-  if (0 != changed) {
+  if ((0 != changed) && can_overwrite(s_kax_infos->GetElementPosition())) {
     s_out->setFilePointer(s_kax_infos->GetElementPosition());
     s_kax_infos->UpdateSize(true);
     info_size -= s_kax_infos->ElementSize();
@@ -1526,7 +1843,7 @@ finish_file(bool last_file,
     s_kax_as.reset();
   }
 
-  if ((g_kax_sh_main->ListSize() > 0) && !hack_engaged(ENGAGE_NO_META_SEEK)) {
+  if ((g_kax_sh_main->ListSize() > 0) && !hack_engaged(ENGAGE_NO_META_SEEK) && can_overwrite(s_kax_sh_void->GetElementPosition())) {
     g_kax_sh_main->UpdateSize();
     if (s_kax_sh_void->ReplaceWith(*g_kax_sh_main, *s_out, true) == INVALID_FILEPOS_T)
       mxwarn(boost::format(Y("This should REALLY not have happened. The space reserved for the first meta seek element was too small. Size needed: %1%. %2%\n"))
@@ -1535,7 +1852,9 @@ finish_file(bool last_file,
 
   // Set the correct size for the segment.
   int64_t final_file_size = s_out->getFilePointer();
-  if (g_kax_segment->ForceSize(final_file_size - g_kax_segment->GetElementPosition() - g_kax_segment->HeadSize()))
+  s_bytes_written_before += final_file_size;
+  if (   can_overwrite(g_kax_segment->GetElementPosition())
+      && g_kax_segment->ForceSize(final_file_size - g_kax_segment->GetElementPosition() - g_kax_segment->HeadSize()))
     g_kax_segment->OverwriteHead(*s_out);
 
   s_out.reset();
@@ -1699,6 +2018,8 @@ append_track(packetizer_t &ptzr,
   ptzr.file                            = amap.src_file_id;
   ptzr.status                          = FILE_STATUS_MOREDATA;
 
+  s_interleaver.request_pull(&ptzr - &g_packetizers[0]);
+
   // If we're dealing with a subtitle track or if the appending file contains
   // chapters then we have to do some magic. During splitting timecodes are
   // offset by a certain amount. This amount is NOT the duration of the
@@ -1829,23 +2150,37 @@ establish_deferred_connections(filelist_t &file) {
 
 static void
 pull_packetizers_for_packets() {
-  for (auto &ptzr : g_packetizers) {
+  auto reader_threads = reader_threads_c::get();
+
+  // Only packetizers without a packet that may still deliver one are
+  // visited. All others would not change their state anyway.
+  s_interleaver.pull([reader_threads](size_t idx) -> bool {
+    auto &ptzr = g_packetizers[idx];
+
     if (FILE_STATUS_HOLDING == ptzr.status)
       ptzr.status = FILE_STATUS_MOREDATA;
 
     ptzr.old_status = ptzr.status;
 
-    while (   !ptzr.pack
-           && (FILE_STATUS_MOREDATA == ptzr.status)
-           && !ptzr.packetizer->packet_available())
-      ptzr.status = ptzr.packetizer->read();
+    if (reader_threads) {
+      // The reader threads have already done the reading, forced the
+      // durations and retrieved the packets.
+      if (!ptzr.pack && (FILE_STATUS_MOREDATA == ptzr.status))
+        reader_threads->pull(ptzr);
 
-    if (   (FILE_STATUS_MOREDATA != ptzr.status)
-           && (FILE_STATUS_MOREDATA == ptzr.old_status))
-      ptzr.packetizer->force_duration_on_last_packet();
+    } else {
+      while (   !ptzr.pack
+             && (FILE_STATUS_MOREDATA == ptzr.status)
+             && !ptzr.packetizer->packet_available())
+        ptzr.status = ptzr.packetizer->read();
+
+      if (   (FILE_STATUS_MOREDATA != ptzr.status)
+             && (FILE_STATUS_MOREDATA == ptzr.old_status))
+        ptzr.packetizer->force_duration_on_last_packet();
 
-    if (!ptzr.pack)
-      ptzr.pack = ptzr.packetizer->get_packet();
+      if (!ptzr.pack)
+        ptzr.pack = ptzr.packetizer->get_packet();
+    }
 
     if (!ptzr.pack && (FILE_STATUS_DONE == ptzr.status))
       ptzr.status = FILE_STATUS_DONE_AND_DRY;
@@ -1866,25 +2201,22 @@ pull_packetizers_for_packets() {
       }
       file.old_num_unfinished_packetizers = file.num_unfinished_packetizers;
     }
-  }
+
+    if (ptzr.pack) {
+      s_interleaver.add_packet(idx, ptzr.pack->output_order_timecode);
+      return false;
+    }
+
+    return FILE_STATUS_DONE_AND_DRY != ptzr.status;
+  });
 }
 
 static packetizer_t *
 select_winning_packetizer() {
-  packetizer_t *winner = nullptr;
-
-  for (auto &ptzr : g_packetizers) {
-    if (!ptzr.pack)
-      continue;
-
-    if (!winner || !winner->pack)
-      winner = &ptzr;
-
-    else if (ptzr.pack && (ptzr.pack->output_order_timecode < winner->pack->output_order_timecode))
-      winner = &ptzr;
-  }
+  if (!s_interleaver.has_packet())
+    return nullptr;
 
-  return winner;
+  return &g_packetizers[s_interleaver.pop_winner()];
 }
 
 static void
@@ -1903,6 +2235,14 @@ discard_queued_packets() {
 */
 void
 main_loop() {
+  // Appending and splitting both modify the packetizers from the main
+  // thread. Only the plain case runs the readers on their own threads.
+  if (g_reader_threads && !s_appending_files && !g_cluster_helper->splitting())
+    reader_threads_c::create(g_reader_thread_queue_depth);
+
+  if (!g_progress_file.empty())
+    progress_reporter_c::create(g_progress_file, g_progress_interval);
+
   // Let's go!
   while (1) {
     // Step 1: Make sure a packet is available for each output
@@ -1923,7 +2263,11 @@ main_loop() {
       // rendered automatically.
       g_cluster_helper->add_packet(pack);
 
+      ++s_num_packets_written;
+      s_output_timestamp = pack->output_order_timecode;
+
       winner->pack.reset();
+      s_interleaver.request_pull(winner - &g_packetizers[0]);
 
       // If splitting by parts is active and the last part has been
       // processed fully then we can finish up.
@@ -1935,11 +2279,14 @@ main_loop() {
       // display some progress information
       if (1 <= verbose)
         display_progress();
+      report_progress();
 
     } else if (!appended_a_track) // exit if there are no more packets
       break;
   }
 
+  reader_threads_c::destroy();
+
   // Render all remaining packets (if there are any).
   if (g_cluster_helper && (0 < g_cluster_helper->get_packet_count()))
     g_cluster_helper->render();
@@ -1948,6 +2295,17 @@ main_loop() {
     display_progress(true);
 }
 
+/** \brief Write the final machine-readable progress report
+
+   Called once the last output file has been finished so that the
+   report contains the final number of bytes written.
+*/
+void
+report_final_progress() {
+  report_progress(true);
+  progress_reporter_c::destroy();
+}
+
 /** \brief Deletes the file readers and other associated objects
 */
 static void
@@ -1962,9 +2320,12 @@ destroy_readers() {
 */
 void
 cleanup() {
+  reader_threads_c::destroy();
+  progress_reporter_c::destroy();
   g_cluster_helper.reset();
 
   destroy_readers();
+  memory_budget_c::cleanup();
   g_attachments.clear();
 
   s_kax_tags.reset();
@@ -17,6 +17,7 @@
 
 #include "common/common_pch.h"
 
+#include <atomic>
 #include <deque>
 #include <unordered_map>
 
@@ -178,13 +179,23 @@ extern std::string g_default_language;
 extern float g_video_fps;
 extern generic_packetizer_c *g_video_packetizer;
 
-extern bool g_write_cues, g_cue_writing_requested;
+extern bool g_write_cues, g_cue_writing_requested, g_cues_at_front, g_stream_output;
 extern bool g_no_lacing, g_no_linking, g_use_durations, g_no_track_statistics_tags;
 
+extern bool g_reader_threads;
+extern size_t g_reader_thread_queue_depth;
+extern unsigned int g_write_behind_buffers;
+extern std::string g_progress_file;
+extern int64_t g_progress_interval;
+extern bool g_mmap_input;
+extern bool g_reserve_header_space;
+extern unsigned int g_num_header_relocations;
+extern uint64_t g_num_header_relocation_bytes;
+
 extern bool g_identifying, g_identify_verbose, g_identify_for_gui;
 
 extern int g_file_num;
-extern int64_t g_file_sizes;
+extern std::atomic<int64_t> g_file_sizes;
 
 extern int64_t g_max_ns_per_cluster;
 extern int g_max_blocks_per_cluster;
@@ -203,6 +214,7 @@ void check_append_mapping();
 
 void cleanup();
 void main_loop();
+void report_final_progress();
 
 void add_packetizer_globally(generic_packetizer_c *packetizer);
 void add_tags(KaxTag *tags);
@@ -0,0 +1,248 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   compact storage for cue points
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <queue>
+
+#include "merge/packed_cue_points.h"
+
+namespace {
+
+void
+put_varint(std::vector<unsigned char> &column,
+           uint64_t value) {
+  while (value >= 0x80) {
+    column.push_back(static_cast<unsigned char>(value | 0x80));
+    value >>= 7;
+  }
+
+  column.push_back(static_cast<unsigned char>(value));
+}
+
+uint64_t
+get_varint(std::vector<unsigned char> const &column,
+           size_t &offset) {
+  auto value = uint64_t{};
+  auto shift = 0u;
+
+  while (true) {
+    auto byte  = column[offset++];
+    value     |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    shift     += 7;
+
+    if (!(byte & 0x80))
+      return value;
+  }
+}
+
+// Differences between positions may be negative.
+uint64_t
+zigzag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t
+unzigzag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+bool
+is_less(cue_point_t const &a,
+        cue_point_t const &b) {
+  return (a.timecode < b.timecode) || ((a.timecode == b.timecode) && (a.track_num < b.track_num));
+}
+
+}
+
+class packed_cue_points_c::cursor_c {
+public:
+  run_t const *m_run;
+  size_t m_idx, m_remaining;
+  size_t m_timecode_ofs, m_cluster_position_ofs, m_codec_state_position_ofs, m_duration_ofs, m_track_num_ofs, m_relative_position_ofs;
+  cue_point_t m_point;
+
+public:
+  cursor_c(run_t const &run,
+           size_t idx)
+    : m_run{&run}
+    , m_idx{idx}
+    , m_remaining{run.m_num_points}
+    , m_timecode_ofs{}
+    , m_cluster_position_ofs{}
+    , m_codec_state_position_ofs{}
+    , m_duration_ofs{}
+    , m_track_num_ofs{}
+    , m_relative_position_ofs{}
+    , m_point{}
+  {
+  }
+
+  bool next() {
+    if (!m_remaining)
+      return false;
+
+    --m_remaining;
+
+    m_point.timecode             += get_varint(m_run->m_timecodes, m_timecode_ofs);
+    m_point.cluster_position     += unzigzag(get_varint(m_run->m_cluster_positions, m_cluster_position_ofs));
+    m_point.codec_state_position  = get_varint(m_run->m_codec_state_positions, m_codec_state_position_ofs);
+    m_point.duration              = get_varint(m_run->m_durations,             m_duration_ofs);
+    m_point.track_num             = get_varint(m_run->m_track_nums,            m_track_num_ofs);
+    m_point.relative_position     = get_varint(m_run->m_relative_positions,    m_relative_position_ofs);
+
+    return true;
+  }
+};
+
+packed_cue_points_c::packed_cue_points_c()
+  : m_num_points{}
+{
+}
+
+void
+packed_cue_points_c::add(std::vector<cue_point_t> &points) {
+  if (points.empty())
+    return;
+
+  std::stable_sort(points.begin(), points.end(), is_less);
+
+  m_runs.push_back(encode(points));
+  m_num_points += points.size();
+}
+
+packed_cue_points_c::run_t
+packed_cue_points_c::encode(std::vector<cue_point_t> const &points) {
+  auto run               = run_t{};
+  auto previous_timecode = uint64_t{};
+  auto previous_position = uint64_t{};
+
+  run.m_num_points = points.size();
+
+  for (auto const &point : points) {
+    put_varint(run.m_timecodes,             point.timecode - previous_timecode);
+    put_varint(run.m_cluster_positions,     zigzag(point.cluster_position - previous_position));
+    put_varint(run.m_codec_state_positions, point.codec_state_position);
+    put_varint(run.m_durations,             point.duration);
+    put_varint(run.m_track_nums,            point.track_num);
+    put_varint(run.m_relative_positions,    point.relative_position);
+
+    previous_timecode = point.timecode;
+    previous_position = point.cluster_position;
+  }
+
+  for (auto column : { &run.m_timecodes, &run.m_cluster_positions, &run.m_codec_state_positions, &run.m_durations, &run.m_track_nums, &run.m_relative_positions })
+    column->shrink_to_fit();
+
+  return run;
+}
+
+void
+packed_cue_points_c::clear() {
+  m_runs.clear();
+  m_num_points = 0;
+}
+
+size_t
+packed_cue_points_c::size()
+  const {
+  return m_num_points;
+}
+
+bool
+packed_cue_points_c::empty()
+  const {
+  return !m_num_points;
+}
+
+size_t
+packed_cue_points_c::get_memory_usage()
+  const {
+  auto usage = m_runs.capacity() * sizeof(run_t);
+
+  for (auto const &run : m_runs)
+    usage += run.m_timecodes.capacity() + run.m_cluster_positions.capacity() + run.m_codec_state_positions.capacity()
+           + run.m_durations.capacity() + run.m_track_nums.capacity()        + run.m_relative_positions.capacity();
+
+  return usage;
+}
+
+void
+packed_cue_points_c::for_each(std::function<void(cue_point_t const &)> const &worker)
+  const {
+  for (auto idx = 0u; idx < m_runs.size(); ++idx) {
+    cursor_c cursor{m_runs[idx], idx};
+    while (cursor.next())
+      worker(cursor.m_point);
+  }
+}
+
+/** \brief Call \c worker for all points sorted by timecode and track number
+
+   Points comparing equal are delivered in the order they were added.
+*/
+void
+packed_cue_points_c::for_each_sorted(std::function<void(cue_point_t const &)> const &worker)
+  const {
+  auto comparator = [](cursor_c const *a, cursor_c const *b) -> bool {
+    if (is_less(b->m_point, a->m_point))
+      return true;
+    if (is_less(a->m_point, b->m_point))
+      return false;
+    return a->m_idx > b->m_idx;
+  };
+
+  auto cursors = std::vector<cursor_c>{};
+  cursors.reserve(m_runs.size());
+
+  std::priority_queue<cursor_c *, std::vector<cursor_c *>, decltype(comparator)> queue{comparator};
+
+  for (auto idx = 0u; idx < m_runs.size(); ++idx) {
+    cursors.emplace_back(m_runs[idx], idx);
+    if (cursors.back().next())
+      queue.push(&cursors.back());
+  }
+
+  while (!queue.empty()) {
+    auto cursor = queue.top();
+    queue.pop();
+
+    worker(cursor->m_point);
+
+    if (cursor->next())
+      queue.push(cursor);
+  }
+}
+
+void
+packed_cue_points_c::adjust_positions(uint64_t old_position,
+                                      uint64_t delta) {
+  // Rare enough that re-encoding each run is fine.
+  for (auto &run : m_runs) {
+    auto points = std::vector<cue_point_t>{};
+    points.reserve(run.m_num_points);
+
+    cursor_c cursor{run, 0};
+    while (cursor.next())
+      points.push_back(cursor.m_point);
+
+    for (auto &point : points) {
+      if (point.cluster_position >= old_position)
+        point.cluster_position += delta;
+      if (point.codec_state_position && (point.codec_state_position >= old_position))
+        point.codec_state_position += delta;
+    }
+
+    run = encode(points);
+  }
+}
@@ -0,0 +1,64 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   compact storage for cue points
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_PACKED_CUE_POINTS_H
+#define MTX_MERGE_PACKED_CUE_POINTS_H
+
+#include "common/common_pch.h"
+
+struct cue_point_t {
+  uint64_t timecode, duration, cluster_position, codec_state_position;
+  uint32_t track_num, relative_position;
+};
+
+/* Stores cue points in runs sorted by timecode and track number. Each
+   field of a run is kept in its own column of variable-length
+   integers. Timecodes and cluster positions are stored as differences
+   to the previous point's values, which usually take one to four bytes
+   instead of eight. Iterating in sorted order merges the runs on the
+   fly without expanding them. */
+class packed_cue_points_c {
+protected:
+  struct run_t {
+    std::vector<unsigned char> m_timecodes, m_cluster_positions, m_codec_state_positions, m_durations, m_track_nums, m_relative_positions;
+    size_t m_num_points;
+  };
+
+  class cursor_c;
+
+  std::vector<run_t> m_runs;
+  size_t m_num_points;
+
+public:
+  packed_cue_points_c();
+
+  // Sorts the points and appends them as a new run.
+  void add(std::vector<cue_point_t> &points);
+  void clear();
+
+  size_t size() const;
+  bool empty() const;
+  size_t get_memory_usage() const;
+
+  void for_each(std::function<void(cue_point_t const &)> const &worker) const;
+  void for_each_sorted(std::function<void(cue_point_t const &)> const &worker) const;
+
+  // Adds 'delta' to all cluster and codec state positions at or after
+  // 'old_position'.
+  void adjust_positions(uint64_t old_position, uint64_t delta);
+
+protected:
+  static run_t encode(std::vector<cue_point_t> const &points);
+};
+
+#endif  // MTX_MERGE_PACKED_CUE_POINTS_H
@@ -16,6 +16,9 @@
 
 #include "common/common_pch.h"
 
+#include <future>
+
+#include "common/memory_pool.h"
 #include "common/timestamp.h"
 
 namespace libmatroska {
@@ -65,6 +68,26 @@ struct packet_t {
 
   std::vector<packet_extension_cptr> extensions;
 
+  // Set while 'data' has been moved to the spill file because the
+  // memory limit was exceeded (see memory_budget_c).
+  int64_t spill_position, spill_size;
+
+  // Set while 'data' and 'data_adds' are being compressed on the
+  // compressor's thread pool. Delivers the compressed 'data' followed
+  // by the compressed 'data_adds'.
+  std::future<std::vector<memory_cptr>> pending_compression;
+
+  // Packets are created and destroyed for each frame. Their memory is
+  // recycled instead of going through malloc() and free() each time.
+  static void *operator new(size_t size) {
+    return mtx::mem::object_pool_c<packet_t>::allocate(size);
+  }
+
+  static void operator delete(void *p,
+                              size_t size) {
+    mtx::mem::object_pool_c<packet_t>::deallocate(p, size);
+  }
+
   packet_t()
     : group{}
     , block{}
@@ -85,6 +108,8 @@ struct packet_t {
     , gap_following{}
     , factory_applied{}
     , source{}
+    , spill_position(-1)
+    , spill_size{}
   {
   }
 
@@ -113,6 +138,8 @@ struct packet_t {
     , gap_following{}
     , factory_applied{}
     , source{}
+    , spill_position(-1)
+    , spill_size{}
   {
   }
 
@@ -141,6 +168,8 @@ struct packet_t {
     , gap_following{}
     , factory_applied{}
     , source{}
+    , spill_position(-1)
+    , spill_size{}
   {
   }
 
@@ -177,6 +206,12 @@ struct packet_t {
     return discard_padding.valid();
   }
 
+  bool
+  is_spilled()
+    const {
+    return 0 <= spill_position;
+  }
+
   int64_t
   get_duration()
     const {
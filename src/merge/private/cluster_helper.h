@@ -15,6 +15,7 @@
 #ifndef MTX_MERGE_PRIVATE_CLUSTER_HELPER_H
 #define MTX_MERGE_PRIVATE_CLUSTER_HELPER_H
 
+#include "merge/cluster_serializer.h"
 #include "merge/track_statistics.h"
 
 class render_groups_c {
@@ -22,10 +23,12 @@ public:
   std::vector<kax_block_blob_cptr> m_groups;
   std::vector<int64_t> m_durations;
   generic_packetizer_c *m_source;
+  int m_direct_block_idx;
   bool m_more_data, m_duration_mandatory;
 
   render_groups_c(generic_packetizer_c *source)
     : m_source(source)
+    , m_direct_block_idx(-1)
     , m_more_data(false)
     , m_duration_mandatory(false)
   {
@@ -47,6 +50,8 @@ public:
   bool first_video_keyframe_seen;
   mm_io_c *out;
 
+  cluster_serializer_c cluster_serializer;
+
   std::vector<split_point_c> split_points;
   std::vector<split_point_c>::iterator current_split_point;
 
@@ -0,0 +1,235 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   machine-readable progress reports
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#if !defined(SYS_WINDOWS)
+# include <signal.h>
+# include <unistd.h>
+#endif
+
+#include "common/mm_io_x.h"
+#include "common/strings/formatting.h"
+#include "common/strings/parsing.h"
+#include "merge/progress_reporter.h"
+
+#if !defined(SYS_WINDOWS)
+namespace {
+
+/* Writes to a file descriptor inherited from the parent process. It
+   may refer to something that can only be written to, e.g. a pipe or
+   a socket, and can therefore not be re-opened via /dev/fd. A
+   duplicate is used so that closing the output leaves the original
+   descriptor alone. */
+class fd_output_io_c: public mm_io_c {
+protected:
+  std::string m_name;
+  FILE *m_file;
+
+public:
+  fd_output_io_c(int fd)
+    : m_name{(boost::format("fd:%1%") % fd).str()}
+    , m_file{}
+  {
+    auto copy = dup(fd);
+    if (-1 == copy)
+      throw mtx::mm_io::open_x{mtx::mm_io::make_error_code()};
+
+    m_file = fdopen(copy, "wb");
+    if (!m_file) {
+      auto error_code = mtx::mm_io::make_error_code();
+      ::close(copy);
+      throw mtx::mm_io::open_x{error_code};
+    }
+  }
+
+  virtual ~fd_output_io_c() {
+    close();
+  }
+
+  virtual uint64 getFilePointer() {
+    return m_current_position;
+  }
+
+  virtual void setFilePointer(int64, seek_mode) {
+    throw mtx::mm_io::seek_x{};
+  }
+
+  virtual void close() {
+    if (m_file)
+      fclose(m_file);
+    m_file = nullptr;
+  }
+
+  virtual bool eof() {
+    return false;
+  }
+
+  virtual std::string get_file_name() const {
+    return m_name;
+  }
+
+  virtual void flush() {
+    if (m_file && fflush(m_file))
+      throw mtx::mm_io::read_write_x{mtx::mm_io::make_error_code()};
+  }
+
+protected:
+  virtual uint32 _read(void *, size_t) {
+    throw mtx::mm_io::wrong_read_write_access_x{};
+  }
+
+  virtual size_t _write(const void *buffer, size_t size) {
+    auto num_written = fwrite(buffer, 1, size, m_file);
+    if (num_written != size)
+      throw mtx::mm_io::read_write_x{mtx::mm_io::make_error_code()};
+
+    m_current_position += num_written;
+
+    return num_written;
+  }
+};
+
+}
+#endif
+
+std::unique_ptr<progress_reporter_c> progress_reporter_c::s_progress_reporter;
+
+progress_reporter_c::progress_reporter_c(mm_io_cptr const &out,
+                                         int64_t interval)
+  : m_out{out}
+  , m_interval{interval}
+  , m_start_time{-1}
+  , m_first{true}
+{
+}
+
+bool
+progress_reporter_c::is_due(int64_t time)
+  const {
+  return m_first || ((time - m_previous.time) >= m_interval);
+}
+
+void
+progress_reporter_c::report(progress_status_t const &status,
+                            bool done) {
+  if (m_first)
+    m_start_time = status.time;
+
+  auto line = format(status, m_first ? status : m_previous, m_start_time, done);
+
+  try {
+    m_out->write(line);
+    m_out->flush();
+
+  } catch (mtx::mm_io::exception &) {
+    // A consumer that has gone away must not abort muxing.
+  }
+
+  m_previous = status;
+  m_first    = false;
+}
+
+/** \brief Format one report as a single line of JSON
+
+   Rates are per second and relative to \c previous. The amounts of
+   data are given in bytes, the rates in MB (10^6 bytes) per
+   second. The estimated time remaining is based on the progress
+   percentage and the time elapsed since \c start_time. Both are \c null
+   if the percentage is unknown.
+*/
+std::string
+progress_reporter_c::format(progress_status_t const &status,
+                            progress_status_t const &previous,
+                            int64_t start_time,
+                            bool done) {
+  auto elapsed  = std::max<int64_t>(status.time - start_time,    0);
+  auto duration = std::max<int64_t>(status.time - previous.time, 0);
+  auto rate     = [duration](int64_t current, int64_t before) -> double {
+    return duration ? (current - before) * 1000.0 / duration : 0.0;
+  };
+
+  auto eta = done                                                  ? std::string{"0"}
+           : (0 < status.percentage) && (100 > status.percentage) ? (boost::format("%|1$.1f|") % (elapsed * (100 - status.percentage) / status.percentage / 1000.0)).str()
+           :                                                        std::string{"null"};
+
+  auto tracks = std::vector<std::string>{};
+  for (auto const &track : status.tracks)
+    tracks.push_back((boost::format("{\"file\":%1%,\"track\":%2%,\"queued_bytes\":%3%}") % track.file_id % track.track_id % track.queued_bytes).str());
+
+  auto timestamp_valid = status.output_timestamp.valid();
+
+  return (boost::format("{\"elapsed\":%|1$.3f|,\"progress\":%2%,\"bytes_read\":%3%,\"bytes_written\":%4%,"
+                        "\"read_mb_per_second\":%|5$.3f|,\"write_mb_per_second\":%|6$.3f|,\"packets\":%7%,\"packets_per_second\":%|8$.1f|,"
+                        "\"output_timestamp\":%9%,\"output_timestamp_ns\":%10%,\"eta\":%11%,\"tracks\":[%12%],\"done\":%13%}\n")
+          % (elapsed / 1000.0)
+          % (0 > status.percentage ? std::string{"null"} : to_string(status.percentage))
+          % status.bytes_read
+          % status.bytes_written
+          % (rate(status.bytes_read,    previous.bytes_read)    / 1000000.0)
+          % (rate(status.bytes_written, previous.bytes_written) / 1000000.0)
+          % status.num_packets
+          % rate(status.num_packets, previous.num_packets)
+          % (timestamp_valid ? format_json_string(format_timestamp(status.output_timestamp)) : std::string{"null"})
+          % (timestamp_valid ? to_string(status.output_timestamp.to_ns())                    : std::string{"null"})
+          % eta
+          % join(",", tracks)
+          % (done ? "true" : "false")).str();
+}
+
+/** \brief Open the target for the progress reports
+
+   \c target is either a file name or \c fd:n for writing to the file
+   descriptor n inherited from the parent process.
+*/
+void
+progress_reporter_c::create(std::string const &target,
+                            int64_t interval) {
+  mm_io_cptr out;
+
+  try {
+    if (balg::starts_with(target, "fd:")) {
+      auto fd = 0;
+      if (!parse_number(target.substr(3), fd) || (0 > fd))
+        mxerror(boost::format(Y("Invalid file descriptor in '--progress-file %1%'.\n")) % target);
+
+#if defined(SYS_WINDOWS)
+      mxerror(Y("Writing the progress to a file descriptor is not supported on Windows.\n"));
+#else
+      out = std::make_shared<fd_output_io_c>(fd);
+
+      // Writing to a pipe or socket whose reader has gone away would
+      // otherwise terminate the program. Such writes fail with EPIPE
+      // instead.
+      signal(SIGPIPE, SIG_IGN);
+#endif
+
+    } else
+      out = std::make_shared<mm_file_io_c>(target, MODE_CREATE);
+
+  } catch (mtx::mm_io::exception &ex) {
+    mxerror(boost::format(Y("The file '%1%' could not be opened for writing: %2%.\n")) % target % ex);
+  }
+
+  s_progress_reporter = std::make_unique<progress_reporter_c>(out, interval);
+}
+
+void
+progress_reporter_c::destroy() {
+  s_progress_reporter.reset();
+}
+
+progress_reporter_c *
+progress_reporter_c::get() {
+  return s_progress_reporter.get();
+}
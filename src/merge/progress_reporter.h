@@ -0,0 +1,74 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definition for the machine-readable progress reports
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_PROGRESS_REPORTER_H
+#define MTX_MERGE_PROGRESS_REPORTER_H
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+#include "common/timestamp.h"
+
+/** \brief The state of the muxing process at one point in time
+
+   Collected by the main loop for each report.
+*/
+struct progress_status_t {
+  struct track_t {
+    int64_t file_id, track_id, queued_bytes;
+  };
+
+  int64_t time;
+  int percentage;
+  int64_t bytes_read, bytes_written, num_packets;
+  timestamp_c output_timestamp;
+  std::vector<track_t> tracks;
+
+  progress_status_t()
+    : time{}
+    , percentage{}
+    , bytes_read{}
+    , bytes_written{}
+    , num_packets{}
+  {
+  }
+};
+
+/* Writes the progress in JSON lines format: one JSON object per line
+   and report. The rates and the estimated time remaining are
+   calculated from the difference to the previous report. Reports are
+   written at most once per interval except for the final one. */
+class progress_reporter_c {
+protected:
+  mm_io_cptr m_out;
+  int64_t m_interval, m_start_time;
+  progress_status_t m_previous;
+  bool m_first;
+
+  static std::unique_ptr<progress_reporter_c> s_progress_reporter;
+
+public:
+  progress_reporter_c(mm_io_cptr const &out, int64_t interval);
+
+  bool is_due(int64_t time) const;
+  void report(progress_status_t const &status, bool done = false);
+
+  static std::string format(progress_status_t const &status, progress_status_t const &previous, int64_t start_time, bool done);
+
+public:
+  static void create(std::string const &target, int64_t interval);
+  static void destroy();
+  static progress_reporter_c *get();
+};
+
+#endif  // MTX_MERGE_PROGRESS_REPORTER_H
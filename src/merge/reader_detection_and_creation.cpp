@@ -12,7 +12,11 @@
 
 #include "common/common_pch.h"
 
+#include "common/mm_follow_io.h"
+#include "common/mm_mmap_io.h"
+#include "common/mm_pipe_input_io.h"
 #include "common/mm_mpls_multi_file_io.h"
+#include "common/mm_probe_buffer_io.h"
 #include "common/mm_read_buffer_io.h"
 #include "common/strings/formatting.h"
 #include "common/xml/xml.h"
@@ -54,6 +58,7 @@
 #include "input/r_wavpack.h"
 #include "merge/filelist.h"
 #include "merge/input_x.h"
+#include "merge/output_control.h"
 #include "merge/reader_detection_and_creation.h"
 
 static std::vector<bfs::path>
@@ -68,8 +73,26 @@ file_names_to_paths(const std::vector<std::string> &file_names) {
 static mm_io_cptr
 open_input_file(filelist_t &file) {
   try {
-    if (file.all_names.size() == 1)
+    if (mm_pipe_input_io_c::is_pipe(file.name))
+      return std::make_shared<mm_pipe_input_io_c>("-" == file.name ? static_cast<mm_io_c *>(new mm_stdio_c) : new mm_file_io_c(file.name), file.name);
+
+    if (file.ti->m_follow_timeout) {
+      auto io = std::make_shared<mm_read_buffer_io_c>(new mm_follow_io_c(new mm_file_io_c(file.name), file.ti->m_follow_timeout), 1 << 17);
+      io->set_growing(true);
+      return io;
+    }
+
+    if (file.all_names.size() == 1) {
+      // Fall back to regular reading for files that cannot be mapped,
+      // e.g. empty files.
+      if (g_mmap_input)
+        try {
+          return mm_mmap_io_c::open(file.name);
+        } catch (mtx::mm_io::exception &) {
+        }
+
       return mm_io_cptr(new mm_read_buffer_io_c(new mm_file_io_c(file.name), 1 << 17));
+    }
 
     else {
       std::vector<bfs::path> paths = file_names_to_paths(file.all_names);
@@ -100,10 +123,11 @@ open_playlist_file(filelist_t &file,
 }
 
 static file_type_e
-detect_text_file_formats(filelist_t const &file) {
+detect_text_file_formats(filelist_t const &file,
+                         mm_io_c &in) {
   auto text_io = mm_text_io_cptr{};
   try {
-    text_io        = std::make_shared<mm_text_io_c>(new mm_file_io_c(file.name));
+    text_io        = std::make_shared<mm_text_io_c>(&in, false);
     auto text_size = text_io->get_size();
 
     if (srt_reader_c::probe_file(text_io.get(), text_size))
@@ -133,10 +157,19 @@ detect_text_file_formats(filelist_t const &file) {
 
    Opens the input file and calls the \c probe_file function for each known
    file reader class. Uses \c mm_text_io_c for subtitle probing.
+
+   Unless the file is memory-mapped all probes read from a buffer
+   holding the head of the file. It is filled once and only extended
+   if a probe needs more data. Pipes keep their head in memory
+   themselves.
 */
 static std::pair<file_type_e, int64_t>
 get_file_type_internal(filelist_t &file) {
   mm_io_cptr af_io = open_input_file(file);
+  auto pipe_io     = dynamic_cast<mm_pipe_input_io_c *>(af_io.get());
+  if (!dynamic_cast<mm_mmap_io_c *>(af_io.get()) && !pipe_io)
+    af_io = std::make_shared<mm_probe_buffer_io_c>(af_io);
+
   mm_io_c *io      = af_io.get();
   int64_t size     = std::min(io->get_size(), static_cast<int64_t>(1 << 25));
 
@@ -190,7 +223,7 @@ get_file_type_internal(filelist_t &file) {
 
   // All text file types (subtitles).
   else
-    type = detect_text_file_formats(file);
+    type = detect_text_file_formats(file, *af_io);
 
   if (FILE_TYPE_IS_UNKNOWN != type)
     ;                           // intentional fall-through
@@ -261,6 +294,17 @@ get_file_type_internal(filelist_t &file) {
         type = FILE_TYPE_AAC;
   }
 
+  // When identifying, the reader is created right away and can read
+  // its headers from the same buffer. Otherwise the buffer would be
+  // kept for all files until the readers are created.
+  // Pipes cannot be opened a second time. Their reader must always
+  // continue with the same input.
+  auto probe_io = dynamic_cast<mm_probe_buffer_io_c *>(af_io.get());
+  if (pipe_io || (probe_io && g_identifying && !is_playlist))
+    file.probe_in = af_io;
+  else if (probe_io)
+    probe_io->drop_buffer();
+
   return std::make_pair(type, size);
 }
 
@@ -274,143 +318,170 @@ get_file_type(filelist_t &file) {
   file.type     = result.first;
 }
 
-/** \brief Creates the file readers
+/** \brief Creates the file reader for a single file
 
-   For each file the appropriate file reader class is instantiated.
-   The newly created class must read all track information in its
-   constructor and throw an exception in case of an error. Otherwise
-   it is assumed that the file can be handled.
+   The appropriate file reader class is instantiated. The newly
+   created class must read all track information in its constructor
+   and throw an exception in case of an error. Otherwise it is assumed
+   that the file can be handled.
 */
 void
-create_readers() {
+create_reader(filelist_t &file) {
   static auto s_debug_timecode_restrictions = debugging_option_c{"timecode_restrictions"};
 
-  for (auto &file : g_files) {
-    try {
-      mm_io_cptr input_file = file->playlist_mpls_in ? std::static_pointer_cast<mm_io_c>(file->playlist_mpls_in) : open_input_file(*file);
-
-      switch (file->type) {
-        case FILE_TYPE_AAC:
-          file->reader.reset(new aac_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_AC3:
-          file->reader.reset(new ac3_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_AVC_ES:
-          file->reader.reset(new avc_es_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_HEVC_ES:
-          file->reader.reset(new hevc_es_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_AVI:
-          file->reader.reset(new avi_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_COREAUDIO:
-          file->reader.reset(new coreaudio_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_DIRAC:
-          file->reader.reset(new dirac_es_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_DTS:
-          file->reader.reset(new dts_reader_c(*file->ti, input_file));
-          break;
+  try {
+    mm_io_cptr input_file = file.playlist_mpls_in ? std::static_pointer_cast<mm_io_c>(file.playlist_mpls_in)
+                          : file.probe_in         ? file.probe_in
+                          :                         open_input_file(file);
+
+    if (file.probe_in) {
+      file.probe_in.reset();
+      input_file->setFilePointer(0);
+    }
+
+    switch (file.type) {
+      case FILE_TYPE_AAC:
+        file.reader.reset(new aac_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_AC3:
+        file.reader.reset(new ac3_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_AVC_ES:
+        file.reader.reset(new avc_es_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_HEVC_ES:
+        file.reader.reset(new hevc_es_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_AVI:
+        file.reader.reset(new avi_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_COREAUDIO:
+        file.reader.reset(new coreaudio_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_DIRAC:
+        file.reader.reset(new dirac_es_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_DTS:
+        file.reader.reset(new dts_reader_c(*file.ti, input_file));
+        break;
 #if defined(HAVE_FLAC_FORMAT_H)
-        case FILE_TYPE_FLAC:
-          file->reader.reset(new flac_reader_c(*file->ti, input_file));
-          break;
+      case FILE_TYPE_FLAC:
+        file.reader.reset(new flac_reader_c(*file.ti, input_file));
+        break;
 #endif
-        case FILE_TYPE_FLV:
-          file->reader.reset(new flv_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_IVF:
-          file->reader.reset(new ivf_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_MATROSKA:
-          file->reader.reset(new kax_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_MP3:
-          file->reader.reset(new mp3_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_MPEG_ES:
-          file->reader.reset(new mpeg_es_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_MPEG_PS:
-          file->reader.reset(new mpeg_ps_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_MPEG_TS:
-          file->reader.reset(new mpeg_ts_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_OGM:
-          file->reader.reset(new ogm_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_PGSSUP:
-          file->reader.reset(new pgssup_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_QTMP4:
-          file->reader.reset(new qtmp4_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_REAL:
-          file->reader.reset(new real_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_SSA:
-          file->reader.reset(new ssa_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_SRT:
-          file->reader.reset(new srt_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_TRUEHD:
-          file->reader.reset(new truehd_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_TTA:
-          file->reader.reset(new tta_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_USF:
-          file->reader.reset(new usf_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_VC1:
-          file->reader.reset(new vc1_es_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_VOBBTN:
-          file->reader.reset(new vobbtn_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_VOBSUB:
-          file->reader.reset(new vobsub_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_WAV:
-          file->reader.reset(new wav_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_WAVPACK4:
-          file->reader.reset(new wavpack_reader_c(*file->ti, input_file));
-          break;
-        default:
-          mxerror(boost::format(Y("EVIL internal bug! (unknown file type). %1%\n")) % BUGMSG);
-          break;
-      }
-
-      file->reader->read_headers();
-      file->reader->set_timecode_restrictions(file->restricted_timecode_min, file->restricted_timecode_max);
-
-      // Re-calculate file size because the reader might switch to a
-      // multi I/O reader in read_headers().
-      file->size = file->reader->get_file_size();
-
-      mxdebug_if(s_debug_timecode_restrictions,
-                 boost::format("Timecode restrictions for %3%: min %1% max %2%\n") % file->restricted_timecode_min % file->restricted_timecode_max % file->ti->m_fname);
-
-    } catch (mtx::mm_io::open_x &error) {
-      mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file->ti->m_fname % Y("The file could not be opened for reading, or there was not enough data to parse its headers."));
-
-    } catch (mtx::input::open_x &error) {
-      mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file->ti->m_fname % Y("The file could not be opened for reading, or there was not enough data to parse its headers."));
-
-    } catch (mtx::input::invalid_format_x &error) {
-      mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file->ti->m_fname % Y("The file content does not match its format type and was not recognized."));
-
-    } catch (mtx::input::header_parsing_x &error) {
-      mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file->ti->m_fname % Y("The file headers could not be parsed, e.g. because they're incomplete, invalid or damaged."));
-
-    } catch (mtx::input::exception &error) {
-      mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file->ti->m_fname % error.error());
+      case FILE_TYPE_FLV:
+        file.reader.reset(new flv_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_IVF:
+        file.reader.reset(new ivf_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_MATROSKA:
+        file.reader.reset(new kax_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_MP3:
+        file.reader.reset(new mp3_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_MPEG_ES:
+        file.reader.reset(new mpeg_es_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_MPEG_PS:
+        file.reader.reset(new mpeg_ps_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_MPEG_TS:
+        file.reader.reset(new mpeg_ts_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_OGM:
+        file.reader.reset(new ogm_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_PGSSUP:
+        file.reader.reset(new pgssup_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_QTMP4:
+        file.reader.reset(new qtmp4_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_REAL:
+        file.reader.reset(new real_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_SSA:
+        file.reader.reset(new ssa_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_SRT:
+        file.reader.reset(new srt_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_TRUEHD:
+        file.reader.reset(new truehd_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_TTA:
+        file.reader.reset(new tta_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_USF:
+        file.reader.reset(new usf_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_VC1:
+        file.reader.reset(new vc1_es_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_VOBBTN:
+        file.reader.reset(new vobbtn_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_VOBSUB:
+        file.reader.reset(new vobsub_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_WAV:
+        file.reader.reset(new wav_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_WAVPACK4:
+        file.reader.reset(new wavpack_reader_c(*file.ti, input_file));
+        break;
+      default:
+        mxerror(boost::format(Y("EVIL internal bug! (unknown file type). %1%\n")) % BUGMSG);
+        break;
     }
+
+    file.reader->read_headers();
+
+    if (auto probe_io = dynamic_cast<mm_probe_buffer_io_c *>(input_file.get()))
+      probe_io->drop_buffer();
+
+    // Only wait for more data once the headers have been read. Pipes
+    // don't have to keep the headers in memory anymore.
+    for (auto io = input_file.get(); io; io = dynamic_cast<mm_proxy_io_c *>(io) ? static_cast<mm_proxy_io_c *>(io)->get_proxied() : nullptr)
+      if (auto follow_io = dynamic_cast<mm_follow_io_c *>(io))
+        follow_io->enable_following();
+      else if (auto pipe_io = dynamic_cast<mm_pipe_input_io_c *>(io))
+        pipe_io->release_head();
+
+    file.reader->set_timecode_restrictions(file.restricted_timecode_min, file.restricted_timecode_max);
+
+    // Re-calculate file size because the reader might switch to a
+    // multi I/O reader in read_headers().
+    file.size = file.reader->get_file_size();
+
+    mxdebug_if(s_debug_timecode_restrictions,
+               boost::format("Timecode restrictions for %3%: min %1% max %2%\n") % file.restricted_timecode_min % file.restricted_timecode_max % file.ti->m_fname);
+
+  } catch (mtx::mm_io::open_x &error) {
+    mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file.ti->m_fname % Y("The file could not be opened for reading, or there was not enough data to parse its headers."));
+
+  } catch (mtx::input::open_x &error) {
+    mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file.ti->m_fname % Y("The file could not be opened for reading, or there was not enough data to parse its headers."));
+
+  } catch (mtx::input::invalid_format_x &error) {
+    mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file.ti->m_fname % Y("The file content does not match its format type and was not recognized."));
+
+  } catch (mtx::input::header_parsing_x &error) {
+    mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file.ti->m_fname % Y("The file headers could not be parsed, e.g. because they're incomplete, invalid or damaged."));
+
+  } catch (mtx::input::exception &error) {
+    mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file.ti->m_fname % error.error());
   }
 }
+
+/** \brief Creates the file readers
+
+   For each file the appropriate file reader class is instantiated.
+*/
+void
+create_readers() {
+  for (auto &file : g_files)
+    create_reader(*file);
+}
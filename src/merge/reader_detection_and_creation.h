@@ -20,6 +20,7 @@
 struct filelist_t;
 
 void get_file_type(filelist_t &file);
+void create_reader(filelist_t &file);
 void create_readers();
 
 #endif // MTX_MERGE_READER_DETECTION_AND_TYPE_H
@@ -0,0 +1,471 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   the threaded demuxing mode
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "merge/filelist.h"
+#include "merge/generic_packetizer.h"
+#include "merge/generic_reader.h"
+#include "merge/memory_budget.h"
+#include "merge/output_control.h"
+#include "merge/packet.h"
+#include "merge/reader_thread.h"
+
+namespace {
+
+// Thrown out of synchronize() in order to unwind a reader thread that
+// is shut down while it is waiting for the main thread.
+struct reader_thread_stopped_x {
+};
+
+// Thrown by mxerror() on a reader thread. Exiting right away from a
+// thread other than the main thread would destroy global state the
+// other threads are still using. The main thread reports the error
+// instead once it needs a packet from that reader.
+struct reader_thread_error_x {
+  std::string m_error;
+};
+
+thread_local reader_thread_c *tl_current_thread = nullptr;
+thread_local bool tl_synchronized               = false;
+
+}
+
+std::unique_ptr<reader_threads_c> reader_threads_c::s_reader_threads;
+
+reader_thread_c::reader_thread_c(reader_threads_c &owner,
+                                 filelist_t &file)
+  : m_owner(owner)
+  , m_file(file)
+  , m_busy{}
+  , m_progress{}
+  , m_position{}
+{
+  for (auto &ptzr : g_packetizers)
+    if (ptzr.file == static_cast<int64_t>(file.id))
+      m_slots.push_back(slot_t{ ptzr.packetizer, {}, FILE_STATUS_MOREDATA, false, false });
+}
+
+reader_thread_c::slot_t &
+reader_thread_c::find_slot(generic_packetizer_c *packetizer) {
+  for (auto &slot : m_slots)
+    if (slot.packetizer == packetizer)
+      return slot;
+
+  assert(false);
+  return m_slots.front();
+}
+
+int
+reader_thread_c::find_slot_to_pull()
+  const {
+  auto winner = -1;
+
+  // Only the reader the main thread is waiting for may read more once
+  // the memory limit has been exceeded. All others are ahead of it.
+  if (memory_budget_c::is_exceeded() && (m_owner.m_waiting_for != this))
+    return winner;
+
+  // A packetizer that is being held back isn't asked again before the
+  // main thread has taken its status off the queue. Reading again
+  // right away would only queue the same status over and over.
+  for (int idx = 0, num_slots = m_slots.size(); idx < num_slots; ++idx) {
+    auto &slot = m_slots[idx];
+
+    if (slot.finished || slot.holding || (slot.queue.size() >= m_owner.m_queue_depth))
+      continue;
+
+    if ((-1 == winner) || (slot.queue.size() < m_slots[winner].queue.size()))
+      winner = idx;
+  }
+
+  return winner;
+}
+
+void
+reader_thread_c::pull(size_t slot_idx) {
+  auto &slot = m_slots[slot_idx];
+
+  if (FILE_STATUS_HOLDING == slot.status)
+    slot.status = FILE_STATUS_MOREDATA;
+
+  auto old_status = slot.status;
+
+  while (   (FILE_STATUS_MOREDATA == slot.status)
+         && !slot.packetizer->packet_available())
+    slot.status = slot.packetizer->read();
+
+  if (   (FILE_STATUS_MOREDATA != slot.status)
+      && (FILE_STATUS_MOREDATA == old_status))
+    slot.packetizer->force_duration_on_last_packet();
+
+  // Take all finished packets off of all of this reader's
+  // packetizers. The main thread would do the same with
+  // get_packet() once it needs a packet for each of them.
+  std::vector<std::vector<packet_cptr>> packets(m_slots.size());
+
+  for (int idx = 0, num_slots = m_slots.size(); idx < num_slots; ++idx)
+    while (true) {
+      auto packet = m_slots[idx].packetizer->get_packet();
+      if (!packet)
+        break;
+      packets[idx].push_back(packet);
+    }
+
+  for (auto const &slot_packets : packets)
+    for (auto const &packet : slot_packets)
+      memory_budget_c::add(packet->data->get_size());
+
+  if (memory_budget_c::is_exceeded())
+    spill(packets);
+
+  auto progress = m_file.reader->get_progress();
+  auto position = static_cast<int64_t>(m_file.reader->m_in->getFilePointer());
+
+  std::lock_guard<std::mutex> lock{m_owner.m_mutex};
+
+  for (int idx = 0, num_slots = m_slots.size(); idx < num_slots; ++idx)
+    for (auto &packet : packets[idx])
+      m_slots[idx].queue.push_back(queue_item_t{ packet, FILE_STATUS_MOREDATA });
+
+  if (packets[slot_idx].empty()) {
+    slot.queue.push_back(queue_item_t{ packet_cptr{}, slot.status });
+    slot.finished = FILE_STATUS_DONE    == slot.status;
+    slot.holding  = FILE_STATUS_HOLDING == slot.status;
+  }
+
+  m_progress = progress;
+  m_position = position;
+
+  m_owner.m_cond.notify_all();
+}
+
+/** \brief Move the data of packets the main thread won't need for a
+    while to the spill file
+
+   Those are all packets that will be queued behind others. Only this
+   thread adds to its queues. The main thread may take packets off
+   them in the meantime, which only means that it reads a packet back
+   a bit earlier.
+*/
+void
+reader_thread_c::spill(std::vector<std::vector<packet_cptr>> &packets) {
+  std::vector<size_t> queue_sizes;
+
+  {
+    std::lock_guard<std::mutex> lock{m_owner.m_mutex};
+    for (auto const &slot : m_slots)
+      queue_sizes.push_back(slot.queue.size());
+  }
+
+  for (int idx = 0, num_slots = m_slots.size(); idx < num_slots; ++idx)
+    for (auto &packet : packets[idx])
+      if (queue_sizes[idx]++)
+        memory_budget_c::spill(*packet);
+}
+
+void
+reader_thread_c::run() {
+  tl_current_thread = this;
+
+  try {
+    std::unique_lock<std::mutex> lock{m_owner.m_mutex};
+
+    while (true) {
+      m_busy = false;
+      m_owner.m_cond.notify_all();
+
+      m_owner.m_cond.wait(lock, [this]() { return m_owner.m_stop || (!m_owner.m_exclusive && (-1 != find_slot_to_pull())); });
+
+      if (m_owner.m_stop)
+        return;
+
+      auto slot_idx = find_slot_to_pull();
+      m_busy        = true;
+
+      lock.unlock();
+      pull(slot_idx);
+      lock.lock();
+    }
+
+  } catch (reader_thread_stopped_x &) {
+
+  } catch (...) {
+    std::lock_guard<std::mutex> lock{m_owner.m_mutex};
+
+    m_exception = std::current_exception();
+    m_busy      = false;
+
+    m_owner.m_cond.notify_all();
+  }
+}
+
+// ------------------------------------------------------------
+
+reader_threads_c::reader_threads_c(size_t queue_depth)
+  : m_waiting_for{}
+  , m_queue_depth{std::max<size_t>(queue_depth, 1)}
+  , m_exclusive{}
+  , m_stop{}
+  , m_debug{"reader_threads"}
+{
+}
+
+reader_threads_c::~reader_threads_c() {
+  stop();
+}
+
+void
+reader_threads_c::create(size_t queue_depth) {
+  s_reader_threads = std::make_unique<reader_threads_c>(queue_depth);
+  s_reader_threads->start();
+}
+
+void
+reader_threads_c::destroy() {
+  s_reader_threads.reset();
+}
+
+reader_threads_c *
+reader_threads_c::get() {
+  return s_reader_threads.get();
+}
+
+void
+reader_threads_c::start() {
+  m_threads_by_file.resize(g_files.size(), nullptr);
+
+  for (auto &file : g_files) {
+    if (!file->reader->get_num_packetizers())
+      continue;
+
+    auto thread = std::make_shared<reader_thread_c>(*this, *file);
+    m_threads.push_back(thread);
+    m_threads_by_file[file->id] = thread.get();
+  }
+
+  mxdebug_if(m_debug, boost::format("starting %1% reader threads with a queue depth of %2% packets\n") % m_threads.size() % m_queue_depth);
+
+  m_previous_error_handler = get_mxmsg_handler(MXMSG_ERROR);
+  auto previous_handler    = m_previous_error_handler;
+
+  set_mxmsg_handler(MXMSG_ERROR, [previous_handler](unsigned int level, std::string const &error) {
+    if (tl_current_thread)
+      throw reader_thread_error_x{error};
+    if (previous_handler)
+      previous_handler(level, error);
+  });
+
+  for (auto &thread : m_threads)
+    thread->m_thread = std::thread{[thread]() { thread->run(); }};
+}
+
+void
+reader_threads_c::stop() {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop = true;
+    m_cond.notify_all();
+  }
+
+  for (auto &thread : m_threads)
+    if (thread->m_thread.joinable())
+      thread->m_thread.join();
+
+  if (m_previous_error_handler) {
+    set_mxmsg_handler(MXMSG_ERROR, m_previous_error_handler);
+    m_previous_error_handler = nullptr;
+  }
+}
+
+reader_thread_c *
+reader_threads_c::get_thread_for(generic_reader_c &reader)
+  const {
+  for (auto &thread : m_threads)
+    if (thread->m_file.reader.get() == &reader)
+      return thread.get();
+
+  return nullptr;
+}
+
+bool
+reader_threads_c::others_are_idle(reader_thread_c const *self)
+  const {
+  for (auto &thread : m_threads)
+    if ((thread.get() != self) && thread->m_busy)
+      return false;
+
+  return true;
+}
+
+/** \brief Hand the next packet or status of a packetizer to the main thread
+
+   Blocks until the reader thread has produced something for the
+   packetizer. Exceptions thrown on the reader thread are re-thrown
+   here, and errors reported with mxerror() on the reader thread are
+   reported again from the main thread.
+*/
+void
+reader_threads_c::pull(packetizer_t &ptzr) {
+  auto thread = m_threads_by_file[ptzr.file];
+  auto &slot  = thread->find_slot(ptzr.packetizer);
+
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  m_waiting_for = thread;
+  m_cond.notify_all();
+
+  m_cond.wait(lock, [thread, &slot]() { return !slot.queue.empty() || thread->m_exception; });
+
+  m_waiting_for = nullptr;
+
+  if (slot.queue.empty()) {
+    auto exception = thread->m_exception;
+    lock.unlock();
+
+    try {
+      std::rethrow_exception(exception);
+    } catch (reader_thread_error_x &ex) {
+      // mxerror() exits. The other threads must not run any longer
+      // while the global objects are destroyed.
+      stop();
+      mxerror(ex.m_error);
+    }
+  }
+
+  auto item = slot.queue.front();
+  slot.queue.pop_front();
+
+  if (item.packet && !item.packet->is_spilled())
+    memory_budget_c::remove(item.packet->data->get_size());
+
+  else if (!item.packet && (FILE_STATUS_HOLDING == item.status))
+    slot.holding = false;
+
+  m_cond.notify_all();
+  lock.unlock();
+
+  if (!item.packet) {
+    ptzr.status = item.status;
+    return;
+  }
+
+  // Spilled packets don't count against the budget. Reading them back
+  // doesn't change the usage.
+  if (item.packet->is_spilled()) {
+    memory_budget_c::unspill(*item.packet);
+    memory_budget_c::remove(item.packet->data->get_size());
+  }
+
+  ptzr.pack = item.packet;
+}
+
+int
+reader_threads_c::get_progress(generic_reader_c &reader) {
+  auto thread = get_thread_for(reader);
+  if (!thread)
+    return reader.get_progress();
+
+  std::lock_guard<std::mutex> lock{m_mutex};
+  return thread->m_progress;
+}
+
+int64_t
+reader_threads_c::get_position(generic_reader_c &reader) {
+  auto thread = get_thread_for(reader);
+  if (!thread)
+    return reader.m_in->getFilePointer();
+
+  std::lock_guard<std::mutex> lock{m_mutex};
+  return thread->m_position;
+}
+
+/** \brief The number of bytes queued for a packetizer
+
+   Includes both the packetizer's own queue and the packets the reader
+   thread has queued for the main thread.
+*/
+int64_t
+reader_threads_c::get_queued_bytes(generic_packetizer_c &packetizer) {
+  auto bytes = packetizer.get_queued_bytes();
+
+  std::lock_guard<std::mutex> lock{m_mutex};
+
+  for (auto &thread : m_threads)
+    for (auto &slot : thread->m_slots)
+      if (slot.packetizer == &packetizer)
+        for (auto &item : slot.queue)
+          if (item.packet)
+            bytes += item.packet->is_spilled() ? item.packet->spill_size : item.packet->data->get_size();
+
+  return bytes;
+}
+
+void
+reader_threads_c::run_exclusively(std::unique_lock<std::mutex> &lock,
+                                  reader_thread_c *self,
+                                  std::function<void()> const &action) {
+  if (self) {
+    self->m_busy = false;
+    m_cond.notify_all();
+    m_cond.wait(lock, [this, self]() { return m_stop || ((m_waiting_for == self) && !m_exclusive); });
+
+  } else
+    m_cond.wait(lock, [this]() { return !m_exclusive; });
+
+  m_exclusive = true;
+  m_cond.wait(lock, [this, self]() { return m_stop || others_are_idle(self); });
+
+  if (m_stop)
+    throw reader_thread_stopped_x{};
+
+  lock.unlock();
+
+  try {
+    tl_synchronized = true;
+    action();
+
+  } catch (...) {
+    tl_synchronized = false;
+    lock.lock();
+    m_exclusive = false;
+    m_cond.notify_all();
+    throw;
+  }
+
+  tl_synchronized = false;
+
+  lock.lock();
+
+  m_exclusive = false;
+  if (self)
+    self->m_busy = true;
+
+  m_cond.notify_all();
+}
+
+/** \brief Run an action that modifies state shared by all packetizers
+
+   Without reader threads or when called recursively the action is
+   run right away.
+*/
+void
+reader_threads_c::synchronize(std::function<void()> const &action) {
+  if (!s_reader_threads || tl_synchronized) {
+    action();
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock{s_reader_threads->m_mutex};
+  s_reader_threads->run_exclusively(lock, tl_current_thread, action);
+}
@@ -0,0 +1,135 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definitions for the threaded demuxing mode
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_READER_THREAD_H
+#define MTX_MERGE_READER_THREAD_H
+
+#include "common/common_pch.h"
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "common/debugging.h"
+#include "merge/file_status.h"
+
+class generic_packetizer_c;
+class generic_reader_c;
+class packet_t;
+using packet_cptr = std::shared_ptr<packet_t>;
+struct filelist_t;
+struct packetizer_t;
+
+class reader_threads_c;
+
+/** \brief Runs one reader and its packetizers on a separate thread
+
+   The thread emulates the calls that pull_packetizers_for_packets()
+   makes in the single-threaded mode: it calls the packetizer's read()
+   function until the packetizer has a packet available, forces the
+   duration on the last packet once the status changes and takes the
+   finished packets off the packetizers' queues. The packets are
+   stored in one bounded queue per packetizer. The main thread takes
+   them off those queues in the same order it would otherwise
+   receive them from the packetizers.
+*/
+class reader_thread_c {
+  friend class reader_threads_c;
+
+protected:
+  struct queue_item_t {
+    packet_cptr packet;
+    file_status_e status;
+  };
+
+  struct slot_t {
+    generic_packetizer_c *packetizer;
+    std::deque<queue_item_t> queue;
+    file_status_e status;
+    bool finished, holding;
+  };
+
+  reader_threads_c &m_owner;
+  filelist_t &m_file;
+  std::vector<slot_t> m_slots;
+  std::thread m_thread;
+  std::exception_ptr m_exception;
+  bool m_busy;
+  int m_progress;
+  int64_t m_position;
+
+public:
+  reader_thread_c(reader_threads_c &owner, filelist_t &file);
+
+protected:
+  void run();
+  void pull(size_t slot_idx);
+  void spill(std::vector<std::vector<packet_cptr>> &packets);
+  int find_slot_to_pull() const;
+  slot_t &find_slot(generic_packetizer_c *packetizer);
+};
+using reader_thread_cptr = std::shared_ptr<reader_thread_c>;
+
+/** \brief Coordinates the reader threads with the main thread
+
+   Packetizers modify global state during processing, e.g. by
+   re-rendering the track headers or changing their default
+   duration. Such modifications must be wrapped in synchronize(). If
+   it is called from a reader thread then the action is only run once
+   the main thread is waiting for packets from that reader and all
+   other reader threads are idle. That is the same point in time at
+   which the action would have been run in the single-threaded mode.
+*/
+class reader_threads_c {
+  friend class reader_thread_c;
+
+protected:
+  std::vector<reader_thread_cptr> m_threads;
+  std::vector<reader_thread_c *> m_threads_by_file;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  reader_thread_c *m_waiting_for;
+  size_t m_queue_depth;
+  bool m_exclusive, m_stop;
+  mxmsg_handler_t m_previous_error_handler;
+  debugging_option_c m_debug;
+
+  static std::unique_ptr<reader_threads_c> s_reader_threads;
+
+public:
+  reader_threads_c(size_t queue_depth);
+  ~reader_threads_c();
+
+  void start();
+  void stop();
+
+  void pull(packetizer_t &ptzr);
+  int get_progress(generic_reader_c &reader);
+  int64_t get_position(generic_reader_c &reader);
+  int64_t get_queued_bytes(generic_packetizer_c &packetizer);
+
+public:
+  static void create(size_t queue_depth);
+  static void destroy();
+  static reader_threads_c *get();
+
+  static void synchronize(std::function<void()> const &action);
+
+protected:
+  reader_thread_c *get_thread_for(generic_reader_c &reader) const;
+  bool others_are_idle(reader_thread_c const *self) const;
+  void run_exclusively(std::unique_lock<std::mutex> &lock, reader_thread_c *self, std::function<void()> const &action);
+};
+
+#endif  // MTX_MERGE_READER_THREAD_H
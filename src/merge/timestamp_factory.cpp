@@ -15,10 +15,169 @@
 #include "common/common_pch.h"
 
 #include "common/mm_io.h"
+#include "common/mm_io_x.h"
+#include "common/mm_mmap_io.h"
 #include "common/strings/formatting.h"
 #include "common/strings/parsing.h"
 #include "merge/timestamp_factory.h"
 
+namespace {
+
+void
+put_varint(std::vector<unsigned char> &buffer,
+           uint64_t value) {
+  while (value >= 0x80) {
+    buffer.push_back(static_cast<unsigned char>(value | 0x80));
+    value >>= 7;
+  }
+
+  buffer.push_back(static_cast<unsigned char>(value));
+}
+
+uint64_t
+get_varint(std::vector<unsigned char> const &buffer,
+           size_t &offset) {
+  auto value = uint64_t{};
+  auto shift = 0u;
+
+  while (true) {
+    auto byte  = buffer[offset++];
+    value     |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    shift     += 7;
+
+    if (!(byte & 0x80))
+      return value;
+  }
+}
+
+uint64_t
+zigzag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t
+unzigzag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+/* Parses plain decimal numbers like "-1234.567" without allocating
+   memory. Only numbers whose digits fit into the 53 bit mantissa of a
+   double and that have at most 22 decimal places are handled. Those
+   can be converted exactly, yielding the same result as
+   parse_number(). Everything else is left to parse_number(). */
+bool
+parse_decimal(char const *p,
+              char const *end,
+              double &value) {
+  static double const s_powers_of_ten[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+  };
+
+  auto negative        = false;
+  auto mantissa        = uint64_t{};
+  auto num_digits      = 0u;
+  auto num_decimals    = 0u;
+  auto num_significant = 0u;
+  auto in_fraction     = false;
+
+  if ((p < end) && (('-' == *p) || ('+' == *p)))
+    negative = '-' == *p++;
+
+  for (; p < end; ++p) {
+    if (('.' == *p) && !in_fraction) {
+      in_fraction = true;
+      continue;
+    }
+
+    if ((*p < '0') || (*p > '9'))
+      return false;
+
+    mantissa = mantissa * 10 + (*p - '0');
+    ++num_digits;
+
+    if (mantissa)
+      ++num_significant;
+    if (in_fraction)
+      ++num_decimals;
+
+    if ((15 < num_significant) || (22 < num_decimals))
+      return false;
+  }
+
+  if (!num_digits)
+    return false;
+
+  value = static_cast<double>(mantissa) / s_powers_of_ten[num_decimals];
+  if (negative)
+    value = -value;
+
+  return true;
+}
+
+/* Splits data into lines terminated by '\n', '\r' or "\r\n" and hands
+   them to a handler. Only lines crossing the boundary between two
+   chunks of data are copied. */
+class line_splitter_c {
+protected:
+  std::function<void(char const *, char const *)> m_handler;
+  std::string m_partial;
+  bool m_skip_newline;
+
+public:
+  line_splitter_c(std::function<void(char const *, char const *)> const &handler)
+    : m_handler{handler}
+    , m_skip_newline{}
+  {
+  }
+
+  void add(char const *data,
+           size_t size) {
+    auto end = data + size;
+
+    if (m_skip_newline && (data < end) && ('\n' == *data))
+      ++data;
+    m_skip_newline = false;
+
+    while (data < end) {
+      auto eol = data;
+      while ((eol < end) && ('\n' != *eol) && ('\r' != *eol))
+        ++eol;
+
+      if (eol == end) {
+        m_partial.append(data, end);
+        return;
+      }
+
+      if (m_partial.empty())
+        m_handler(data, eol);
+
+      else {
+        m_partial.append(data, eol);
+        m_handler(m_partial.c_str(), m_partial.c_str() + m_partial.length());
+        m_partial.clear();
+      }
+
+      data = eol + 1;
+
+      if ('\r' == *eol) {
+        if (data == end)
+          m_skip_newline = true;
+        else if ('\n' == *data)
+          ++data;
+      }
+    }
+  }
+
+  void finish() {
+    if (!m_partial.empty())
+      m_handler(m_partial.c_str(), m_partial.c_str() + m_partial.length());
+    m_partial.clear();
+  }
+};
+
+}
+
 timestamp_factory_cptr
 timestamp_factory_c::create(const std::string &file_name,
                            const std::string &source_name,
@@ -185,58 +344,51 @@ timestamp_factory_v1_c::get_at(uint64_t frame) {
 
 void
 timestamp_factory_v2_c::parse(mm_io_c &in) {
-  std::string line;
   std::map<int64_t, int64_t> dur_map;
 
-  int64_t dur_sum          = 0;
-  int line_no              = 0;
-  double previous_timecode = 0;
+  int line_no = 0;
+  line_splitter_c splitter{[this, &line_no, &dur_map](char const *begin, char const *end) {
+    parse_line(begin, end, ++line_no, dur_map);
+  }};
 
-  while (in.getline2(line)) {
-    line_no++;
-    strip(line);
-    if ((line.length() == 0) || (line[0] == '#'))
-      continue;
+  auto source = open_for_chunked_reading(in);
+
+  if (source) {
+    while (true) {
+      auto size = std::min<int64_t>(source->get_size() - source->getFilePointer(), s_chunk_size);
+      if (0 >= size)
+        break;
 
-    double timecode;
-    if (!parse_number(line.c_str(), timecode))
-      mxerror(boost::format(Y("The line %1% of the timecode file '%2%' does not contain a valid floating point number.\n")) % line_no % m_file_name);
-
-    if ((2 == m_version) && (timecode < previous_timecode))
-      mxerror(boost::format(Y("The timecode v2 file '%1%' contains timecodes that are not ordered. "
-                              "Due to a bug in mkvmerge versions up to and including v1.5.0 this was necessary "
-                              "if the track to which the timecode file was applied contained B frames. "
-                              "Starting with v1.5.1 mkvmerge now handles this correctly, and the timecodes in the timecode file must be ordered normally. "
-                              "For example, the frame sequence 'IPBBP...' at 25 FPS requires a timecode file with "
-                              "the first timecodes being '0', '40', '80', '120' etc and not '0', '120', '40', '80' etc.\n\n"
-                              "If you really have to specify non-sorted timecodes then use the timecode format v4. "
-                              "It is identical to format v2 but allows non-sorted timecodes.\n"))
-              % in.get_file_name());
-
-    previous_timecode = timecode;
-    m_timecodes.push_back((int64_t)(timecode * 1000000));
-    if (m_timecodes.size() > 1) {
-      int64_t duration = m_timecodes[m_timecodes.size() - 1] - m_timecodes[m_timecodes.size() - 2];
-      if (dur_map.find(duration) == dur_map.end())
-        dur_map[duration] = 1;
-      else
-        dur_map[duration] = dur_map[duration] + 1;
-      dur_sum += duration;
-      m_durations.push_back(duration);
+      auto chunk = source->read(size);
+      splitter.add(reinterpret_cast<char const *>(chunk->get_buffer()), chunk->get_size());
+    }
+
+  } else {
+    // Files in UTF-16 or UTF-32 must be converted line by line.
+    std::string line;
+    while (in.getline2(line)) {
+      splitter.add(line.c_str(), line.length());
+      splitter.add("\n", 1);
     }
   }
 
-  if (m_timecodes.empty())
+  splitter.finish();
+
+  if (!m_num_timecodes)
     mxerror(boost::format(Y("The timecode file '%1%' does not contain any valid entry.\n")) % m_file_name);
 
+  m_timecodes.shrink_to_fit();
+  m_next_timecode = unzigzag(get_varint(m_timecodes, m_read_offset));
+
+  mxdebug_if(m_debug, boost::format("ext_timecodes: Version %1%, %2% entries stored in %3% bytes.\n") % m_version % m_num_timecodes % m_timecodes.size());
+
   if (m_debug) {
     mxdebug("Absolute probablities with maximum in separate line:\n");
     mxdebug("Duration  | Absolute probability\n");
     mxdebug("----------+---------------------\n");
   }
 
-  dur_sum = -1;
-  std::pair<int64_t, int64_t> entry;
+  int64_t dur_sum = -1;
   for (auto entry : dur_map) {
     if ((0 > dur_sum) || (dur_map[dur_sum] < entry.second))
       dur_sum = entry.first;
@@ -249,36 +401,107 @@ timestamp_factory_v2_c::parse(mm_io_c &in) {
   if (0 < dur_sum)
     m_default_duration = dur_sum;
 
-  m_durations.push_back(dur_sum);
+  m_last_duration = dur_sum;
+}
+
+/** \brief Open the file behind \c in for reading it in large chunks
+
+   The chunks start at the current position of \c in, which must be
+   right after the format line. The file is memory-mapped if possible;
+   otherwise \c in itself is read from. A null pointer is returned if
+   the file's byte order requires converting each character.
+*/
+mm_io_cptr
+timestamp_factory_v2_c::open_for_chunked_reading(mm_io_c &in) {
+  auto text_in = dynamic_cast<mm_text_io_c *>(&in);
+  if (text_in && (BO_NONE != text_in->get_byte_order()) && (BO_UTF8 != text_in->get_byte_order()))
+    return mm_io_cptr{};
+
+  auto position = in.getFilePointer();
+  auto file_in  = text_in ? dynamic_cast<mm_file_io_c *>(text_in->get_proxied()) : nullptr;
+
+  if (file_in) {
+    try {
+      auto mapped = mm_mmap_io_c::open(file_in->get_file_name());
+      mapped->setFilePointer(position);
+      return mapped;
+
+    } catch (mtx::mm_io::exception &) {
+    }
+  }
+
+  // Not mappable; read from 'in' without taking ownership.
+  return mm_io_cptr{&in, [](mm_io_c *) {}};
+}
+
+void
+timestamp_factory_v2_c::parse_line(char const *begin,
+                                   char const *end,
+                                   int line_no,
+                                   std::map<int64_t, int64_t> &dur_map) {
+  while ((begin < end) && isblanktab(*begin))
+    ++begin;
+  while ((begin < end) && isblanktab(end[-1]))
+    --end;
+
+  if ((begin == end) || ('#' == *begin))
+    return;
+
+  double timecode;
+  if (   !parse_decimal(begin, end, timecode)
+      && !parse_number(std::string{begin, end}, timecode))
+    mxerror(boost::format(Y("The line %1% of the timecode file '%2%' does not contain a valid floating point number.\n")) % line_no % m_file_name);
+
+  if ((2 == m_version) && (timecode < m_previous_timecode))
+    mxerror(boost::format(Y("The timecode v2 file '%1%' contains timecodes that are not ordered. "
+                            "Due to a bug in mkvmerge versions up to and including v1.5.0 this was necessary "
+                            "if the track to which the timecode file was applied contained B frames. "
+                            "Starting with v1.5.1 mkvmerge now handles this correctly, and the timecodes in the timecode file must be ordered normally. "
+                            "For example, the frame sequence 'IPBBP...' at 25 FPS requires a timecode file with "
+                            "the first timecodes being '0', '40', '80', '120' etc and not '0', '120', '40', '80' etc.\n\n"
+                            "If you really have to specify non-sorted timecodes then use the timecode format v4. "
+                            "It is identical to format v2 but allows non-sorted timecodes.\n"))
+          % m_file_name);
+
+  auto value          = static_cast<int64_t>(timecode * 1000000);
+  m_previous_timecode = timecode;
+
+  if (m_num_timecodes)
+    ++dur_map[value - m_last_timecode];
+
+  put_varint(m_timecodes, zigzag(value - m_last_timecode));
+  m_last_timecode = value;
+  ++m_num_timecodes;
 }
 
 bool
 timestamp_factory_v2_c::get_next(packet_cptr &packet) {
-  if ((static_cast<size_t>(m_frameno) >= m_timecodes.size()) && !m_warning_printed) {
-    mxwarn_tid(m_source_name, m_tid,
-               boost::format(Y("The number of external timecodes %1% is smaller than the number of frames in this track. "
-                               "The remaining frames of this track might not be timestamped the way you intended them to be. mkvmerge might even crash.\n"))
-               % m_timecodes.size());
+  if (static_cast<size_t>(m_frameno) >= m_num_timecodes) {
+    if (!m_warning_printed)
+      mxwarn_tid(m_source_name, m_tid,
+                 boost::format(Y("The number of external timecodes %1% is smaller than the number of frames in this track. "
+                                 "The remaining frames of this track might not be timestamped the way you intended them to be. mkvmerge might even crash.\n"))
+                 % m_num_timecodes);
     m_warning_printed = true;
 
-    if (m_timecodes.empty()) {
-      packet->assigned_timecode = 0;
-      if (!m_preserve_duration || (0 >= packet->duration))
-        packet->duration = 0;
-
-    } else {
-      packet->assigned_timecode = m_timecodes.back();
-      if (!m_preserve_duration || (0 >= packet->duration))
-        packet->duration = m_timecodes.back();
-    }
+    packet->assigned_timecode = m_last_timecode;
+    if (!m_preserve_duration || (0 >= packet->duration))
+      packet->duration = m_last_timecode;
 
     return false;
   }
 
-  packet->assigned_timecode = m_timecodes[m_frameno];
+  auto timecode = m_next_timecode;
+  auto duration = m_last_duration;
+
+  if (static_cast<size_t>(++m_frameno) < m_num_timecodes) {
+    m_next_timecode += unzigzag(get_varint(m_timecodes, m_read_offset));
+    duration         = m_next_timecode - timecode;
+  }
+
+  packet->assigned_timecode = timecode;
   if (!m_preserve_duration || (0 >= packet->duration))
-    packet->duration = m_durations[m_frameno];
-  m_frameno++;
+    packet->duration = duration;
 
   return false;
 }
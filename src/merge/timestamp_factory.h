@@ -123,11 +123,19 @@ protected:
   virtual int64_t get_at(uint64_t frame);
 };
 
+/* Timecode files with one timecode per frame can contain tens of
+   millions of lines. They're parsed in large chunks (directly from a
+   memory mapping where possible), and the timecodes are stored as
+   variable-length differences to their predecessors. get_next()
+   decodes them one at a time. */
 class timestamp_factory_v2_c: public timestamp_factory_c {
 protected:
-  std::vector<int64_t> m_timecodes, m_durations;
-  int64_t m_frameno;
-  double m_default_duration;
+  static size_t const s_chunk_size = 1024 * 1024;
+
+  std::vector<unsigned char> m_timecodes;
+  size_t m_num_timecodes, m_read_offset;
+  int64_t m_frameno, m_next_timecode, m_last_timecode, m_last_duration;
+  double m_previous_timecode, m_default_duration;
   bool m_warning_printed;
 
 public:
@@ -135,7 +143,13 @@ public:
                         const std::string &source_name,
                         int64_t tid, int version)
     : timestamp_factory_c(file_name, source_name, tid, version)
+    , m_num_timecodes(0)
+    , m_read_offset(0)
     , m_frameno(0)
+    , m_next_timecode(0)
+    , m_last_timecode(0)
+    , m_last_duration(0)
+    , m_previous_timecode(0)
     , m_default_duration(0)
     , m_warning_printed(false)
   {
@@ -148,6 +162,10 @@ public:
   virtual double get_default_duration(double proposal) {
     return m_default_duration != 0 ? m_default_duration : proposal;
   }
+
+protected:
+  virtual void parse_line(char const *begin, char const *end, int line_no, std::map<int64_t, int64_t> &dur_map);
+  virtual mm_io_cptr open_for_chunked_reading(mm_io_c &in);
 };
 
 class timestamp_factory_v3_c: public timestamp_factory_c {
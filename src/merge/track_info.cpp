@@ -21,6 +21,7 @@
 track_info_c::track_info_c()
   : m_id{}
   , m_disable_multi_file{}
+  , m_follow_timeout{}
   , m_aspect_ratio{}
   , m_display_width{}
   , m_display_height{}
@@ -54,6 +55,7 @@ track_info_c::operator =(const track_info_c &src) {
   m_vtracks                    = src.m_vtracks;
   m_track_tags                 = src.m_track_tags;
   m_disable_multi_file         = src.m_disable_multi_file;
+  m_follow_timeout             = src.m_follow_timeout;
 
   m_private_data               = src.m_private_data ? src.m_private_data->clone() : src.m_private_data;
 
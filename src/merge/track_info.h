@@ -116,6 +116,7 @@ public:
   std::string m_fname;
   item_selector_c<bool> m_atracks, m_vtracks, m_stracks, m_btracks, m_track_tags;
   bool m_disable_multi_file;
+  int64_t m_follow_timeout;     // In milliseconds; 0 if the file isn't growing
 
   // Options used by the packetizers.
   memory_cptr m_private_data;
@@ -89,7 +89,7 @@ mpeg4_p10_es_video_packetizer_c::add_extra_data(memory_cptr data) {
 }
 
 int
-mpeg4_p10_es_video_packetizer_c::process(packet_cptr packet) {
+mpeg4_p10_es_video_packetizer_c::process_impl(packet_cptr packet) {
   try {
     if (packet->has_timecode())
       m_parser.add_timecode(packet->timecode);
@@ -199,6 +199,18 @@ mpeg4_p10_es_video_packetizer_c::get_nalu_size_length()
   return m_parser.get_nalu_size_length();
 }
 
+// The AVCC is only known once the parameter sets have been found. It
+// consists of seven bytes plus two bytes and the NALU for each
+// sequence and picture parameter set. SPS NALUs usually have 10 to 60
+// bytes, PPS NALUs fewer than 10. 1 KB also suffices for streams
+// carrying several of each, e.g. broadcasts with one PPS per slice
+// type.
+int64_t
+mpeg4_p10_es_video_packetizer_c::get_expected_header_growth()
+  const {
+  return 1024;
+}
+
 void
 mpeg4_p10_es_video_packetizer_c::connect(generic_packetizer_c *src,
                                          int64_t p_append_timecode_offset) {
@@ -115,7 +115,7 @@ dts_packetizer_c::set_headers() {
 }
 
 int
-dts_packetizer_c::process(packet_cptr packet) {
+dts_packetizer_c::process_impl(packet_cptr packet) {
   m_timestamp_calculator.add_timecode(packet);
 
   m_packet_buffer.add(packet->data->get_buffer(), packet->data->get_size());
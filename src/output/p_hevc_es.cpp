@@ -84,7 +84,7 @@ hevc_es_video_packetizer_c::add_extra_data(memory_cptr data) {
 }
 
 int
-hevc_es_video_packetizer_c::process(packet_cptr packet) {
+hevc_es_video_packetizer_c::process_impl(packet_cptr packet) {
   try {
     if (packet->has_timecode())
       m_parser.add_timecode(packet->timecode);
@@ -184,6 +184,17 @@ hevc_es_video_packetizer_c::get_nalu_size_length()
   return m_parser.get_nalu_size_length();
 }
 
+// The HEVCC is only known once the parameter sets and SEI NALUs have
+// been found. Its fixed part has 23 bytes, and each NALU costs two
+// bytes plus its size. The VPS, SPS and PPS together rarely exceed
+// 200 bytes, but SEI NALUs with user data (e.g. the encoder settings
+// written by x265) can take more than a kilobyte.
+int64_t
+hevc_es_video_packetizer_c::get_expected_header_growth()
+  const {
+  return 2048;
+}
+
 void
 hevc_es_video_packetizer_c::connect(generic_packetizer_c *src,
                                          int64_t p_append_timecode_offset) {
@@ -178,7 +178,7 @@ mp3_packetizer_c::set_headers() {
 }
 
 int
-mp3_packetizer_c::process(packet_cptr packet) {
+mp3_packetizer_c::process_impl(packet_cptr packet) {
   m_timestamp_calculator.add_timecode(packet);
 
   unsigned char *mp3_packet;
@@ -171,8 +171,18 @@ mpeg1_2_video_packetizer_c::remove_stuffing_bytes_and_handle_sequence_headers(pa
   }
 }
 
+// Room for the sequence header if it has to be extracted from the
+// first frames: 12 bytes, up to 128 bytes for the intra and non-intra
+// quantizer matrices, 10 bytes for the sequence extension and up to
+// 12 bytes for the sequence display extension.
+int64_t
+mpeg1_2_video_packetizer_c::get_expected_header_growth()
+  const {
+  return m_hcodec_private ? 0 : 512;
+}
+
 int
-mpeg1_2_video_packetizer_c::process(packet_cptr packet) {
+mpeg1_2_video_packetizer_c::process_impl(packet_cptr packet) {
   if (0.0 > m_fps)
     extract_fps(packet->data->get_buffer(), packet->data->get_size());
 
@@ -188,11 +198,11 @@ mpeg1_2_video_packetizer_c::process_framed(packet_cptr packet) {
     return FILE_STATUS_MOREDATA;
 
   if (4 > packet->data->get_size())
-    return video_packetizer_c::process(packet);
+    return video_packetizer_c::process_impl(packet);
 
   remove_stuffing_bytes_and_handle_sequence_headers(packet);
 
-  return video_packetizer_c::process(packet);
+  return video_packetizer_c::process_impl(packet);
 }
 
 int
@@ -230,7 +240,7 @@ mpeg1_2_video_packetizer_c::process_unframed(packet_cptr packet) {
 
       remove_stuffing_bytes_and_handle_sequence_headers(new_packet);
 
-      video_packetizer_c::process(new_packet);
+      video_packetizer_c::process_impl(new_packet);
 
       frame->data = nullptr;
       state       = m_parser.GetState();
@@ -82,14 +82,24 @@ mpeg4_p2_video_packetizer_c::~mpeg4_p2_video_packetizer_c() {
          % m_statistics.m_num_generated_timecodes % m_statistics.m_num_dropped_timecodes);
 }
 
+// Room for the configuration data if it has to be extracted from the
+// first frame. The visual object sequence, visual object and video
+// object layer headers need less than 50 bytes. Encoders often add
+// user data with their name and version, e.g. 'XviD0050'.
+int64_t
+mpeg4_p2_video_packetizer_c::get_expected_header_growth()
+  const {
+  return !m_input_is_native && m_output_is_native && !m_ti.m_private_data ? 512 : 0;
+}
+
 int
-mpeg4_p2_video_packetizer_c::process(packet_cptr packet) {
+mpeg4_p2_video_packetizer_c::process_impl(packet_cptr packet) {
   extract_size(packet->data->get_buffer(), packet->data->get_size());
   extract_aspect_ratio(packet->data->get_buffer(), packet->data->get_size());
 
-  int result = m_input_is_native == m_output_is_native ? video_packetizer_c::process(packet)
-             : m_input_is_native                       ?                     process_native(packet)
-             :                                                               process_non_native(packet);
+  int result = m_input_is_native == m_output_is_native ? video_packetizer_c::process_impl(packet)
+             : m_input_is_native                       ?                          process_native(packet)
+             :                                                                    process_non_native(packet);
 
   ++m_frames_output;
 
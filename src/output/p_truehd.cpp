@@ -76,7 +76,7 @@ truehd_packetizer_c::process_framed(truehd_frame_cptr const &frame,
 }
 
 int
-truehd_packetizer_c::process(packet_cptr packet) {
+truehd_packetizer_c::process_impl(packet_cptr packet) {
   m_timestamp_calculator.add_timecode(packet);
 
   m_parser.add_data(packet->data->get_buffer(), packet->data->get_size());
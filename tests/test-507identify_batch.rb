@@ -0,0 +1,38 @@
+#!/usr/bin/ruby -w
+
+# The results must be output in the order the names are listed even
+# though several files are identified at the same time. They must be
+# the same as when identifying each file on its own. Files that cannot
+# be identified yield a single error line each, and the exit code is
+# 2.
+
+describe "mkvmerge / identification of several files with --identify-batch"
+
+files = [ "data/avi/v.avi", "data/does-not-exist.mkv", "data/mkv/complex.mkv", "data/simple/v.mp3", "data/mp4/o12-short.m4v", "data/does-not-exist-either.mp4" ]
+
+def batch_output_matches? files
+  expected = files.collect do |file|
+    if %r{does-not-exist}.match(file)
+      "File '#{Regexp.escape(file)}': error: [^\\n]+\\n"
+    else
+      Regexp.escape(sys("../src/mkvmerge --identify-for-gui #{file}")[0].join)
+    end
+  end
+
+  output = IO.read(tmp)
+  hash_tmp
+
+  %r{\A#{expected.join}\z}.match(output) ? "ok" : "different"
+end
+
+test "list with identifiable and unidentifiable files" do
+  File.open("#{tmp}-list", "w") { |file| file.puts files.join("\n") }
+  sys "../src/mkvmerge --identify-batch #{tmp}-list --identify-threads 4 > #{tmp}", :exit_code => 2
+  batch_output_matches? files
+end
+
+test "all files identifiable, names read from the standard input" do
+  identifiable = files.reject { |file| %r{does-not-exist}.match(file) }
+  sys "printf '%s\\n' #{identifiable.join(' ')} | ../src/mkvmerge --identify-batch - --identify-threads 2 > #{tmp}"
+  batch_output_matches? identifiable
+end
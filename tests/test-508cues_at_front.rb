@@ -0,0 +1,51 @@
+#!/usr/bin/ruby -w
+
+# With --cues 0:all every MP3 frame gets a cue point. That's far more
+# than the space reserved in front of the clusters is projected for,
+# so the cues must end up at the end of the file.
+#
+# The space reserved for the cues is projected from the sizes of the
+# source files. The probes only look at the first 32 MB of each file,
+# so larger files must not be mistaken for 32 MB ones.
+
+describe "mkvmerge / cues in the space reserved in front of the clusters"
+
+def cues_before_first_cluster? args
+  merge "--cues-at-front #{args}"
+
+  lines   = info("-v #{tmp}", :output => :return)[0]
+  cues    = lines.index { |line| %r{^\|\+ Cues}.match line }
+  cluster = lines.index { |line| %r{^\|\+ Cluster}.match line }
+
+  error "no cues or clusters found" if !cues || !cluster
+
+  hash_tmp
+
+  cues < cluster
+end
+
+# Appends the file to itself until it is larger than 32 MB.
+def create_source_larger_than_32mb
+  source = tmp_name
+  merge "data/avi/v.avi", :output => source
+
+  while File.size(source) <= 32 * 1024 * 1024
+    doubled = tmp_name
+    merge "#{source} + #{source}", :output => doubled
+    source  = doubled
+  end
+
+  source
+end
+
+test "cues fitting into the reserved space" do
+  cues_before_first_cluster?("data/avi/v.avi") ? :ok : :bad
+end
+
+test "more cue points than projected" do
+  cues_before_first_cluster?("--cues 0:all data/simple/v.mp3") ? :bad : :ok
+end
+
+test "source file larger than 32 MB" do
+  cues_before_first_cluster?(create_source_larger_than_32mb) ? :ok : :bad
+end
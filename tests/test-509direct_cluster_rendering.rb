@@ -0,0 +1,30 @@
+#!/usr/bin/ruby -w
+
+# Clusters encoded directly by mkvmerge's own cluster serializer must
+# be byte-identical to the ones rendered element by element by
+# libmatroska. The sources cover SimpleBlocks (audio, video with B
+# frames) as well as BlockGroups with durations and references
+# (subtitles, Matroska sources with all kinds of tracks).
+
+describe "mkvmerge / direct cluster rendering produces the same files as libmatroska"
+
+def same_output_with_direct_rendering? args
+  merge args
+  regular = hash_tmp
+
+  merge "--engage direct_cluster_rendering #{args}"
+  direct = hash_tmp
+
+  regular == direct ? "ok" : "different"
+end
+
+[ "data/avi/v.avi",
+  "data/ogg/v.ogg",
+  "data/mp4/o12-short.m4v",
+  "data/h264/IcePrincess.h264",
+  "--sub-charset 0:ISO-8859-1 data/subtitles/srt/vde.srt",
+  "data/mkv/complex.mkv",
+  "--engage no_simpleblocks data/avi/v.avi",
+].each do |args|
+  test(args) { same_output_with_direct_rendering? args }
+end
@@ -0,0 +1,29 @@
+#!/usr/bin/ruby -w
+
+# Reading each source file on its own thread must not change the
+# output. The main thread takes the packets off the reader threads'
+# queues in the same order in which it would otherwise read them.
+
+describe "mkvmerge / reading source files on separate threads produces the same files"
+
+def same_output_with_reader_threads? args
+  merge args
+  regular = hash_tmp
+
+  merge "--reader-threads #{args}"
+  threaded = hash_tmp
+
+  merge "--reader-threads --reader-thread-queue-depth 1 #{args}"
+  shallow = hash_tmp
+
+  (regular == threaded) && (regular == shallow) ? "ok" : "different"
+end
+
+[ "data/avi/v.avi",
+  "data/mkv/complex.mkv",
+  "data/avi/v.avi data/ogg/v.ogg",
+  "data/h264/IcePrincess.h264 --sub-charset 0:ISO-8859-1 data/subtitles/srt/vde.srt",
+  "data/mp4/o12-short.m4v data/mkv/complex.mkv",
+].each do |args|
+  test(args) { same_output_with_reader_threads? args }
+end
@@ -0,0 +1,71 @@
+#include "common/common_pch.h"
+
+#include "common/content_decoder.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+class zlib_decoder_c: public content_decoder_c {
+public:
+  zlib_decoder_c() {
+    kax_content_encoding_t encoding;
+    encoding.compressor = compressor_c::create(COMPRESSION_ZLIB);
+    encodings.push_back(encoding);
+  }
+};
+
+class ContentDecoder: public ::testing::TestWithParam<unsigned int> {
+protected:
+  virtual void SetUp() {
+    compressor_c::set_num_threads(GetParam());
+  }
+
+  virtual void TearDown() {
+    compressor_c::set_num_threads(0);
+  }
+};
+
+TEST_P(ContentDecoder, ReverseStartedFrames) {
+  auto compressor = compressor_c::create(COMPRESSION_ZLIB);
+  auto originals  = std::vector<std::string>{};
+  auto frames     = std::vector<memory_cptr>{};
+  zlib_decoder_c decoder;
+
+  for (auto idx = 0u; idx < 20; ++idx) {
+    originals.push_back(std::string(1000 + idx, 'a' + idx));
+    frames.push_back(compressor->compress(memory_c::clone(originals.back())));
+    decoder.start_reversing(frames.back(), CONTENT_ENCODING_SCOPE_BLOCK);
+  }
+
+  // A different memory_c referring to the same buffer finds the result.
+  for (auto idx = 0u; idx < frames.size(); ++idx) {
+    auto frame = std::make_shared<memory_c>(frames[idx]->get_buffer(), frames[idx]->get_size(), false);
+    decoder.reverse(frame, CONTENT_ENCODING_SCOPE_BLOCK);
+    EXPECT_EQ(originals[idx], std::string(reinterpret_cast<char *>(frame->get_buffer()), frame->get_size()));
+  }
+}
+
+TEST_P(ContentDecoder, DiscardPending) {
+  auto compressor = compressor_c::create(COMPRESSION_ZLIB);
+  auto frame      = compressor->compress(memory_c::clone(std::string(100, 'x')));
+  zlib_decoder_c decoder;
+
+  decoder.start_reversing(frame, CONTENT_ENCODING_SCOPE_BLOCK);
+  decoder.discard_pending();
+
+  decoder.reverse(frame, CONTENT_ENCODING_SCOPE_BLOCK);
+  EXPECT_EQ(std::string(100, 'x'), std::string(reinterpret_cast<char *>(frame->get_buffer()), frame->get_size()));
+}
+
+TEST_P(ContentDecoder, Errors) {
+  auto frame = memory_c::clone(std::string{"not zlib data"});
+  zlib_decoder_c decoder;
+
+  decoder.start_reversing(frame, CONTENT_ENCODING_SCOPE_BLOCK);
+  EXPECT_THROW(decoder.reverse(frame, CONTENT_ENCODING_SCOPE_BLOCK), mtx::compression_x);
+}
+
+INSTANTIATE_TEST_CASE_P(Threads, ContentDecoder, ::testing::Values(0u, 2u));
+
+}
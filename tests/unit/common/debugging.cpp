@@ -0,0 +1,48 @@
+#include "common/common_pch.h"
+
+#include <thread>
+
+#include "common/debugging.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(Debugging, Options) {
+  debugging_option_c option{"unit_test_option"}, same_option{"unit_test_option"};
+
+  EXPECT_FALSE(option);
+
+  debugging_c::request("unit_test_option");
+  EXPECT_TRUE(option);
+  EXPECT_TRUE(same_option);
+
+  debugging_c::request("unit_test_option", false);
+  EXPECT_FALSE(option);
+  EXPECT_FALSE(same_option);
+}
+
+TEST(Debugging, OptionsOnSeveralThreads) {
+  debugging_c::request("unit_test_thread_option_3");
+
+  std::atomic<int> wrong{0};
+  auto threads = std::vector<std::thread>{};
+
+  for (auto idx = 0; idx < 4; ++idx)
+    threads.emplace_back([&wrong, idx]() {
+      for (auto run = 0; run < 1000; ++run) {
+        debugging_option_c option{(boost::format("unit_test_thread_option_%1%") % ((idx + run) % 50)).str()};
+        if (!!option != (3 == ((idx + run) % 50)))
+          ++wrong;
+      }
+    });
+
+  for (auto &thread : threads)
+    thread.join();
+
+  debugging_c::request("unit_test_thread_option_3", false);
+
+  EXPECT_EQ(0, wrong);
+}
+
+}
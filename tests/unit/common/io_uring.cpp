@@ -0,0 +1,159 @@
+#include "common/common_pch.h"
+
+#include <chrono>
+#include <iostream>
+
+#include "common/io_uring.h"
+#include "common/mm_io_x.h"
+#include "common/mm_read_buffer_io.h"
+#include "common/mm_write_buffer_io.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+class IoUring: public ::testing::Test {
+protected:
+  std::string m_file_name;
+
+  virtual void SetUp() {
+    m_file_name = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("mtx-io-uring-%%%%-%%%%-%%%%")).string();
+    io_uring_c::enable(true);
+  }
+
+  virtual void TearDown() {
+    io_uring_c::enable(false);
+    boost::system::error_code ec;
+    boost::filesystem::remove(m_file_name, ec);
+  }
+
+  static std::string make_data(size_t size) {
+    auto data = std::string(size, '\0');
+    for (auto idx = 0u; idx < size; ++idx)
+      data[idx] = 'a' + (idx * 7 + idx / 251) % 26;
+    return data;
+  }
+};
+
+TEST_F(IoUring, WriteBuffers) {
+  if (!io_uring_c::is_available())
+    return;
+
+  auto data = make_data(100000);
+
+  {
+    auto out = mm_write_buffer_io_c::open(m_file_name, 4096, 3);
+
+    for (auto offset = 0u, size = 1u; offset < data.size(); offset += size, size = size * 7 % 9973)
+      out->write(data.substr(offset, size));
+
+    EXPECT_EQ(data.size(), out->getFilePointer());
+
+    // Re-rendering a header in the middle of the data
+    out->setFilePointer(5000);
+    out->write(std::string{"rerendered"});
+    data.replace(5000, 10, "rerendered");
+    EXPECT_EQ(5010u, out->getFilePointer());
+
+    out->setFilePointer(0, seek_end);
+    out->write(std::string(10000, 'x'));
+    data += std::string(10000, 'x');
+    EXPECT_EQ(data.size(), out->getFilePointer());
+  }
+
+  auto content = mm_file_io_c::slurp(m_file_name);
+  EXPECT_EQ(data, std::string(reinterpret_cast<char *>(content->get_buffer()), content->get_size()));
+}
+
+TEST_F(IoUring, ReadAhead) {
+  if (!io_uring_c::is_available())
+    return;
+
+  auto data = make_data(100000);
+
+  {
+    mm_file_io_c out{m_file_name, MODE_CREATE};
+    out.write(data);
+  }
+
+  auto in     = mm_read_buffer_io_c::open(m_file_name, 1000);
+  auto result = std::string{};
+  auto buffer = std::string{};
+
+  // Sequential reading with the occasional seek
+  for (auto size = 1u; result.size() < data.size(); size = size * 7 % 3001) {
+    if (!(result.size() % 7)) {
+      in->setFilePointer(result.size() / 2);
+      in->setFilePointer(result.size());
+    }
+
+    buffer.clear();
+    auto num_read = in->read(buffer, std::min<size_t>(size, data.size() - result.size()));
+    result += buffer.substr(0, num_read);
+
+    ASSERT_EQ(result.size(), in->getFilePointer());
+  }
+
+  EXPECT_EQ(data, result);
+  EXPECT_EQ(0u, in->read(buffer, 1));
+  EXPECT_TRUE(in->eof());
+}
+
+// Benchmark comparing blocking I/O with io_uring for writing and
+// reading a large file the way mkvmerge and mkvextract do. Run with
+// --gtest_also_run_disabled_tests.
+class IoUringBenchmark: public ::testing::TestWithParam<bool> {
+protected:
+  // Stands in for parsing and rendering the data.
+  static uint64_t process(memory_c const &chunk) {
+    auto sum = uint64_t{};
+    for (auto idx = 0u, size = static_cast<unsigned int>(chunk.get_size()); idx < size; ++idx)
+      sum = sum * 31 + chunk.get_buffer()[idx];
+    return sum;
+  }
+};
+
+TEST_P(IoUringBenchmark, DISABLED_Throughput) {
+  auto const file_size  = 1024ull * 1024 * 1024;
+  auto const chunk_size = 64 * 1024u;
+  auto use_io_uring     = GetParam();
+  auto file_name        = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("mtx-io-uring-%%%%-%%%%-%%%%")).string();
+  auto chunk            = memory_c::alloc(chunk_size);
+
+  auto checksum         = uint64_t{};
+
+  memset(chunk->get_buffer(), 0x55, chunk_size);
+  io_uring_c::enable(use_io_uring);
+
+  auto start = std::chrono::steady_clock::now();
+  {
+    auto out = mm_write_buffer_io_c::open(file_name, 20 * 1024 * 1024, use_io_uring ? 4 : 1);
+    for (auto written = 0ull; written < file_size; written += chunk_size) {
+      checksum += process(*chunk);
+      out->write(chunk);
+    }
+    out->flush();
+  }
+  auto write_duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  start = std::chrono::steady_clock::now();
+  {
+    auto in = mm_read_buffer_io_c::open(file_name, 1 << 20);
+    while (in->read(chunk->get_buffer(), chunk_size) == chunk_size)
+      checksum += process(*chunk);
+  }
+  auto read_duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  io_uring_c::enable(false);
+  boost::filesystem::remove(file_name);
+
+  std::cout << boost::format("[ BENCH    ] %1%: writing %|2$.0f| MB/s, reading %|3$.0f| MB/s (checksum %4%)\n")
+    % (use_io_uring ? "io_uring" : "blocking")
+    % (file_size / write_duration / 1024 / 1024)
+    % (file_size / read_duration  / 1024 / 1024)
+    % checksum;
+}
+
+INSTANTIATE_TEST_CASE_P(Backends, IoUringBenchmark, ::testing::Values(false, true));
+
+}
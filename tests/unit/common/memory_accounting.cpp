@@ -0,0 +1,105 @@
+#include "common/common_pch.h"
+
+#include "common/memory.h"
+#include "common/memory_accounting.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace mtx::mem;
+
+class MemoryAccounting: public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    set_accounting_enabled(true);
+  }
+
+  virtual void TearDown() {
+    set_accounting_enabled(false);
+  }
+
+  memory_cptr create(size_t size) {
+    return memory_cptr{new memory_c(safemalloc(size), size, true)};
+  }
+};
+
+TEST_F(MemoryAccounting, AllocResizeFree) {
+  component_scope_c scope{component_e::parsers};
+
+  auto current = get_accounted_bytes(component_e::parsers);
+  auto peak    = get_peak_accounted_bytes(component_e::parsers);
+  auto mem     = create(1000);
+
+  EXPECT_EQ(current + 1000, get_accounted_bytes(component_e::parsers));
+
+  mem->resize(3000);
+  EXPECT_EQ(current + 3000, get_accounted_bytes(component_e::parsers));
+
+  mem->resize(2000);
+  EXPECT_EQ(current + 2000, get_accounted_bytes(component_e::parsers));
+  EXPECT_LE(std::max(peak, current + 3000), get_peak_accounted_bytes(component_e::parsers));
+
+  mem.reset();
+  EXPECT_EQ(current, get_accounted_bytes(component_e::parsers));
+}
+
+TEST_F(MemoryAccounting, NonOwningBuffersAreNotAccounted) {
+  unsigned char buffer[100];
+  auto current = get_accounted_bytes(component_e::other);
+  auto mem     = memory_cptr{new memory_c(buffer, 100, false)};
+
+  EXPECT_EQ(current, get_accounted_bytes(component_e::other));
+
+  // The copy is allocated from the pool and rounded up to its size class.
+  mem->grab();
+  EXPECT_LE(current + 100, get_accounted_bytes(component_e::other));
+
+  mem.reset();
+  EXPECT_EQ(current, get_accounted_bytes(component_e::other));
+}
+
+TEST_F(MemoryAccounting, ScopeAndComponentChange) {
+  EXPECT_EQ(component_e::other, get_current_component());
+
+  memory_cptr mem;
+
+  {
+    component_scope_c scope{component_e::readers};
+    EXPECT_EQ(component_e::readers, get_current_component());
+
+    {
+      component_scope_c inner_scope{component_e::io_buffers};
+      EXPECT_EQ(component_e::io_buffers, get_current_component());
+    }
+
+    EXPECT_EQ(component_e::readers, get_current_component());
+
+    mem = create(500);
+  }
+
+  EXPECT_EQ(component_e::other, get_current_component());
+
+  auto readers = get_accounted_bytes(component_e::readers);
+  auto packets = get_accounted_bytes(component_e::packets);
+
+  mem->set_accounting_component(component_e::packets);
+  EXPECT_EQ(readers - 500, get_accounted_bytes(component_e::readers));
+  EXPECT_EQ(packets + 500, get_accounted_bytes(component_e::packets));
+
+  mem.reset();
+  EXPECT_EQ(packets, get_accounted_bytes(component_e::packets));
+}
+
+TEST_F(MemoryAccounting, ExplicitAccounting) {
+  auto current = get_accounted_bytes(component_e::cues);
+
+  account(component_e::cues, 4096);
+  EXPECT_EQ(current + 4096, get_accounted_bytes(component_e::cues));
+  EXPECT_LE(current + 4096, get_peak_accounted_bytes(component_e::cues));
+
+  account(component_e::cues, -4096);
+  EXPECT_EQ(current, get_accounted_bytes(component_e::cues));
+}
+
+}
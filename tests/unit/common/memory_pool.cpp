@@ -0,0 +1,83 @@
+#include "common/common_pch.h"
+
+#include "common/memory.h"
+#include "common/memory_pool.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(MemoryPool, BuffersAreReused) {
+  auto mem    = memory_c::alloc(100);
+  auto buffer = mem->get_buffer();
+
+  mem.reset();
+
+  // Same size class (128 bytes).
+  mem = memory_c::alloc(120);
+  EXPECT_EQ(buffer, mem->get_buffer());
+  EXPECT_EQ(120u,   mem->get_size());
+}
+
+TEST(MemoryPool, PoolAllocCapacity) {
+  auto capacity = size_t{};
+  auto buffer   = mtx::mem::pool_alloc(65, capacity);
+
+  EXPECT_EQ(128u, capacity);
+  mtx::mem::pool_free(buffer, capacity);
+
+  buffer = mtx::mem::pool_alloc(2 * 1024 * 1024, capacity);
+  EXPECT_EQ(0u, capacity);
+  mtx::mem::pool_free(buffer, capacity);
+}
+
+TEST(MemoryPool, CloneAndResize) {
+  unsigned char data[200];
+  for (auto idx = 0u; idx < sizeof(data); ++idx)
+    data[idx] = idx;
+
+  auto mem = memory_c::clone(data, 50);
+  EXPECT_EQ(50u, mem->get_size());
+  EXPECT_EQ(0,   memcmp(mem->get_buffer(), data, 50));
+
+  // Within the buffer's capacity
+  mem->resize(60);
+  EXPECT_EQ(60u, mem->get_size());
+  EXPECT_EQ(0,   memcmp(mem->get_buffer(), data, 50));
+
+  // Beyond the buffer's capacity
+  mem->add(&data[60], 140);
+  memcpy(mem->get_buffer() + 50, &data[50], 10);
+  EXPECT_EQ(200u, mem->get_size());
+  EXPECT_EQ(0,    memcmp(mem->get_buffer(), data, 200));
+}
+
+TEST(MemoryPool, Grab) {
+  unsigned char data[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+  auto mem = std::make_shared<memory_c>(data, sizeof(data), false);
+  mem->set_offset(2);
+  mem->grab();
+
+  EXPECT_TRUE(mem->is_free());
+  EXPECT_NE(&data[2], mem->get_buffer());
+  EXPECT_EQ(8u, mem->get_size());
+  EXPECT_EQ(0,  memcmp(mem->get_buffer(), &data[2], 8));
+}
+
+TEST(MemoryPool, PoolingDisabled) {
+  mtx::mem::set_pooling_enabled(false);
+
+  auto capacity = size_t{1};
+  auto buffer   = mtx::mem::pool_alloc(100, capacity);
+
+  EXPECT_EQ(0u, capacity);
+  mtx::mem::pool_free(buffer, capacity);
+
+  auto mem = memory_c::clone("hello", 5);
+  EXPECT_EQ(0, memcmp(mem->get_buffer(), "hello", 5));
+
+  mtx::mem::set_pooling_enabled(true);
+}
+
+}
@@ -0,0 +1,106 @@
+#include "common/common_pch.h"
+
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+#include "common/mm_follow_io.h"
+#include "common/mm_read_buffer_io.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+class MmFollowIo: public ::testing::Test {
+protected:
+  std::string m_file_name;
+
+  virtual void SetUp() {
+    m_file_name = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("mtx-follow-%%%%-%%%%-%%%%")).string();
+    append("0123456789");
+  }
+
+  virtual void TearDown() {
+    boost::system::error_code ec;
+    boost::filesystem::remove(m_file_name, ec);
+  }
+
+  void append(std::string const &content) {
+    std::ofstream out{m_file_name, std::ios::binary | std::ios::app};
+    out.write(content.c_str(), content.size());
+  }
+};
+
+TEST_F(MmFollowIo, NotFollowing) {
+  mm_follow_io_c in{new mm_file_io_c(m_file_name), 10000};
+  auto buffer = std::string(20, '\0');
+
+  EXPECT_EQ(10u, in.read(&buffer[0], 20));
+  EXPECT_TRUE(in.eof());
+}
+
+TEST_F(MmFollowIo, WaitsForMoreData) {
+  mm_follow_io_c in{new mm_file_io_c(m_file_name), 2000};
+  auto buffer = std::string(20, '\0');
+
+  in.enable_following();
+
+  auto writer = std::thread{[this]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    append("abcde");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    append("fghij");
+  }};
+
+  EXPECT_EQ(20u, in.read(&buffer[0], 20));
+  EXPECT_EQ("0123456789abcdefghij", buffer);
+  EXPECT_FALSE(in.eof());
+  EXPECT_EQ(20, in.get_size());
+
+  writer.join();
+}
+
+TEST_F(MmFollowIo, IdleTimeout) {
+  mm_follow_io_c in{new mm_file_io_c(m_file_name), 300};
+  auto buffer = std::string(20, '\0');
+
+  in.enable_following();
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(10u, in.read(&buffer[0], 20));
+  EXPECT_LE(300, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+
+  EXPECT_TRUE(in.eof());
+  EXPECT_FALSE(in.is_following());
+
+  // The file is considered complete now; reads don't wait anymore.
+  start = std::chrono::steady_clock::now();
+  EXPECT_EQ(0u, in.read(&buffer[0], 20));
+  EXPECT_GT(300, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+TEST_F(MmFollowIo, BufferedWaitsForMoreData) {
+  auto follow = new mm_follow_io_c{new mm_file_io_c(m_file_name), 2000};
+  mm_read_buffer_io_c in{follow, 1024};
+  auto buffer = std::string(20, '\0');
+
+  in.set_growing(true);
+  follow->enable_following();
+
+  auto writer = std::thread{[this]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    append("abcde");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    append("fghij");
+  }};
+
+  for (auto idx = 0u; idx < 20; ++idx)
+    EXPECT_EQ(1u, in.read(&buffer[idx], 1));
+
+  EXPECT_EQ("0123456789abcdefghij", buffer);
+  EXPECT_FALSE(in.eof());
+
+  writer.join();
+}
+
+}
@@ -4,6 +4,7 @@
 #include "tests/unit/util.h"
 
 #include "common/mm_io_x.h"
+#include "common/mm_write_buffer_io.h"
 
 namespace {
 
@@ -16,4 +17,47 @@ TEST(MmIo, Slurp) {
   ASSERT_THROW(mm_file_io_c::slurp("doesnotexist"), mtx::mm_io::exception);
 }
 
+TEST(MmIo, InsertSpace) {
+  auto file_name = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("mtx-insert-space-%%%%-%%%%-%%%%")).string();
+  auto data      = std::string(3 * 1024 * 1024, '\0');
+
+  for (auto idx = 0u; idx < data.size(); ++idx)
+    data[idx] = 'a' + (idx * 7 + idx / 251) % 26;
+
+  // Whole blocks, partial blocks and more than the data to move.
+  for (auto const &range : std::vector<std::pair<uint64_t, uint64_t>>{ { 8192, 4096 }, { 5000, 3000 }, { 100, 2000000 }, { 1000000, 1500000 } }) {
+    auto out = mm_write_buffer_io_c::open(file_name, 64 * 1024, 2);
+
+    out->write(data);
+    out->setFilePointer(12345);
+
+    if (!out->insert_space(range.first, range.second)) {
+      out.reset();
+      boost::filesystem::remove(file_name);
+      return;
+    }
+
+    EXPECT_EQ(12345u, out->getFilePointer());
+    EXPECT_EQ(static_cast<int64_t>(data.size() + range.second), out->get_size());
+
+    auto content = std::string{};
+    out->setFilePointer(0);
+    out->read(content, data.size() + range.second);
+
+    EXPECT_EQ(data.substr(0, range.first), content.substr(0, range.first));
+    EXPECT_EQ(data.substr(range.first),    content.substr(range.first + range.second));
+
+    // Writing after the moved data continues at the new end.
+    out->setFilePointer(0, seek_end);
+    out->write(std::string{"end"});
+    EXPECT_EQ(static_cast<int64_t>(data.size() + range.second + 3), out->get_size());
+  }
+
+  boost::filesystem::remove(file_name);
+
+  unsigned char const mem[10] = { 0 };
+  auto mem_io = mm_mem_io_c{mem, sizeof(mem)};
+  EXPECT_FALSE(mem_io.insert_space(2, 4));
+}
+
 }
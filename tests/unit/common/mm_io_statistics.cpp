@@ -0,0 +1,76 @@
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+#include "common/mm_io_statistics.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+class MmIoStatistics: public ::testing::Test {
+protected:
+  std::string m_file_name;
+
+  virtual void SetUp() {
+    m_file_name = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("mtx-io-statistics-%%%%-%%%%-%%%%")).string();
+    mm_io_statistics_c::enable(true);
+  }
+
+  virtual void TearDown() {
+    mm_io_statistics_c::enable(false);
+    boost::filesystem::remove(m_file_name);
+  }
+};
+
+TEST_F(MmIoStatistics, Histogram) {
+  mm_io_statistics_c::histogram_c histogram{{ 10, 100 }};
+
+  histogram.add(0);
+  histogram.add(10);
+  histogram.add(11);
+  histogram.add(1000);
+
+  EXPECT_EQ(2u, histogram.get_count(0));
+  EXPECT_EQ(1u, histogram.get_count(1));
+  EXPECT_EQ(1u, histogram.get_count(2));
+  EXPECT_EQ("<= 10: 2, <= 100: 1, > 100: 1", histogram.format({ "<= 10", "<= 100", "> 100" }));
+}
+
+TEST_F(MmIoStatistics, FileOperations) {
+  unsigned char buffer[10000];
+  memset(buffer, 0, 10000);
+
+  mm_file_io_c file{m_file_name, MODE_CREATE};
+  auto statistics = file.get_statistics();
+
+  ASSERT_TRUE(!!statistics);
+
+  file.write(buffer, 10000);
+  file.setFilePointer(0);
+  file.setFilePointer(0);
+  EXPECT_EQ(1000u, file.read(buffer, 1000));
+  file.setFilePointer(6000);
+  EXPECT_EQ(4000u, file.read(buffer, 5000));
+
+  EXPECT_EQ(10000u, statistics->get_bytes_written());
+  EXPECT_EQ(1u,     statistics->get_num_writes());
+  EXPECT_EQ(5000u,  statistics->get_bytes_read());
+  EXPECT_EQ(2u,     statistics->get_num_reads());
+  EXPECT_EQ(3u,     statistics->get_num_seeks());
+  EXPECT_EQ(2u,     statistics->get_num_moving_seeks());
+  EXPECT_EQ(15000u, statistics->get_seek_distance());
+
+  // Read sizes: 1000 and 4000 bytes, both <= 4K.
+  EXPECT_EQ(2u, statistics->get_read_sizes().get_count(1));
+  // Seek distances: 10000 and 5000 bytes, both <= 64K.
+  EXPECT_EQ(2u, statistics->get_seek_distances().get_count(1));
+}
+
+TEST_F(MmIoStatistics, DisabledByDefault) {
+  mm_io_statistics_c::enable(false);
+
+  mm_file_io_c file{m_file_name, MODE_CREATE};
+  EXPECT_FALSE(!!file.get_statistics());
+}
+
+}
@@ -0,0 +1,197 @@
+#include "common/common_pch.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#include "common/mm_io_x.h"
+#include "common/mm_mmap_io.h"
+#include "common/mm_read_buffer_io.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+class MmMmapIo: public ::testing::Test {
+protected:
+  std::string m_file_name, m_data;
+
+  virtual void SetUp() {
+    m_file_name = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("mtx-mmap-%%%%-%%%%-%%%%")).string();
+  }
+
+  virtual void TearDown() {
+    boost::system::error_code ec;
+    boost::filesystem::remove(m_file_name, ec);
+  }
+
+  void create_file(size_t size) {
+    m_data = std::string(size, '\0');
+    for (auto idx = 0u; idx < size; ++idx)
+      m_data[idx] = 'a' + (idx * 7 + idx / 251) % 26;
+
+    std::ofstream out{m_file_name, std::ios::binary};
+    out.write(m_data.c_str(), m_data.size());
+  }
+
+  std::string to_string(memory_cptr const &mem) {
+    return std::string{reinterpret_cast<char *>(mem->get_buffer()), mem->get_size()};
+  }
+};
+
+TEST_F(MmMmapIo, Reading) {
+  create_file(100000);
+
+  // Windows of a single page force reads crossing window boundaries.
+  auto in      = mm_mmap_io_c{m_file_name, 1};
+  auto content = std::string{};
+
+  EXPECT_EQ(static_cast<int64_t>(m_data.size()), in.get_size());
+
+  for (auto size = 1u; content.size() < m_data.size(); size = size * 7 % 9973) {
+    auto chunk = std::string{};
+    in.read(chunk, std::min<size_t>(size, m_data.size() - content.size()));
+    content += chunk;
+  }
+
+  EXPECT_EQ(m_data, content);
+  EXPECT_EQ(m_data.size(), in.getFilePointer());
+  EXPECT_FALSE(in.eof());
+
+  unsigned char byte;
+  EXPECT_EQ(0u, in.read(&byte, 1));
+  EXPECT_TRUE(in.eof());
+}
+
+TEST_F(MmMmapIo, Views) {
+  create_file(100000);
+
+  auto in = std::make_shared<mm_mmap_io_c>(m_file_name, 1);
+
+  in->setFilePointer(4000);
+  auto view1 = in->read(10000);
+  EXPECT_EQ(m_data.substr(4000, 10000), to_string(view1));
+  EXPECT_EQ(14000u, in->getFilePointer());
+
+  // Enough windows to push the first one out of the file's cache.
+  auto view2 = memory_cptr{};
+  for (auto offset = 20000u; offset < 90000u; offset += 10000) {
+    in->setFilePointer(offset);
+    view2 = in->read(5000);
+    EXPECT_EQ(m_data.substr(offset, 5000), to_string(view2));
+  }
+
+  // Modifications of a view never end up in the file.
+  view1->get_buffer()[0] = '!';
+  in->setFilePointer(4000);
+  EXPECT_EQ(m_data.substr(4000, 10), to_string(in->read(10)));
+
+  in->setFilePointer(-3, seek_end);
+  EXPECT_THROW(in->read(10), mtx::mm_io::end_of_file_x);
+  EXPECT_TRUE(in->eof());
+
+  in->close();
+  in.reset();
+
+  EXPECT_EQ(std::string{"!"} + m_data.substr(4001, 9999), to_string(view1));
+  EXPECT_EQ(m_data.substr(80000, 5000), to_string(view2));
+
+  // Packetizers grab the data of the packets they queue. Views don't
+  // have to be copied for that.
+  auto buffer = view2->get_buffer();
+  view2->grab();
+  EXPECT_EQ(buffer, view2->get_buffer());
+
+  // Views can be resized like any other buffer.
+  view2->resize(6000);
+  EXPECT_EQ(m_data.substr(80000, 5000), to_string(view2).substr(0, 5000));
+}
+
+TEST_F(MmMmapIo, Seeking) {
+  create_file(1000);
+
+  auto in = mm_mmap_io_c{m_file_name};
+
+  in.setFilePointer(-10, seek_end);
+  EXPECT_EQ(990u, in.getFilePointer());
+  EXPECT_EQ(static_cast<unsigned char>(m_data[990]), in.read_uint8());
+
+  in.setFilePointer(-100, seek_current);
+  EXPECT_EQ(891u, in.getFilePointer());
+
+  EXPECT_THROW(in.setFilePointer(-1), mtx::mm_io::seek_x);
+  EXPECT_THROW(in.write(std::string{"x"}), mtx::mm_io::wrong_read_write_access_x);
+}
+
+TEST_F(MmMmapIo, EmptyFile) {
+  create_file(0);
+
+  auto in = mm_mmap_io_c{m_file_name};
+  unsigned char byte;
+
+  EXPECT_EQ(0, in.get_size());
+  EXPECT_EQ(0u, in.read(&byte, 1));
+  EXPECT_TRUE(in.eof());
+}
+
+TEST_F(MmMmapIo, TruncatedWhileMapped) {
+  create_file(3 * 4096);
+
+  auto in   = mm_mmap_io_c{m_file_name};
+  auto view = in.read(3 * 4096);
+
+  boost::filesystem::resize_file(m_file_name, 4096);
+
+  EXPECT_EXIT(std::cerr << static_cast<int>(view->get_buffer()[2 * 4096]), ::testing::ExitedWithCode(2), "'" + m_file_name + "' was truncated while it was being read");
+}
+
+TEST_F(MmMmapIo, MissingFile) {
+  EXPECT_THROW(mm_mmap_io_c{m_file_name}, mtx::mm_io::open_x);
+}
+
+// Benchmark comparing frame-sized reads that copy from a read buffer
+// with views into the mapping. Run with
+// --gtest_also_run_disabled_tests.
+class MmMmapIoBenchmark: public ::testing::TestWithParam<bool> {
+};
+
+TEST_P(MmMmapIoBenchmark, DISABLED_ReadFrames) {
+  auto const file_size  = 256 * 1024 * 1024u;
+  auto const frame_size = 50 * 1024u;
+  auto use_mmap         = GetParam();
+  auto file_name        = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("mtx-mmap-%%%%-%%%%-%%%%")).string();
+  auto checksum         = uint64_t{};
+
+  {
+    auto chunk = std::string(1024 * 1024, '\x55');
+    std::ofstream out{file_name, std::ios::binary};
+    for (auto written = 0u; written < file_size; written += chunk.size())
+      out.write(chunk.c_str(), chunk.size());
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  {
+    auto in = use_mmap ? mm_mmap_io_c::open(file_name) : mm_io_cptr{new mm_read_buffer_io_c(new mm_file_io_c(file_name), 1 << 17)};
+
+    for (auto offset = 0u; (offset + frame_size) <= file_size; offset += frame_size) {
+      // Like a packetizer queueing the frame as a packet.
+      auto frame  = in->read(frame_size);
+      frame->grab();
+      checksum   += frame->get_buffer()[frame_size / 2];
+    }
+  }
+
+  auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  boost::filesystem::remove(file_name);
+
+  std::cout << boost::format("[ BENCH    ] %1%: %|2$.0f| MB/s (checksum %3%)\n")
+    % (use_mmap ? "mmap views" : "read buffer copies")
+    % (file_size / duration / 1024 / 1024)
+    % checksum;
+}
+
+INSTANTIATE_TEST_CASE_P(Mmap, MmMmapIoBenchmark, ::testing::Values(false, true));
+
+}
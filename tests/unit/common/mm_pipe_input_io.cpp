@@ -0,0 +1,87 @@
+#include "common/common_pch.h"
+
+#include "common/mm_io_x.h"
+#include "common/mm_pipe_input_io.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// Behaves like a pipe: it can only be read sequentially.
+class pipe_io_c: public mm_mem_io_c {
+public:
+  pipe_io_c(std::string const &data)
+    : mm_mem_io_c{reinterpret_cast<unsigned char const *>(data.c_str()), data.size()}
+  {
+  }
+
+  virtual void setFilePointer(int64, seek_mode) {
+    throw mtx::mm_io::seek_x{};
+  }
+};
+
+std::string
+make_data(size_t size) {
+  auto data = std::string(size, '\0');
+  for (auto idx = 0u; idx < size; ++idx)
+    data[idx] = 'a' + (idx * 7 + idx / 251) % 26;
+  return data;
+}
+
+std::string
+read_at(mm_io_c &in,
+        int64_t position,
+        size_t size) {
+  auto buffer = std::string(size, '\0');
+  in.setFilePointer(position);
+  buffer.resize(in.read(&buffer[0], size));
+  return buffer;
+}
+
+TEST(MmPipeInputIo, ShortInput) {
+  auto data = make_data(100000);
+  mm_pipe_input_io_c in{new pipe_io_c{data}, "-"};
+
+  EXPECT_EQ(data.substr(0, 1000), read_at(in, 0, 1000));
+  EXPECT_EQ(static_cast<int64_t>(data.size()), in.get_size());
+  EXPECT_TRUE(in.is_size_known());
+  EXPECT_EQ(data.substr(500, 1000), read_at(in, 500, 1000));
+  EXPECT_EQ(data.substr(0, 10), read_at(in, 0, 10));
+
+  in.setFilePointer(-10, seek_end);
+  EXPECT_EQ(data.substr(data.size() - 10), read_at(in, in.getFilePointer(), 20));
+  EXPECT_TRUE(in.eof());
+
+  EXPECT_EQ("-", in.get_file_name());
+}
+
+TEST(MmPipeInputIo, RewindBuffer) {
+  auto data = make_data(20 * 1024 * 1024);
+  mm_pipe_input_io_c in{new pipe_io_c{data}, "-", 2 * 1024 * 1024};
+
+  EXPECT_LT(static_cast<int64_t>(data.size()), in.get_size());
+  EXPECT_FALSE(in.is_size_known());
+  EXPECT_THROW(in.setFilePointer(-10, seek_end), mtx::mm_io::seek_x);
+  EXPECT_THROW(in.setFilePointer(3 * 1024 * 1024), mtx::mm_io::seek_x);
+
+  // The whole head can be re-read while probing.
+  EXPECT_EQ(data.substr(1024 * 1024, 100), read_at(in, 1024 * 1024, 100));
+  EXPECT_EQ(data.substr(0, 100), read_at(in, 0, 100));
+
+  in.release_head();
+
+  // Seeking forward skips data; seeking back only works within the
+  // rewind buffer.
+  EXPECT_EQ(data.substr(15 * 1024 * 1024, 1000), read_at(in, 15 * 1024 * 1024, 1000));
+  EXPECT_EQ(data.substr(14 * 1024 * 1024, 1000), read_at(in, 14 * 1024 * 1024, 1000));
+  EXPECT_THROW(in.setFilePointer(0), mtx::mm_io::seek_x);
+
+  auto rest = std::string(6 * 1024 * 1024, '\0');
+  rest.resize(in.read(&rest[0], rest.size()));
+  EXPECT_EQ(data.substr(14 * 1024 * 1024 + 1000), rest);
+  EXPECT_TRUE(in.eof());
+  EXPECT_TRUE(in.is_size_known());
+  EXPECT_EQ(static_cast<int64_t>(data.size()), in.get_size());
+}
+
+}
@@ -0,0 +1,100 @@
+#include "common/common_pch.h"
+
+#include "common/mm_probe_buffer_io.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// Counts the read requests reaching the storage.
+class counting_mem_io_c: public mm_mem_io_c {
+public:
+  unsigned int m_num_reads;
+
+  counting_mem_io_c(std::string const &data)
+    : mm_mem_io_c{reinterpret_cast<unsigned char const *>(data.c_str()), data.size()}
+    , m_num_reads{}
+  {
+  }
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size) {
+    ++m_num_reads;
+    return mm_mem_io_c::_read(buffer, size);
+  }
+};
+
+std::string
+make_data(size_t size) {
+  auto data = std::string(size, '\0');
+  for (auto idx = 0u; idx < size; ++idx)
+    data[idx] = 'a' + (idx * 7 + idx / 251) % 26;
+  return data;
+}
+
+std::string
+read_at(mm_io_c &in,
+        int64_t position,
+        size_t size) {
+  auto buffer = std::string(size, '\0');
+  in.setFilePointer(position);
+  buffer.resize(in.read(&buffer[0], size));
+  return buffer;
+}
+
+TEST(MmProbeBufferIo, RepeatedProbesReadOnce) {
+  auto data   = make_data(300000);
+  auto source = std::make_shared<counting_mem_io_c>(data);
+  mm_probe_buffer_io_c in{source};
+
+  for (auto probe = 0u; probe < 20; ++probe) {
+    EXPECT_EQ(data.substr(0, 4),            read_at(in, 0, 4));
+    EXPECT_EQ(data.substr(1000, 64 * 1024), read_at(in, 1000, 64 * 1024));
+    EXPECT_EQ(data.substr(200000),          read_at(in, 200000, 200000));
+    EXPECT_TRUE(in.eof());
+  }
+
+  EXPECT_EQ(1u, source->m_num_reads);
+  EXPECT_EQ(data.size(), in.get_buffered_size());
+}
+
+TEST(MmProbeBufferIo, ExtendsOnDemand) {
+  auto data   = make_data(100000);
+  auto source = std::make_shared<counting_mem_io_c>(data);
+  mm_probe_buffer_io_c in{source, 50000};
+
+  EXPECT_EQ(data.substr(0, 100), read_at(in, 0, 100));
+  EXPECT_EQ(50000u, in.get_buffered_size());
+
+  // Continues past the maximum buffer size.
+  EXPECT_EQ(data.substr(40000, 20000), read_at(in, 40000, 20000));
+  EXPECT_EQ(2u, source->m_num_reads);
+
+  // Starts behind the buffer.
+  EXPECT_EQ(data.substr(90000, 100), read_at(in, 90000, 100));
+  EXPECT_EQ(3u, source->m_num_reads);
+
+  EXPECT_EQ(data.substr(45000, 100), read_at(in, 45000, 100));
+  EXPECT_EQ(3u, source->m_num_reads);
+}
+
+TEST(MmProbeBufferIo, DropBuffer) {
+  auto data   = make_data(10000);
+  auto source = std::make_shared<counting_mem_io_c>(data);
+  mm_probe_buffer_io_c in{source};
+
+  EXPECT_EQ(data.substr(0, 100), read_at(in, 0, 100));
+  in.drop_buffer();
+
+  EXPECT_EQ(0u, in.get_buffered_size());
+  EXPECT_EQ(data.substr(5000, 100), read_at(in, 5000, 100));
+  EXPECT_EQ(data.substr(5100, 100), read_at(in, 5100, 100));
+  EXPECT_EQ(3u, source->m_num_reads);
+  EXPECT_EQ(0u, in.get_buffered_size());
+
+  in.setFilePointer(-10, seek_end);
+  EXPECT_EQ(9990u, in.getFilePointer());
+  EXPECT_EQ(data.substr(9990), read_at(in, 9990, 100));
+}
+
+}
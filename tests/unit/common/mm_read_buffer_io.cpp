@@ -0,0 +1,136 @@
+#include "common/common_pch.h"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "common/mm_io_x.h"
+#include "common/mm_read_buffer_io.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// Simulates storage with a high latency per read request.
+class slow_mem_io_c: public mm_mem_io_c {
+protected:
+  std::chrono::microseconds m_latency;
+
+public:
+  slow_mem_io_c(std::string const &data, std::chrono::microseconds latency)
+    : mm_mem_io_c{reinterpret_cast<unsigned char const *>(data.c_str()), data.size()}
+    , m_latency{latency}
+  {
+  }
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size) {
+    std::this_thread::sleep_for(m_latency);
+    return mm_mem_io_c::_read(buffer, size);
+  }
+};
+
+std::string
+make_data(size_t size) {
+  auto data = std::string(size, '\0');
+  for (auto idx = 0u; idx < size; ++idx)
+    data[idx] = 'a' + (idx * 7 + idx / 251) % 26;
+  return data;
+}
+
+class MmReadBufferIo: public ::testing::TestWithParam<unsigned int> {
+protected:
+  virtual void SetUp() {
+    mm_read_buffer_io_c::set_read_ahead_buffers(GetParam());
+  }
+
+  virtual void TearDown() {
+    mm_read_buffer_io_c::set_read_ahead_buffers(0);
+  }
+};
+
+TEST_P(MmReadBufferIo, SequentialReading) {
+  auto data    = make_data(100000);
+  auto content = std::string{};
+
+  mm_read_buffer_io_c in{new slow_mem_io_c{data, std::chrono::microseconds{0}}, 1000};
+
+  for (auto size = 1u; content.size() < data.size(); size = size * 7 % 2003) {
+    auto chunk = std::string{};
+    in.read(chunk, std::min<size_t>(size, data.size() - content.size()));
+    content += chunk;
+    ASSERT_EQ(content.size(), in.getFilePointer());
+  }
+
+  EXPECT_EQ(data, content);
+  EXPECT_FALSE(in.eof());
+
+  unsigned char byte;
+  EXPECT_EQ(0u, in.read(&byte, 1));
+  EXPECT_TRUE(in.eof());
+}
+
+TEST_P(MmReadBufferIo, SeekingWhileReadingAhead) {
+  auto data  = make_data(100000);
+  auto chunk = std::string{};
+
+  mm_read_buffer_io_c in{new slow_mem_io_c{data, std::chrono::microseconds{0}}, 1000};
+
+  for (auto position = 0u; position < 90000; position += 7919) {
+    in.setFilePointer(position);
+
+    // Long enough for several refills and starting the thread.
+    EXPECT_EQ(5000u, in.read(chunk, 5000));
+    EXPECT_EQ(data.substr(position, 5000), chunk);
+    EXPECT_EQ(position + 5000, in.getFilePointer());
+
+    // Seeking backwards within the current buffer keeps reading ahead.
+    in.setFilePointer(-10, seek_current);
+    EXPECT_EQ(20u, in.read(chunk, 20));
+    EXPECT_EQ(data.substr(position + 4990, 20), chunk);
+  }
+
+  in.setFilePointer(-3000, seek_end);
+  EXPECT_EQ(3000u, in.read(chunk, 5000));
+  EXPECT_EQ(data.substr(data.size() - 3000), chunk);
+  EXPECT_TRUE(in.eof());
+
+  in.setFilePointer(500);
+  EXPECT_EQ(10u, in.read(chunk, 10));
+  EXPECT_EQ(data.substr(500, 10), chunk);
+}
+
+INSTANTIATE_TEST_CASE_P(ReadAheadBuffers, MmReadBufferIo, ::testing::Values(0u, 1u, 4u));
+
+// Benchmark reading from storage with 2 ms latency per request and
+// 1 ms of processing per 128 KB block. Run with
+// --gtest_also_run_disabled_tests.
+class MmReadBufferIoBenchmark: public ::testing::TestWithParam<unsigned int> {
+};
+
+TEST_P(MmReadBufferIoBenchmark, DISABLED_SlowStorage) {
+  auto const block_size = 128 * 1024u;
+  auto data             = make_data(32 * 1024 * 1024);
+  auto chunk            = std::string{};
+
+  mm_read_buffer_io_c::set_read_ahead_buffers(GetParam());
+
+  auto start = std::chrono::steady_clock::now();
+
+  {
+    mm_read_buffer_io_c in{new slow_mem_io_c{data, std::chrono::microseconds{2000}}, block_size};
+
+    while (in.read(chunk, block_size))
+      std::this_thread::sleep_for(std::chrono::microseconds{1000});
+  }
+
+  auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  mm_read_buffer_io_c::set_read_ahead_buffers(0);
+
+  std::cout << boost::format("[ BENCH    ] %1% read ahead buffers: %|2$.2f|s\n") % GetParam() % duration;
+}
+
+INSTANTIATE_TEST_CASE_P(ReadAheadBuffers, MmReadBufferIoBenchmark, ::testing::Values(0u, 1u, 4u));
+
+}
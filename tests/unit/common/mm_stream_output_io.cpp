@@ -0,0 +1,93 @@
+#include "common/common_pch.h"
+
+#include "common/mm_io_x.h"
+#include "common/mm_stream_output_io.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// Records everything written to it, similar to a pipe.
+class recording_io_c: public mm_mem_io_c {
+public:
+  std::string m_written;
+
+  recording_io_c()
+    : mm_mem_io_c{nullptr, 0, 1024}
+  {
+  }
+
+protected:
+  virtual size_t _write(const void *buffer, size_t size) {
+    m_written.append(static_cast<char const *>(buffer), size);
+    return size;
+  }
+};
+
+TEST(MmStreamOutputIo, HeadCanBeOverwritten) {
+  auto out = std::make_shared<recording_io_c>();
+  mm_stream_output_io_c stream{out, "test", 1024};
+
+  stream.write(std::string(100, 'a'));
+  stream.setFilePointer(10);
+  stream.write(std::string("bcd"));
+  stream.setFilePointer(0, seek_end);
+  stream.write(std::string(10, 'e'));
+
+  EXPECT_TRUE(out->m_written.empty());
+  EXPECT_EQ(110, stream.get_size());
+  EXPECT_TRUE(stream.can_overwrite(0));
+
+  stream.close();
+
+  EXPECT_EQ(std::string(10, 'a') + "bcd" + std::string(87, 'a') + std::string(10, 'e'), out->m_written);
+}
+
+TEST(MmStreamOutputIo, PassesOnDataBeyondTheHead) {
+  auto out = std::make_shared<recording_io_c>();
+  mm_stream_output_io_c stream{out, "test", 1024};
+  auto data = std::string{};
+
+  for (auto idx = 0u; idx < 4 * 1024; ++idx) {
+    auto chunk = std::string(1024, 'a' + idx % 26);
+    data      += chunk;
+    stream.write(chunk);
+  }
+
+  EXPECT_FALSE(out->m_written.empty());
+  EXPECT_FALSE(stream.can_overwrite(0));
+  EXPECT_THROW(stream.setFilePointer(0), mtx::mm_io::seek_x);
+  EXPECT_EQ(data.substr(0, out->m_written.size()), out->m_written);
+
+  // The most recent data can still be read and overwritten.
+  auto position = stream.get_size() - 2048;
+  ASSERT_TRUE(stream.can_overwrite(position));
+
+  stream.setFilePointer(position);
+  auto buffer = std::string(4, '\0');
+  EXPECT_EQ(4u, stream.read(&buffer[0], 4));
+  EXPECT_EQ(data.substr(position, 4), buffer);
+
+  stream.setFilePointer(position);
+  stream.write(std::string("wxyz"));
+  data.replace(position, 4, "wxyz");
+
+  stream.close();
+
+  EXPECT_EQ(data, out->m_written);
+}
+
+TEST(MmStreamOutputIo, ReleaseHead) {
+  auto out = std::make_shared<recording_io_c>();
+  mm_stream_output_io_c stream{out, "test"};
+
+  stream.write(std::string(3 * 1024 * 1024, 'a'));
+  EXPECT_TRUE(out->m_written.empty());
+
+  stream.release_head();
+  EXPECT_EQ(2u * 1024 * 1024, out->m_written.size());
+  EXPECT_FALSE(stream.can_overwrite(0));
+  EXPECT_TRUE(stream.can_overwrite(2 * 1024 * 1024));
+}
+
+}
@@ -0,0 +1,73 @@
+#include "common/common_pch.h"
+
+#include "common/mm_io_x.h"
+#include "common/mm_write_buffer_io.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// Writes data in chunks of varying sizes, overwrites parts of it
+// after seeking back (like rendering the headers again does) and
+// reads some of it back.
+std::string
+write_and_rewrite(unsigned int num_buffers) {
+  auto mem_io   = new mm_mem_io_c(nullptr, 0, 1000);
+  auto out      = std::make_shared<mm_write_buffer_io_c>(mem_io, 100, false, num_buffers);
+  auto data     = std::string{};
+  auto read_buf = std::string{};
+
+  for (auto idx = 0; idx < 100; ++idx)
+    data += (boost::format("%1%:%2%;") % idx % std::string(idx % 17, 'a' + idx % 26)).str();
+
+  for (auto offset = 0u, size = 1u; offset < data.size(); offset += size, size = size * 3 % 251)
+    out->write(data.substr(offset, size));
+
+  EXPECT_EQ(data.size(), out->getFilePointer());
+
+  out->setFilePointer(10);
+  out->write(std::string{"rerendered"});
+  EXPECT_EQ(20u, out->getFilePointer());
+
+  out->setFilePointer(-5, seek_end);
+  EXPECT_EQ(data.size() - 5, out->getFilePointer());
+  out->write(std::string{"final"});
+
+  out->setFilePointer(0);
+  EXPECT_EQ(25u, out->read(read_buf, 25));
+  EXPECT_EQ(25u, out->getFilePointer());
+
+  out->write(std::string(250, 'x'));
+  EXPECT_EQ(275u, out->getFilePointer());
+
+  out->close();
+
+  auto result = std::string{reinterpret_cast<char *>(mem_io->get_buffer()), static_cast<std::string::size_type>(mem_io->get_size())};
+  delete mem_io;
+
+  return read_buf + result;
+}
+
+TEST(MmWriteBufferIo, WriteBehindProducesSameContent) {
+  auto expected = write_and_rewrite(1);
+
+  EXPECT_NE(std::string::npos, expected.find("rerendered"));
+  EXPECT_EQ(expected, write_and_rewrite(2));
+  EXPECT_EQ(expected, write_and_rewrite(4));
+}
+
+TEST(MmWriteBufferIo, WriteErrorsAreReported) {
+  unsigned char const mem[10] = { 0 };
+  auto mem_io = std::make_shared<mm_mem_io_c>(mem, sizeof(mem));
+  auto out    = std::make_shared<mm_write_buffer_io_c>(mem_io.get(), 100, false, 3);
+
+  // Writing to read-only memory fails. The error is reported once the
+  // output waits for the writer thread.
+  EXPECT_NO_THROW(out->write(std::string(150, 'x')));
+  EXPECT_THROW(out->flush(), mtx::mm_io::exception);
+
+  out->discard_buffer();
+  EXPECT_NO_THROW(out->close());
+}
+
+}
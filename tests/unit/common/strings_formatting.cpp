@@ -21,6 +21,14 @@ TEST(StringsFormatting, FileSize) {
   EXPECT_EQ(   "2.0 GiB", format_file_size(2147483648ll));
 }
 
+TEST(StringsFormatting, FormatJsonString) {
+  EXPECT_EQ("\"\"",                      format_json_string(""));
+  EXPECT_EQ("\"Hello\"",                 format_json_string("Hello"));
+  EXPECT_EQ("\"a\\\"b\\\\c\"",           format_json_string("a\"b\\c"));
+  EXPECT_EQ("\"1\\n2\\r3\\t4\\u0001\"",  format_json_string("1\n2\r3\t4\x01"));
+  EXPECT_EQ("\"f\xc3\xbc\xc3\x9f\"",     format_json_string("f\xc3\xbc\xc3\x9f"));
+}
+
 TEST(StringsFormatting, FormatTimecodeWithPrecision) {
   auto value = 567891234ll + 1000000000ll * (34 + 2 * 60 + 1 * 3600);
 
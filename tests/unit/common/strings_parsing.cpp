@@ -0,0 +1,55 @@
+#include "common/common_pch.h"
+
+#include <thread>
+
+#include "common/strings/parsing.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(StringsParsing, FloatingPointNumbers) {
+  auto value = 0.0;
+
+  EXPECT_TRUE(parse_number("1.5", value));
+  EXPECT_EQ(1.5, value);
+
+  EXPECT_TRUE(parse_number(std::string{"-23.25"}, value));
+  EXPECT_EQ(-23.25, value);
+
+  EXPECT_TRUE(parse_number("1e3", value));
+  EXPECT_EQ(1000.0, value);
+
+  value = 42.0;
+  EXPECT_FALSE(parse_number("", value));
+  EXPECT_FALSE(parse_number("1,5", value));
+  EXPECT_FALSE(parse_number(" 1.5", value));
+  EXPECT_FALSE(parse_number("1.5 ", value));
+  EXPECT_FALSE(parse_number("1.5x", value));
+  EXPECT_EQ(42.0, value);
+
+  auto float_value = 0.0f;
+  EXPECT_TRUE(parse_number("0.25", float_value));
+  EXPECT_EQ(0.25f, float_value);
+}
+
+TEST(StringsParsing, FloatingPointNumbersOnSeveralThreads) {
+  std::atomic<int> failures{0};
+  auto threads = std::vector<std::thread>{};
+
+  for (auto idx = 0; idx < 4; ++idx)
+    threads.emplace_back([&failures]() {
+      for (auto run = 0; run < 10000; ++run) {
+        auto value = 0.0;
+        if (!parse_number("3.75", value) || (3.75 != value))
+          ++failures;
+      }
+    });
+
+  for (auto &thread : threads)
+    thread.join();
+
+  EXPECT_EQ(0, failures);
+}
+
+}
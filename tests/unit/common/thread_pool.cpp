@@ -0,0 +1,122 @@
+#include "common/common_pch.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+#include "common/compression.h"
+#include "common/thread_pool.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+memory_cptr
+make_frame(size_t size,
+           unsigned int seed) {
+  auto frame = memory_c::alloc(size);
+  for (auto idx = 0u; idx < size; ++idx)
+    frame->get_buffer()[idx] = (idx * seed + idx / 97) % 23;
+  return frame;
+}
+
+TEST(ThreadPool, ResultsInSubmissionOrder) {
+  mtx::thread_pool_c pool{4};
+
+  EXPECT_EQ(4u, pool.get_num_threads());
+
+  auto results = std::vector<std::future<unsigned int>>{};
+  for (auto idx = 0u; idx < 200; ++idx)
+    results.push_back(pool.submit([idx]() { return idx * idx; }));
+
+  for (auto idx = 0u; idx < 200; ++idx)
+    EXPECT_EQ(idx * idx, results[idx].get());
+}
+
+TEST(ThreadPool, Exceptions) {
+  mtx::thread_pool_c pool{2};
+
+  auto result = pool.submit([]() -> int { throw mtx::compression_x{"failed"}; });
+
+  EXPECT_THROW(result.get(), mtx::compression_x);
+  EXPECT_EQ(42, pool.submit([]() { return 42; }).get());
+}
+
+TEST(ThreadPool, RunsQueuedJobsBeforeDestruction) {
+  std::atomic<unsigned int> num_run{0};
+
+  {
+    mtx::thread_pool_c pool{1};
+    for (auto idx = 0u; idx < 50; ++idx)
+      pool.submit([&num_run]() { ++num_run; });
+  }
+
+  EXPECT_EQ(50u, num_run.load());
+}
+
+TEST(ThreadPool, ZlibCompression) {
+  auto compressor = compressor_c::create(COMPRESSION_ZLIB);
+  mtx::thread_pool_c pool{3};
+
+  ASSERT_TRUE(compressor->is_thread_safe());
+  EXPECT_FALSE(compressor_c::create(COMPRESSION_MPEG4_P2)->is_thread_safe());
+
+  auto frames  = std::vector<memory_cptr>{};
+  auto results = std::vector<std::future<memory_cptr>>{};
+
+  for (auto idx = 0u; idx < 30; ++idx) {
+    frames.push_back(make_frame(10000 + idx * 100, idx + 1));
+    auto frame = frames.back();
+    results.push_back(pool.submit([compressor, frame]() { return compressor->compress(frame); }));
+  }
+
+  for (auto idx = 0u; idx < frames.size(); ++idx) {
+    auto compressed = results[idx].get();
+    EXPECT_TRUE(*compressed == *compressor->compress(frames[idx]));
+    EXPECT_TRUE(*frames[idx] == *compressor->decompress(compressed));
+  }
+}
+
+// Benchmark compressing 100 KB frames with zlib inline and on four
+// threads. Run with --gtest_also_run_disabled_tests.
+class ThreadPoolBenchmark: public ::testing::TestWithParam<unsigned int> {
+};
+
+TEST_P(ThreadPoolBenchmark, DISABLED_ZlibFrames) {
+  auto const num_frames = 500u;
+  auto num_threads      = GetParam();
+  auto compressor       = compressor_c::create(COMPRESSION_ZLIB);
+  auto frame            = make_frame(100 * 1024, 7);
+  auto total_size       = uint64_t{};
+
+  auto start = std::chrono::steady_clock::now();
+
+  if (!num_threads) {
+    for (auto idx = 0u; idx < num_frames; ++idx)
+      total_size += compressor->compress(frame)->get_size();
+
+  } else {
+    mtx::thread_pool_c pool{num_threads};
+    auto results = std::deque<std::future<memory_cptr>>{};
+
+    // Keep a window of frames in flight like the packetizers do.
+    for (auto idx = 0u; idx < num_frames; ++idx) {
+      results.push_back(pool.submit([compressor, frame]() { return compressor->compress(frame); }));
+      if (results.size() >= 2 * num_threads) {
+        total_size += results.front().get()->get_size();
+        results.pop_front();
+      }
+    }
+
+    for (auto &result : results)
+      total_size += result.get()->get_size();
+  }
+
+  auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << boost::format("[ BENCH    ] %1% threads: %|2$.0f| frames/s (%3% bytes)\n") % num_threads % (num_frames / duration) % total_size;
+}
+
+INSTANTIATE_TEST_CASE_P(Threads, ThreadPoolBenchmark, ::testing::Values(0u, 4u));
+
+}
@@ -0,0 +1,69 @@
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+#include "common/tracing.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+std::vector<std::string>
+write_lines() {
+  mm_mem_io_c out{nullptr, 0, 1024};
+  mtx::trace::write(out);
+
+  auto content = std::string{reinterpret_cast<char const *>(out.get_buffer()), static_cast<size_t>(out.get_size())};
+  auto lines   = std::vector<std::string>{};
+  boost::split(lines, content, boost::is_any_of("\n"));
+
+  return lines;
+}
+
+TEST(Tracing, DisabledByDefault) {
+  EXPECT_FALSE(mtx::trace::is_enabled());
+
+  { mtx::trace::span_c span{"test", "disabled"}; }
+
+  auto lines = write_lines();
+
+  ASSERT_EQ(3u, lines.size());
+  EXPECT_EQ("{\"traceEvents\":[", lines[0]);
+  EXPECT_EQ("],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_spans\":0}}", lines[1]);
+}
+
+TEST(Tracing, Spans) {
+  mtx::trace::enable("unused", 10);
+
+  auto start = mtx::trace::get_time_ns();
+  mtx::trace::add_span("reader", "read", start, start + 2500, 3);
+
+  { mtx::trace::span_c span{"muxer", "render"}; }
+
+  auto lines = write_lines();
+  mtx::trace::disable();
+
+  ASSERT_EQ(5u, lines.size());
+  EXPECT_TRUE(balg::starts_with(lines[1], "{\"name\":\"read\",\"cat\":\"reader\",\"ph\":\"X\",\"ts\":"));
+  EXPECT_TRUE(balg::ends_with(lines[1], ",\"dur\":2.500,\"pid\":1,\"tid\":1,\"args\":{\"track\":3}},"));
+  EXPECT_TRUE(balg::starts_with(lines[2], "{\"name\":\"render\",\"cat\":\"muxer\",\"ph\":\"X\","));
+  EXPECT_TRUE(balg::ends_with(lines[2], ",\"pid\":1,\"tid\":1}"));
+  EXPECT_FALSE(mtx::trace::is_enabled());
+}
+
+TEST(Tracing, RingBufferKeepsMostRecentSpans) {
+  mtx::trace::enable("unused", 2);
+
+  mtx::trace::add_span("test", "first",  0, 1000);
+  mtx::trace::add_span("test", "second", 0, 2000);
+  mtx::trace::add_span("test", "third",  0, 3000);
+
+  auto lines = write_lines();
+  mtx::trace::disable();
+
+  ASSERT_EQ(5u, lines.size());
+  EXPECT_TRUE(balg::starts_with(lines[1], "{\"name\":\"second\","));
+  EXPECT_TRUE(balg::starts_with(lines[2], "{\"name\":\"third\","));
+  EXPECT_EQ("],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_spans\":1}}", lines[3]);
+}
+
+}
@@ -0,0 +1,206 @@
+#include "common/common_pch.h"
+
+#include <chrono>
+#include <iostream>
+
+#include "merge/cluster_serializer.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+int64_t const s_scale = 1000000;
+
+memory_cptr
+frame(std::string const &content) {
+  return memory_c::clone(content);
+}
+
+memory_cptr
+frame(size_t size,
+      unsigned char value) {
+  auto buffer = memory_c::alloc(size);
+  std::memset(buffer->get_buffer(), value, size);
+  return buffer;
+}
+
+std::string
+render(cluster_serializer_c &serializer,
+       int64_t cluster_timecode,
+       size_t prefix = 0) {
+  mm_mem_io_c out{nullptr, 0, 1000};
+  out.write(std::string(prefix, '\0'));
+
+  auto size = serializer.render(out, cluster_timecode, s_scale);
+
+  EXPECT_EQ(prefix + size, out.getFilePointer());
+
+  auto buffer = out.get_and_lock_buffer();
+  return std::string{reinterpret_cast<char *>(buffer) + prefix, static_cast<size_t>(size)};
+}
+
+std::string
+bytes(std::initializer_list<unsigned int> values) {
+  auto result = std::string{};
+  for (auto value : values)
+    result += static_cast<char>(value);
+  return result;
+}
+
+TEST(ClusterSerializer, SimpleBlock) {
+  cluster_serializer_c serializer;
+
+  auto idx = serializer.add_block(1, true, LACING_AUTO);
+  EXPECT_TRUE(serializer.add_frame(idx, frame("abc"), 1040 * s_scale, -1, -1));
+
+  auto expected = bytes({ 0x1f, 0x43, 0xb6, 0x75, 0x8d,
+                          0xe7, 0x82, 0x03, 0xe8,
+                          0xa3, 0x87, 0x81, 0x00, 0x28, 0x80 }) + "abc";
+
+  EXPECT_EQ(expected, render(serializer, 1000 * s_scale));
+  EXPECT_EQ(5u, serializer.get_head_size());
+}
+
+TEST(ClusterSerializer, SimpleBlockFlags) {
+  cluster_serializer_c serializer;
+
+  // B frame: discardable, not a key frame
+  serializer.add_frame(serializer.add_block(200, true, LACING_AUTO), frame("b"), 40 * s_scale, 0, 80 * s_scale);
+  // P frame: neither
+  serializer.add_frame(serializer.add_block(200, true, LACING_AUTO), frame("p"), 80 * s_scale, 0, -1);
+
+  auto expected = bytes({ 0x1f, 0x43, 0xb6, 0x75, 0x93,
+                          0xe7, 0x81, 0x00,
+                          0xa3, 0x86, 0x40, 0xc8, 0x00, 0x28, 0x01, 'b',
+                          0xa3, 0x86, 0x40, 0xc8, 0x00, 0x50, 0x00, 'p' });
+
+  EXPECT_EQ(expected, render(serializer, 0));
+}
+
+TEST(ClusterSerializer, BlockGroup) {
+  cluster_serializer_c serializer;
+
+  auto idx = serializer.add_block(2, false, LACING_AUTO);
+  EXPECT_TRUE(serializer.add_frame(idx, frame("xy"), 80 * s_scale, 40 * s_scale, -1));
+  serializer.set_block_duration(idx, 40 * s_scale);
+
+  auto expected = bytes({ 0x1f, 0x43, 0xb6, 0x75, 0x93,
+                          0xe7, 0x81, 0x00,
+                          0xa0, 0x8e,
+                          0xa1, 0x86, 0x82, 0x00, 0x50, 0x00, 'x', 'y',
+                          0xfb, 0x81, 0xd8,
+                          0x9b, 0x81, 0x28 });
+
+  EXPECT_EQ(expected, render(serializer, 0));
+}
+
+TEST(ClusterSerializer, NoDurationForSimpleBlocks) {
+  cluster_serializer_c serializer;
+
+  auto idx = serializer.add_block(1, true, LACING_AUTO);
+  serializer.add_frame(idx, frame("a"), 0, -1, -1);
+  serializer.set_block_duration(idx, 40 * s_scale);
+
+  EXPECT_EQ(-1, serializer.get_blocks()[0].m_duration);
+}
+
+TEST(ClusterSerializer, Lacing) {
+  cluster_serializer_c serializer;
+
+  auto fixed = serializer.add_block(1, true, LACING_AUTO);
+  auto xiph  = serializer.add_block(2, true, LACING_AUTO);
+  auto ebml  = serializer.add_block(3, true, LACING_AUTO);
+
+  // Interleaved the way the cluster helper adds frames of several tracks.
+  for (auto idx = 0; idx < 3; ++idx) {
+    serializer.add_frame(fixed, frame(3, 'f'),                                        0, -1, -1);
+    serializer.add_frame(xiph,  frame(std::vector<size_t>{ 10, 200, 50 }[idx], 'x'), 0, -1, -1);
+    serializer.add_frame(ebml,  frame(std::vector<size_t>{ 1000, 1010, 5 }[idx], 'e'), 0, -1, -1);
+  }
+
+  auto data = render(serializer, 0);
+
+  // Cluster head, cluster timecode
+  auto pos = 4u + 2u + 3u;
+
+  // Fixed lacing: same sizes
+  EXPECT_EQ(bytes({ 0xa3, 0x8e, 0x81, 0x00, 0x00, 0x84, 0x02 }) + std::string(9, 'f'), data.substr(pos, 16));
+  pos += 16;
+
+  // Xiph lacing: 3 bytes of lacing head vs 4 for EBML lacing
+  EXPECT_EQ(bytes({ 0xa3, 0x41, 0x0b, 0x82, 0x00, 0x00, 0x82, 0x02, 10, 200 }), data.substr(pos, 10));
+  pos += 10 + 260;
+
+  // EBML lacing: 4 bytes of lacing head vs 9 for Xiph lacing
+  EXPECT_EQ(bytes({ 0xa3, 0x47, 0xe7, 0x83, 0x00, 0x00, 0x86, 0x02, 0x43, 0xe8, 0xc9 }), data.substr(pos, 11));
+  pos += 11 + 2015;
+
+  EXPECT_EQ(data.size(), pos);
+}
+
+TEST(ClusterSerializer, AddFrameResult) {
+  cluster_serializer_c serializer;
+
+  auto idx = serializer.add_block(1, true, LACING_AUTO);
+  for (auto num = 1u; num < cluster_serializer_c::s_max_frames_per_block; ++num)
+    EXPECT_TRUE(serializer.add_frame(idx, frame("a"), 0, -1, -1));
+  EXPECT_FALSE(serializer.add_frame(idx, frame("a"), 0, -1, -1));
+
+  EXPECT_FALSE(serializer.add_frame(serializer.add_block(1, true, LACING_AUTO), frame(6 * 0xff, 'a'), 0, -1, -1));
+  EXPECT_FALSE(serializer.add_frame(serializer.add_block(1, true, LACING_NONE), frame("a"),            0, -1, -1));
+}
+
+TEST(ClusterSerializer, Positions) {
+  cluster_serializer_c serializer;
+
+  serializer.add_frame(serializer.add_block(1, true,  LACING_AUTO), frame(1000, 'a'), 0,            -1, -1);
+  serializer.add_frame(serializer.add_block(2, false, LACING_AUTO), frame(10,   'b'), 0,            -1, -1);
+  serializer.add_frame(serializer.add_block(1, true,  LACING_AUTO), frame(20,   'c'), 40 * s_scale, -1, -1);
+
+  auto data = render(serializer, 0, 123);
+
+  auto &blocks = serializer.get_blocks();
+  ASSERT_EQ(3u, blocks.size());
+
+  EXPECT_EQ(123u + 4 + 2 + 3,                      blocks[0].m_position);
+  EXPECT_EQ(blocks[0].m_position + 1 + 2 + 1004,   blocks[1].m_position);
+  EXPECT_EQ(blocks[1].m_position + 2 + 1 + 1 + 14, blocks[2].m_position);
+
+  EXPECT_EQ(static_cast<char>(0xa3), data[blocks[0].m_position - 123]);
+  EXPECT_EQ(static_cast<char>(0xa0), data[blocks[1].m_position - 123]);
+  EXPECT_EQ(static_cast<char>(0xa3), data[blocks[2].m_position - 123]);
+
+  serializer.clear();
+  EXPECT_TRUE(serializer.empty());
+}
+
+// Benchmark serializing clusters of many small blocks. Run with
+// --gtest_also_run_disabled_tests.
+TEST(ClusterSerializer, DISABLED_SmallFrames) {
+  auto const num_clusters = 2000u;
+  auto const num_blocks   = 500u;
+  auto payload            = frame(100, 'a');
+  auto total_size         = uint64_t{};
+  cluster_serializer_c serializer;
+  mm_mem_io_c out{nullptr, 0, 1 << 20};
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (auto cluster = 0u; cluster < num_clusters; ++cluster) {
+    for (auto block = 0u; block < num_blocks; ++block)
+      serializer.add_frame(serializer.add_block(1 + block % 2, true, LACING_NONE), payload, block * s_scale, -1, -1);
+
+    out.setFilePointer(0);
+    total_size += serializer.render(out, 0, s_scale);
+    serializer.clear();
+  }
+
+  auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << boost::format("[ BENCH    ] %1% blocks: %|2$.0f| blocks/s, %|3$.0f| MB/s\n")
+    % (num_clusters * num_blocks)
+    % (num_clusters * num_blocks / duration)
+    % (total_size / duration / 1024 / 1024);
+}
+
+}
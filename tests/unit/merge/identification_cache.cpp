@@ -0,0 +1,82 @@
+#include "common/common_pch.h"
+
+#include <fstream>
+
+#include "merge/identification_cache.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+class IdentificationCache: public ::testing::Test {
+protected:
+  bfs::path m_directory;
+  std::string m_file_name;
+
+  virtual void SetUp() {
+    m_directory = bfs::temp_directory_path() / bfs::unique_path("mtx-identification-cache-%%%%-%%%%-%%%%");
+    m_file_name = (bfs::temp_directory_path() / bfs::unique_path("mtx-identification-file-%%%%-%%%%-%%%%")).string();
+    bfs::create_directories(m_directory);
+    create_file("content");
+  }
+
+  virtual void TearDown() {
+    boost::system::error_code ec;
+    bfs::remove_all(m_directory, ec);
+    bfs::remove(m_file_name, ec);
+  }
+
+  void create_file(std::string const &content) {
+    std::ofstream out{m_file_name, std::ios::binary};
+    out.write(content.c_str(), content.size());
+  }
+};
+
+TEST_F(IdentificationCache, RoundTrip) {
+  identification_cache_c cache{m_directory, "variant"};
+
+  EXPECT_FALSE(!!cache.get(m_file_name));
+
+  cache.put(m_file_name, { "File 'x': container: Matroska\nTrack ID 0: video\n", 3 });
+
+  auto result = cache.get(m_file_name);
+  ASSERT_TRUE(!!result);
+  EXPECT_EQ("File 'x': container: Matroska\nTrack ID 0: video\n", result->output);
+  EXPECT_EQ(3, result->exit_code);
+}
+
+TEST_F(IdentificationCache, Invalidation) {
+  identification_cache_c cache{m_directory, "variant"};
+  cache.put(m_file_name, { "output\n", 0 });
+
+  EXPECT_FALSE(!!identification_cache_c(m_directory, "other variant").get(m_file_name));
+
+  create_file("changed content");
+  EXPECT_FALSE(!!cache.get(m_file_name));
+
+  EXPECT_FALSE(!!cache.get((m_directory / "does-not-exist").string()));
+}
+
+TEST_F(IdentificationCache, OtherNameForTheSameFile) {
+  identification_cache_c cache{m_directory, "variant"};
+  cache.put(m_file_name, { "File '" + m_file_name + "': container: Matroska\n", 0 });
+
+  // The output contains the name as given.
+  auto path = bfs::path{m_file_name};
+  EXPECT_FALSE(!!cache.get((path.parent_path() / "." / path.filename()).string()));
+  EXPECT_TRUE(!!cache.get(m_file_name));
+}
+
+TEST_F(IdentificationCache, InvalidationWithinTheSameSecond) {
+  identification_cache_c cache{m_directory, "variant"};
+  cache.put(m_file_name, { "output\n", 0 });
+
+  // Same size, same modification time in seconds.
+  auto modification_time = bfs::last_write_time(m_file_name);
+  create_file("CONTENT");
+  bfs::last_write_time(m_file_name, modification_time);
+
+  EXPECT_FALSE(!!cache.get(m_file_name));
+}
+
+}
@@ -0,0 +1,160 @@
+#include "common/common_pch.h"
+
+#include <chrono>
+#include <iostream>
+
+#include "merge/interleaver.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(Interleaver, OrderedByTimecode) {
+  auto interleaver = interleaver_c{};
+
+  interleaver.add_packet(0, timestamp_c::ms(40));
+  interleaver.add_packet(1, timestamp_c::ms(10));
+  interleaver.add_packet(2, timestamp_c::ms(20));
+
+  ASSERT_TRUE(interleaver.has_packet());
+  EXPECT_EQ(1u, interleaver.pop_winner());
+  EXPECT_EQ(2u, interleaver.pop_winner());
+  EXPECT_EQ(0u, interleaver.pop_winner());
+  EXPECT_FALSE(interleaver.has_packet());
+}
+
+TEST(Interleaver, TiesBrokenByIndex) {
+  auto interleaver = interleaver_c{};
+
+  interleaver.add_packet(3, timestamp_c::ms(10));
+  interleaver.add_packet(1, timestamp_c::ms(10));
+  interleaver.add_packet(2, timestamp_c::ms(10));
+  interleaver.add_packet(0, timestamp_c::ms(20));
+
+  EXPECT_EQ(1u, interleaver.pop_winner());
+  EXPECT_EQ(2u, interleaver.pop_winner());
+  EXPECT_EQ(3u, interleaver.pop_winner());
+  EXPECT_EQ(0u, interleaver.pop_winner());
+}
+
+TEST(Interleaver, PullOrder) {
+  auto interleaver = interleaver_c{};
+  auto visited     = std::vector<size_t>{};
+
+  interleaver.request_pull(4);
+  interleaver.request_pull(1);
+
+  // Requests for higher indexes are honored during the same run,
+  // requests for lower ones during the next one.
+  interleaver.pull([&](size_t idx) -> bool {
+    visited.push_back(idx);
+    if (1 == idx) {
+      interleaver.request_pull(3);
+      interleaver.request_pull(0);
+    }
+    return 4 == idx;
+  });
+
+  EXPECT_EQ((std::vector<size_t>{ 1, 3, 4 }), visited);
+
+  visited.clear();
+  interleaver.pull([&](size_t idx) -> bool {
+    visited.push_back(idx);
+    return false;
+  });
+
+  EXPECT_EQ((std::vector<size_t>{ 0, 4 }), visited);
+
+  visited.clear();
+  interleaver.pull([&](size_t idx) -> bool {
+    visited.push_back(idx);
+    return false;
+  });
+
+  EXPECT_TRUE(visited.empty());
+}
+
+TEST(Interleaver, SameOrderAsLinearScan) {
+  auto const num_tracks = 17u;
+  auto interleaver      = interleaver_c{};
+  auto next_timecodes   = std::vector<int64_t>(num_tracks);
+
+  for (auto idx = 0u; idx < num_tracks; ++idx)
+    interleaver.add_packet(idx, timestamp_c::ns(next_timecodes[idx]));
+
+  for (auto packet_num = 0; packet_num < 10000; ++packet_num) {
+    auto expected = -1;
+    for (auto idx = 0u; idx < num_tracks; ++idx)
+      if ((-1 == expected) || (next_timecodes[idx] < next_timecodes[expected]))
+        expected = idx;
+
+    auto winner = interleaver.pop_winner();
+    ASSERT_EQ(static_cast<size_t>(expected), winner);
+
+    next_timecodes[winner] += 1000000 * (winner % 5 + 1);
+    interleaver.add_packet(winner, timestamp_c::ns(next_timecodes[winner]));
+  }
+}
+
+// Benchmark comparing the interleaver with a linear scan over all
+// tracks. Run with --gtest_also_run_disabled_tests.
+class InterleaverBenchmark: public ::testing::TestWithParam<unsigned int> {
+protected:
+  static int64_t duration_for_track(unsigned int idx) {
+    return 10000000ll + (idx % 7) * 3000000ll;
+  }
+
+  static double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+};
+
+TEST_P(InterleaverBenchmark, DISABLED_LinearScanVsInterleaver) {
+  auto num_packets    = 1000000u;
+  auto num_tracks     = GetParam();
+  auto next_timecodes = std::vector<int64_t>(num_tracks);
+  auto checksum_scan  = uint64_t{};
+  auto checksum_heap  = uint64_t{};
+
+  auto start          = now();
+
+  for (auto packet_num = 0u; packet_num < num_packets; ++packet_num) {
+    auto winner = 0u;
+    for (auto idx = 1u; idx < num_tracks; ++idx)
+      if (next_timecodes[idx] < next_timecodes[winner])
+        winner = idx;
+
+    checksum_scan          += winner;
+    next_timecodes[winner] += duration_for_track(winner);
+  }
+
+  auto scan_duration = now() - start;
+  auto interleaver   = interleaver_c{};
+
+  std::fill(next_timecodes.begin(), next_timecodes.end(), 0);
+
+  start = now();
+
+  for (auto idx = 0u; idx < num_tracks; ++idx)
+    interleaver.add_packet(idx, timestamp_c::ns(0));
+
+  for (auto packet_num = 0u; packet_num < num_packets; ++packet_num) {
+    auto winner = interleaver.pop_winner();
+
+    checksum_heap          += winner;
+    next_timecodes[winner] += duration_for_track(winner);
+
+    interleaver.add_packet(winner, timestamp_c::ns(next_timecodes[winner]));
+  }
+
+  auto heap_duration = now() - start;
+
+  EXPECT_EQ(checksum_scan, checksum_heap);
+
+  std::cout << boost::format("[ BENCH    ] %|1$4d| tracks, %2% packets: linear scan %|3$.3f|s, interleaver %|4$.3f|s\n")
+    % num_tracks % num_packets % scan_duration % heap_duration;
+}
+
+INSTANTIATE_TEST_CASE_P(Tracks, InterleaverBenchmark, ::testing::Values(1u, 10u, 100u, 1000u));
+
+}
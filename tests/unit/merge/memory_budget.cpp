@@ -0,0 +1,138 @@
+#include "common/common_pch.h"
+
+#include "merge/memory_budget.h"
+#include "merge/packet.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+class MemoryBudget: public ::testing::Test {
+protected:
+  virtual void TearDown() {
+    memory_budget_c::set_limit(0);
+    memory_budget_c::cleanup();
+  }
+
+  packet_cptr create_packet(size_t size,
+                            char content) {
+    auto data = std::string(size, content);
+    auto pack = std::make_shared<packet_t>(memory_c::clone(data));
+
+    memory_budget_c::add(size);
+
+    return pack;
+  }
+};
+
+TEST_F(MemoryBudget, Limit) {
+  auto usage = memory_budget_c::get_usage();
+
+  EXPECT_FALSE(memory_budget_c::is_exceeded());
+
+  memory_budget_c::set_limit(usage + 100);
+  memory_budget_c::add(100);
+  EXPECT_FALSE(memory_budget_c::is_exceeded());
+
+  memory_budget_c::add(1);
+  EXPECT_TRUE(memory_budget_c::is_exceeded());
+
+  memory_budget_c::remove(101);
+  EXPECT_FALSE(memory_budget_c::is_exceeded());
+  EXPECT_EQ(usage, memory_budget_c::get_usage());
+}
+
+TEST_F(MemoryBudget, SpillAndUnspill) {
+  auto usage   = memory_budget_c::get_usage();
+  auto packet1 = create_packet(1000, 'a');
+  auto packet2 = create_packet(500,  'b');
+
+  memory_budget_c::spill(*packet1);
+  memory_budget_c::spill(*packet2);
+
+  EXPECT_TRUE(packet1->is_spilled());
+  EXPECT_TRUE(packet2->is_spilled());
+  EXPECT_FALSE(!!packet1->data);
+  EXPECT_EQ(usage, memory_budget_c::get_usage());
+
+  memory_budget_c::unspill(*packet2);
+  memory_budget_c::unspill(*packet1);
+
+  ASSERT_FALSE(packet1->is_spilled());
+  ASSERT_FALSE(packet2->is_spilled());
+  EXPECT_EQ(std::string(1000, 'a'), std::string(reinterpret_cast<char const *>(packet1->data->get_buffer()), packet1->data->get_size()));
+  EXPECT_EQ(std::string(500,  'b'), std::string(reinterpret_cast<char const *>(packet2->data->get_buffer()), packet2->data->get_size()));
+  EXPECT_EQ(usage + 1500, memory_budget_c::get_usage());
+
+  memory_budget_c::discard(*packet1);
+  memory_budget_c::discard(*packet2);
+  EXPECT_EQ(usage, memory_budget_c::get_usage());
+}
+
+TEST_F(MemoryBudget, DiscardSpilled) {
+  auto usage   = memory_budget_c::get_usage();
+  auto packet1 = create_packet(100, 'a');
+
+  memory_budget_c::spill(*packet1);
+  memory_budget_c::discard(*packet1);
+
+  EXPECT_FALSE(packet1->is_spilled());
+  EXPECT_EQ(usage, memory_budget_c::get_usage());
+
+  // The space in the spill file is re-used.
+  auto packet2 = create_packet(10, 'b');
+  memory_budget_c::spill(*packet2);
+  EXPECT_EQ(0, packet2->spill_position);
+
+  memory_budget_c::unspill(*packet2);
+  EXPECT_EQ(std::string(10, 'b'), std::string(reinterpret_cast<char const *>(packet2->data->get_buffer()), packet2->data->get_size()));
+
+  memory_budget_c::discard(*packet2);
+}
+
+
+TEST_F(MemoryBudget, ReuseFreedSpace) {
+  auto packet1 = create_packet(1000, 'a');
+  auto packet2 = create_packet(500,  'b');
+  auto packet3 = create_packet(300,  'c');
+
+  memory_budget_c::spill(*packet1);
+  memory_budget_c::spill(*packet2);
+  memory_budget_c::spill(*packet3);
+
+  EXPECT_EQ(0,    packet1->spill_position);
+  EXPECT_EQ(1000, packet2->spill_position);
+  EXPECT_EQ(1500, packet3->spill_position);
+
+  // Packets are spilled into the first gap that's large enough.
+  memory_budget_c::unspill(*packet2);
+
+  auto packet4 = create_packet(400, 'd');
+  memory_budget_c::spill(*packet4);
+  EXPECT_EQ(1000, packet4->spill_position);
+
+  // Adjacent gaps are merged.
+  memory_budget_c::unspill(*packet1);
+  memory_budget_c::unspill(*packet4);
+
+  auto packet5 = create_packet(1500, 'e');
+  memory_budget_c::spill(*packet5);
+  EXPECT_EQ(0, packet5->spill_position);
+
+  // Space at the end is given up.
+  memory_budget_c::unspill(*packet3);
+
+  auto packet6 = create_packet(600, 'f');
+  memory_budget_c::spill(*packet6);
+  EXPECT_EQ(1500, packet6->spill_position);
+
+  memory_budget_c::unspill(*packet5);
+  memory_budget_c::unspill(*packet6);
+  EXPECT_EQ(std::string(1500, 'e'), std::string(reinterpret_cast<char const *>(packet5->data->get_buffer()), packet5->data->get_size()));
+  EXPECT_EQ(std::string(600,  'f'), std::string(reinterpret_cast<char const *>(packet6->data->get_buffer()), packet6->data->get_size()));
+
+  for (auto const &packet : { packet1, packet2, packet3, packet4, packet5, packet6 })
+    memory_budget_c::discard(*packet);
+}
+
+}
@@ -0,0 +1,154 @@
+#include "common/common_pch.h"
+
+#include <chrono>
+#include <iostream>
+
+#include "merge/packed_cue_points.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+cue_point_t
+point(uint64_t timecode,
+      uint32_t track_num,
+      uint64_t cluster_position,
+      uint32_t relative_position    = 0,
+      uint64_t duration             = 0,
+      uint64_t codec_state_position = 0) {
+  return { timecode, duration, cluster_position, codec_state_position, track_num, relative_position };
+}
+
+std::vector<cue_point_t>
+sorted(packed_cue_points_c const &points) {
+  auto result = std::vector<cue_point_t>{};
+  points.for_each_sorted([&result](cue_point_t const &p) { result.push_back(p); });
+  return result;
+}
+
+void
+expect_eq(cue_point_t const &expected,
+          cue_point_t const &actual) {
+  EXPECT_EQ(expected.timecode,             actual.timecode);
+  EXPECT_EQ(expected.track_num,            actual.track_num);
+  EXPECT_EQ(expected.cluster_position,     actual.cluster_position);
+  EXPECT_EQ(expected.relative_position,    actual.relative_position);
+  EXPECT_EQ(expected.duration,             actual.duration);
+  EXPECT_EQ(expected.codec_state_position, actual.codec_state_position);
+}
+
+TEST(PackedCuePoints, RoundTrip) {
+  auto input = std::vector<cue_point_t>{
+    point(0,                  1, 4000,          12, 0,          0),
+    point(40000000,           2, 4000,          300000),
+    point(1000000000000000ull, 1, 1ull << 40,   7,  5000000000, 1ull << 35),
+    point(80000000,           1, 900000,        0,  40000000),
+  };
+  auto expected = std::vector<cue_point_t>{ input[0], input[1], input[3], input[2] };
+
+  packed_cue_points_c points;
+  points.add(input);
+
+  EXPECT_EQ(4u, points.size());
+  EXPECT_FALSE(points.empty());
+
+  auto output = sorted(points);
+  ASSERT_EQ(expected.size(), output.size());
+  for (auto idx = 0u; idx < expected.size(); ++idx)
+    expect_eq(expected[idx], output[idx]);
+
+  points.clear();
+  EXPECT_TRUE(points.empty());
+  EXPECT_TRUE(sorted(points).empty());
+}
+
+TEST(PackedCuePoints, MergesRuns) {
+  packed_cue_points_c points;
+
+  // Subtitle cues added after the video cues of later clusters.
+  auto run1 = std::vector<cue_point_t>{ point(0, 1, 100), point(2000, 1, 200), point(4000, 1, 300) };
+  auto run2 = std::vector<cue_point_t>{ point(1000, 3, 150), point(2000, 2, 200), point(6000, 1, 400) };
+  auto run3 = std::vector<cue_point_t>{ point(2000, 1, 999), point(3000, 2, 250) };
+
+  points.add(run1);
+  points.add(run2);
+  points.add(run3);
+
+  auto output = sorted(points);
+  auto tracks = std::vector<std::pair<uint64_t, uint32_t>>{};
+  for (auto const &p : output)
+    tracks.emplace_back(p.timecode, p.track_num);
+
+  auto expected = std::vector<std::pair<uint64_t, uint32_t>>{ {0, 1}, {1000, 3}, {2000, 1}, {2000, 1}, {2000, 2}, {3000, 2}, {4000, 1}, {6000, 1} };
+  EXPECT_EQ(expected, tracks);
+
+  // Equal points keep the order they were added in.
+  EXPECT_EQ(200u, output[2].cluster_position);
+  EXPECT_EQ(999u, output[3].cluster_position);
+
+  auto num_points = 0u;
+  points.for_each([&num_points](cue_point_t const &) { ++num_points; });
+  EXPECT_EQ(8u, num_points);
+}
+
+TEST(PackedCuePoints, AdjustPositions) {
+  packed_cue_points_c points;
+
+  auto run = std::vector<cue_point_t>{ point(0, 1, 100, 0, 0, 50), point(1, 1, 500, 0, 0, 600), point(2, 1, 1000) };
+  points.add(run);
+  points.adjust_positions(500, 4096);
+
+  auto output = sorted(points);
+  ASSERT_EQ(3u, output.size());
+
+  EXPECT_EQ(100u,         output[0].cluster_position);
+  EXPECT_EQ(50u,          output[0].codec_state_position);
+  EXPECT_EQ(500u + 4096,  output[1].cluster_position);
+  EXPECT_EQ(600u + 4096,  output[1].codec_state_position);
+  EXPECT_EQ(1000u + 4096, output[2].cluster_position);
+  EXPECT_EQ(0u,           output[2].codec_state_position);
+}
+
+// Benchmark storing cues for every frame of a 10 hour, 60 fps video
+// track and an audio track. Run with --gtest_also_run_disabled_tests.
+TEST(PackedCuePoints, DISABLED_TenHours) {
+  auto const num_frames = 10u * 3600 * 60;
+  auto position         = uint64_t{4000};
+  auto points           = std::vector<cue_point_t>{};
+  packed_cue_points_c packed;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (auto frame = 0u; frame < num_frames; ++frame) {
+    auto timecode = frame * 1000000000ull / 60;
+    if (!(frame % 60))
+      position += 1500000;
+
+    points.push_back(point(timecode, 1, position, 10 + (frame % 60) * 25000));
+    points.push_back(point(timecode, 2, position, 20 + (frame % 60) * 25000 + 20000));
+
+    if (points.size() >= 4096) {
+      packed.add(points);
+      points.clear();
+    }
+  }
+
+  packed.add(points);
+
+  auto packed_at = std::chrono::steady_clock::now();
+  auto checksum  = uint64_t{};
+
+  packed.for_each_sorted([&checksum](cue_point_t const &p) { checksum += p.relative_position; });
+
+  auto end = std::chrono::steady_clock::now();
+
+  std::cout << boost::format("[ BENCH    ] %1% points: %2% bytes packed vs. %3% unpacked; packing %|4$.2f|s, sorted iteration %|5$.2f|s (checksum %6%)\n")
+    % packed.size()
+    % packed.get_memory_usage()
+    % (packed.size() * sizeof(cue_point_t))
+    % std::chrono::duration<double>(packed_at - start).count()
+    % std::chrono::duration<double>(end - packed_at).count()
+    % checksum;
+}
+
+}
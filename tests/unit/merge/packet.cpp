@@ -0,0 +1,53 @@
+#include "common/common_pch.h"
+
+#include <chrono>
+#include <iostream>
+
+#include "common/memory_pool.h"
+#include "merge/packet.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// Benchmark for creating and releasing packets the way small-frame
+// audio packetizers do. Run with --gtest_also_run_disabled_tests.
+class PacketAllocationBenchmark: public ::testing::TestWithParam<bool> {
+};
+
+TEST_P(PacketAllocationBenchmark, DISABLED_PacketsPerSecond) {
+  auto const num_packets = 5000000u;
+  auto const window_size = 64u;
+  auto pooling           = GetParam();
+  unsigned char frame[1536];
+  std::deque<packet_cptr> queued;
+
+  memset(frame, 0, sizeof(frame));
+  mtx::mem::set_pooling_enabled(pooling);
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (auto packet_num = 0u; packet_num < num_packets; ++packet_num) {
+    // Roughly what ac3_packetizer_c & co. do: clone the frame, create
+    // a packet and keep a couple of them around until they're
+    // rendered.
+    auto packet = packet_cptr(new packet_t(memory_c::clone(frame, 256 + (packet_num % 5) * 256), packet_num * 32000000ll, 32000000ll));
+    queued.push_back(packet);
+
+    if (queued.size() > window_size)
+      queued.pop_front();
+  }
+
+  queued.clear();
+
+  auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  mtx::mem::set_pooling_enabled(true);
+
+  std::cout << boost::format("[ BENCH    ] pooling %1%: %2% packets in %|3$.3f|s = %|4$.0f| packets/s\n")
+    % (pooling ? "enabled " : "disabled") % num_packets % duration % (num_packets / duration);
+}
+
+INSTANTIATE_TEST_CASE_P(Pooling, PacketAllocationBenchmark, ::testing::Values(false, true));
+
+}
@@ -0,0 +1,136 @@
+#include "common/common_pch.h"
+
+#if !defined(SYS_WINDOWS)
+# include <unistd.h>
+#endif
+
+#include "common/mm_io.h"
+#include "merge/progress_reporter.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+progress_status_t
+create_status(int64_t time,
+              int percentage,
+              int64_t bytes_read,
+              int64_t bytes_written,
+              int64_t num_packets) {
+  progress_status_t status;
+
+  status.time          = time;
+  status.percentage    = percentage;
+  status.bytes_read    = bytes_read;
+  status.bytes_written = bytes_written;
+  status.num_packets   = num_packets;
+
+  return status;
+}
+
+TEST(ProgressReporter, Format) {
+  auto previous = create_status(1000, 10, 1000000, 500000, 100);
+  auto status   = create_status(3000, 20, 5000000, 2500000, 300);
+
+  status.output_timestamp = timestamp_c::ms(1500);
+  status.tracks.push_back(progress_status_t::track_t{ 0, 1, 4096 });
+  status.tracks.push_back(progress_status_t::track_t{ 1, 0, 0 });
+
+  EXPECT_EQ("{\"elapsed\":3.000,\"progress\":20,\"bytes_read\":5000000,\"bytes_written\":2500000,"
+            "\"read_mb_per_second\":2.000,\"write_mb_per_second\":1.000,\"packets\":300,\"packets_per_second\":100.0,"
+            "\"output_timestamp\":\"00:00:01.500000000\",\"output_timestamp_ns\":1500000000,\"eta\":12.0,"
+            "\"tracks\":[{\"file\":0,\"track\":1,\"queued_bytes\":4096},{\"file\":1,\"track\":0,\"queued_bytes\":0}],\"done\":false}\n",
+            progress_reporter_c::format(status, previous, 0, false));
+}
+
+TEST(ProgressReporter, FormatWithoutData) {
+  auto status = create_status(0, 0, 0, 0, 0);
+
+  EXPECT_EQ("{\"elapsed\":0.000,\"progress\":0,\"bytes_read\":0,\"bytes_written\":0,"
+            "\"read_mb_per_second\":0.000,\"write_mb_per_second\":0.000,\"packets\":0,\"packets_per_second\":0.0,"
+            "\"output_timestamp\":null,\"output_timestamp_ns\":null,\"eta\":null,\"tracks\":[],\"done\":false}\n",
+            progress_reporter_c::format(status, status, 0, false));
+
+  status.percentage = 100;
+
+  EXPECT_EQ("{\"elapsed\":0.000,\"progress\":100,\"bytes_read\":0,\"bytes_written\":0,"
+            "\"read_mb_per_second\":0.000,\"write_mb_per_second\":0.000,\"packets\":0,\"packets_per_second\":0.0,"
+            "\"output_timestamp\":null,\"output_timestamp_ns\":null,\"eta\":0,\"tracks\":[],\"done\":true}\n",
+            progress_reporter_c::format(status, status, 0, true));
+}
+
+TEST(ProgressReporter, FormatWithUnknownProgress) {
+  auto previous = create_status(1000, -1, 1000000, 500000, 100);
+  auto status   = create_status(3000, -1, 5000000, 2500000, 300);
+
+  EXPECT_EQ("{\"elapsed\":3.000,\"progress\":null,\"bytes_read\":5000000,\"bytes_written\":2500000,"
+            "\"read_mb_per_second\":2.000,\"write_mb_per_second\":1.000,\"packets\":300,\"packets_per_second\":100.0,"
+            "\"output_timestamp\":null,\"output_timestamp_ns\":null,\"eta\":null,\"tracks\":[],\"done\":false}\n",
+            progress_reporter_c::format(status, previous, 0, false));
+}
+
+TEST(ProgressReporter, Interval) {
+  auto out = std::make_shared<mm_mem_io_c>(nullptr, 0, 1024);
+  progress_reporter_c reporter{out, 500};
+
+  EXPECT_TRUE(reporter.is_due(10000));
+  reporter.report(create_status(10000, 0, 0, 0, 0));
+
+  EXPECT_FALSE(reporter.is_due(10499));
+  EXPECT_TRUE(reporter.is_due(10500));
+  reporter.report(create_status(10500, 50, 0, 0, 0), true);
+
+  auto content = std::string{reinterpret_cast<char const *>(out->get_buffer()), static_cast<size_t>(out->get_size())};
+  auto lines   = std::vector<std::string>{};
+  boost::split(lines, content, boost::is_any_of("\n"));
+
+  ASSERT_EQ(3u, lines.size());
+  EXPECT_TRUE(balg::starts_with(lines[0], "{\"elapsed\":0.000,\"progress\":0,"));
+  EXPECT_TRUE(balg::starts_with(lines[1], "{\"elapsed\":0.500,\"progress\":50,"));
+  EXPECT_TRUE(balg::ends_with(lines[1], "\"done\":true}"));
+  EXPECT_EQ("", lines[2]);
+}
+
+#if !defined(SYS_WINDOWS)
+TEST(ProgressReporter, FileDescriptor) {
+  // The write end of a pipe can neither be read from nor re-opened
+  // for reading and writing.
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+
+  progress_reporter_c::create((boost::format("fd:%1%") % fds[1]).str(), 500);
+  progress_reporter_c::get()->report(create_status(0, 0, 0, 0, 0), true);
+  progress_reporter_c::destroy();
+
+  // The reporter writes to a duplicate of the descriptor.
+  ASSERT_EQ(0, close(fds[1]));
+
+  auto content = std::string{};
+  char buffer[1024];
+  ssize_t num_read;
+
+  while (0 < (num_read = ::read(fds[0], buffer, sizeof(buffer))))
+    content.append(buffer, num_read);
+
+  close(fds[0]);
+
+  EXPECT_TRUE(balg::starts_with(content, "{\"elapsed\":0.000,\"progress\":0,"));
+  EXPECT_TRUE(balg::ends_with(content, "\"done\":true}\n"));
+}
+
+TEST(ProgressReporter, FileDescriptorWithoutReader) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  ASSERT_EQ(0, close(fds[0]));
+
+  // Neither SIGPIPE nor the failing write must abort the program.
+  progress_reporter_c::create((boost::format("fd:%1%") % fds[1]).str(), 500);
+  EXPECT_NO_THROW(progress_reporter_c::get()->report(create_status(0, 0, 0, 0, 0)));
+  EXPECT_NO_THROW(progress_reporter_c::get()->report(create_status(1000, 100, 0, 0, 0), true));
+  progress_reporter_c::destroy();
+
+  close(fds[1]);
+}
+#endif
+
+}
@@ -0,0 +1,156 @@
+#include "common/common_pch.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#include "common/mm_io.h"
+#include "merge/timestamp_factory.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+class TimestampFactory: public ::testing::Test {
+protected:
+  std::string m_file_name;
+
+  virtual void SetUp() {
+    m_file_name = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("mtx-timestamps-%%%%-%%%%-%%%%")).string();
+  }
+
+  virtual void TearDown() {
+    boost::system::error_code ec;
+    boost::filesystem::remove(m_file_name, ec);
+  }
+
+  void create_file(std::string const &content) {
+    std::ofstream out{m_file_name, std::ios::binary};
+    out.write(content.c_str(), content.size());
+  }
+
+  std::vector<std::pair<int64_t, int64_t>> get_all(timestamp_factory_c &factory,
+                                                   size_t num_frames) {
+    auto result = std::vector<std::pair<int64_t, int64_t>>{};
+
+    for (auto idx = 0u; idx < num_frames; ++idx) {
+      auto packet = std::make_shared<packet_t>();
+      factory.get_next(packet);
+      result.emplace_back(packet->assigned_timecode, packet->duration);
+    }
+
+    return result;
+  }
+};
+
+TEST_F(TimestampFactory, V2) {
+  create_file("# timecode format v2\r\n"
+              "# comment\r\n"
+              "\r\n"
+              "0\r\n"
+              "  40 \r\n"
+              "80.5\r"
+              "1.2e2\n"
+              "+160\n"
+              "200.5");
+
+  auto factory  = timestamp_factory_c::create(m_file_name, "", 0);
+  auto expected = std::vector<std::pair<int64_t, int64_t>>{
+    {         0, 40000000 },
+    {  40000000, 40500000 },
+    {  80500000, 39500000 },
+    { 120000000, 40000000 },
+    { 160000000, 40500000 },
+    { 200500000, 40000000 },
+  };
+
+  EXPECT_EQ(expected, get_all(*factory, expected.size()));
+  EXPECT_EQ(40000000.0, factory->get_default_duration(1.0));
+}
+
+TEST_F(TimestampFactory, V4Unsorted) {
+  create_file("# timecode format v4\n0\n120\n40\n80\n");
+
+  auto factory  = timestamp_factory_c::create(m_file_name, "", 0);
+  auto expected = std::vector<std::pair<int64_t, int64_t>>{
+    {         0, 120000000 },
+    { 120000000, -80000000 },
+    {  40000000,  40000000 },
+    {  80000000,  40000000 },
+  };
+
+  EXPECT_EQ(expected, get_all(*factory, expected.size()));
+}
+
+TEST_F(TimestampFactory, LinesCrossingChunks) {
+  auto const num_frames = 300000u;
+  auto content          = std::string{"# timecode format v2\n"};
+  auto expected         = std::vector<int64_t>{};
+
+  for (auto frame = 0u; frame < num_frames; ++frame) {
+    auto timecode = (boost::format("%1%.%|2$03d|") % (frame * 1001 / 24) % (frame * 1001 % 24 * 1000 / 24)).str();
+    content      += timecode + (frame % 2 ? "\r\n" : "\r");
+    expected.push_back(static_cast<int64_t>(std::stod(timecode) * 1000000));
+  }
+
+  create_file(content);
+
+  auto factory = timestamp_factory_c::create(m_file_name, "", 0);
+  auto frames  = get_all(*factory, num_frames);
+
+  for (auto frame = 0u; frame < num_frames; ++frame) {
+    ASSERT_EQ(expected[frame], frames[frame].first);
+    if (frame)
+      ASSERT_EQ(frames[frame - 1].first + frames[frame - 1].second, frames[frame].first);
+  }
+}
+
+TEST_F(TimestampFactory, NotMapped) {
+  auto content = std::string{"100\n150\n200\n"};
+  mm_text_io_c in{new mm_mem_io_c(reinterpret_cast<unsigned char const *>(content.c_str()), content.size())};
+  timestamp_factory_v2_c factory{"", "", 0, 2};
+
+  factory.parse(in);
+
+  auto expected = std::vector<std::pair<int64_t, int64_t>>{
+    { 100000000, 50000000 },
+    { 150000000, 50000000 },
+    { 200000000, 50000000 },
+  };
+
+  EXPECT_EQ(expected, get_all(factory, expected.size()));
+}
+
+// Benchmark parsing a timecode file for 10 hours of 60 fps video. Run
+// with --gtest_also_run_disabled_tests.
+TEST_F(TimestampFactory, DISABLED_TenHours) {
+  auto const num_frames = 10u * 3600 * 60;
+
+  {
+    std::ofstream out{m_file_name, std::ios::binary};
+    out << "# timecode format v2\n";
+    for (auto frame = 0u; frame < num_frames; ++frame)
+      out << boost::format("%|1$.6f|\n") % (frame * 1000.0 / 60);
+  }
+
+  auto start    = std::chrono::steady_clock::now();
+  auto factory  = timestamp_factory_c::create(m_file_name, "", 0);
+  auto parsed   = std::chrono::steady_clock::now();
+  auto checksum = int64_t{};
+  auto packet   = std::make_shared<packet_t>();
+
+  for (auto frame = 0u; frame < num_frames; ++frame) {
+    factory->get_next(packet);
+    checksum += packet->duration;
+  }
+
+  auto end = std::chrono::steady_clock::now();
+
+  std::cout << boost::format("[ BENCH    ] %1% timecodes: parsing %|2$.2f|s, get_next() %|3$.2f|s (checksum %4%)\n")
+    % num_frames
+    % std::chrono::duration<double>(parsed - start).count()
+    % std::chrono::duration<double>(end - parsed).count()
+    % checksum;
+}
+
+}